@@ -1862,8 +1862,9 @@ duk_ret_t ILibDuktape_MeshAgent_coreHash(duk_context *ctx)
 	duk_push_this(ctx);																		// [MeshAgent]
 	agent = (MeshAgentHostContainer*)Duktape_GetPointerProperty(ctx, -1, MESH_AGENT_PTR);
 
-	char *hashref = ILibSimpleDataStore_GetHash(agent->masterDb, "CoreModule");				// Get the reference to the SHA384 hash for the currently running code
-	util_tohex(hashref, ILibSimpleDataStore_GetHashSize(), ILibScratchPad);
+	char hash[UTIL_SHA384_HASHSIZE];
+	if (ILibSimpleDataStore_GetHashCopy(agent->masterDb, "CoreModule", hash) == 0) { return(0); }	// Get the SHA384 hash for the currently running code
+	util_tohex(hash, ILibSimpleDataStore_GetHashSize(), ILibScratchPad);
 	duk_push_string(ctx, ILibScratchPad);
 	return(1);
 }
@@ -3147,8 +3148,8 @@ void MeshServer_ProcessCommand(ILibWebClient_StateObject WebStateObject, MeshAge
 
 			if (cmdLen > sizeof(MeshCommand_BinaryPacket_CoreModule)) // Setup a new mesh core. 
 			{
-				char *hashref = ILibSimpleDataStore_GetHash(agent->masterDb, "CoreModule"); // Get the reference to the SHA384 hash for the currently running code
-				if (hashref == NULL || memcmp(hashref, cm->coreModuleHash, sizeof(cm->coreModuleHash)) != 0) 
+				char hash[UTIL_SHA384_HASHSIZE];
+				if (ILibSimpleDataStore_GetHashCopy(agent->masterDb, "CoreModule", hash) == 0 || memcmp(hash, cm->coreModuleHash, sizeof(cm->coreModuleHash)) != 0) // Get the SHA384 hash for the currently running code
 				{					
 					agent->coreTimeout = NULL; // Setting this to null becuase we're going to stop the core. If we stop the core, this timeout will cleanup by itself.
 					if (command == MeshCommand_CompressedCoreModule)
@@ -3180,8 +3181,7 @@ void MeshServer_ProcessCommand(ILibWebClient_StateObject WebStateObject, MeshAge
 					// If server sends us the same core, just do nothing.
 					// Server sent us a new core, start by storing it in the data store
 					ILibSimpleDataStore_PutCompressed(agent->masterDb, "CoreModule", 10, coremodule, (int)coremoduleLen);	// Store the JavaScript in the data store
-					hashref = ILibSimpleDataStore_GetHash(agent->masterDb, "CoreModule");					// Get the reference to the SHA384 hash
-					if (memcmp(hashref, cm->coreModuleHash, sizeof(cm->coreModuleHash)) != 0) 
+					if (ILibSimpleDataStore_GetHashCopy(agent->masterDb, "CoreModule", hash) == 0 || memcmp(hash, cm->coreModuleHash, sizeof(cm->coreModuleHash)) != 0) 
 					{																						// Check the hash for sanity
 																											// Something went wrong, clear the data store
 						ILibSimpleDataStore_Delete(agent->masterDb, "CoreModule");
@@ -3211,15 +3211,15 @@ void MeshServer_ProcessCommand(ILibWebClient_StateObject WebStateObject, MeshAge
 						// TODO: Ylian: New Java Core threw an exception... Exception String is stored in 'coreException'
 					}
 
-					// Since we did a big write to the data store, good time to compact the store
-					ILibSimpleDataStore_Compact(agent->masterDb);
+					// Since we did a big write to the data store, good time to compact the store. Done a slice at a time, so the chain isn't blocked
+					ILibSimpleDataStore_CompactInBackground(agent->masterDb, agent->chain, 0, NULL, NULL);
 				}
 
 				// Create the server confirmation message that we are running the new core
 				MeshCommand_BinaryPacket_CoreModule *rcm = (MeshCommand_BinaryPacket_CoreModule*)ILibScratchPad2;
 				((unsigned short*)ILibScratchPad2)[0] = htons(MeshCommand_CoreModuleHash);					// MeshCommand_CoreModuleHash (11), SHA384 hash of the code module
 				((unsigned short*)ILibScratchPad2)[1] = htons(requestid);									// Request id
-				memcpy_s(ILibScratchPad2 + 4, sizeof(ILibScratchPad2) - 4, hashref, UTIL_SHA384_HASHSIZE);			// SHA384 hash
+				memcpy_s(ILibScratchPad2 + 4, sizeof(ILibScratchPad2) - 4, hash, UTIL_SHA384_HASHSIZE);			// SHA384 hash
 
 				// Send the confirmation to the server
 				ILibWebClient_WebSocket_Send(WebStateObject, ILibWebClient_WebSocket_DataType_BINARY, (char*)rcm, sizeof(MeshCommand_BinaryPacket_CoreModule), ILibAsyncSocket_MemoryOwnership_USER, ILibWebClient_WebSocket_FragmentFlag_Complete);
@@ -3245,7 +3245,8 @@ void MeshServer_ProcessCommand(ILibWebClient_StateObject WebStateObject, MeshAge
 		case MeshCommand_CoreModuleHash: // Request/return the SHA384 hash of the core module
 		{
 			// Tell the server what core module we are running
-			char *hashref = ILibSimpleDataStore_GetHash(agent->masterDb, "CoreModule");						// Get the reference to the SHA384 hash
+			char hash[UTIL_SHA384_HASHSIZE];
+			int hashLen = ILibSimpleDataStore_GetHashCopy(agent->masterDb, "CoreModule", hash);			// Get the SHA384 hash
 			int len = agent->localScript == 0 ? 4 : (int)sizeof(MeshCommand_BinaryPacket_CoreModule);
 
 			// Confirm to the server what core we are running
@@ -3253,7 +3254,7 @@ void MeshServer_ProcessCommand(ILibWebClient_StateObject WebStateObject, MeshAge
 			memset(rcm, 0, sizeof(MeshCommand_BinaryPacket_CoreModule));
 			rcm->command = htons(MeshCommand_CoreModuleHash);										// MeshCommand_CoreModuleHash (11), SHA384 hash of the code module
 			rcm->request = htons(requestid);														// Request id
-			if (agent->localScript == 0 && hashref != NULL) { memcpy_s(rcm->coreModuleHash, sizeof(rcm->coreModuleHash), hashref, UTIL_SHA384_HASHSIZE); len = sizeof(MeshCommand_BinaryPacket_CoreModule); }
+			if (agent->localScript == 0 && hashLen != 0) { memcpy_s(rcm->coreModuleHash, sizeof(rcm->coreModuleHash), hash, UTIL_SHA384_HASHSIZE); len = sizeof(MeshCommand_BinaryPacket_CoreModule); }
 
 			// Send the confirmation to the server
 			ILibWebClient_WebSocket_Send(WebStateObject, ILibWebClient_WebSocket_DataType_BINARY, (char*)rcm, len, ILibAsyncSocket_MemoryOwnership_USER, ILibWebClient_WebSocket_FragmentFlag_Complete);
@@ -4137,7 +4138,7 @@ void MeshServer_ConnectEx(MeshAgentHostContainer *agent)
 		printf("Connecting %sto: %s\n", useproxy!=0?"(via proxy) ":"", agent->serveruri);
 		if (agent->logUpdate != 0 || agent->controlChannelDebug != 0) { ILIBLOGMESSAGEX("Connecting %sto: %s", useproxy != 0 ? "(via proxy) " : "", agent->serveruri); }
 
-		ILibWebClient_AddWebSocketRequestHeaders(req, 65535, MeshServer_OnSendOK);
+		ILibWebClient_AddWebSocketRequestHeadersEx(req, 65535, MeshServer_OnSendOK, ILibSimpleDataStore_Get(agent->masterDb, "noControlChannelCompression", NULL, 0) == 0 ? ILibWebClient_WebSocket_DeflateFlag_ENABLED : ILibWebClient_WebSocket_DeflateFlag_NONE);
 
 		void **tmp = ILibMemory_SmartAllocate(2 * sizeof(void*));
 		agent->controlChannelRequest = tmp;
@@ -4425,6 +4426,7 @@ int importSettings(MeshAgentHostContainer *agent, char* fileName)
 
 	pr = ILibParseString(importFile, 0, importFileLen, "\n", 1);
 	f = pr->FirstResult;
+	ILibSimpleDataStore_BatchBegin(agent->masterDb);	// Write all the imported settings together
 	while (f != NULL)
 	{
 		f->datalength = ILibTrimString(&(f->data), f->datalength);
@@ -4471,6 +4473,7 @@ int importSettings(MeshAgentHostContainer *agent, char* fileName)
 		}
 		f = f->NextResult;
 	}
+	ILibSimpleDataStore_BatchCommitEx(agent->masterDb, 1);
 	ILibDestructParserResults(pr);
 	free(importFile);
 
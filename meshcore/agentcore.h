@@ -283,6 +283,7 @@ controlChannelDebug:		If set, will log/display controlChannel messages (Except f
 controlChannelIdleTimeout:  Integer value specifying the idle timeout in seconds, to send Ping/Pong to server, to keep connection alive
 coreDumpEnabled:			If set, a dump file will be written when the agent crashes
 disableUpdate:				If set, will prevent the agent from self-updating
+noControlChannelCompression:	If set, the agent will not offer permessage-deflate on the control channel
 noUpdateCoreModule:			If set, will prevent the agent from taking a new meshcore from the server
 enableILibRemoteLogging:	Integer value specifying the port number to enable Web Logging. Disabled otherwise
 fakeUpdate:					If set, when the agent self-updates, it will update to the same version. Will set disableUpdate upon completion
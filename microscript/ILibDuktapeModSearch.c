@@ -202,6 +202,18 @@ int ILibDuktape_ModSearch_AddHandler(duk_context *ctx, char *id, ILibDuktape_Mod
 	return(0);
 }
 
+// Load the source of a module from the data store. The source is decoded once, and shared by every script engine using the data store,
+// until it is released with ILibSimpleDataStore_ReleaseDecoded(). Modules with the same source share one decoded copy. Returns NULL if the module isn't in the data store
+char* ILibDuktape_ModSearch_LoadModule(ILibSimpleDataStore ds, char *id, size_t idLen, size_t *sourceLen)
+{
+	char moduleKey[255];
+	int moduleKeyLen;
+
+	if (ds == NULL || idLen > sizeof(moduleKey) - sizeof(ILibDuktape_ModSearch_ModuleKeyPrefix)) { return(NULL); }
+	moduleKeyLen = sprintf_s(moduleKey, sizeof(moduleKey), "%s%.*s", ILibDuktape_ModSearch_ModuleKeyPrefix, (int)idLen, id);
+	return(ILibSimpleDataStore_GetDecodedEx(ds, moduleKey, (size_t)moduleKeyLen, sourceLen));
+}
+
 duk_ret_t mod_Search_Files(duk_context *ctx, char* id)
 {
 	char fileName[255];
@@ -316,18 +328,13 @@ duk_ret_t mod_Search(duk_context *ctx)
 		else
 		{
 			// Next Check the database
-			char key[255];
-			int keyLen;
 			char *value;
-			int valueLen;
+			size_t valueLen;
 
-			keyLen = sprintf_s(key, sizeof(key), "__MODULE:%s", id);
-			valueLen = ILibSimpleDataStore_GetEx(mDS, key, keyLen, NULL, 0);
-			if (valueLen > 0)
+			if ((value = ILibDuktape_ModSearch_LoadModule(mDS, id, idLen, &valueLen)) != NULL)
 			{
-				value = ILibMemory_Allocate(valueLen, 0, NULL, NULL);
-				ILibSimpleDataStore_GetEx(mDS, key, keyLen, value, valueLen);
 				duk_push_lstring(ctx, value, valueLen);
+				ILibSimpleDataStore_ReleaseDecoded(mDS, value);
 				return 1;
 			}
 			else
@@ -369,6 +376,7 @@ void ILibDuktape_ModSearch_Init(duk_context * ctx, void * chain, ILibSimpleDataS
 	{
 		duk_push_pointer(ctx, mDB);					// [globalString][func][DB]
 		duk_put_prop_string(ctx, -2, "SimpleDS");	// [globalString][func]
+		ILibSimpleDataStore_ConfigDecodedCache(mDB, ILibDuktape_ModSearch_SourceCacheSize);
 	}
 
 	duk_put_prop_string(ctx, -2, "modSearch");	// [globalString]
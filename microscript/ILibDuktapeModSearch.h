@@ -32,4 +32,11 @@ uint32_t ILibDuktape_ModSearch_GetJSModuleDate(duk_context *ctx, char *id);
 int ILibDuktape_ModSearch_IsRequired(duk_context *ctx, char *id, size_t idLen);
 void ILibDuktape_ModSearch_Init(duk_context *ctx, void *chain, ILibSimpleDataStore mDB);
 
+// Modules stored in the data store, as compressed __MODULE:<id> keys. The decoded source is cached in memory for every script engine that uses
+// the data store, and modules with the same source share one copy. Release a loaded source with ILibSimpleDataStore_ReleaseDecoded()
+#define ILibDuktape_ModSearch_ModuleKeyPrefix	"__MODULE:"
+#define ILibDuktape_ModSearch_SourceCacheSize	4194304
+#define ILibDuktape_ModSearch_IsModuleKey(key, keyLen) ((keyLen) > sizeof(ILibDuktape_ModSearch_ModuleKeyPrefix) - 1 && memcmp(key, ILibDuktape_ModSearch_ModuleKeyPrefix, sizeof(ILibDuktape_ModSearch_ModuleKeyPrefix) - 1) == 0)
+char* ILibDuktape_ModSearch_LoadModule(ILibSimpleDataStore ds, char *id, size_t idLen, size_t *sourceLen);
+
 #endif
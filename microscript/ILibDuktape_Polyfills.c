@@ -2751,6 +2751,13 @@ duk_ret_t ILibDuktape_ChainViewer_getTimerInfo(duk_context *ctx)
 	ILibMemory_Free(v);
 	return(1);
 }
+duk_ret_t ILibDuktape_ChainViewer_getTransportMetrics(duk_context *ctx)
+{
+	char *v = ILibChain_GetMetadataForTransports(duk_ctx_chain(ctx));
+	duk_push_string(ctx, v);
+	ILibMemory_Free(v);
+	return(1);
+}
 void ILibDuktape_ChainViewer_Push(duk_context *ctx, void *chain)
 {
 	duk_push_object(ctx);													// [viewer]
@@ -2764,6 +2771,7 @@ void ILibDuktape_ChainViewer_Push(duk_context *ctx, void *chain)
 	ILibDuktape_EventEmitter_CreateEventEx(emitter, "PostSelect");
 	ILibDuktape_CreateInstanceMethod(ctx, "getSnapshot", ILibDuktape_ChainViewer_getSnapshot, 0);
 	ILibDuktape_CreateInstanceMethod(ctx, "getTimerInfo", ILibDuktape_ChainViewer_getTimerInfo, 0);
+	ILibDuktape_CreateInstanceMethod(ctx, "getTransportMetrics", ILibDuktape_ChainViewer_getTransportMetrics, 0);
 	duk_push_array(ctx); duk_put_prop_string(ctx, -2, ILibDuktape_ChainViewer_PromiseList);
 	ILibPrependToChain(chain, (void*)t);
 
@@ -73,7 +73,7 @@ duk_ret_t ILibDuktape_SimpleDataStore_Put(duk_context *ctx)
 	}
 
 	duk_push_current_function(ctx);									// [func]
-	if (Duktape_GetBooleanProperty(ctx, -1, "compressed", 0) == 0)
+	if (Duktape_GetBooleanProperty(ctx, -1, "compressed", 0) == 0 && (cguid != NULL || !ILibDuktape_ModSearch_IsModuleKey(key, keyLen)))	// Module sources are always stored compressed
 	{
 		duk_push_int(ctx, ILibSimpleDataStore_PutEx(dataStore, key, (int)keyLen, value, (int)valueLen));		// [ds][ptr][retVal]
 	}
@@ -89,9 +89,8 @@ duk_ret_t ILibDuktape_SimpleDataStore_GetRaw(duk_context *ctx)
 	char *cguid = NULL;
 	char *key = (char*)duk_require_string(ctx, 0);
 	ILibSimpleDataStore dataStore;
-	char *buffer;
+	char *buffer, *value;
 	int bufferSize;
-	int written;
 
 	duk_push_this(ctx);														// [ds]
 	duk_get_prop_string(ctx, -1, ILibDuktape_DataStore_PTR);				// [ds][ptr]
@@ -104,25 +103,19 @@ duk_ret_t ILibDuktape_SimpleDataStore_GetRaw(duk_context *ctx)
 		key = ILibScratchPad2;
 	}
 
-	bufferSize = ILibSimpleDataStore_Get(dataStore, key, NULL, 0);
-	if (bufferSize == 0)
+	// The value is copied while the data store is locked, as another thread's write can move or unmap it
+	if ((value = ILibSimpleDataStore_GetCopyEx(dataStore, key, strnlen_s(key, ILibSimpleDataStore_MaxKeyLength))) == NULL)
 	{
 		duk_push_null(ctx);
 		return 1;
 	}
 
+	bufferSize = (int)ILibMemory_Size(value);
 	duk_push_fixed_buffer(ctx, bufferSize);									// [ds][ptr][buffer]
 	buffer = Duktape_GetBuffer(ctx, -1, NULL);
-	written = ILibSimpleDataStore_Get(dataStore, key, buffer, bufferSize);
-	if (written != bufferSize)
-	{
-		duk_push_null(ctx);													// [ds][ptr][buffer][null]
-	}
-	else
-	{
-		duk_push_buffer_object(ctx, -1, 0, bufferSize, DUK_BUFOBJ_NODEJS_BUFFER);
-	}
-
+	memcpy_s(buffer, bufferSize, value, bufferSize);
+	ILibMemory_Free(value);
+	duk_push_buffer_object(ctx, -1, 0, bufferSize, DUK_BUFOBJ_NODEJS_BUFFER);
 	return 1;
 }
 duk_ret_t ILibDuktape_SimpleDataStore_Get(duk_context *ctx)
@@ -146,6 +139,49 @@ duk_ret_t ILibDuktape_SimpleDataStore_Compact(duk_context *ctx)
 	duk_push_int(ctx, ILibSimpleDataStore_Compact(dataStore));				// [ds][ptr][retVal]
 	return 1;
 }
+duk_ret_t ILibDuktape_SimpleDataStore_BeginBatch(duk_context *ctx)
+{
+	ILibSimpleDataStore dataStore;
+
+	duk_push_this(ctx);														// [ds]
+	duk_get_prop_string(ctx, -1, ILibDuktape_DataStore_PTR);				// [ds][ptr]
+	dataStore = (ILibSimpleDataStore)duk_to_pointer(ctx, -1);
+	duk_push_int(ctx, ILibSimpleDataStore_BatchBegin(dataStore));			// [ds][ptr][retVal]
+	return 1;
+}
+duk_ret_t ILibDuktape_SimpleDataStore_CommitBatch(duk_context *ctx)
+{
+	ILibSimpleDataStore dataStore;
+	int durable = duk_get_top(ctx) > 0 ? (duk_to_boolean(ctx, 0) ? 1 : 0) : 0;
+
+	duk_push_this(ctx);														// [ds]
+	duk_get_prop_string(ctx, -1, ILibDuktape_DataStore_PTR);				// [ds][ptr]
+	dataStore = (ILibSimpleDataStore)duk_to_pointer(ctx, -1);
+	duk_push_int(ctx, ILibSimpleDataStore_BatchCommitEx(dataStore, durable));	// [ds][ptr][retVal]
+	return 1;
+}
+duk_ret_t ILibDuktape_SimpleDataStore_ConfigWriteBack(duk_context *ctx)
+{
+	ILibSimpleDataStore dataStore;
+	int flushInterval = duk_require_int(ctx, 0);
+	duk_uint_t flushThreshold = duk_get_top(ctx) > 1 ? duk_require_uint(ctx, 1) : 0;
+
+	duk_push_this(ctx);														// [ds]
+	duk_get_prop_string(ctx, -1, ILibDuktape_DataStore_PTR);				// [ds][ptr]
+	dataStore = (ILibSimpleDataStore)duk_to_pointer(ctx, -1);
+	duk_push_int(ctx, ILibSimpleDataStore_ConfigWriteBack(dataStore, Duktape_GetChain(ctx), flushInterval, (size_t)flushThreshold));	// [ds][ptr][retVal]
+	return 1;
+}
+duk_ret_t ILibDuktape_SimpleDataStore_Flush(duk_context *ctx)
+{
+	ILibSimpleDataStore dataStore;
+
+	duk_push_this(ctx);														// [ds]
+	duk_get_prop_string(ctx, -1, ILibDuktape_DataStore_PTR);				// [ds][ptr]
+	dataStore = (ILibSimpleDataStore)duk_to_pointer(ctx, -1);
+	duk_push_int(ctx, ILibSimpleDataStore_Flush(dataStore));				// [ds][ptr][retVal]
+	return 1;
+}
 void ILibDuktape_SimpleDataStore_Keys_EnumerationSink(ILibSimpleDataStore sender, char* Key, int KeyLen, void *user)
 {
 	ILibDuktape_SimpleDataStore_Enumerator * en = (ILibDuktape_SimpleDataStore_Enumerator*)user;
@@ -162,31 +198,101 @@ void ILibDuktape_SimpleDataStore_Keys_EnumerationSink(ILibSimpleDataStore sender
 		duk_put_prop_index(en->ctx, -2, en->count++);
 	}
 }
-duk_ret_t ILibDuktape_SimpleDataStore_Keys(duk_context *ctx)
+// Find the key namespace of the calling context, if it has one. The prefix is pushed on the stack
+ILibSimpleDataStore ILibDuktape_SimpleDataStore_InitEnumerator(duk_context *ctx, ILibDuktape_SimpleDataStore_Enumerator *enumerator)
 {
 	ILibSimpleDataStore ds;
-	ILibDuktape_SimpleDataStore_Enumerator enumerator;
-	memset(&enumerator, 0, sizeof(ILibDuktape_SimpleDataStore_Enumerator));
+	memset(enumerator, 0, sizeof(ILibDuktape_SimpleDataStore_Enumerator));
 
 	duk_push_this(ctx);																				// [DataStore]
 	duk_get_prop_string(ctx, -1, ILibDuktape_DataStore_PTR);										// [DataStore][ptr]
 	ds = (ILibSimpleDataStore)duk_get_pointer(ctx, -1);
 
-	enumerator.ctx = ctx;
-	enumerator.count = 0;
-	enumerator.GuidHex = Duktape_GetContextGuidHex(ctx, ds);
-	if (enumerator.GuidHex != NULL) 
+	enumerator->ctx = ctx;
+	enumerator->count = 0;
+	enumerator->GuidHex = Duktape_GetContextGuidHex(ctx, ds);
+	if (enumerator->GuidHex != NULL) 
 	{ 
-		enumerator.GuidHexLen = 1 + (int)strnlen_s(enumerator.GuidHex, sizeof(ILibScratchPad)); 
-		char *tmp = Duktape_PushBuffer(ctx, enumerator.GuidHexLen + 1);
-		memcpy_s(tmp, ILibMemory_Size(tmp), enumerator.GuidHex, enumerator.GuidHexLen - 1);
-		tmp[enumerator.GuidHexLen - 1] = '/';
-		tmp[enumerator.GuidHexLen] = 0;
-		enumerator.GuidHex = tmp;
+		enumerator->GuidHexLen = 1 + (int)strnlen_s(enumerator->GuidHex, sizeof(ILibScratchPad)); 
+		char *tmp = Duktape_PushBuffer(ctx, enumerator->GuidHexLen + 1);
+		memcpy_s(tmp, ILibMemory_Size(tmp), enumerator->GuidHex, enumerator->GuidHexLen - 1);
+		tmp[enumerator->GuidHexLen - 1] = '/';
+		tmp[enumerator->GuidHexLen] = 0;
+		enumerator->GuidHex = tmp;
 	}
+	return(ds);
+}
+
+// Prepend the context's key namespace to a key. If a new buffer is needed, it is pushed on the stack
+char* ILibDuktape_SimpleDataStore_ContextKey(duk_context *ctx, ILibDuktape_SimpleDataStore_Enumerator *enumerator, char *key, duk_size_t keyLen, duk_size_t *len)
+{
+	char *ret;
+
+	if (enumerator->GuidHex == NULL) { *len = keyLen; return(key); }
+	ret = Duktape_PushBuffer(ctx, enumerator->GuidHexLen + keyLen);
+	memcpy_s(ret, ILibMemory_Size(ret), enumerator->GuidHex, enumerator->GuidHexLen);
+	if (keyLen > 0) { memcpy_s(ret + enumerator->GuidHexLen, ILibMemory_Size(ret) - enumerator->GuidHexLen, key, keyLen); }
+	*len = enumerator->GuidHexLen + keyLen;
+	return(ret);
+}
+duk_ret_t ILibDuktape_SimpleDataStore_Keys(duk_context *ctx)
+{
+	ILibDuktape_SimpleDataStore_Enumerator enumerator;
+	ILibSimpleDataStore ds = ILibDuktape_SimpleDataStore_InitEnumerator(ctx, &enumerator);
 
 	duk_push_array(ctx);																			// [DataStore][ptr][retVal]
-	ILibSimpleDataStore_EnumerateKeys(ds, ILibDuktape_SimpleDataStore_Keys_EnumerationSink, &enumerator);
+	if (enumerator.GuidHex != NULL)
+	{
+		ILibSimpleDataStore_EnumeratePrefix(ds, enumerator.GuidHex, enumerator.GuidHexLen, ILibDuktape_SimpleDataStore_Keys_EnumerationSink, &enumerator);
+	}
+	else
+	{
+		ILibSimpleDataStore_EnumerateKeys(ds, ILibDuktape_SimpleDataStore_Keys_EnumerationSink, &enumerator);
+	}
+	return 1;
+}
+duk_ret_t ILibDuktape_SimpleDataStore_KeysWithPrefix(duk_context *ctx)
+{
+	ILibDuktape_SimpleDataStore_Enumerator enumerator;
+	ILibSimpleDataStore ds;
+	duk_size_t prefixLen;
+	char *prefix;
+
+	if (!duk_is_string(ctx, 0)) { return(ILibDuktape_Error(ctx, "SimpleDataStore.KeysWithPrefix(): 'prefix' invalid parameter")); }
+	prefix = (char*)duk_get_lstring(ctx, 0, &prefixLen);
+	ds = ILibDuktape_SimpleDataStore_InitEnumerator(ctx, &enumerator);
+	prefix = ILibDuktape_SimpleDataStore_ContextKey(ctx, &enumerator, prefix, prefixLen, &prefixLen);
+
+	duk_push_array(ctx);
+	ILibSimpleDataStore_EnumeratePrefix(ds, prefix, prefixLen, ILibDuktape_SimpleDataStore_Keys_EnumerationSink, &enumerator);
+	return 1;
+}
+duk_ret_t ILibDuktape_SimpleDataStore_KeysInRange(duk_context *ctx)
+{
+	ILibDuktape_SimpleDataStore_Enumerator enumerator;
+	ILibSimpleDataStore ds;
+	duk_size_t startLen, endLen = 0;
+	char *start, *end = NULL;
+
+	if (!duk_is_string(ctx, 0)) { return(ILibDuktape_Error(ctx, "SimpleDataStore.KeysInRange(): 'start' invalid parameter")); }
+	start = (char*)duk_get_lstring(ctx, 0, &startLen);
+	if (duk_is_string(ctx, 1)) { end = (char*)duk_get_lstring(ctx, 1, &endLen); }
+	ds = ILibDuktape_SimpleDataStore_InitEnumerator(ctx, &enumerator);
+
+	start = ILibDuktape_SimpleDataStore_ContextKey(ctx, &enumerator, start, startLen, &startLen);
+	if (end != NULL)
+	{
+		end = ILibDuktape_SimpleDataStore_ContextKey(ctx, &enumerator, end, endLen, &endLen);
+	}
+	else if (enumerator.GuidHex != NULL)
+	{
+		// Stop at the end of this context's namespace, '0' is the character after '/'
+		end = ILibDuktape_SimpleDataStore_ContextKey(ctx, &enumerator, NULL, 0, &endLen);
+		end[endLen - 1] = '0';
+	}
+
+	duk_push_array(ctx);
+	ILibSimpleDataStore_EnumerateRange(ds, start, startLen, end, endLen, ILibDuktape_SimpleDataStore_Keys_EnumerationSink, &enumerator);
 	return 1;
 }
 duk_ret_t ILibDuktape_SimpleDataStore_Delete(duk_context *ctx)
@@ -206,6 +312,7 @@ duk_ret_t ILibDuktape_SimpleDataStore_Create(duk_context *ctx)
 	char *filePath;
 	int nargs = duk_get_top(ctx);
 	int rdonly = (nargs > 1 && duk_is_object(ctx, 1)) ? Duktape_GetIntPropertyValue(ctx, 1, "readOnly", 0) : 0;
+	char *checksum = (nargs > 1 && duk_is_object(ctx, 1)) ? Duktape_GetStringPropertyValue(ctx, 1, "checksum", "sha384") : "sha384";
 
 	duk_push_this(ctx);										// [DataStore]
 	duk_push_object(ctx);									// [DataStore][RetVal]
@@ -230,6 +337,7 @@ duk_ret_t ILibDuktape_SimpleDataStore_Create(duk_context *ctx)
 	{
 		filePath = (char*)duk_require_string(ctx, 0);
 		dataStore = ILibSimpleDataStore_CreateEx2(filePath, 0, rdonly);
+		if (dataStore != NULL && strcmp(checksum, "crc32c") == 0) { ILibSimpleDataStore_ConfigRecordFormat(dataStore, ILibSimpleDataStore_RecordFormat_CRC32C); }
 		duk_pop_2(ctx);												// [DataStore][RetVal]
 		ILibDuktape_CreateFinalizer(ctx, ILibDuktape_SimpleDataStore_Finalizer);
 	}
@@ -243,9 +351,15 @@ duk_ret_t ILibDuktape_SimpleDataStore_Create(duk_context *ctx)
 		ILibDuktape_CreateInstanceMethodWithBooleanProperty(ctx, "compressed", 0, "Put", ILibDuktape_SimpleDataStore_Put, 2);
 		ILibDuktape_CreateInstanceMethodWithBooleanProperty(ctx, "compressed", 1, "PutCompressed", ILibDuktape_SimpleDataStore_Put, 2);
 		ILibDuktape_CreateInstanceMethod(ctx, "Compact", ILibDuktape_SimpleDataStore_Compact, 0);
+		ILibDuktape_CreateInstanceMethod(ctx, "BeginBatch", ILibDuktape_SimpleDataStore_BeginBatch, 0);
+		ILibDuktape_CreateInstanceMethod(ctx, "CommitBatch", ILibDuktape_SimpleDataStore_CommitBatch, DUK_VARARGS);
+		ILibDuktape_CreateInstanceMethod(ctx, "ConfigWriteBack", ILibDuktape_SimpleDataStore_ConfigWriteBack, DUK_VARARGS);
+		ILibDuktape_CreateInstanceMethod(ctx, "Flush", ILibDuktape_SimpleDataStore_Flush, 0);
 	}
 	ILibDuktape_CreateInstanceMethod(ctx, "Get", ILibDuktape_SimpleDataStore_Get, DUK_VARARGS);
 	ILibDuktape_CreateInstanceMethod(ctx, "GetBuffer", ILibDuktape_SimpleDataStore_GetRaw, DUK_VARARGS);
+	ILibDuktape_CreateInstanceMethod(ctx, "KeysWithPrefix", ILibDuktape_SimpleDataStore_KeysWithPrefix, 1);
+	ILibDuktape_CreateInstanceMethod(ctx, "KeysInRange", ILibDuktape_SimpleDataStore_KeysInRange, DUK_VARARGS);
 	ILibDuktape_CreateEventWithGetter(ctx, "Keys", ILibDuktape_SimpleDataStore_Keys);
 
 	return 1;
@@ -335,10 +449,46 @@ public:
 	*/
 	void Compact();
 	/*!
+	\brief Stages subsequent Put/Delete calls, until CommitBatch() writes them to disk together. Staged values are not returned by Get() until committed.
+	\return 0 on success, non-zero if a batch is already open or the SimpleDataStore is not writable
+	*/
+	Integer BeginBatch();
+	/*!
+	\brief Writes all the Put/Delete calls staged since BeginBatch() with a single write
+	\param durable <b>Optional</b> \<boolean\> If true, the file is also synced to disk
+	\return 0 on success
+	*/
+	Integer CommitBatch([durable]);
+	/*!
+	\brief Holds Put values in memory, so repeated puts to the same key are written as one record when they are flushed
+	\param flushInterval \<Integer\> Milliseconds a value can be held before it is written, 0 for no timer
+	\param flushThreshold <b>Optional</b> \<Integer\> Bytes of held values that cause them to be written, 0 (default) for no limit. If both are 0, the held values are written and Put goes back to writing directly.
+	\return 0 on success
+	*/
+	Integer ConfigWriteBack(flushInterval[, flushThreshold]);
+	/*!
+	\brief Writes the values held by ConfigWriteBack() with a single write. Held values are also written by Compact() and when the SimpleDataStore is closed.
+	\return 0 on success
+	*/
+	Integer Flush();
+	/*!
 	\brief Enumerates all the keys in the SimpleDataStore instance
-	\return Array<String> of all the valid keys.
+	\return Array<String> of all the valid keys, in sorted order.
 	*/
 	Array<String> Keys;
+	/*!
+	\brief Enumerates the keys that begin with the given prefix, without visiting the other keys
+	\param prefix \<String\> Prefix to match
+	\return Array<String> of the matching keys, in sorted order.
+	*/
+	Array<String> KeysWithPrefix(prefix);
+	/*!
+	\brief Enumerates the keys from 'start', up to but not including 'end'
+	\param start \<String\> First key of the range
+	\param end <b>Optional</b> \<String\> End of the range. If omitted, the range runs to the last key
+	\return Array<String> of the matching keys, in sorted order.
+	*/
+	Array<String> KeysInRange(start[, end]);
 
 
 
@@ -346,8 +496,11 @@ public:
 	/*!
 	\brief Creates a new SimpleDataStore instance, using the specified path
 	\param path \<String\> Path of the datastore to use/create.
+	\param options <b>Optional</b> \<Object\> with the following properties:\n
+	<b>readOnly</b> \<boolean\> Open the datastore read-only\n
+	<b>checksum</b> \<String\> Check value written with new records, 'sha384' (default) or 'crc32c'. Compact() rewrites existing records in this format. Older agents can't read 'crc32c' records.\n
 	*/
-	static SimpleDataStore Create(path);
+	static SimpleDataStore Create(path[, options]);
 	/*!
 	\brief Creates a shared SimpleDataStore instance bound to the datastore created by the JavaScriptEngine (if available)
 	*/
@@ -620,6 +620,47 @@ duk_ret_t ILibduktape_net_socket_bytesWritten(duk_context *ctx)
 	duk_push_int(ctx, (int)ILibAsyncSocket_GetTotalBytesSent(ptrs->socketModule));
 	return 1;
 }
+void ILibDuktape_net_PushStats(duk_context *ctx, ILibAsyncSocket_SocketModule module)
+{
+	ILibTransport_Metrics m;
+	unsigned int rtt, rttvar, cwnd;
+
+	memset(&m, 0, sizeof(ILibTransport_Metrics));
+	if (module != NULL) { ILibAsyncSocket_GetMetrics(module, &m); }
+
+	duk_push_object(ctx);																		// [stats]
+	duk_push_number(ctx, (duk_double_t)m.bytesSent); duk_put_prop_string(ctx, -2, "bytesSent");
+	duk_push_number(ctx, (duk_double_t)m.bytesReceived); duk_put_prop_string(ctx, -2, "bytesReceived");
+	duk_push_number(ctx, (duk_double_t)m.sendCalls); duk_put_prop_string(ctx, -2, "sendCalls");
+	duk_push_number(ctx, (duk_double_t)m.recvCalls); duk_put_prop_string(ctx, -2, "recvCalls");
+	duk_push_number(ctx, (duk_double_t)m.partialWrites); duk_put_prop_string(ctx, -2, "partialWrites");
+	duk_push_number(ctx, (duk_double_t)m.bufferGrowEvents); duk_put_prop_string(ctx, -2, "bufferGrowEvents");
+	duk_push_number(ctx, (duk_double_t)m.pausedMilliseconds); duk_put_prop_string(ctx, -2, "pausedMilliseconds");
+	duk_push_number(ctx, (duk_double_t)m.tlsRecordsSent); duk_put_prop_string(ctx, -2, "tlsRecordsSent");
+	duk_push_number(ctx, (duk_double_t)m.tlsRecordsReceived); duk_put_prop_string(ctx, -2, "tlsRecordsReceived");
+	duk_push_number(ctx, (duk_double_t)m.sendQueueHighWater); duk_put_prop_string(ctx, -2, "sendQueueHighWater");
+	duk_push_number(ctx, (duk_double_t)(module != NULL ? ILibAsyncSocket_GetPendingBytesToSend(module) : 0)); duk_put_prop_string(ctx, -2, "pendingBytesToSend");
+
+	if (module != NULL && ILibAsyncSocket_GetTcpInfo(module, &rtt, &rttvar, &cwnd) == 0)
+	{
+		duk_push_object(ctx);																	// [stats][tcp]
+		duk_push_number(ctx, (duk_double_t)rtt / 1000.0); duk_put_prop_string(ctx, -2, "rtt");
+		duk_push_number(ctx, (duk_double_t)rttvar / 1000.0); duk_put_prop_string(ctx, -2, "rttvar");
+		duk_push_uint(ctx, cwnd); duk_put_prop_string(ctx, -2, "cwnd");
+		duk_put_prop_string(ctx, -2, "tcp");													// [stats]
+	}
+}
+duk_ret_t ILibDuktape_net_socket_stats(duk_context *ctx)
+{
+	ILibDuktape_net_socket *ptrs;
+
+	duk_push_this(ctx);											// [obj]
+	duk_get_prop_string(ctx, -1, ILibDuktape_net_socket_ptr);	// [obj][ptrs]
+	ptrs = (ILibDuktape_net_socket*)duk_to_pointer(ctx, -1);
+
+	ILibDuktape_net_PushStats(ctx, ptrs->socketModule);
+	return(1);
+}
 duk_ret_t ILibDuktape_net_socket_address(duk_context *ctx)
 {
 	ILibDuktape_net_socket *ptrs;
@@ -744,6 +785,7 @@ void ILibDuktape_net_socket_PUSH(duk_context *ctx, ILibAsyncSocket_SocketModule
 
 	ILibDuktape_CreateInstanceMethod(ctx, "address", ILibDuktape_net_socket_address, 0);
 	ILibDuktape_CreateInstanceMethod(ctx, "setTimeout", ILibDuktape_net_socket_setTimeout, DUK_VARARGS);
+	ILibDuktape_CreateInstanceMethod(ctx, "stats", ILibDuktape_net_socket_stats, 0);
 	ILibDuktape_CreateFinalizer(ctx, ILibDuktape_net_socket_finalizer);
 }
 
@@ -831,6 +873,17 @@ void ILibDuktape_net_server_ResumeSink(ILibDuktape_DuplexStream *sender, void *u
 
 	ILibAsyncSocket_Resume(session->connection);
 }
+duk_ret_t ILibDuktape_net_server_socket_stats(duk_context *ctx)
+{
+	ILibDuktape_net_server_session *session;
+
+	duk_push_this(ctx);																// [socket]
+	duk_get_prop_string(ctx, -1, ILibDuktape_net_Server_Session_buffer);			// [socket][buffer]
+	session = (ILibDuktape_net_server_session*)Duktape_GetBuffer(ctx, -1, NULL);
+
+	ILibDuktape_net_PushStats(ctx, session != NULL ? session->connection : NULL);
+	return(1);
+}
 duk_ret_t ILibDuktape_net_server_socket_Finalizer(duk_context *ctx)
 {
 	ILibDuktape_net_server_session *session;
@@ -881,6 +934,7 @@ void ILibDuktape_net_server_OnConnect(ILibAsyncServerSocket_ServerModule AsyncSe
 	duk_push_object(ptr->ctx);																								// [emit][this][connection][socket]
 	ILibDuktape_WriteID(ptr->ctx, isTLS ? "tls.serverSocketConnection" : "net.serverSocketConnection");
 	ILibDuktape_CreateFinalizer(ptr->ctx, ILibDuktape_net_server_socket_Finalizer);
+	ILibDuktape_CreateInstanceMethod(ptr->ctx, "stats", ILibDuktape_net_server_socket_stats, 0);
 	session = Duktape_PushBuffer(ptr->ctx, sizeof(ILibDuktape_net_server_session));											// [emit][this][connection][socket][buffer]
 	duk_put_prop_string(ptr->ctx, -2, ILibDuktape_net_Server_Session_buffer);												// [emit][this][connection][socket]
 
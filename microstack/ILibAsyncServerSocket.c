@@ -14,6 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#if defined(_POSIX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		// accept4()
+#endif
+
 #if defined(WIN32) && !defined(_WIN32_WCE) && !defined(_MINCORE)
 #define _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
@@ -47,7 +51,11 @@ typedef struct ILibAsyncServerSocketModule
 
 	int MaxConnection;
 	void **AsyncSockets;
+	int *FreeSlots;					// Stack of indexes into AsyncSockets, that are available for new connections
+	int FreeSlotCount;
+	ILibSpinLock FreeSlotLock;
 	ILibServerScope scope;
+	int listenFlags;
 
 	SOCKET ListenSocket;
 	unsigned short portNumber, initialPortNumber;
@@ -75,6 +83,7 @@ typedef struct ILibAsyncServerSocket_Data
 	struct ILibAsyncServerSocketModule *module;
 	ILibAsyncServerSocket_BufferReAllocated Callback;
 	void *user;
+	int slot;
 }ILibAsyncServerSocket_Data;
 
 const int ILibMemory_ASYNCSERVERSOCKET_CONTAINERSIZE = (const int)sizeof(ILibAsyncServerSocketModule);
@@ -124,6 +133,43 @@ void ILibAsyncServerSocket_SetTag2(ILibAsyncServerSocket_ServerModule ILibAsyncS
 	((struct ILibAsyncServerSocketModule*)ILibAsyncSocketModule)->Tag2 = tag;
 }
 
+//
+// Returns the connection slot held by this session to the free list. Can be called from any thread.
+//
+void ILibAsyncServerSocket_ReleaseSlot(struct ILibAsyncServerSocket_Data *data)
+{
+	ILibSpinLock_Lock(&(data->module->FreeSlotLock));
+	if (data->slot >= 0)
+	{
+		data->module->FreeSlots[data->module->FreeSlotCount++] = data->slot;
+		data->slot = -1;
+	}
+	ILibSpinLock_UnLock(&(data->module->FreeSlotLock));
+}
+//
+// Takes a connection slot from the free list. Returns -1 if there are none available
+//
+int ILibAsyncServerSocket_AcquireSlot(struct ILibAsyncServerSocketModule *module)
+{
+	int slot = -1;
+	int tries;
+	ILibSpinLock_Lock(&(module->FreeSlotLock));
+	for (tries = module->FreeSlotCount; tries > 0 && slot < 0; --tries)
+	{
+		slot = module->FreeSlots[--module->FreeSlotCount];
+		if (ILibAsyncSocket_IsFree(module->AsyncSockets[slot]) == 0)
+		{
+			// Should never happen. Don't hand out a busy socket, but don't lose the slot either: move it to the bottom of the stack, so it is tried again last
+			memmove(module->FreeSlots + 1, module->FreeSlots, module->FreeSlotCount * sizeof(int));
+			module->FreeSlots[0] = slot;
+			++module->FreeSlotCount;
+			slot = -1;
+		}
+	}
+	ILibSpinLock_UnLock(&(module->FreeSlotLock));
+	return(slot);
+}
+
 //
 // Internal method called by ILibAsyncSocket, to signal an interrupt condition
 //
@@ -136,6 +182,7 @@ void ILibAsyncServerSocket_OnInterruptSink(ILibAsyncSocket_SocketModule socketMo
 	if (data->module->OnInterrupt != NULL) data->module->OnInterrupt(data->module, socketModule, data->user);
 	if (ILibAsyncSocket_GetUser(socketModule) != NULL)
 	{
+		ILibAsyncServerSocket_ReleaseSlot(data);
 		free(user);
 		ILibAsyncSocket_SetUser(socketModule, NULL);
 	}
@@ -151,29 +198,21 @@ void ILibAsyncServerSocket_OnInterruptSink(ILibAsyncSocket_SocketModule socketMo
 void ILibAsyncServerSocket_PreSelect(void* socketModule, fd_set *readset, fd_set *writeset, fd_set *errorset, int* blocktime)
 {
 	struct ILibAsyncServerSocketModule *module = (struct ILibAsyncServerSocketModule*)socketModule;
-	int i;
 
 	UNREFERENCED_PARAMETER( writeset );
 	UNREFERENCED_PARAMETER( errorset );
 	UNREFERENCED_PARAMETER( blocktime );
 
-	if (module->ListenSocket != ~0)
+	// Only put the ListenSocket in the readset, if we are able to handle a new socket
+	if (module->ListenSocket != ~0 && module->FreeSlotCount > 0)
 	{
-		// Only put the ListenSocket in the readset, if we are able to handle a new socket
-		for(i = 0; i < module->MaxConnection; ++i)
-		{
-			if (ILibAsyncSocket_IsFree(module->AsyncSockets[i]) != 0)
-			{
-				#if defined(WIN32)
-				#pragma warning( push, 3 ) // warning C4127: conditional expression is constant
-				#endif
-				FD_SET(module->ListenSocket, readset);
-				#if defined(WIN32)
-				#pragma warning( pop )
-				#endif
-				break;
-			}
-		}
+		#if defined(WIN32)
+		#pragma warning( push, 3 ) // warning C4127: conditional expression is constant
+		#endif
+		FD_SET(module->ListenSocket, readset);
+		#if defined(WIN32)
+		#pragma warning( pop )
+		#endif
 	}
 }
 /*! \fn ILibAsyncServerSocket_SetReAllocateNotificationCallback(ILibAsyncServerSocket_ServerModule AsyncServerSocketToken, ILibAsyncServerSocket_ConnectionToken ConnectionToken, ILibAsyncServerSocket_BufferReAllocated Callback)
@@ -212,7 +251,10 @@ void ILibAsyncServerSocket_PostSelect(void* socketModule, int slct, fd_set *read
 #endif
 
 	struct ILibAsyncServerSocketModule *module = (struct ILibAsyncServerSocketModule*)socketModule;
-	int i,flags;
+	int i;
+#if !defined(_POSIX) || !defined(SOCK_NONBLOCK)
+	int flags;
+#endif
 #ifdef _WIN32_WCE
 	SOCKET NewSocket;
 #elif WIN32
@@ -228,95 +270,69 @@ void ILibAsyncServerSocket_PostSelect(void* socketModule, int slct, fd_set *read
 	if (FD_ISSET(module->ListenSocket, readset) != 0)
 	{
 		//
-		// There are pending TCP connection requests
+		// There are pending TCP connection requests. Accept as many as we can, until the backlog is drained
 		//
-		for(i = 0; i < module->MaxConnection; ++i)
+		while ((i = ILibAsyncServerSocket_AcquireSlot(module)) >= 0)
 		{
-			//
-			// Check to see if we have available resources to handle this connection request
-			//
-			if (ILibAsyncSocket_IsFree(module->AsyncSockets[i]) != 0)
+			addrlen = sizeof(addr);
+#if defined(_POSIX) && defined(SOCK_NONBLOCK)
+			NewSocket = accept4(module->ListenSocket, (struct sockaddr*)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+			NewSocket = accept(module->ListenSocket, (struct sockaddr*)&addr, &addrlen); // Klocwork claims we could lose the resource acquired fom the declaration, but that is not possible in this case
+#endif
+			if (NewSocket == ~0)
 			{
-				addrlen = sizeof(addr);
-				NewSocket = accept(module->ListenSocket, (struct sockaddr*)&addr, &addrlen); // Klocwork claims we could lose the resource acquired fom the declaration, but that is not possible in this case
-				//printf("Accept NewSocket=%d\r\n", NewSocket);
-
-				// This code rejects connections that are from out-of-scope addresses (Outside the subnet, outside local host...)
-				// It needs to be updated to IPv6.
-				/*
-				if (NewSocket != ~0)
-				{
-				switch(module->scope)
-				{
-				case ILibServerScope_LocalLoopback:
-				// Check that the caller ip address is the same as the receive IP address
-				getsockname(NewSocket, (struct sockaddr*)&receivingAddress, &receivingAddressLength);
-				if (((struct sockaddr_in*)&receivingAddress)->sin_addr.s_addr != ((struct sockaddr_in*)&addr)->sin_addr.s_addr)   // TODO: NOT IPv6 COMPILANT!!!!!!!!!!!!!!!!!!!!!!!!
-				{
-				#if defined(WIN32) || defined(_WIN32_WCE)
-				closesocket(NewSocket);
-				#else
-				close(NewSocket);
-				#endif
-				NewSocket = ~0;
-				}
-				break;
-				case ILibServerScope_LocalSegment:
-				getsockname(NewSocket, (struct sockaddr*)&receivingAddress, &receivingAddressLength);
-				break;
-				default:
+				// Nothing left to accept (EAGAIN), so put the slot back
+				ILibSpinLock_Lock(&(module->FreeSlotLock));
+				module->FreeSlots[module->FreeSlotCount++] = i;
+				ILibSpinLock_UnLock(&(module->FreeSlotLock));
 				break;
-				}
-				}
-				*/
-				if (NewSocket != ~0)
-				{
-					//printf("Accepting new connection, socket = %d\r\n", NewSocket);
-					//
-					// Set this new socket to non-blocking mode, so we can play nice and share thread
-					//
+			}
+
+			//
+			// Set this new socket to non-blocking mode, so we can play nice and share thread
+			//
 #ifdef _WIN32_WCE
-					flags = 1;
-					ioctlsocket(NewSocket ,FIONBIO, &flags);
+			flags = 1;
+			ioctlsocket(NewSocket ,FIONBIO, &flags);
 #elif WIN32
-					flags = 1;
-					ioctlsocket(NewSocket, FIONBIO, (u_long *)(&flags));
-#elif _POSIX
-					flags = fcntl(NewSocket, F_GETFL,0);
-					fcntl(NewSocket, F_SETFL, O_NONBLOCK|flags);
-#endif
-					//
-					// Instantiate a module to contain all the data about this connection
-					//
-					if ((data = (struct ILibAsyncServerSocket_Data*)malloc(sizeof(struct ILibAsyncServerSocket_Data))) == NULL) ILIBCRITICALEXIT(254);
-					memset(data, 0, sizeof(struct ILibAsyncServerSocket_Data));
-					data->module = (struct ILibAsyncServerSocketModule*)socketModule;
-
-					ILibAsyncSocket_UseThisSocket(module->AsyncSockets[i], NewSocket, &ILibAsyncServerSocket_OnInterruptSink, data);
-					ILibAsyncSocket_UpdateCallbacks(module->AsyncSockets[i], ILibAsyncServerSocket_OnData, ILibAsyncServerSocket_OnConnectSink, ILibAsyncServerSocket_OnDisconnectSink, ILibAsyncServerSocket_OnSendOKSink);
-					ILibAsyncSocket_SetRemoteAddress(module->AsyncSockets[i], (struct sockaddr*)&addr);
-
-					#ifndef MICROSTACK_NOTLS
-					if (module->ssl_ctx != NULL)
-					{
-						// Accept a new TLS connection
+			flags = 1;
+			ioctlsocket(NewSocket, FIONBIO, (u_long *)(&flags));
+#elif defined(_POSIX) && !defined(SOCK_NONBLOCK)
+			flags = fcntl(NewSocket, F_GETFL,0);
+			fcntl(NewSocket, F_SETFL, O_NONBLOCK|flags);
+#endif
+			//
+			// Instantiate a module to contain all the data about this connection
+			//
+			if ((data = (struct ILibAsyncServerSocket_Data*)malloc(sizeof(struct ILibAsyncServerSocket_Data))) == NULL) ILIBCRITICALEXIT(254);
+			memset(data, 0, sizeof(struct ILibAsyncServerSocket_Data));
+			data->module = (struct ILibAsyncServerSocketModule*)socketModule;
+			data->slot = i;
+
+			ILibAsyncSocket_UseThisSocket(module->AsyncSockets[i], NewSocket, &ILibAsyncServerSocket_OnInterruptSink, data);
+			ILibAsyncSocket_UpdateCallbacks(module->AsyncSockets[i], ILibAsyncServerSocket_OnData, ILibAsyncServerSocket_OnConnectSink, ILibAsyncServerSocket_OnDisconnectSink, ILibAsyncServerSocket_OnSendOKSink);
+			ILibAsyncSocket_SetRemoteAddress(module->AsyncSockets[i], (struct sockaddr*)&addr);
+
+			#ifndef MICROSTACK_NOTLS
+			if (module->ssl_ctx != NULL)
+			{
+				// Accept a new TLS connection
 #ifdef MICROSTACK_TLS_DETECT
-						SSL* ctx = ILibAsyncSocket_SetSSLContext(module->AsyncSockets[i], module->ssl_ctx, module->TLSDetectEnabled == 0 ? ILibAsyncSocket_TLS_Mode_Server : ILibAsyncSocket_TLS_Mode_Server_with_TLSDetectLogic);
+				SSL* ctx = ILibAsyncSocket_SetSSLContext(module->AsyncSockets[i], module->ssl_ctx, module->TLSDetectEnabled == 0 ? ILibAsyncSocket_TLS_Mode_Server : ILibAsyncSocket_TLS_Mode_Server_with_TLSDetectLogic);
 #else
-						SSL* ctx = ILibAsyncSocket_SetSSLContext(module->AsyncSockets[i], module->ssl_ctx, ILibAsyncSocket_TLS_Mode_Server);
-#endif
-						if (ctx != NULL && module->OnSSLContext != NULL) { module->OnSSLContext(module, module->AsyncSockets[i], ctx, &(data->user)); }
-					}
-					else
-					#endif	
-					if (module->OnConnect != NULL)
-					{
-						// Notify the user about this new connection
-						module->OnConnect(module, module->AsyncSockets[i], &(data->user));
-					}
-				}
-				else {break;}
+				SSL* ctx = ILibAsyncSocket_SetSSLContext(module->AsyncSockets[i], module->ssl_ctx, ILibAsyncSocket_TLS_Mode_Server);
+#endif
+				if (ctx != NULL && module->OnSSLContext != NULL) { module->OnSSLContext(module, module->AsyncSockets[i], ctx, &(data->user)); }
+			}
+			else
+			#endif	
+			if (module->OnConnect != NULL)
+			{
+				// Notify the user about this new connection
+				module->OnConnect(module, module->AsyncSockets[i], &(data->user));
 			}
+			if (module->ListenSocket == ~0) { break; } // User stopped listening
 		}
 	}
 } // Klocwork claims that we could lose the resource acquired in the declaration, but that is not possible in this case
@@ -332,6 +348,8 @@ void ILibAsyncServerSocket_Destroy(void *socketModule)
 
 	free(module->AsyncSockets);
 	module->AsyncSockets = NULL;
+	free(module->FreeSlots);
+	module->FreeSlots = NULL;
 	if (module->ListenSocket != (SOCKET)~0)
 	{
 #ifdef _WIN32_WCE
@@ -385,7 +403,7 @@ void ILibAsyncServerSocket_OnConnectSink(ILibAsyncSocket_SocketModule socketModu
 {
 	struct ILibAsyncServerSocket_Data *data = (struct ILibAsyncServerSocket_Data*)user;
 	if (data == NULL) return;
-	if (Connected == 0) { free(data); data = NULL; return; } // Connection Failed, clean up
+	if (Connected == 0) { ILibAsyncServerSocket_ReleaseSlot(data); free(data); data = NULL; return; } // Connection Failed, clean up
 	if (data->module->OnConnect != NULL) data->module->OnConnect(data->module, socketModule, &(data->user));
 }
 // 
@@ -402,6 +420,7 @@ void ILibAsyncServerSocket_OnDisconnectSink(ILibAsyncSocket_SocketModule socketM
 	if (data->module->OnDisconnect != NULL) data->module->OnDisconnect(data->module, socketModule, data->user);
 	if (ILibAsyncSocket_GetUser(socketModule) != NULL)
 	{
+		ILibAsyncServerSocket_ReleaseSlot(data);
 		free(data);
 		ILibAsyncSocket_SetUser(socketModule, NULL);
 	}
@@ -514,6 +533,9 @@ void ILibAsyncServerSocket_ResumeListeningSink(void *chain, void* user)
 #else
 	// On Linux. Setting the re-use on a TCP socket allows reuse of the socket even in timeout state. Allows for fast stop/start (Not a problem on Windows).
 	if (setsockopt(m->ListenSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&ra, sizeof(int)) != 0) ILIBCRITICALERREXIT(253);
+#ifdef SO_REUSEPORT
+	if ((m->listenFlags & ILibAsyncServerSocket_ListenFlags_REUSEPORT) != 0 && setsockopt(m->ListenSocket, SOL_SOCKET, SO_REUSEPORT, (char*)&ra, sizeof(int)) != 0) { close(m->ListenSocket); m->ListenSocket = (SOCKET)~0; return; }
+#endif
 #endif
 
 	// Bind the socket
@@ -601,30 +623,47 @@ void ILibAsyncServerSocket_RemoveFromChain(ILibAsyncServerSocket_ServerModule se
 ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemory(void *Chain, int MaxConnections, unsigned short PortNumber, int initialBufferSize, int loopbackFlag, ILibAsyncServerSocket_OnConnect OnConnect, ILibAsyncServerSocket_OnDisconnect OnDisconnect, ILibAsyncServerSocket_OnReceive OnReceive, ILibAsyncServerSocket_OnInterrupt OnInterrupt, ILibAsyncServerSocket_OnSendOK OnSendOK, int ServerUserMappedMemorySize, int SessionUserMappedMemorySize)
 {
 	struct sockaddr_in6 localif;
-	memset(&localif, 0, sizeof(struct sockaddr_in6));
+	ILibAsyncServerSocket_SetLocalInterface(&localif, PortNumber, loopbackFlag);
+	return(ILibCreateAsyncServerSocketModuleWithMemoryEx(Chain, MaxConnections, initialBufferSize, (struct sockaddr*)&localif, OnConnect, OnDisconnect, OnReceive, OnInterrupt, OnSendOK, ServerUserMappedMemorySize, SessionUserMappedMemorySize));
+}
+/*! \fn ILibAsyncServerSocket_SetLocalInterface(struct sockaddr_in6 *localif, unsigned short PortNumber, int loopbackFlag)
+\brief Sets up the ANY or loopback address to listen on, preferring IPv6 (dual stack) if supported
+\param loopbackFlag 0 to bind to ANY, 1 to bind to IPv6 loopback first, 2 to bind to IPv4 loopback first.
+*/
+void ILibAsyncServerSocket_SetLocalInterface(struct sockaddr_in6 *localif, unsigned short PortNumber, int loopbackFlag)
+{
+	memset(localif, 0, sizeof(struct sockaddr_in6));
 
 	if (loopbackFlag != 2 && ILibDetectIPv6Support())
 	{
 		// Setup the IPv6 any or loopback address, this socket will also work for IPv4 traffic on IPv6 stack
-		localif.sin6_family = AF_INET6;
-		localif.sin6_addr = (loopbackFlag != 0 ? in6addr_loopback : in6addr_any);
-		localif.sin6_port = htons(PortNumber);
+		localif->sin6_family = AF_INET6;
+		localif->sin6_addr = (loopbackFlag != 0 ? in6addr_loopback : in6addr_any);
+		localif->sin6_port = htons(PortNumber);
 	}
 	else
 	{
 		// IPv4-only detected
-		localif.sin6_family = AF_INET;
+		localif->sin6_family = AF_INET;
 #ifdef WIN32
-		((struct sockaddr_in*)&localif)->sin_addr.S_un.S_addr = htonl((loopbackFlag != 0 ? INADDR_LOOPBACK : INADDR_ANY));
+		((struct sockaddr_in*)localif)->sin_addr.S_un.S_addr = htonl((loopbackFlag != 0 ? INADDR_LOOPBACK : INADDR_ANY));
 #else 
-		((struct sockaddr_in*)&localif)->sin_addr.s_addr = htonl((loopbackFlag != 0 ? INADDR_LOOPBACK : INADDR_ANY));
+		((struct sockaddr_in*)localif)->sin_addr.s_addr = htonl((loopbackFlag != 0 ? INADDR_LOOPBACK : INADDR_ANY));
 #endif
-		((struct sockaddr_in*)&localif)->sin_port = htons(PortNumber);
+		((struct sockaddr_in*)localif)->sin_port = htons(PortNumber);
 	}
-
-	return(ILibCreateAsyncServerSocketModuleWithMemoryEx(Chain, MaxConnections, initialBufferSize, (struct sockaddr*)&localif, OnConnect, OnDisconnect, OnReceive, OnInterrupt, OnSendOK, ServerUserMappedMemorySize, SessionUserMappedMemorySize));
 }
 ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryExMOD(void *Chain, int MaxConnections, int initialBufferSize, struct sockaddr *local, ILibAsyncServerSocket_OnConnect OnConnect, ILibAsyncServerSocket_OnDisconnect OnDisconnect, ILibAsyncServerSocket_OnReceive OnReceive, ILibAsyncServerSocket_OnInterrupt OnInterrupt, ILibAsyncServerSocket_OnSendOK OnSendOK, int mod, int ServerUserMappedMemorySize, int SessionUserMappedMemorySize)
+{
+	return(ILibCreateAsyncServerSocketModuleWithMemoryExFLAGS(Chain, MaxConnections, initialBufferSize, local, OnConnect, OnDisconnect, OnReceive, OnInterrupt, OnSendOK, mod, ILibAsyncServerSocket_ListenFlags_NONE, ServerUserMappedMemorySize, SessionUserMappedMemorySize));
+}
+/*! \fn ILibCreateAsyncServerSocketModuleWithMemoryExFLAGS(void *Chain, int MaxConnections, int initialBufferSize, struct sockaddr *local, ILibAsyncServerSocket_OnConnect OnConnect, ILibAsyncServerSocket_OnDisconnect OnDisconnect, ILibAsyncServerSocket_OnReceive OnReceive, ILibAsyncServerSocket_OnInterrupt OnInterrupt, ILibAsyncServerSocket_OnSendOK OnSendOK, int mod, int listenFlags, int ServerUserMappedMemorySize, int SessionUserMappedMemorySize)
+\brief Instantiates a new ILibAsyncServerSocket, bound to the specified local address
+\param mod File mode to set on an AF_UNIX socket (0 = Don't change)
+\param listenFlags ILibAsyncServerSocket_ListenFlags. ILibAsyncServerSocket_ListenFlags_REUSEPORT allows several modules (each on their own chain) to share the same port
+\returns An ILibAsyncServerSocket module, or NULL on failure
+*/
+ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryExFLAGS(void *Chain, int MaxConnections, int initialBufferSize, struct sockaddr *local, ILibAsyncServerSocket_OnConnect OnConnect, ILibAsyncServerSocket_OnDisconnect OnDisconnect, ILibAsyncServerSocket_OnReceive OnReceive, ILibAsyncServerSocket_OnInterrupt OnInterrupt, ILibAsyncServerSocket_OnSendOK OnSendOK, int mod, int listenFlags, int ServerUserMappedMemorySize, int SessionUserMappedMemorySize)
 {
 	int i;
 	int ra = 1;
@@ -636,6 +675,9 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 #ifdef WIN32
 	if (local->sa_family == AF_UNIX) { return(NULL); } // NOT YET SUPPORTED on Windows
 #endif
+#ifndef SO_REUSEPORT
+	if ((listenFlags & ILibAsyncServerSocket_ListenFlags_REUSEPORT) != 0) { return(NULL); } // NOT SUPPORTED on this platform
+#endif
 
 	// Instantiate a new AsyncServer module
 	RetVal = (struct ILibAsyncServerSocketModule*)ILibChain_Link_Allocate(sizeof(struct ILibAsyncServerSocketModule), ServerUserMappedMemorySize);
@@ -649,12 +691,15 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 	RetVal->OnSendOK = OnSendOK;
 	RetVal->OnReceive = OnReceive;
 	RetVal->MaxConnection = MaxConnections;
+	RetVal->listenFlags = listenFlags;
 	RetVal->AsyncSockets = (void**)malloc(MaxConnections * sizeof(void*));
 	if (RetVal->AsyncSockets == NULL) { free(RetVal); ILIBMARKPOSITION(253); return NULL; }
+	if ((RetVal->FreeSlots = (int*)malloc(MaxConnections * sizeof(int))) == NULL) { ILIBCRITICALEXIT(254); }
+	ILibSpinLock_Init(&(RetVal->FreeSlotLock));
 	if (local->sa_family == AF_UNIX)
 	{
 		// Get our IPC socket
-		if ((RetVal->ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) { free(RetVal->AsyncSockets); free(RetVal); return 0; }
+		if ((RetVal->ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) { free(RetVal->FreeSlots); free(RetVal->AsyncSockets); free(RetVal); return 0; }
 	}
 	else
 	{
@@ -662,7 +707,7 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 		RetVal->initialPortNumber = RetVal->portNumber;
 
 		// Get our listening socket
-		if ((RetVal->ListenSocket = socket(((struct sockaddr_in6*)local)->sin6_family, SOCK_STREAM, IPPROTO_TCP)) == -1) { free(RetVal->AsyncSockets); free(RetVal); return 0; }
+		if ((RetVal->ListenSocket = socket(((struct sockaddr_in6*)local)->sin6_family, SOCK_STREAM, IPPROTO_TCP)) == -1) { free(RetVal->FreeSlots); free(RetVal->AsyncSockets); free(RetVal); return 0; }
 
 		// Setup the IPv6 & IPv4 support on same socket
 		if (((struct sockaddr_in6*)local)->sin6_family == AF_INET6) if (setsockopt(RetVal->ListenSocket, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&off, sizeof(off)) != 0) ILIBCRITICALERREXIT(253);
@@ -680,15 +725,19 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 #else
 	// On Linux. Setting the re-use on a TCP socket allows reuse of the socket even in timeout state. Allows for fast stop/start (Not a problem on Windows).
 	if (setsockopt(RetVal->ListenSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&ra, sizeof(int)) != 0) ILIBCRITICALERREXIT(253);
+#ifdef SO_REUSEPORT
+	// Every socket bound to this port with SO_REUSEPORT gets its own accept queue, and the kernel load balances new connections between them
+	if ((listenFlags & ILibAsyncServerSocket_ListenFlags_REUSEPORT) != 0 && setsockopt(RetVal->ListenSocket, SOL_SOCKET, SO_REUSEPORT, (char*)&ra, sizeof(int)) != 0) { close(RetVal->ListenSocket); free(RetVal->FreeSlots); free(RetVal->AsyncSockets); free(RetVal); return 0; }
+#endif
 #endif
 	
 	// Bind the socket
 #if defined(WIN32)
-	if (bind(RetVal->ListenSocket, local, INET_SOCKADDR_LENGTH(((struct sockaddr_in6*)local)->sin6_family)) != 0) { closesocket(RetVal->ListenSocket); free(RetVal->AsyncSockets); free(RetVal); return 0; }
+	if (bind(RetVal->ListenSocket, local, INET_SOCKADDR_LENGTH(((struct sockaddr_in6*)local)->sin6_family)) != 0) { closesocket(RetVal->ListenSocket); free(RetVal->FreeSlots); free(RetVal->AsyncSockets); free(RetVal); return 0; }
 #else
 	if (local->sa_family == AF_UNIX)
 	{
-		if (bind(RetVal->ListenSocket, local, SUN_LEN((struct sockaddr_un*)local)) != 0) { close(RetVal->ListenSocket); free(RetVal->AsyncSockets); free(RetVal); return 0; }
+		if (bind(RetVal->ListenSocket, local, SUN_LEN((struct sockaddr_un*)local)) != 0) { close(RetVal->ListenSocket); free(RetVal->FreeSlots); free(RetVal->AsyncSockets); free(RetVal); return 0; }
 		if (mod != 0)
 		{
 			chmod(((struct sockaddr_un*)local)->sun_path, (mode_t)mod);
@@ -696,7 +745,7 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 	}
 	else
 	{
-		if (bind(RetVal->ListenSocket, local, INET_SOCKADDR_LENGTH(((struct sockaddr_in6*)local)->sin6_family)) != 0) { close(RetVal->ListenSocket); free(RetVal->AsyncSockets); free(RetVal); return 0; }
+		if (bind(RetVal->ListenSocket, local, INET_SOCKADDR_LENGTH(((struct sockaddr_in6*)local)->sin6_family)) != 0) { close(RetVal->ListenSocket); free(RetVal->FreeSlots); free(RetVal->AsyncSockets); free(RetVal); return 0; }
 	}
 #endif
 
@@ -718,6 +767,7 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 		// We want to know about any buffer reallocations, because anything above us may want to know
 		//
 		ILibAsyncSocket_SetReAllocateNotificationCallback(RetVal->AsyncSockets[i], &ILibAsyncServerSocket_OnBufferReAllocated);
+		RetVal->FreeSlots[RetVal->FreeSlotCount++] = MaxConnections - 1 - i; // So that slots are handed out in order
 	}
 
 
@@ -734,7 +784,7 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 #endif
 
 	RetVal->listening = 1;
-	listen(RetVal->ListenSocket, 4);
+	listen(RetVal->ListenSocket, (listenFlags & ILibAsyncServerSocket_ListenFlags_REUSEPORT) != 0 ? SOMAXCONN : 4);
 	#if defined(WIN32)
 	#pragma warning( push, 3 ) // warning C4127: conditional expression is constant
 	#endif
@@ -744,6 +794,30 @@ ILibAsyncServerSocket_ServerModule ILibCreateAsyncServerSocketModuleWithMemoryEx
 	return RetVal;
 }
 
+/*! \fn ILibAsyncServerSocket_CreateShards(void **chains, int chainCount, ILibAsyncServerSocket_ServerModule *shards, int MaxConnectionsPerShard, int initialBufferSize, struct sockaddr *local, ILibAsyncServerSocket_OnConnect OnConnect, ILibAsyncServerSocket_OnDisconnect OnDisconnect, ILibAsyncServerSocket_OnReceive OnReceive, ILibAsyncServerSocket_OnInterrupt OnInterrupt, ILibAsyncServerSocket_OnSendOK OnSendOK, int ServerUserMappedMemorySize, int SessionUserMappedMemorySize)
+\brief Creates one listener per chain, all sharing the same port with SO_REUSEPORT, so that accepted connections are spread across the threads running those chains
+\param chains Array of chains. (Chains must <B>not</B> be running, and each should be started on its own thread)
+\param chainCount Number of chains in \a chains
+\param[out] shards Receives the ILibAsyncServerSocket created on each chain
+\param local Local address to bind to. If the port is 0, the port selected for the first shard is used for the rest
+\returns The number of shards that were created
+*/
+int ILibAsyncServerSocket_CreateShards(void **chains, int chainCount, ILibAsyncServerSocket_ServerModule *shards, int MaxConnectionsPerShard, int initialBufferSize, struct sockaddr *local, ILibAsyncServerSocket_OnConnect OnConnect, ILibAsyncServerSocket_OnDisconnect OnDisconnect, ILibAsyncServerSocket_OnReceive OnReceive, ILibAsyncServerSocket_OnInterrupt OnInterrupt, ILibAsyncServerSocket_OnSendOK OnSendOK, int ServerUserMappedMemorySize, int SessionUserMappedMemorySize)
+{
+	struct sockaddr_in6 addr;
+	int i;
+
+	if (local->sa_family != AF_INET && local->sa_family != AF_INET6) { return(0); }
+	memcpy_s(&addr, sizeof(addr), local, INET_SOCKADDR_LENGTH(local->sa_family));
+	for (i = 0; i < chainCount; ++i)
+	{
+		shards[i] = ILibCreateAsyncServerSocketModuleWithMemoryExFLAGS(chains[i], MaxConnectionsPerShard, initialBufferSize, (struct sockaddr*)&addr, OnConnect, OnDisconnect, OnReceive, OnInterrupt, OnSendOK, 0, ILibAsyncServerSocket_ListenFlags_REUSEPORT, ServerUserMappedMemorySize, SessionUserMappedMemorySize);
+		if (shards[i] == NULL) { break; }
+		if (i == 0) { addr.sin6_port = htons(ILibAsyncServerSocket_GetPortNumber(shards[0])); } // sin_port and sin6_port are at the same offset
+	}
+	return(i);
+}
+
 void ILibAsyncServerSocket_GetLocal(ILibAsyncServerSocket_ServerModule ServerSocketModule, struct sockaddr* addr, size_t addrLen)
 {
 	socklen_t ssize = (socklen_t)addrLen;
@@ -14,6 +14,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#if defined(_POSIX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		// recvmmsg(), sendmmsg()
+#endif
+#if defined(_POSIX) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64	// 64 bit off_t for sendfile(), so files over 2 GB can be sent on 32 bit builds
+#endif
+
 #ifdef MEMORY_CHECK
 #include <assert.h>
 #define MEMCHECK(x) x
@@ -55,6 +62,12 @@ limitations under the License.
 #include <sys/socket.h>
 #include <sys/un.h>
 #endif
+#ifdef ILibAsyncSocket_SENDFILE_SUPPORTED
+#include <sys/sendfile.h>
+#endif
+#if defined(_POSIX) && !defined(__APPLE__) && !defined(_FREEBSD)
+#include <netinet/tcp.h>
+#endif
 
 #ifndef MICROSTACK_NOTLS
 #include <openssl/err.h>
@@ -117,8 +130,37 @@ typedef struct ILibAsyncSocket_SendData
 
 	ILibAsyncSocket_MemoryOwnership UserFree;
 	struct ILibAsyncSocket_SendData *Next;
+#ifdef ILibAsyncSocket_SENDFILE_SUPPORTED
+	// When isFileSegment is set, bufferSize bytes are sent from fileDescriptor with sendfile(), instead of from buffer
+	int isFileSegment;
+	int fileDescriptor;
+	off_t fileOffset;
+#endif
 }ILibAsyncSocket_SendData;
 
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+#define ILibAsyncSocket_DatagramBatch_SlotSize 4096
+typedef struct ILibAsyncSocket_DatagramBatch
+{
+	// Datagrams read with one recvmmsg(). Each slot is MallocSize bytes, and recvIndex is the next one to deliver
+	char *recvBuffers;
+	struct mmsghdr recvMsgs[ILibAsyncSocket_DatagramBatchSize];
+	struct iovec recvIov[ILibAsyncSocket_DatagramBatchSize];
+	struct sockaddr_in6 recvAddress[ILibAsyncSocket_DatagramBatchSize];
+	int recvCount;
+	int recvIndex;
+
+	// Datagrams sent from the chain thread, written with one sendmmsg() at the end of the chain iteration
+	struct mmsghdr sendMsgs[ILibAsyncSocket_DatagramBatchSize];
+	struct iovec sendIov[ILibAsyncSocket_DatagramBatchSize];
+	struct sockaddr_in6 sendAddress[ILibAsyncSocket_DatagramBatchSize];
+	ILibAsyncSocket_MemoryOwnership sendOwnership[ILibAsyncSocket_DatagramBatchSize];
+	char sendCopy[ILibAsyncSocket_DatagramBatchSize][ILibAsyncSocket_DatagramBatch_SlotSize];
+	int sendCount;
+	int preSelectDone;	// Set between PreSelect and PostSelect, when a held datagram would wait for select() to return
+}ILibAsyncSocket_DatagramBatch;
+#endif
+
 typedef struct ILibAsyncSocketModule
 {
 	ILibTransport Transport;
@@ -205,8 +247,56 @@ typedef struct ILibAsyncSocketModule
 	long long timeout_lastActivity;
 	int timeout_milliSeconds;
 	ILibAsyncSocket_TimeoutHandler timeout_handler;
+
+	ILibTransport_Metrics Metrics;
+	ILibTransport_Metrics *ChainMetrics;
+	long long PausedSince;
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	ILibAsyncSocket_DatagramBatch *DatagramBatch;
+#endif
 }ILibAsyncSocketModule;
 
+// Transport metrics are kept per socket, and mirrored into the totals for the chain. Sockets on the same chain
+// can be sending from different threads at once, so the chain totals are updated with atomic 64 bit operations
+#if defined(WIN32)
+	#define ILibAsyncSocket_Metrics_ChainAdd(module, field, value) InterlockedExchangeAdd64((volatile LONG64*)&((module)->ChainMetrics->field), (LONG64)(value))
+	#define ILibAsyncSocket_Metrics_ChainCAS(ptr, oldValue, newValue) ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(ptr), (LONG64)(newValue), (LONG64)(oldValue)) == (oldValue))
+#elif defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)
+	#define ILibAsyncSocket_Metrics_ChainAdd(module, field, value) __sync_fetch_and_add(&((module)->ChainMetrics->field), (uint64_t)(value))
+	#define ILibAsyncSocket_Metrics_ChainCAS(ptr, oldValue, newValue) __sync_bool_compare_and_swap((ptr), (oldValue), (newValue))
+#else
+	// No lock-free 64 bit operations on this platform, so only the chain thread updates the chain totals
+	#define ILibAsyncSocket_Metrics_ChainAdd(module, field, value) if (ILibIsRunningOnChainThread((module)->Transport.ChainLink.ParentChain) != 0) { (module)->ChainMetrics->field += (uint64_t)(value); }
+#endif
+#define ILibAsyncSocket_Metrics_Add(module, field, value) { (module)->Metrics.field += (uint64_t)(value); if ((module)->ChainMetrics != NULL) { ILibAsyncSocket_Metrics_ChainAdd(module, field, value); } }
+void ILibAsyncSocket_Metrics_Sent(ILibAsyncSocketModule *module, int requested, int sent)
+{
+	ILibAsyncSocket_Metrics_Add(module, sendCalls, 1);
+	if (sent > 0) { ILibAsyncSocket_Metrics_Add(module, bytesSent, sent); }
+	if (sent < requested) { ILibAsyncSocket_Metrics_Add(module, partialWrites, 1); }
+}
+void ILibAsyncSocket_Metrics_Received(ILibAsyncSocketModule *module, int received)
+{
+	ILibAsyncSocket_Metrics_Add(module, recvCalls, 1);
+	if (received > 0) { ILibAsyncSocket_Metrics_Add(module, bytesReceived, received); }
+}
+void ILibAsyncSocket_Metrics_Queued(ILibAsyncSocketModule *module)
+{
+	if (module->PendingBytesToSend > module->Metrics.sendQueueHighWater) { module->Metrics.sendQueueHighWater = module->PendingBytesToSend; }
+	if (module->ChainMetrics == NULL) { return; }
+#ifdef ILibAsyncSocket_Metrics_ChainCAS
+	{
+		uint64_t current;
+		do
+		{
+			current = module->ChainMetrics->sendQueueHighWater;
+		} while (module->PendingBytesToSend > current && !ILibAsyncSocket_Metrics_ChainCAS(&(module->ChainMetrics->sendQueueHighWater), current, (uint64_t)module->PendingBytesToSend));
+	}
+#else
+	if (ILibIsRunningOnChainThread(module->Transport.ChainLink.ParentChain) != 0 && module->PendingBytesToSend > module->ChainMetrics->sendQueueHighWater) { module->ChainMetrics->sendQueueHighWater = module->PendingBytesToSend; }
+#endif
+}
+
 void ILibAsyncSocket_PostSelect(void* object,int slct, fd_set *readset, fd_set *writeset, fd_set *errorset);
 void ILibAsyncSocket_PreSelect(void* object,fd_set *readset, fd_set *writeset, fd_set *errorset, int* blocktime);
 const int ILibMemory_ASYNCSOCKET_CONTAINERSIZE = (const int)sizeof(ILibAsyncSocketModule);
@@ -397,6 +487,9 @@ void ILibAsyncSocket_Destroy(void *socketModule)
 		module->buffer = NULL;
 		module->MallocSize = 0;
 	}
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	ILibAsyncSocket_SetDatagramBatching(module, 0);
+#endif
 
 	// Clear all the data that is pending to be sent
 	temp = current = module->PendingSend_Head;
@@ -471,6 +564,7 @@ ILibAsyncSocket_SocketModule ILibCreateAsyncSocketModuleWithMemory(void *Chain,
 	RetVal->OnConnect = OnConnect;
 	RetVal->OnDisconnect = OnDisconnect;
 	RetVal->OnSendOK = OnSendOK;
+	RetVal->ChainMetrics = ILibChain_GetTransportMetrics(Chain);
 	RetVal->InitialSize = initialBufferSize;
 	RetVal->MallocSize = initialBufferSize;
 	RetVal->LifeTime = ILibGetBaseTimer(Chain); //ILibCreateLifeTime(Chain);
@@ -503,6 +597,17 @@ void ILibAsyncSocket_ClearPendingSend(ILibAsyncSocket_SocketModule socketModule)
 		free(data);
 		data = temp;
 	}
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	if (module->DatagramBatch != NULL)
+	{
+		int i;
+		for (i = 0; i < module->DatagramBatch->sendCount; ++i)
+		{
+			if (module->DatagramBatch->sendOwnership[i] == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(module->DatagramBatch->sendIov[i].iov_base); }
+		}
+		module->DatagramBatch->sendCount = 0;
+	}
+#endif
 }
 
 void ILibAsyncSocket_SendError(ILibAsyncSocket_SocketModule socketModule)
@@ -525,6 +630,176 @@ ILibSpinLock *ILibAsyncSocket_GetSpinLock(ILibAsyncSocket_SocketModule socketMod
 	return(&((struct ILibAsyncSocketModule*)socketModule)->SendLock);
 }
 
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+// Writes the held datagrams with sendmmsg(). Whatever the socket does not accept is moved to the pending send queue. Caller must hold the SendLock
+void ILibAsyncSocket_DatagramBatch_Flush(struct ILibAsyncSocketModule *module)
+{
+	ILibAsyncSocket_DatagramBatch *b = module->DatagramBatch;
+	struct ILibAsyncSocket_SendData *data;
+	int sent = 0, i, r;
+
+	if (b == NULL || b->sendCount == 0) { return; }
+	while (sent < b->sendCount && module->PendingSend_Tail == NULL && module->internalSocket != ~0)
+	{
+		r = sendmmsg(module->internalSocket, b->sendMsgs + sent, (unsigned int)(b->sendCount - sent), MSG_NOSIGNAL);
+		ILibAsyncSocket_Metrics_Add(module, sendCalls, 1);
+		if (r < 0)
+		{
+			if (errno == EWOULDBLOCK) { break; }
+			// This datagram could not be sent, so drop it like sendto() would have, and carry on with the rest
+			if (b->sendOwnership[sent] == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(b->sendIov[sent].iov_base); }
+			++sent;
+			continue;
+		}
+		for (i = sent; i < sent + r; ++i)
+		{
+			ILibAsyncSocket_Metrics_Add(module, bytesSent, b->sendMsgs[i].msg_len);
+			module->TotalBytesSent += b->sendMsgs[i].msg_len;
+			if (b->sendOwnership[i] == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(b->sendIov[i].iov_base); }
+		}
+		sent += r;
+	}
+
+	for (i = sent; i < b->sendCount; ++i)
+	{
+		// The socket is full, so queue the rest behind any pending data. ILibAsyncSocket_PostSelect() will send them when it is writable
+		data = (ILibAsyncSocket_SendData*)ILibMemory_Allocate(sizeof(ILibAsyncSocket_SendData), 0, NULL, NULL);
+		data->bufferSize = (int)b->sendIov[i].iov_len;
+		if (b->sendOwnership[i] == ILibAsyncSocket_MemoryOwnership_USER)
+		{
+			if ((data->buffer = (char*)malloc(data->bufferSize)) == NULL) ILIBCRITICALEXIT(254);
+			memcpy_s(data->buffer, data->bufferSize, b->sendIov[i].iov_base, data->bufferSize);
+			data->UserFree = ILibAsyncSocket_MemoryOwnership_CHAIN;
+		}
+		else
+		{
+			data->buffer = (char*)b->sendIov[i].iov_base;
+			data->UserFree = b->sendOwnership[i];
+		}
+		memcpy_s(&(data->remoteAddress), sizeof(struct sockaddr_in6), &(b->sendAddress[i]), sizeof(struct sockaddr_in6));
+		module->PendingBytesToSend += data->bufferSize;
+		if (module->PendingSend_Tail == NULL)
+		{
+			module->PendingSend_Head = module->PendingSend_Tail = data;
+		}
+		else
+		{
+			module->PendingSend_Tail->Next = data;
+			module->PendingSend_Tail = data;
+		}
+		ILibAsyncSocket_Metrics_Add(module, partialWrites, 1);
+	}
+	b->sendCount = 0;
+}
+
+// Holds a datagram, to be written with the others at the end of the chain iteration. Caller must hold the SendLock
+void ILibAsyncSocket_DatagramBatch_Queue(struct ILibAsyncSocketModule *module, char *buffer, size_t bufferLen, struct sockaddr *remoteAddress, ILibAsyncSocket_MemoryOwnership UserFree)
+{
+	ILibAsyncSocket_DatagramBatch *b = module->DatagramBatch;
+	int i = b->sendCount++;
+
+	if (UserFree == ILibAsyncSocket_MemoryOwnership_USER)
+	{
+		memcpy_s(b->sendCopy[i], ILibAsyncSocket_DatagramBatch_SlotSize, buffer, bufferLen);
+		buffer = b->sendCopy[i];
+	}
+	b->sendIov[i].iov_base = buffer;
+	b->sendIov[i].iov_len = bufferLen;
+	b->sendOwnership[i] = UserFree;
+	memcpy_s(&(b->sendAddress[i]), sizeof(struct sockaddr_in6), remoteAddress, INET_SOCKADDR_LENGTH(remoteAddress->sa_family));
+	b->sendMsgs[i].msg_hdr.msg_namelen = INET_SOCKADDR_LENGTH(remoteAddress->sa_family);
+
+	if (b->sendCount == ILibAsyncSocket_DatagramBatchSize) { ILibAsyncSocket_DatagramBatch_Flush(module); }
+}
+
+// Delivers the datagrams left from the last recvmmsg() to OnData, until they are all consumed or the socket is paused
+void ILibAsyncSocket_DatagramBatch_Deliver(struct ILibAsyncSocketModule *module)
+{
+	ILibAsyncSocket_DatagramBatch *b = module->DatagramBatch;
+	int i, iPointer;
+
+	while (b->recvIndex < b->recvCount && module->internalSocket != ~0 && module->PAUSE <= 0)
+	{
+		i = b->recvIndex++;
+		if (b->recvMsgs[i].msg_len == 0) { continue; }
+
+		memcpy_s(&(module->SourceAddress), sizeof(struct sockaddr_in6), &(b->recvAddress[i]), sizeof(struct sockaddr_in6));
+		ILib6to4((struct sockaddr*)&(module->SourceAddress));
+		iPointer = 0;
+		if (module->OnData != NULL)
+		{
+			module->OnData(module, (char*)b->recvIov[i].iov_base, &iPointer, (int)b->recvMsgs[i].msg_len, &(module->OnInterrupt), &(module->user), &(module->PAUSE));
+		}
+	}
+}
+
+// Reads as many datagrams as are ready with one recvmmsg(), and delivers them. Returns the number read, or -1 on error
+int ILibAsyncSocket_DatagramBatch_Receive(struct ILibAsyncSocketModule *module)
+{
+	ILibAsyncSocket_DatagramBatch *b = module->DatagramBatch;
+	int i, r;
+
+	for (i = 0; i < ILibAsyncSocket_DatagramBatchSize; ++i)
+	{
+		b->recvMsgs[i].msg_hdr.msg_name = &(b->recvAddress[i]);
+		b->recvMsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+		b->recvMsgs[i].msg_hdr.msg_flags = 0;
+		b->recvMsgs[i].msg_len = 0;
+	}
+
+	r = recvmmsg(module->internalSocket, b->recvMsgs, ILibAsyncSocket_DatagramBatchSize, MSG_DONTWAIT, NULL);
+	ILibAsyncSocket_Metrics_Add(module, recvCalls, 1);
+	ILibRemoteLogging_printf(ILibChainGetLogger(module->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_Microstack_AsyncSocket, ILibRemoteLogging_Flags_VerbosityLevel_2, "AsyncSocket[%p] recvmmsg returned %d", (void*)module, r);
+	if (r < 0) { return(errno == EWOULDBLOCK ? 0 : -1); }
+
+	b->recvCount = r;
+	b->recvIndex = 0;
+	for (i = 0; i < r; ++i) { ILibAsyncSocket_Metrics_Add(module, bytesReceived, b->recvMsgs[i].msg_len); }
+	ILibAsyncSocket_DatagramBatch_Deliver(module);
+	return(r);
+}
+void ILibAsyncSocket_SetDatagramBatching(ILibAsyncSocket_SocketModule socketModule, int enable)
+{
+	struct ILibAsyncSocketModule *module = (struct ILibAsyncSocketModule*)socketModule;
+	ILibAsyncSocket_DatagramBatch *b;
+	int i;
+
+	if (module == NULL) { return; }
+	if (enable != 0)
+	{
+		if (module->DatagramBatch != NULL || module->MallocSize <= 0 || module->MallocSize > ILibAsyncSocket_DatagramBatch_SlotSize) { return; }
+		if ((b = (ILibAsyncSocket_DatagramBatch*)malloc(sizeof(ILibAsyncSocket_DatagramBatch))) == NULL) ILIBCRITICALEXIT(254);
+		memset(b, 0, sizeof(ILibAsyncSocket_DatagramBatch));
+		if ((b->recvBuffers = (char*)malloc(ILibAsyncSocket_DatagramBatchSize * module->MallocSize)) == NULL) ILIBCRITICALEXIT(254);
+		for (i = 0; i < ILibAsyncSocket_DatagramBatchSize; ++i)
+		{
+			b->recvIov[i].iov_base = b->recvBuffers + (i * module->MallocSize);
+			b->recvIov[i].iov_len = (size_t)module->MallocSize;
+			b->recvMsgs[i].msg_hdr.msg_iov = &(b->recvIov[i]);
+			b->recvMsgs[i].msg_hdr.msg_iovlen = 1;
+			b->sendMsgs[i].msg_hdr.msg_iov = &(b->sendIov[i]);
+			b->sendMsgs[i].msg_hdr.msg_iovlen = 1;
+			b->sendMsgs[i].msg_hdr.msg_name = &(b->sendAddress[i]);
+		}
+		ILibSpinLock_Lock(&(module->SendLock));
+		module->DatagramBatch = b;
+		ILibSpinLock_UnLock(&(module->SendLock));
+	}
+	else if ((b = module->DatagramBatch) != NULL)
+	{
+		ILibSpinLock_Lock(&(module->SendLock));
+		ILibAsyncSocket_DatagramBatch_Flush(module);
+		for (i = 0; i < b->sendCount; ++i)
+		{
+			if (b->sendOwnership[i] == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(b->sendIov[i].iov_base); }
+		}
+		module->DatagramBatch = NULL;
+		ILibSpinLock_UnLock(&(module->SendLock));
+		free(b->recvBuffers);
+		free(b);
+	}
+}
+#endif
 
 /*! \fn ILibAsyncSocket_SendTo(ILibAsyncSocket_SocketModule socketModule, char* buffer, int length, int remoteAddress, unsigned short remotePort, enum ILibAsyncSocket_MemoryOwnership UserFree)
 \brief Sends data on an AsyncSocket module to a specific destination. (Valid only for <B>UDP</B>)
@@ -573,6 +848,7 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 			SSL_TRACE1("SSL_write()");
 			SSL_write(module->ssl, buffer, (int)bufferLen); // No dataloss, becuase we capped at INT32_MAX
 			SSL_TRACE2("SSL_write()");
+			ILibAsyncSocket_Metrics_Add(module, tlsRecordsSent, (bufferLen + SSL3_RT_MAX_PLAIN_LENGTH - 1) / SSL3_RT_MAX_PLAIN_LENGTH);
 			TLSLOG1("SSL_write[%d]: %d bytes...\n", module->internalSocket, bufferLen);
 
 			if (UserFree == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(buffer); }
@@ -588,6 +864,7 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 				{
 					BIO_clear_retry_flags(module->writeBio); // Klocwork reports this could block, but this is a memory bio, so it will never block.
 					bytesSent = send(module->internalSocket, module->writeBioBuffer->data, (int)(module->writeBioBuffer->length), MSG_NOSIGNAL); // Klocwork reports that this could block while holding a lock... This socket has been set to O_NONBLOCK, so that will never happen
+					ILibAsyncSocket_Metrics_Sent(module, (int)(module->writeBioBuffer->length), bytesSent);
 					TLSLOG1("--> SOCKET WRITE[%d]: %d bytes...\n", module->internalSocket, bytesSent);
 #ifdef WIN32
 					if ((bytesSent > 0 && bytesSent < (int)(module->writeBioBuffer->length)) || (bytesSent < 0 && WSAGetLastError() == WSAEWOULDBLOCK))
@@ -689,6 +966,18 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 			if (UserFree == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(buffer); }
 			continue;
 		}
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+		if (module->DatagramBatch != NULL && remoteAddress != NULL && remoteAddress->sa_family != AF_UNIX)
+		{
+			if (module->DatagramBatch->preSelectDone == 0 && module->FinConnect != 0 && bufferLen <= ILibAsyncSocket_DatagramBatch_SlotSize && ILibIsRunningOnChainThread(module->Transport.ChainLink.ParentChain))
+			{
+				// Hold this datagram, so it goes out with the others sent during this chain iteration
+				ILibAsyncSocket_DatagramBatch_Queue(module, buffer, bufferLen, remoteAddress, UserFree);
+				continue;
+			}
+			ILibAsyncSocket_DatagramBatch_Flush(module); // Anything held must go first, to preserve ordering
+		}
+#endif
 		if (module->PendingSend_Tail != NULL || module->FinConnect == 0)
 		{
 			// There are still bytes that are pending to be sent, or pending connection, so we need to queue this up
@@ -723,6 +1012,7 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 		else if (module->PendingSend_Tail == NULL && module->FinConnect != 0)
 		{
 			// No pending data, so we can try to send now
+			module->PendingBytesToSend += (int)bufferLen;
 			if (remoteAddress == NULL || remoteAddress->sa_family == AF_UNIX)
 			{
 				// Set MSG_NOSIGNAL since we don't want to get Broken Pipe signals in Linux, ignored if Windows.
@@ -732,6 +1022,7 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 			{
 				bytesSent = sendto(module->internalSocket, buffer, (int)bufferLen, MSG_NOSIGNAL, (struct sockaddr*)remoteAddress, INET_SOCKADDR_LENGTH(remoteAddress->sa_family)); // No dataloss, capped to INT32_MAX
 			}
+			ILibAsyncSocket_Metrics_Sent(module, (int)bufferLen, bytesSent);
 #ifdef WIN32
 			if ((bytesSent > 0 && bytesSent < (int)bufferLen) || (bytesSent < 0 && WSAGetLastError() == WSAEWOULDBLOCK))
 #else
@@ -778,6 +1069,7 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 	}
 	va_end(vlist); 
 
+	ILibAsyncSocket_Metrics_Queued(module);
 	if (lockOverride == 0) { ILibSpinLock_UnLock(&(module->SendLock)); }
 	if (notok != 0)
 	{
@@ -789,6 +1081,77 @@ ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocket_Soc
 	return (retVal);
 }
 
+#ifdef ILibAsyncSocket_SENDFILE_SUPPORTED
+int ILibAsyncSocket_CanSendFile(ILibAsyncSocket_SocketModule socketModule)
+{
+	struct ILibAsyncSocketModule *module = (struct ILibAsyncSocketModule*)socketModule;
+	if (module == NULL || module->internalSocket == ~0 || module->RemoteAddress.sin6_family == AF_UNIX) { return(0); }
+#ifndef MICROSTACK_NOTLS
+	if (module->ssl != NULL) { return(0); }
+#endif
+	return(1);
+}
+enum ILibAsyncSocket_SendStatus ILibAsyncSocket_SendFile(ILibAsyncSocket_SocketModule socketModule, int fd, long long offset, unsigned int length)
+{
+	struct ILibAsyncSocketModule *module = (struct ILibAsyncSocketModule*)socketModule;
+	struct ILibAsyncSocket_SendData *data;
+	enum ILibAsyncSocket_SendStatus retVal = ILibAsyncSocket_ALL_DATA_SENT;
+	off_t fileOffset = (off_t)offset;
+	int bytesSent = 0;
+
+	if (module == NULL || module->internalSocket == ~0) { return(ILibAsyncSocket_SEND_ON_CLOSED_SOCKET_ERROR); }
+	if (length > INT32_MAX || ILibAsyncSocket_CanSendFile(module) == 0) { return(ILibAsyncSocket_BUFFER_TOO_LARGE); }
+	if (length == 0) { return(ILibAsyncSocket_ALL_DATA_SENT); }
+
+	ILibSpinLock_Lock(&(module->SendLock));
+	if (module->PendingSend_Tail == NULL && module->FinConnect != 0)
+	{
+		// No pending data, so we can try to send now. This socket is O_NONBLOCK, so this will never block
+		bytesSent = (int)sendfile(module->internalSocket, fd, &fileOffset, (size_t)length);
+		ILibAsyncSocket_Metrics_Sent(module, (int)length, bytesSent);
+		if ((bytesSent < 0 && errno != EWOULDBLOCK) || bytesSent == 0)
+		{
+			// sendfile() returns 0 at the end of the file, which means the file is shorter than the segment
+			ILibAsyncSocket_SendError(module);
+			ILibSpinLock_UnLock(&(module->SendLock));
+			return(ILibAsyncSocket_SEND_ON_CLOSED_SOCKET_ERROR);
+		}
+		if (bytesSent > 0) { module->TotalBytesSent += bytesSent; }
+		if (bytesSent == (int)length)
+		{
+			ILibSpinLock_UnLock(&(module->SendLock));
+			return(ILibAsyncSocket_ALL_DATA_SENT);
+		}
+		if (bytesSent < 0) { bytesSent = 0; }
+	}
+
+	// Queue the rest of the segment. sendfile() advances fileOffset, so it picks up where we left off
+	data = (ILibAsyncSocket_SendData*)ILibMemory_Allocate(sizeof(ILibAsyncSocket_SendData), 0, NULL, NULL);
+	data->isFileSegment = 1;
+	data->fileDescriptor = fd;
+	data->fileOffset = fileOffset;
+	data->bufferSize = (int)length;
+	data->bytesSent = bytesSent;
+	data->UserFree = ILibAsyncSocket_MemoryOwnership_STATIC;
+	module->PendingBytesToSend += (unsigned int)(length - bytesSent);
+	if (module->PendingSend_Tail == NULL)
+	{
+		module->PendingSend_Head = module->PendingSend_Tail = data;
+	}
+	else
+	{
+		module->PendingSend_Tail->Next = data;
+		module->PendingSend_Tail = data;
+	}
+	retVal = ILibAsyncSocket_NOT_ALL_DATA_SENT_YET;
+	ILibAsyncSocket_Metrics_Queued(module);
+	ILibSpinLock_UnLock(&(module->SendLock));
+
+	if (!ILibIsRunningOnChainThread(module->Transport.ChainLink.ParentChain)) ILibForceUnBlockChain(module->Transport.ChainLink.ParentChain);
+	return(retVal);
+}
+#endif
+
 /*! \fn ILibAsyncSocket_Disconnect(ILibAsyncSocket_SocketModule socketModule)
 \brief Disconnects an ILibAsyncSocket
 \param socketModule The ILibAsyncSocket to disconnect
@@ -922,6 +1285,8 @@ void ILibAsyncSocket_ConnectTo(void* socketModule, struct sockaddr *localInterfa
 	module->PendingBytesToSend = 0;
 	module->TotalBytesSent = 0;
 	module->PAUSE = 0;
+	module->PausedSince = 0;
+	memset(&(module->Metrics), 0, sizeof(ILibTransport_Metrics));
 	module->user = user;
 	module->OnInterrupt = InterruptPtr;
 	if ((tmp = (char*)realloc(module->buffer, module->InitialSize)) == NULL) ILIBCRITICALEXIT(254);
@@ -1188,6 +1553,17 @@ void ILibProcessAsyncSocket(struct ILibAsyncSocketModule *Reader, int pendingRea
 		return;
 	}
 
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	if (Reader->DatagramBatch != NULL && Reader->RemoteAddress.sin6_family != AF_UNIX)
+	{
+		// Finish delivering the last batch before reading another one
+		ILibAsyncSocket_DatagramBatch_Deliver(Reader);
+		if (Reader->DatagramBatch->recvIndex < Reader->DatagramBatch->recvCount || pendingRead == 0 || Reader->internalSocket == ~0) { return; }
+		if (ILibAsyncSocket_DatagramBatch_Receive(Reader) >= 0) { return; }
+		// recvmmsg() failed, so fall through to recvfrom(), which reports the error the usual way
+	}
+#endif
+
 	
 	//
 	// Try to read from the socket
@@ -1234,6 +1610,7 @@ void ILibProcessAsyncSocket(struct ILibAsyncSocketModule *Reader, int pendingRea
 			{
 				bytesReceived = recvfrom(Reader->internalSocket, Reader->readBioBuffer_mem + Reader->readBioBuffer->length, (int)(Reader->readBioBuffer->max - Reader->readBioBuffer->length), 0, (struct sockaddr*)&(Reader->SourceAddress), &len);
 			}
+			ILibAsyncSocket_Metrics_Received(Reader, bytesReceived);
 			if (bytesReceived > 0)
 			{
 				Reader->readBioBuffer->length += bytesReceived;
@@ -1288,11 +1665,13 @@ void ILibProcessAsyncSocket(struct ILibAsyncSocketModule *Reader, int pendingRea
 						if (j > 0) 
 						{ 
 							Reader->EndPointer += j; 
+							ILibAsyncSocket_Metrics_Add(Reader, tlsRecordsReceived, 1);
 							if (Reader->MallocSize - Reader->EndPointer == 0)
 							{
 								Reader->MallocSize = (Reader->MallocSize + MEMORYCHUNKSIZE < Reader->MaxBufferSize) ? (Reader->MallocSize + MEMORYCHUNKSIZE) : (Reader->MaxBufferSize == 0 ? (Reader->MallocSize + MEMORYCHUNKSIZE) : Reader->MaxBufferSize);
 								temp = Reader->buffer;
 								if ((Reader->buffer = (char*)realloc(Reader->buffer, Reader->MallocSize)) == NULL) ILIBCRITICALEXIT(254);
+								ILibAsyncSocket_Metrics_Add(Reader, bufferGrowEvents, 1);
 								//
 								// If this realloc moved the buffer somewhere, we need to inform people of it
 								//
@@ -1339,6 +1718,7 @@ void ILibProcessAsyncSocket(struct ILibAsyncSocketModule *Reader, int pendingRea
 				bytesReceived = (int)recvfrom(Reader->internalSocket, Reader->buffer + Reader->EndPointer, Reader->MallocSize - Reader->EndPointer, 0, (struct sockaddr*)&(Reader->SourceAddress), &len);
 			}
 #endif
+			ILibAsyncSocket_Metrics_Received(Reader, bytesReceived);
 			if (Reader->RemoteAddress.sin6_family != AF_UNIX)
 			{
 				ILib6to4((struct sockaddr*)&(Reader->SourceAddress));
@@ -1491,6 +1871,7 @@ void ILibProcessAsyncSocket(struct ILibAsyncSocketModule *Reader, int pendingRea
 
 			temp = Reader->buffer;
 			if ((Reader->buffer = (char*)realloc(Reader->buffer, Reader->MallocSize)) == NULL) ILIBCRITICALEXIT(254);
+			ILibAsyncSocket_Metrics_Add(Reader, bufferGrowEvents, 1);
 			//
 			// If this realloc moved the buffer somewhere, we need to inform people of it
 			//
@@ -1560,6 +1941,15 @@ void ILibAsyncSocket_PreSelect(void* socketModule,fd_set *readset, fd_set *write
 
 	ILibSpinLock_Lock(&(module->SendLock));
 
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	if (module->DatagramBatch != NULL)
+	{
+		// Write everything that was sent during this chain iteration. Anything sent before PostSelect is written immediately, so it does not wait on select()
+		ILibAsyncSocket_DatagramBatch_Flush(module);
+		module->DatagramBatch->preSelectDone = 1;
+	}
+#endif
+
 	if (module->internalSocket != -1)
 	{
 		if (module->timeout_milliSeconds != 0)
@@ -1725,6 +2115,10 @@ void ILibAsyncSocket_PostSelect(void* socketModule, int slct, fd_set *readset, f
 	int fd_error, fd_read, fd_write;
 	struct ILibAsyncSocketModule *module = (struct ILibAsyncSocketModule*)socketModule;
 
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	if (module->DatagramBatch != NULL) { module->DatagramBatch->preSelectDone = 0; }
+#endif
+
 	// If there is no internal socket or no events, just return now.
 	if (module->internalSocket == -1 || module->FinConnect == -1) return;
 	fd_error = FD_ISSET(module->internalSocket, errorset);
@@ -1944,6 +2338,7 @@ void ILibAsyncSocket_PostSelect(void* socketModule, int slct, fd_set *readset, f
 					if (module->PendingSend_Head->buffer != NULL && module->PendingSend_Head->bytesSent != module->PendingSend_Head->bufferSize)
 					{
 						bytesSent = (int)send(module->internalSocket, module->PendingSend_Head->buffer + module->PendingSend_Head->bytesSent, module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent, MSG_NOSIGNAL); // Klocwork reports that this could block while holding a lock... This socket has been set to O_NONBLOCK, so that will never happen
+						ILibAsyncSocket_Metrics_Sent(module, module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent, bytesSent);
 						TLSLOG1("  << Draining[%d]: %d >>\n", module->internalSocket, bytesSent);
 
 						if (bytesSent > 0)
@@ -1983,6 +2378,7 @@ void ILibAsyncSocket_PostSelect(void* socketModule, int slct, fd_set *readset, f
 				{
 					BIO_clear_retry_flags(module->writeBio);
 					bytesSent = (int)send(module->internalSocket, module->writeBioBuffer->data, (int)(module->writeBioBuffer->length), MSG_NOSIGNAL); // Klocwork reports that this could block while holding a lock... This socket has been set to O_NONBLOCK, so that will never happen
+					ILibAsyncSocket_Metrics_Sent(module, (int)(module->writeBioBuffer->length), bytesSent);
 					TLSLOG1("  << BIOBUFFER[%d] drain: %d of %d bytes >>\n", module->internalSocket, bytesSent, (int)module->writeBioBuffer->length);
 #ifdef WIN32
 					if ((bytesSent > 0 && bytesSent < (int)(module->writeBioBuffer->length)) || (bytesSent < 0 && WSAGetLastError() == WSAEWOULDBLOCK))
@@ -2050,6 +2446,21 @@ void ILibAsyncSocket_PostSelect(void* socketModule, int slct, fd_set *readset, f
 			else
 #endif
 			{
+#ifdef ILibAsyncSocket_SENDFILE_SUPPORTED
+				if (module->PendingSend_Head->isFileSegment != 0)
+				{
+					bytesSent = (int)sendfile(module->internalSocket, module->PendingSend_Head->fileDescriptor, &(module->PendingSend_Head->fileOffset), (size_t)(module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent));
+					if (bytesSent == 0)
+					{
+						// sendfile() returns 0 at the end of the file, so a file shorter than the queued segment can never finish sending
+						module->PendingBytesToSend -= (unsigned int)(module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent);
+						ILibAsyncSocket_SendError(module);
+						bytesSent = -1;
+						break;
+					}
+				}
+				else
+#endif
 				if (module->PendingSend_Head->remoteAddress.sin6_family == 0 || module->PendingSend_Head->remoteAddress.sin6_family == AF_UNIX)
 				{
 					bytesSent = (int)send(module->internalSocket, module->PendingSend_Head->buffer + module->PendingSend_Head->bytesSent, module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent, MSG_NOSIGNAL); // Klocwork reports that this could block while holding a lock... This socket has been set to O_NONBLOCK, so that will never happen
@@ -2058,6 +2469,7 @@ void ILibAsyncSocket_PostSelect(void* socketModule, int slct, fd_set *readset, f
 				{
 					bytesSent = (int)sendto(module->internalSocket, module->PendingSend_Head->buffer + module->PendingSend_Head->bytesSent, module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent, MSG_NOSIGNAL, (struct sockaddr*)&module->PendingSend_Head->remoteAddress, INET_SOCKADDR_LENGTH(module->PendingSend_Head->remoteAddress.sin6_family)); // Klocwork reports that this could block while holding a lock... This socket has been set to O_NONBLOCK, so that will never happen
 				}
+				ILibAsyncSocket_Metrics_Sent(module, module->PendingSend_Head->bufferSize - module->PendingSend_Head->bytesSent, bytesSent);
 
 				if (bytesSent == 0) { TRY_TO_SEND = 0; } //To avoid get stuck in an infinite loop when bytesSent == 0
 
@@ -2193,6 +2605,49 @@ unsigned int ILibAsyncSocket_GetTotalBytesSent(ILibAsyncSocket_SocketModule sock
 	return(module->TotalBytesSent);
 }
 
+/*! \fn ILibAsyncSocket_GetMetrics(ILibAsyncSocket_SocketModule socketModule, ILibTransport_Metrics *metrics)
+\brief Fetches the transport counters for this connection
+\param socketModule The ILibAsyncSocket to query
+\param[out] metrics The counters since the connection was established
+*/
+void ILibAsyncSocket_GetMetrics(ILibAsyncSocket_SocketModule socketModule, ILibTransport_Metrics *metrics)
+{
+	struct ILibAsyncSocketModule *module = (struct ILibAsyncSocketModule*)socketModule;
+
+	ILibSpinLock_Lock(&(module->SendLock));
+	memcpy_s(metrics, sizeof(ILibTransport_Metrics), &(module->Metrics), sizeof(ILibTransport_Metrics));
+	ILibSpinLock_UnLock(&(module->SendLock));
+	if (module->PAUSE > 0 && module->PausedSince != 0) { metrics->pausedMilliseconds += (uint64_t)(ILibGetUptime() - module->PausedSince); }
+}
+
+/*! \fn ILibAsyncSocket_GetTcpInfo(ILibAsyncSocket_SocketModule socketModule, unsigned int *rtt, unsigned int *rttvar, unsigned int *cwnd)
+\brief Queries the kernel's view of the TCP connection (Linux only)
+\param socketModule The ILibAsyncSocket to query
+\param[out] rtt Smoothed round trip time, in microseconds
+\param[out] rttvar Round trip time variance, in microseconds
+\param[out] cwnd Congestion window, in segments
+\returns 0 on success, nonzero if not available
+*/
+int ILibAsyncSocket_GetTcpInfo(ILibAsyncSocket_SocketModule socketModule, unsigned int *rtt, unsigned int *rttvar, unsigned int *cwnd)
+{
+#if defined(_POSIX) && defined(TCP_INFO) && !defined(__APPLE__) && !defined(_FREEBSD)
+	struct ILibAsyncSocketModule *module = (struct ILibAsyncSocketModule*)socketModule;
+	struct tcp_info info;
+	socklen_t infoLen = (socklen_t)sizeof(info);
+
+	if (module->internalSocket == ~0 || module->RemoteAddress.sin6_family == AF_UNIX) { return(1); }
+	if (getsockopt(module->internalSocket, IPPROTO_TCP, TCP_INFO, (void*)&info, &infoLen) != 0) { return(1); }
+	*rtt = info.tcpi_rtt;
+	*rttvar = info.tcpi_rttvar;
+	*cwnd = info.tcpi_snd_cwnd;
+	return(0);
+#else
+	UNREFERENCED_PARAMETER(socketModule);
+	*rtt = *rttvar = *cwnd = 0;
+	return(1);
+#endif
+}
+
 /*! \fn ILibAsyncSocket_ResetTotalBytesSent(ILibAsyncSocket_SocketModule socketModule)
 \brief Resets the total bytes sent counter
 \param socketModule The ILibAsyncSocket to reset
@@ -2356,6 +2811,8 @@ void ILibAsyncSocket_UseThisSocket(ILibAsyncSocket_SocketModule socketModule, in
 	module->user = user;
 	module->FinConnect = 1;
 	module->PAUSE = 0;
+	module->PausedSince = 0;
+	memset(&(module->Metrics), 0, sizeof(ILibTransport_Metrics));
 	#ifndef MICROSTACK_NOTLS
 	module->SSLConnect = 0;
 	#endif
@@ -2472,6 +2929,7 @@ void ILibAsyncSocket_Pause(ILibAsyncSocket_SocketModule socketModule)
 	struct ILibAsyncSocketModule *sm = (struct ILibAsyncSocketModule*)socketModule;
 	if (socketModule == NULL) { return; }
 
+	if (sm->PAUSE <= 0) { sm->PausedSince = ILibGetUptime(); }
 	sm->PAUSE = 1;
 }
 /*! \fn ILibAsyncSocket_Resume(ILibAsyncSocket_SocketModule socketModule)
@@ -2488,6 +2946,7 @@ void ILibAsyncSocket_Resume(ILibAsyncSocket_SocketModule socketModule)
 	if (sm->PAUSE > 0)
 	{
 		ILibRemoteLogging_printf(ILibChainGetLogger(sm->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_Microstack_AsyncSocket, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Unblocking Chain");
+		if (sm->PausedSince != 0) { ILibAsyncSocket_Metrics_Add(sm, pausedMilliseconds, ILibGetUptime() - sm->PausedSince); sm->PausedSince = 0; }
 		sm->PAUSE = -1;
 		ILibForceUnBlockChain(sm->Transport.ChainLink.ParentChain);
 	}
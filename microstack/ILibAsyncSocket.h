@@ -171,6 +171,8 @@ void *ILibAsyncSocket_GetSocket(ILibAsyncSocket_SocketModule module);
 unsigned int ILibAsyncSocket_GetPendingBytesToSend(ILibAsyncSocket_SocketModule socketModule);
 unsigned int ILibAsyncSocket_GetTotalBytesSent(ILibAsyncSocket_SocketModule socketModule);
 void ILibAsyncSocket_ResetTotalBytesSent(ILibAsyncSocket_SocketModule socketModule);
+void ILibAsyncSocket_GetMetrics(ILibAsyncSocket_SocketModule socketModule, ILibTransport_Metrics *metrics);
+int ILibAsyncSocket_GetTcpInfo(ILibAsyncSocket_SocketModule socketModule, unsigned int *rtt, unsigned int *rttvar, unsigned int *cwnd);
 
 void ILibAsyncSocket_ConnectTo(void* socketModule, struct sockaddr *localInterface, struct sockaddr *remoteAddress, ILibAsyncSocket_OnInterrupt InterruptPtr, void *user);
 
@@ -193,6 +195,43 @@ enum ILibAsyncSocket_SendStatus ILibAsyncSocket_SendTo_MultiWrite(ILibAsyncSocke
 #define ILibAsyncSocket_Send(socketModule, buffer, length, UserFree) ILibAsyncSocket_SendTo_MultiWrite(socketModule, NULL, 1, buffer, (size_t)length, UserFree)
 #define ILibAsyncSocket_SendTo(socketModule, buffer, length, remoteAddress, UserFree) ILibAsyncSocket_SendTo_MultiWrite(socketModule, remoteAddress, 1, buffer, (size_t)length, UserFree)
 
+#if defined(_POSIX) && !defined(__APPLE__) && !defined(_FREEBSD) && !defined(NO_SENDFILE)
+#define ILibAsyncSocket_SENDFILE_SUPPORTED
+/*! \fn ILibAsyncSocket_CanSendFile(ILibAsyncSocket_SocketModule socketModule)
+\brief Determines if \a ILibAsyncSocket_SendFile can be used on this connection (Plaintext TCP only)
+\param socketModule The \a ILibAsyncSocket_SocketModule to query
+\returns Nonzero if file segments can be sent zero-copy, 0 otherwise
+*/
+int ILibAsyncSocket_CanSendFile(ILibAsyncSocket_SocketModule socketModule);
+/*! \fn ILibAsyncSocket_SendFile(ILibAsyncSocket_SocketModule socketModule, int fd, long long offset, unsigned int length)
+\brief Sends a segment of a file onto the TCP stream, using sendfile() so the data is never copied into user space
+\par
+The segment is queued behind any pending data, so it can be freely mixed with \a ILibAsyncSocket_Send. The file descriptor
+must remain open until the segment has been sent, which is signaled by OnSendOK when NOT_ALL_DATA_SENT_YET is returned.
+\param socketModule The \a ILibAsyncSocket_SocketModule to send data on
+\param fd The file descriptor to read from
+\param offset The offset into the file to start sending from
+\param length The number of bytes to send
+\returns \a ILibAsyncSocket_SendStatus indicating the send status
+*/
+enum ILibAsyncSocket_SendStatus ILibAsyncSocket_SendFile(ILibAsyncSocket_SocketModule socketModule, int fd, long long offset, unsigned int length);
+#endif
+
+#if defined(__linux__) && !defined(NO_MMSG)
+#define ILibAsyncSocket_MMSG_SUPPORTED
+#define ILibAsyncSocket_DatagramBatchSize 16
+/*! \fn ILibAsyncSocket_SetDatagramBatching(ILibAsyncSocket_SocketModule socketModule, int enable)
+\brief Reads and writes datagrams in batches, using recvmmsg() and sendmmsg() (UDP only)
+\par
+Each read event drains up to \a ILibAsyncSocket_DatagramBatchSize datagrams with one system call, and delivers them to OnData in one pass.
+Datagrams sent from the chain thread are held until the end of the chain iteration, and are then written with one system call.
+Batching is off by default, as it holds a 64 KB send buffer for each socket. It is not enabled if the receive buffer is larger than 4096 bytes.
+\param socketModule The \a ILibAsyncSocket_SocketModule to configure
+\param enable Nonzero to enable batching, 0 to disable
+*/
+void ILibAsyncSocket_SetDatagramBatching(ILibAsyncSocket_SocketModule socketModule, int enable);
+#endif
+
 void ILibAsyncSocket_Disconnect(ILibAsyncSocket_SocketModule socketModule);
 void ILibAsyncSocket_GetBuffer(ILibAsyncSocket_SocketModule socketModule, char **buffer, int *BeginPointer, int *EndPointer);
 
@@ -1001,6 +1001,7 @@ typedef struct ILibBaseChain
 	int selectTimeout;
 	void *node;
 	int lastDescriptorCount;
+	ILibTransport_Metrics TransportMetrics;
 }ILibBaseChain;
 
 #if defined(ILIBMEMTRACK) && !defined(ILIBCHAIN_GLOBAL_LOCK)
@@ -3445,6 +3446,29 @@ int ILibChain_GetMinimumTimer(void *chain)
 	ILibLinkedList_UnLock(LifeTimeMonitor->ObjectList);
 	return(minimum);
 }
+/*! \fn ILibChain_GetTransportMetrics(void *chain)
+\brief Fetches the transport counters accumulated by every socket on this chain
+\param chain Microstack Chain to query
+\returns Pointer to the chain's counters
+*/
+ILibTransport_Metrics *ILibChain_GetTransportMetrics(void *chain)
+{
+	return(chain != NULL ? &(((ILibBaseChain*)chain)->TransportMetrics) : NULL);
+}
+char *ILibChain_GetMetadataForTransports(void *chain)
+{
+	ILibTransport_Metrics *m = ILibChain_GetTransportMetrics(chain);
+	char *ret;
+	int len;
+
+#define ILibChain_TransportMetrics_FORMAT " Bytes Sent: %llu\n Bytes Received: %llu\n send() Calls: %llu\n recv() Calls: %llu\n Partial Writes: %llu\n Buffer Grow Events: %llu\n Paused: %llu milliseconds\n TLS Records Sent: %llu\n TLS Records Received: %llu\n Send Queue High Water: %llu bytes\n"
+#define ILibChain_TransportMetrics_VALUES (unsigned long long)m->bytesSent, (unsigned long long)m->bytesReceived, (unsigned long long)m->sendCalls, (unsigned long long)m->recvCalls, (unsigned long long)m->partialWrites, (unsigned long long)m->bufferGrowEvents, (unsigned long long)m->pausedMilliseconds, (unsigned long long)m->tlsRecordsSent, (unsigned long long)m->tlsRecordsReceived, (unsigned long long)m->sendQueueHighWater
+
+	len = snprintf(NULL, 0, ILibChain_TransportMetrics_FORMAT, ILibChain_TransportMetrics_VALUES);
+	ret = ILibMemory_SmartAllocate(len + 1);
+	sprintf_s(ret, ILibMemory_Size(ret), ILibChain_TransportMetrics_FORMAT, ILibChain_TransportMetrics_VALUES);
+	return(ret);
+}
 char *ILibChain_GetMetadataForTimers(void *chain)
 {
 	void *node;
@@ -7855,7 +7879,7 @@ void ILibLifeTime_Check(void *LifeTimeMonitorObject, fd_set *readset, fd_set *wr
 	if (LifeTimeMonitor->NextTriggerTick != -1 && *blocktime > (int)(LifeTimeMonitor->NextTriggerTick - CurrentTick))
 	{
 		int delta = (int)(LifeTimeMonitor->NextTriggerTick - CurrentTick);
-		if (delta < 1000) *blocktime = 1000; else *blocktime = delta;
+		*blocktime = delta < 0 ? 0 : delta; // Don't round short timers up, or they fire late (SCTP retransmit, pacing)
 	}
 }
 
@@ -9926,7 +9950,7 @@ long long ILibGetUptime()
 	struct timespec ts; 
 	memset(&ts, 0, sizeof ts);
 	clock_gettime(CLOCK_MONOTONIC, &ts);
-	return (((long long)ts.tv_sec) * 1000) + ((((long long)ts.tv_nsec) / 1000) % 1000);
+	return (((long long)ts.tv_sec) * 1000) + (((long long)ts.tv_nsec) / 1000000);
 }
 #endif
 
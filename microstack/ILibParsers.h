@@ -626,6 +626,23 @@ int ILibIsRunningOnChainThread(void* chain);
 		ILibTransport_OnSendOK SendOkPtr;						/*!< [RESERVED: Encapsulated SendOK Callback] */
 		unsigned int IdentifierFlags;						/*!< ILibTransport Type Identifier */
 	}ILibTransport;
+
+	/*! \struct ILibTransport_Metrics
+	\brief Transport counters, kept for each socket and accumulated for each chain
+	*/
+	typedef struct ILibTransport_Metrics
+	{
+		uint64_t bytesSent;					/*!< Bytes written to the network */
+		uint64_t bytesReceived;				/*!< Bytes read from the network */
+		uint64_t sendCalls;					/*!< send()/sendto()/sendfile() system calls */
+		uint64_t recvCalls;					/*!< recv() system calls */
+		uint64_t partialWrites;				/*!< Writes that did not complete, so the remainder was queued */
+		uint64_t bufferGrowEvents;			/*!< Receive buffer reallocations */
+		uint64_t pausedMilliseconds;		/*!< Time spent with reading paused */
+		uint64_t tlsRecordsSent;			/*!< TLS application data records written */
+		uint64_t tlsRecordsReceived;		/*!< TLS application data records read */
+		uint64_t sendQueueHighWater;		/*!< Largest number of bytes that were queued to be sent */
+	}ILibTransport_Metrics;
 	/*! @} */
 
 
@@ -1077,6 +1094,8 @@ int ILibIsRunningOnChainThread(void* chain);
 	char *ILibChain_GetMetaDataFromDescriptorSet(void *chain, fd_set *inr, fd_set *inw, fd_set *ine);
 	char *ILibChain_GetMetaDataFromDescriptorSetEx(void *chain, fd_set *inr, fd_set *inw, fd_set *ine);
 	char *ILibChain_GetMetadataForTimers(void *chain);
+	ILibTransport_Metrics *ILibChain_GetTransportMetrics(void *chain);
+	char *ILibChain_GetMetadataForTransports(void *chain);
 	int ILibChain_GetMinimumTimer(void *chain);
 	ILibChain_Link **ILibChain_GetModules(void *chain);
 #ifdef WIN32
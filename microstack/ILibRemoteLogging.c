@@ -49,6 +49,7 @@ typedef struct ILibRemoteLogging_Session
 
 typedef struct ILibRemoteLogging_Module
 {
+	unsigned int EnabledMask;		// MUST be first, read without the lock by ILibRemoteLogging_IsEnabled()
 	sem_t LogSyncLock;
 	unsigned int LogFlags;
 
@@ -69,6 +70,26 @@ void ILibRemoteLogging_Destroy(ILibRemoteLogging module)
 	}
 }
 
+// Caches the union of all session flags, so disabled log statements can be skipped before formatting. Call with LogSyncLock held
+void ILibRemoteLogging_UpdateEnabledMask(ILibRemoteLogging_Module *obj)
+{
+	int i;
+	unsigned int mask = 0;
+
+	if (obj->RawForwardSink != NULL)
+	{
+		// Everything is forwarded, the other side does the filtering
+		obj->EnabledMask = 0xFFFFFFFF;
+		return;
+	}
+	for (i = 0; i < (int)(sizeof(obj->Sessions) / sizeof(ILibRemoteLogging_Session)); ++i)
+	{
+		if (obj->Sessions[i].UserContext == NULL) { break; }
+		mask |= obj->Sessions[i].Flags;
+	}
+	obj->EnabledMask = mask;
+}
+
 void ILibRemoteLogging_CompactSessions(ILibRemoteLogging_Session sessions[], int sessionsLength)
 {
 	int x=0,y=0;
@@ -139,6 +160,7 @@ void ILibRemoteLogging_SetRawForward(ILibRemoteLogging logger, int bufferOffset,
 {
 	((ILibRemoteLogging_Module*)logger)->RawForwardSink = onRawForward;
 	((ILibRemoteLogging_Module*)logger)->RawForwardOffset = bufferOffset;
+	ILibRemoteLogging_UpdateEnabledMask((ILibRemoteLogging_Module*)logger);
 }
 ILibRemoteLogging ILibRemoteLogging_Create(ILibRemoteLogging_OnWrite onOutput)
 {
@@ -172,6 +194,7 @@ void ILibRemoteLogging_DeleteUserContext(ILibRemoteLogging logger, void *userCon
 
 	sem_wait(&(obj->LogSyncLock));
 	ILibRemoteLogging_RemoveUserContext(obj->Sessions, sizeof(obj->Sessions) / sizeof(ILibRemoteLogging_Session), userContext);
+	ILibRemoteLogging_UpdateEnabledMask(obj);
 	sem_post(&(obj->LogSyncLock));
 }
 
@@ -384,6 +407,7 @@ int ILibRemoteLogging_Dispatch(ILibRemoteLogging loggingModule, char* data, int
 		{
 			// Disable Modules
 			session->Flags &= (0xFFFFFFFF ^ module);
+			ILibRemoteLogging_UpdateEnabledMask(obj);
 			sem_post(&(obj->LogSyncLock));
 			ILibRemoteLogging_Dispatch_Update(obj, module, "DISABLED", userContext);
 			
@@ -394,6 +418,7 @@ int ILibRemoteLogging_Dispatch(ILibRemoteLogging loggingModule, char* data, int
 			session->Flags &= 0xFFC0FFFF;							// Reset Verbosity Flags
 			session->Flags |= (flags << 16);						// Set Verbosity Flags
 			session->Flags |= (unsigned int)module;					// Enable Modules
+			ILibRemoteLogging_UpdateEnabledMask(obj);
 			sem_post(&(obj->LogSyncLock));
 			ILibRemoteLogging_Dispatch_Update(obj, module, "ENABLED", userContext);
 		}
@@ -639,6 +664,7 @@ void ILibRemoteLogging_FileTransport_CommandSink(ILibRemoteLogging sender, ILibR
 					unsigned short newFlags = ntohs(((unsigned short*)data)[1]);
 					obj->Sessions[i].Flags = (newFlags & 0x3F) << 16;
 					obj->Sessions[i].Flags |= (unsigned int)newModules;
+					ILibRemoteLogging_UpdateEnabledMask(obj);
 
 					ILibLinkedList_FileBacked_ReloadRoot(ft->logFile);
 					ft->logFile->flags = (unsigned int)ft->enabled << 31;
@@ -69,6 +69,17 @@ char* ILibRemoteLogging_ConvertAddress(struct sockaddr* addr);
 #ifdef _REMOTELOGGING
 	char* ILibRemoteLogging_ConvertToHex(char* inVal, int inValLength);
 	void ILibRemoteLogging_printf(ILibRemoteLogging loggingModule, ILibRemoteLogging_Modules module, ILibRemoteLogging_Flags flags, char* format, ...);
+	//! Checks the logger's cached session mask, to see if a log statement with the given module/verbosity would be delivered
+	/*!
+		\b NOTE: Reads the mask without locking, so a session being attached/detached concurrently may gain/lose a line
+		\param loggingModule ILibRemoteLogging Logging Module (may be NULL)
+		\param module ILibRemoteLogging_Modules Describing the source of the message
+		\param flags ILibRemoteLogging_Flags Logging Flags
+		\return Non-zero if the statement should be formatted
+	*/
+	#define ILibRemoteLogging_IsEnabled(loggingModule, module, flags) ((((unsigned int)(module)) & ILibRemoteLogging_Modules_ConsolePrint) != 0 || ((loggingModule) != NULL && (((unsigned int*)(loggingModule))[0] & (unsigned int)(module)) != 0 && ((((unsigned int*)(loggingModule))[0] >> 16) & 0x3E) >= (unsigned int)(flags)))
+	//! Same as ILibRemoteLogging_printf, but the arguments are only evaluated if ILibRemoteLogging_IsEnabled(), for use on per-packet/per-read paths
+	#define ILibRemoteLogging_printfEx(loggingModule, module, flags, ...) do { ILibRemoteLogging _ilibLogger = (loggingModule); if (ILibRemoteLogging_IsEnabled(_ilibLogger, module, flags)) { ILibRemoteLogging_printf(_ilibLogger, module, flags, __VA_ARGS__); } } while (0)
 
 	ILibRemoteLogging ILibRemoteLogging_Create(ILibRemoteLogging_OnWrite onOutput);
 	ILibTransport* ILibRemoteLogging_CreateFileTransport(ILibRemoteLogging loggingModule, ILibRemoteLogging_Modules modules, ILibRemoteLogging_Flags flags, char* path, int pathLen);
@@ -85,6 +96,8 @@ char* ILibRemoteLogging_ConvertAddress(struct sockaddr* addr);
 #else
 	#define ILibRemoteLogging_ConvertToHex(...) ;
 	#define ILibRemoteLogging_printf(...) ;
+	#define ILibRemoteLogging_IsEnabled(...) 0
+	#define ILibRemoteLogging_printfEx(...) ;
 	#define ILibRemoteLogging_Create(...) NULL;
 	#define ILibRemoteLogging_SetRawForward(...) ;
 	#define ILibRemoteLogging_CreateFileTransport(...) NULL;
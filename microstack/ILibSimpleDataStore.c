@@ -18,6 +18,8 @@ limitations under the License.
 #include "ILibCrypto.h"
 #ifndef WIN32
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #else
 #include <io.h>
@@ -31,6 +33,7 @@ limitations under the License.
 
 
 #define SHA384HASHSIZE 48
+#define ILibSimpleDataStore_KeyIndex_MaxLevel 20
 
 #ifdef _WIN64
 	#define ILibSimpleDataStore_GetPosition(filePtr) _ftelli64(filePtr)
@@ -40,6 +43,21 @@ limitations under the License.
 	#define ILibSimpleDataStore_SeekPosition(filePtr, position, seekMode) fseek(filePtr, (long)position, seekMode)
 #endif
 
+#ifdef WIN32
+	#define ILibSimpleDataStore_CurrentThread() ((uintptr_t)GetCurrentThreadId())
+	#define ILibSimpleDataStore_CurrentView(root) ((ILibSimpleDataStore_MappedView*)InterlockedCompareExchangePointer((PVOID volatile*)&((root)->mapped), NULL, NULL))
+	#define ILibSimpleDataStore_PublishView(root, v) InterlockedExchangePointer((PVOID volatile*)&((root)->mapped), (v))
+#else
+	#define ILibSimpleDataStore_CurrentThread() ((uintptr_t)pthread_self())
+	#if defined(__ATOMIC_ACQUIRE)
+		#define ILibSimpleDataStore_CurrentView(root) __atomic_load_n(&((root)->mapped), __ATOMIC_ACQUIRE)
+		#define ILibSimpleDataStore_PublishView(root, v) __atomic_store_n(&((root)->mapped), (v), __ATOMIC_RELEASE)
+	#else
+		#define ILibSimpleDataStore_CurrentView(root) ((ILibSimpleDataStore_MappedView*)NULL)	// Readers always pick up the view under readerLock
+		#define ILibSimpleDataStore_PublishView(root, v) (root)->mapped = (v)
+	#endif
+#endif
+
 typedef struct ILibSimpleDataStore_Root
 {
 	FILE* dataFile;
@@ -55,8 +73,30 @@ typedef struct ILibSimpleDataStore_Root
 	void* warningSinkUser;
 	int error;
 	int createdAsNew;
+	int readonly;
 	ILibSimpleDataStore_WriteErrorHandler ErrorHandler;
 	void *ErrorHandlerUser;
+	struct ILibSimpleDataStore_MappedView *mapped;	// Read-only view of dataFile, created on demand by ILibSimpleDataStore_MapValue()
+	char *batch;			// Records staged by ILibSimpleDataStore_BatchBegin(), NULL if no batch is open
+	size_t batchLen;
+	size_t batchSize;
+	ILibHashtable batchKeys;	// Keys with a record staged in the open batch
+	struct ILibSimpleDataStore_CompactionState *compaction;	// Incremental compaction in progress, NULL if none
+	ILibSimpleDataStore_CompactionStats compactionStats;
+	struct ILibSimpleDataStore_KeyIndexNode *keyIndex[ILibSimpleDataStore_KeyIndex_MaxLevel];	// Sorted skip list of the keys in keyTable, built by the first ordered enumeration
+	struct ILibSimpleDataStore_KeyIndexNode **keyIndexTail[ILibSimpleDataStore_KeyIndex_MaxLevel];	// Last link of each level
+	int keyIndexValid;
+	uint32_t keyIndexSeed;
+	uint32_t keyIndexVersion;	// Bumped when index nodes are freed, so an enumeration knows to seek again
+	struct ILibSimpleDataStore_PutStream *putStream;	// Streaming put in progress, NULL if none
+	ILibSimpleDataStore_RecordFormats recordFormat;		// Check value written with new records
+	ILibHashtable contentHashes;	// keys --> ILibSimpleDataStore_ContentHash, SHA384 of values stored with a CRC32C check value, created by the first GetHash of one
+	struct ILibSimpleDataStore_WriteBack *writeBack;	// Write-back tier, NULL unless enabled by ILibSimpleDataStore_ConfigWriteBack()
+	ILibReaderWriterLock rwLock;	// Shared by readers, exclusive for anything that changes the store
+	volatile uintptr_t writer;		// Thread holding rwLock exclusively, 0 if none
+	int writerDepth;				// Locks taken by that thread, so it can call back into the store
+	sem_t readerLock;				// Guards what readers fill in on demand: the mapped view, content hashes, pending value hashes and decoded values
+	struct ILibSimpleDataStore_DecodedCache *decoded;	// Decoded values by hash, NULL unless enabled by ILibSimpleDataStore_ConfigDecodedCache()
 } ILibSimpleDataStore_Root;
 
 /* File Format                 
@@ -69,6 +109,42 @@ Variable	- Key
 Variable	- Value
 ------------------------------------------ */
 
+/* CRC32C Check Value (ILibSimpleDataStore_RecordFormat_CRC32C, in place of the SHA384 hash)
+------------------------------------------
+ 4 Bytes	- Magic (network byte order)
+ 4 Bytes	- CRC32C of the value (network byte order)
+40 Bytes	- Zero
+------------------------------------------
+Each record is checked in the format of its own check value, so both formats can be mixed in one file */
+#define ILibSimpleDataStore_CRC32C_MAGIC 0x43524331
+
+/* Index Snapshot Format (<filePath>.idx, written on Close and after Compact)
+------------------------------------------
+ 4 Bytes	- Magic/Version (native byte order)
+ 4 Bytes	- Entry count
+ 8 Bytes	- Data file end offset covered by the snapshot
+ 8 Bytes	- Dirty size
+48 Bytes	- SHA384 of the data file bytes just before the end offset
+Entries		- Key length, Value length, Value offset, SHA384 hash, Key
+48 Bytes	- SHA384 of everything above
+------------------------------------------ */
+#define ILibSimpleDataStore_IndexSnapshot_MAGIC 0x49445831
+
+/* Chunked Value Format (key stored with the inverted crc32c of the key appended, all integers in network byte order)
+------------------------------------------
+Variable	- Chunks, each deflated if that made it smaller
+Variable	- Chunk table, offset, stored length, flags and SHA384 of each uncompressed chunk
+48 Bytes	- SHA384 of the whole uncompressed value
+ 4 Bytes	- Uncompressed length
+ 4 Bytes	- Chunk size
+ 4 Bytes	- Chunk count
+ 4 Bytes	- Magic
+------------------------------------------
+The record hash covers the value as stored, so the record is validated like any other when the file is loaded */
+#define ILibSimpleDataStore_ChunkTrailer_MAGIC 0x43484B31
+#define ILibSimpleDataStore_ChunkFlags_Compressed 0x01
+#define ILibSimpleDataStore_MaxChunkSize 16777216
+
 #define ILibSimpleDataStore_RecordHeader_ValueOffset(h) (((uint64_t*)(((char*)h) - sizeof(uint64_t)))[0])
 
 #pragma pack(push, 1)
@@ -98,14 +174,61 @@ typedef struct ILibSimpleDataStore_RecordHeader_64
 	char reserved[12];
 	char key[];
 } ILibSimpleDataStore_RecordHeader_64;
+typedef struct ILibSimpleDataStore_IndexHeader
+{
+	unsigned int magic;
+	unsigned int entryCount;
+	uint64_t endOffset;
+	uint64_t dirtySize;
+	char tailHash[SHA384HASHSIZE];
+} ILibSimpleDataStore_IndexHeader;
+typedef struct ILibSimpleDataStore_IndexRecord
+{
+	int keyLen;
+	int valueLength;
+	uint64_t valueOffset;
+	char valueHash[SHA384HASHSIZE];
+	char key[];
+} ILibSimpleDataStore_IndexRecord;
+typedef struct ILibSimpleDataStore_CompactionKey
+{
+	uint64_t oldOffset;		// Value offset when the compaction started
+	uint64_t newOffset;		// Value offset in the compacted file, 0 if not copied
+	int keyLen;
+	char key[];
+} ILibSimpleDataStore_CompactionKey;
+typedef struct ILibSimpleDataStore_ChunkInfo
+{
+	unsigned int offset;		// Offset of the stored chunk from the start of the value
+	unsigned int length;		// Stored length of the chunk
+	unsigned int flags;
+	char hash[SHA384HASHSIZE];	// SHA384 of the uncompressed chunk
+} ILibSimpleDataStore_ChunkInfo;
+typedef struct ILibSimpleDataStore_ChunkTrailer
+{
+	char hash[SHA384HASHSIZE];
+	unsigned int length;
+	unsigned int chunkSize;
+	unsigned int chunkCount;
+	unsigned int magic;
+} ILibSimpleDataStore_ChunkTrailer;
 #pragma pack(pop)
 
 
+typedef struct ILibSimpleDataStore_PendingValue
+{
+	int valueLength;
+	int hashed;				// valueHash was computed by GetHash
+	char valueHash[SHA384HASHSIZE];
+	char value[];
+} ILibSimpleDataStore_PendingValue;
 typedef struct ILibSimpleDataStore_TableEntry
 {
 	int valueLength;
 	char valueHash[SHA384HASHSIZE];
-	uint64_t valueOffset;
+	uint64_t valueOffset;	// 0 if the key only has a pending value
+	int verified;			// Value was checked against valueHash since the store was opened
+	ILibSimpleDataStore_PendingValue *pending;	// Newer value held by the write-back tier, the other fields still describe the record in the file
 } ILibSimpleDataStore_TableEntry;
 typedef struct ILibSimpleDataStore_CacheEntry
 {
@@ -113,9 +236,94 @@ typedef struct ILibSimpleDataStore_CacheEntry
 	int valueLength;
 	char value[];
 }ILibSimpleDataStore_CacheEntry;
+typedef struct ILibSimpleDataStore_KeyIndexNode
+{
+	int keyLen;
+	int refCount;			// Number of keyTable keys for this key, a key can have a plain, a compressed and a chunked record
+	int level;
+	struct ILibSimpleDataStore_KeyIndexNode *next[];	// Followed by the key
+} ILibSimpleDataStore_KeyIndexNode;
+#define ILibSimpleDataStore_KeyIndexNode_Key(node) ((char*)((node)->next + (node)->level))
+typedef struct ILibSimpleDataStore_CompactionState
+{
+	FILE *compacted;
+	char *tmpPath;
+	char *keys;			// ILibSimpleDataStore_CompactionKey records for every key that was live when the compaction started
+	size_t keysLen;
+	size_t cursor;			// Next key to copy
+	uint64_t endOffset;		// Records at or past this offset were written during the compaction, and are carried over as-is
+	uint64_t dirtySize;		// Dirty size when the compaction started
+	void *chain;			// Set while ILibSimpleDataStore_CompactInBackground() is driving the compaction
+	size_t sliceSize;
+	ILibSimpleDataStore_CompactionHandler handler;
+	void *user;
+} ILibSimpleDataStore_CompactionState;
+typedef struct ILibSimpleDataStore_PutStream
+{
+	FILE *tmp;			// Stored chunks, copied into the data file when the stream ends
+	char *tmpPath;
+	char *key;			// Key of the chunked record
+	int compressed;
+	int error;
+	char *chunk;			// Chunk being filled, followed by room for it deflated
+	size_t chunkLen;
+	char *infos;			// ILibSimpleDataStore_ChunkInfo of each chunk written so far
+	size_t infosLen;
+	size_t infosSize;
+	uint64_t storedLen;
+	uint64_t length;
+	SHA512_CTX valueHash;		// SHA384 of the uncompressed value
+	SHA512_CTX storedHash;		// Check value of the value as stored, either SHA384 or CRC32C
+	uint32_t storedCrc;
+	ILibSimpleDataStore_RecordFormats format;
+} ILibSimpleDataStore_PutStream;
+typedef struct ILibSimpleDataStore_ContentHash
+{
+	char hash[SHA384HASHSIZE];
+} ILibSimpleDataStore_ContentHash;
+typedef struct ILibSimpleDataStore_MappedView
+{
+	char *view;
+	uint64_t size;
+#ifdef WIN32
+	HANDLE handle;
+#endif
+	struct ILibSimpleDataStore_MappedView *retired;	// Older view a reader may still be using, unmapped when the exclusive lock is next taken
+} ILibSimpleDataStore_MappedView;
+typedef struct ILibSimpleDataStore_WriteBack
+{
+	ILibSimpleDataStore_Root *root;
+	ILibHashtable dirty;		// keys --> ILibSimpleDataStore_TableEntry with a pending value
+	size_t dirtyBytes;			// Size of the pending values
+	size_t flushThreshold;		// Flush once dirtyBytes reaches this, 0 for no threshold
+	int flushInterval;			// Milliseconds a value can be pending, 0 for no timer
+	void *chain;
+	int timerSet;
+} ILibSimpleDataStore_WriteBack;
+typedef struct ILibSimpleDataStore_DecodedValue
+{
+	struct ILibSimpleDataStore_DecodedValue *prev, *next;	// Most recently used first
+	char hash[SHA384HASHSIZE];	// SHA384 of the value, as returned by GetHash
+	size_t valueLen;
+	int refs;					// Callers holding the value, it is freed with the last one once it has left the cache
+	int cached;
+} ILibSimpleDataStore_DecodedValue;
+#define ILibSimpleDataStore_DecodedValue_Value(decoded) ((char*)(decoded) + sizeof(ILibSimpleDataStore_DecodedValue))
+typedef struct ILibSimpleDataStore_DecodedCache
+{
+	ILibHashtable table;		// SHA384 of the value --> ILibSimpleDataStore_DecodedValue
+	ILibSimpleDataStore_DecodedValue *head, *tail;
+	size_t bytes;
+	size_t maxBytes;
+} ILibSimpleDataStore_DecodedCache;
 
 const int ILibMemory_SimpleDataStore_CONTAINERSIZE = sizeof(ILibSimpleDataStore_Root);
 void ILibSimpleDataStore_RebuildKeyTable(ILibSimpleDataStore_Root *root);
+void ILibSimpleDataStore_WriteBack_Release(ILibSimpleDataStore_Root *root);
+void ILibSimpleDataStore_DecodedCache_Release(ILibSimpleDataStore_Root *root);
+void ILibSimpleDataStore_ExclusiveLock(ILibSimpleDataStore_Root *root);
+void ILibSimpleDataStore_ExclusiveUnLock(ILibSimpleDataStore_Root *root);
+void ILibSimpleDataStore_PutStream_Replace(ILibSimpleDataStore_Root *root, char *key, int keyLen);
 extern int ILibInflate(char *buffer, size_t bufferLen, char *decompressed, size_t *decompressedLen, uint32_t crc);
 extern int ILibDeflate(char *buffer, size_t bufferLen, char *compressed, size_t *compressedLen, uint32_t *crc);
 extern uint32_t crc32c(uint32_t crci, const unsigned char *buf, uint32_t len);
@@ -123,7 +331,50 @@ extern uint32_t crc32c(uint32_t crci, const unsigned char *buf, uint32_t len);
 // Perform a SHA384 hash of some data
 void ILibSimpleDataStore_SHA384(char *data, size_t datalen, char* result) { util_sha384(data, datalen, result); }
 
-void ILibSimpleDataStore_CachedEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen, char *vhash)
+// Format a CRC32C as a record check value
+void ILibSimpleDataStore_CRC32CCheck(uint32_t crc, char *result)
+{
+	memset(result, 0, SHA384HASHSIZE);
+	((uint32_t*)result)[0] = htonl(ILibSimpleDataStore_CRC32C_MAGIC);
+	((uint32_t*)result)[1] = htonl(crc);
+}
+
+// Compute the check value of a record value, in the given format
+void ILibSimpleDataStore_Checksum(ILibSimpleDataStore_RecordFormats format, char *value, size_t valueLen, char *result)
+{
+	if (format == ILibSimpleDataStore_RecordFormat_CRC32C)
+	{
+		ILibSimpleDataStore_CRC32CCheck(crc32c(0, (unsigned char*)value, (uint32_t)valueLen), result); // No dataloss, capped to INT32_MAX
+	}
+	else
+	{
+		ILibSimpleDataStore_SHA384(value, valueLen, result);
+	}
+}
+
+// Format of a record check value
+ILibSimpleDataStore_RecordFormats ILibSimpleDataStore_ChecksumFormat(char *check)
+{
+	int i;
+
+	if (ntohl(((uint32_t*)check)[0]) != ILibSimpleDataStore_CRC32C_MAGIC) { return(ILibSimpleDataStore_RecordFormat_SHA384); }
+	for (i = 2 * sizeof(uint32_t); i < SHA384HASHSIZE; ++i)
+	{
+		if (check[i] != 0) { return(ILibSimpleDataStore_RecordFormat_SHA384); }
+	}
+	return(ILibSimpleDataStore_RecordFormat_CRC32C);
+}
+
+// Check a value against the check value of its record, returns 0 if it matches
+int ILibSimpleDataStore_VerifyValue(char *value, size_t valueLen, char *check)
+{
+	char result[SHA384HASHSIZE];
+
+	ILibSimpleDataStore_Checksum(ILibSimpleDataStore_ChecksumFormat(check), value, valueLen, result);
+	return(memcmp(result, check, SHA384HASHSIZE) == 0 ? 0 : 1);
+}
+
+void ILibSimpleDataStore_CachedEx_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen, char *vhash)
 {
 	if (keyLen > INT32_MAX || valueLen > INT32_MAX) { return; }
 
@@ -171,6 +422,12 @@ void ILibSimpleDataStore_CachedEx(ILibSimpleDataStore dataStore, char* key, size
 	ILibHashtable_Put(root->cacheTable, NULL, key, (int)keyLen, entry); // No loss of data, becuase capped at INT32_MAX
 	if (vhash != NULL) { ILibMemory_Free(key); }
 }
+__EXPORT_TYPE void ILibSimpleDataStore_CachedEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen, char *vhash)
+{
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	ILibSimpleDataStore_CachedEx_Locked(dataStore, key, keyLen, value, valueLen, vhash);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+}
 
 typedef struct ILibSimpleDateStore_JSONCache
 {
@@ -212,7 +469,7 @@ void ILibSimpleDataStore_Cached_GetValues_sink(ILibHashtable sender, void *Key1,
 	// Not a compressed record
 	handler(dataStore, Key2, (size_t)Key2Len, entry->value, entry->valueLength, userObject);
 }
-int ILibSimpleDataStore_Cached_GetValues(ILibSimpleDataStore dataStore, ILibSimpleDataStore_GetValuesHandler handler, void *user)
+int ILibSimpleDataStore_Cached_GetValues_Locked(ILibSimpleDataStore dataStore, ILibSimpleDataStore_GetValuesHandler handler, void *user)
 {
 	void *callback[] = { dataStore, handler, user };
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
@@ -222,6 +479,28 @@ int ILibSimpleDataStore_Cached_GetValues(ILibSimpleDataStore dataStore, ILibSimp
 	}
 	return(0);
 }
+__EXPORT_TYPE int ILibSimpleDataStore_Cached_GetValues(ILibSimpleDataStore dataStore, ILibSimpleDataStore_GetValuesHandler handler, void *user)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_Cached_GetValues_Locked(dataStore, handler, user);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Cut the file back to the given length, used to undo a partial write
+void ILibSimpleDataStore_Truncate(FILE *f, uint64_t length)
+{
+#ifdef WIN32
+	LARGE_INTEGER i;
+	i.QuadPart = length;
+	SetFilePointerEx((HANDLE)_get_osfhandle(_fileno(f)), i, NULL, FILE_BEGIN);
+	SetEndOfFile((HANDLE)_get_osfhandle(_fileno(f)));
+#else
+	ignore_result(ftruncate(fileno(f), length));
+#endif
+}
 
 // Write a key/value pair to file, the hash is already calculated
 uint64_t ILibSimpleDataStore_WriteRecord(FILE *f, char* key, int keyLen, char* value, int valueLen, char* hash)
@@ -252,17 +531,197 @@ uint64_t ILibSimpleDataStore_WriteRecord(FILE *f, char* key, int keyLen, char* v
 		// Unable to write all data, probably because insufficient disc space,
 		// so we're going to undo the last write, so we don't corrupt the db,
 		//
+		ILibSimpleDataStore_Truncate(f, curlen);
+		return(0);
+	}
+	return offset;
+}
+
+// Unmap a view, and the older views retired behind it
+void ILibSimpleDataStore_UnmapViews(ILibSimpleDataStore_MappedView *mapped)
+{
+	ILibSimpleDataStore_MappedView *retired;
+
+	while (mapped != NULL)
+	{
+		retired = mapped->retired;
 #ifdef WIN32
-		LARGE_INTEGER i;
-		i.QuadPart = curlen;
-		SetFilePointerEx((HANDLE)_get_osfhandle(_fileno(f)), i, NULL, FILE_BEGIN);
-		SetEndOfFile((HANDLE)_get_osfhandle(_fileno(f)));
+		UnmapViewOfFile(mapped->view);
+		CloseHandle(mapped->handle);
 #else
-		ignore_result(ftruncate(fileno(f), curlen));
+		munmap(mapped->view, (size_t)mapped->size);
 #endif
-		return(0);
+		free(mapped);
+		mapped = retired;
 	}
-	return offset;
+}
+
+// Drop the read-only view of the data file, it is re-created by the next read. The caller holds the exclusive lock
+void ILibSimpleDataStore_Unmap(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_UnmapViews(root->mapped);
+	root->mapped = NULL;
+}
+
+// Unmap the views that were replaced while readers held the shared lock. The caller just took the exclusive lock, so no reader is left using them
+void ILibSimpleDataStore_UnmapRetired(ILibSimpleDataStore_Root *root)
+{
+	if (root->mapped == NULL || root->mapped->retired == NULL) { return; }
+	ILibSimpleDataStore_UnmapViews(root->mapped->retired);
+	root->mapped->retired = NULL;
+}
+
+// Map the whole data file, if it is larger than minimumSize. Returns NULL if the file can't be mapped
+ILibSimpleDataStore_MappedView* ILibSimpleDataStore_MapFile(ILibSimpleDataStore_Root *root, uint64_t minimumSize)
+{
+	ILibSimpleDataStore_MappedView *mapped;
+	uint64_t size;
+
+#ifdef WIN32
+	LARGE_INTEGER fileSize;
+	HANDLE h = (HANDLE)_get_osfhandle(_fileno(root->dataFile));
+	HANDLE mapping;
+	char *view;
+	if (GetFileSizeEx(h, &fileSize) == 0) { return(NULL); }
+	size = (uint64_t)fileSize.QuadPart;
+	if (size <= minimumSize || size > (uint64_t)SIZE_MAX) { return(NULL); }
+	if ((mapping = CreateFileMappingW(h, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) { return(NULL); }
+	if ((view = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) == NULL)
+	{
+		CloseHandle(mapping);
+		return(NULL);
+	}
+#else
+	struct stat st;
+	void *view;
+	if (fstat(fileno(root->dataFile), &st) != 0) { return(NULL); }
+	size = (uint64_t)st.st_size;
+	if (size <= minimumSize || size > (uint64_t)SIZE_MAX) { return(NULL); }
+	if ((view = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(root->dataFile), 0)) == MAP_FAILED) { return(NULL); }
+#endif
+
+	if ((mapped = (ILibSimpleDataStore_MappedView*)malloc(sizeof(ILibSimpleDataStore_MappedView))) == NULL) { ILIBCRITICALEXIT(254); }
+	mapped->view = (char*)view;
+	mapped->size = size;
+#ifdef WIN32
+	mapped->handle = mapping;
+#endif
+	mapped->retired = NULL;
+	return(mapped);
+}
+
+// Get a pointer to a value in the read-only view of the data file, re-mapping if the file grew past the view. Returns NULL if the file can't be mapped
+char* ILibSimpleDataStore_MapValue(ILibSimpleDataStore_Root *root, uint64_t offset, int length)
+{
+	ILibSimpleDataStore_MappedView *mapped, *grown;
+
+	if (root->dataFile == NULL || length < 0) { return(NULL); }
+	if ((mapped = ILibSimpleDataStore_CurrentView(root)) == NULL || offset + (uint64_t)length > mapped->size)
+	{
+		// Readers can get here together. The old view is retired rather than unmapped, another reader may still be using it
+		sem_wait(&(root->readerLock));
+		if ((mapped = root->mapped) == NULL || offset + (uint64_t)length > mapped->size)
+		{
+			if ((grown = ILibSimpleDataStore_MapFile(root, mapped != NULL ? mapped->size : 0)) != NULL)
+			{
+				grown->retired = mapped;
+				ILibSimpleDataStore_PublishView(root, grown);
+				mapped = grown;
+			}
+		}
+		sem_post(&(root->readerLock));
+	}
+	if (mapped == NULL || offset + (uint64_t)length > mapped->size) { return(NULL); }
+	return(mapped->view + offset);
+}
+
+// Read part of the data file into buffer, at an offset. Readers share the file, so nothing relies on the file position. Returns 0 on success
+int ILibSimpleDataStore_ReadFile(ILibSimpleDataStore_Root *root, uint64_t offset, char *buffer, size_t length)
+{
+#ifdef WIN32
+	OVERLAPPED ov;
+	DWORD bytesRead;
+
+	memset(&ov, 0, sizeof(ov));
+	ov.Offset = (DWORD)offset;
+	ov.OffsetHigh = (DWORD)(offset >> 32);
+	return((length <= MAXDWORD && ReadFile((HANDLE)_get_osfhandle(_fileno(root->dataFile)), buffer, (DWORD)length, &bytesRead, &ov) != 0 && bytesRead == (DWORD)length) ? 0 : 1);
+#else
+	ssize_t bytesRead;
+
+	while (length > 0)
+	{
+		if ((bytesRead = pread(fileno(root->dataFile), buffer, length, (off_t)offset)) < 0 && errno == EINTR) { continue; }
+		if (bytesRead <= 0) { return(1); }
+		buffer += bytesRead;
+		offset += (uint64_t)bytesRead;
+		length -= (size_t)bytesRead;
+	}
+	return(0);
+#endif
+}
+
+// Take the exclusive lock. The thread holding it can take it again, and can take the shared lock, so handlers can call back into the store
+void ILibSimpleDataStore_ExclusiveLock(ILibSimpleDataStore_Root *root)
+{
+	if (root == NULL) { return; }
+	if (root->writer == ILibSimpleDataStore_CurrentThread()) { ++root->writerDepth; return; }
+	ILibReaderWriterLock_WriteLock(root->rwLock);
+	root->writer = ILibSimpleDataStore_CurrentThread();
+	root->writerDepth = 1;
+	ILibSimpleDataStore_UnmapRetired(root);
+}
+void ILibSimpleDataStore_ExclusiveUnLock(ILibSimpleDataStore_Root *root)
+{
+	if (root == NULL) { return; }
+	if (--root->writerDepth > 0) { return; }
+	root->writer = 0;
+	ILibReaderWriterLock_WriteUnLock(root->rwLock);
+}
+
+// Take the shared lock, for reads that don't call out of the store. Readers don't block one another, and don't move the file position
+void ILibSimpleDataStore_SharedLock(ILibSimpleDataStore_Root *root)
+{
+	if (root == NULL) { return; }
+	if (root->writer == ILibSimpleDataStore_CurrentThread()) { ++root->writerDepth; return; }
+	ILibReaderWriterLock_ReadLock(root->rwLock);
+}
+void ILibSimpleDataStore_SharedUnLock(ILibSimpleDataStore_Root *root)
+{
+	if (root == NULL) { return; }
+	if (root->writer == ILibSimpleDataStore_CurrentThread()) { --root->writerDepth; return; }
+	ILibReaderWriterLock_ReadUnLock(root->rwLock);
+}
+
+// Append a record to the data store file
+uint64_t ILibSimpleDataStore_AppendRecord(ILibSimpleDataStore_Root *root, char* key, int keyLen, char* value, int valueLen, char* hash)
+{
+#ifdef WIN32
+	ILibSimpleDataStore_Unmap(root); // A mapped view prevents SetEndOfFile(), which is used to undo a partial write
+#endif
+	return(ILibSimpleDataStore_WriteRecord(root->dataFile, key, keyLen, value, valueLen, hash));
+}
+
+// Stage a record in the open batch, in the same format it will have in the file
+void ILibSimpleDataStore_BatchRecord(ILibSimpleDataStore_Root *root, char* key, int keyLen, char* value, int valueLen, char* hash)
+{
+	ILibSimpleDataStore_RecordHeader_NG *header;
+	size_t len = sizeof(ILibSimpleDataStore_RecordHeader_NG) + keyLen + valueLen;
+
+	if (root->batchLen + len > root->batchSize)
+	{
+		while (root->batchLen + len > root->batchSize) { root->batchSize *= 2; }
+		if ((root->batch = (char*)realloc(root->batch, root->batchSize)) == NULL) { ILIBCRITICALEXIT(254); }
+	}
+	header = (ILibSimpleDataStore_RecordHeader_NG*)(root->batch + root->batchLen);
+	header->nodeSize = htonl((int)len);
+	header->keyLen = htonl(keyLen);
+	header->valueLength = htonl(valueLen);
+	if (hash != NULL) { memcpy_s(header->hash, sizeof(header->hash), hash, SHA384HASHSIZE); } else { memset(header->hash, 0, SHA384HASHSIZE); }
+	memcpy_s(header->key, keyLen, key, keyLen);
+	if (valueLen > 0) { memcpy_s(header->key + keyLen, valueLen, value, valueLen); }
+	root->batchLen += len;
+	ILibHashtable_Put(root->batchKeys, NULL, key, keyLen, root);
 }
 
 // Read the next record in the file
@@ -272,6 +731,8 @@ ILibSimpleDataStore_RecordHeader_NG* ILibSimpleDataStore_ReadNextRecord(ILibSimp
 	char data[4096];
 	char result[SHA384HASHSIZE];
 	int i, bytesLeft;
+	uint32_t crc = 0;
+	ILibSimpleDataStore_RecordFormats format;
 
 	ILibSimpleDataStore_RecordHeader_NG *node;
 	size_t nodeSize;
@@ -326,17 +787,18 @@ ILibSimpleDataStore_RecordHeader_NG* ILibSimpleDataStore_ReadNextRecord(ILibSimp
 	}
 	// Validate Data, in 4k chunks at a time
 	bytesLeft = node->valueLength;
+	format = ILibSimpleDataStore_ChecksumFormat(node->hash);
 
-	// Hash SHA384 the data
-	SHA384_Init(&c);
+	// Hash SHA384 the data, or CRC32C it if that is the format of the record
+	if (format == ILibSimpleDataStore_RecordFormat_SHA384) { SHA384_Init(&c); }
 	while (bytesLeft > 0)
 	{
 		i = (int)fread(data, 1, bytesLeft > 4096 ? 4096 : bytesLeft, root->dataFile);
 		if (i <= 0) { bytesLeft = 0; break; }
-		SHA384_Update(&c, data, i);
+		if (format == ILibSimpleDataStore_RecordFormat_CRC32C) { crc = crc32c(crc, (unsigned char*)data, (uint32_t)i); } else { SHA384_Update(&c, data, i); }
 		bytesLeft -= i;
 	}
-	SHA384_Final((unsigned char*)result, &c);
+	if (format == ILibSimpleDataStore_RecordFormat_CRC32C) { ILibSimpleDataStore_CRC32CCheck(crc, result); } else { SHA384_Final((unsigned char*)result, &c); }
 	if (node->valueLength > 0)
 	{
 		// Check the hash
@@ -369,125 +831,540 @@ void ILibSimpleDataStore_TableClear_Sink(ILibHashtable sender, void *Key1, char*
 	free(Data);
 }
 
-// Rebuild the in-memory key to record table, done when starting up the data store
-void ILibSimpleDataStore_RebuildKeyTable(ILibSimpleDataStore_Root *root)
+// Length of the key as seen by the user, compressed records are stored with the crc32c of the key appended, and chunked records with the inverted crc32c
+int ILibSimpleDataStore_UserKeyLen(char *key, int keyLen)
 {
-	ILibSimpleDataStore_RecordHeader_NG *node = NULL;
-	ILibSimpleDataStore_TableEntry *entry;
-	int count;
-	uint64_t newoffset;
-
-	if (root == NULL) return;
-
-	ILibHashtable_ClearEx(root->keyTable, ILibSimpleDataStore_TableClear_Sink, root); // Wipe the key table, we will rebulit it
-	fseek(root->dataFile, 0, SEEK_END); // See the start of the file
-	root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
-	fseek(root->dataFile, 0, SEEK_SET); // See the start of the file
-
+	uint32_t crc;
 
-	// First, try NG Format
-	count = 0;
-	while ((node = ILibSimpleDataStore_ReadNextRecord(root, 0)) != NULL)
+	if (keyLen > (int)sizeof(uint32_t))
 	{
-		// Get the entry from the memory table
-		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, node->key, node->keyLen);
-		if (node->valueLength > 0)
-		{
-			// If the value is not empty, we need to create/overwrite this value in memory
-			if (entry == NULL) 
-			{
-				// Create new entry in table
-				++count;  
-				entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL);
-			}
-			else
-			{
-				// Entry already exists in table
-				root->dirtySize += entry->valueLength;
-			}
-			memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
-			entry->valueLength = node->valueLength;
-			entry->valueOffset = ILibSimpleDataStore_RecordHeader_ValueOffset(node);
-			ILibHashtable_Put(root->keyTable, NULL, node->key, node->keyLen, entry);
-		}
-		else if (entry != NULL)
+		crc = crc32c(0, (unsigned char*)key, (uint32_t)(keyLen - sizeof(uint32_t)));
+		if (crc == ((uint32_t*)(key + keyLen - sizeof(uint32_t)))[0] || ~crc == ((uint32_t*)(key + keyLen - sizeof(uint32_t)))[0])
 		{
-			// If value is empty, remove the in-memory entry.
-			root->dirtySize += entry->valueLength;
-			--count;
-			ILibHashtable_Remove(root->keyTable, NULL, node->key, node->keyLen);
-			free(entry);
+			keyLen -= sizeof(uint32_t);
 		}
 	}
-	
-	if (count == 0)
-	{
-		ILibHashtable_ClearEx(root->keyTable, ILibSimpleDataStore_TableClear_Sink, root); // Wipe the key table, we will rebulit it
-		fseek(root->dataFile, 0, SEEK_SET); // See the start of the file
-		root->fileSize = -1; // Indicate we can't write to the data store
+	return(keyLen);
+}
 
-		// Check if this is Legacy32 Format
-		count = 0;
-		while ((node = ILibSimpleDataStore_ReadNextRecord(root, 32)) != NULL)
-		{
-			// Get the entry from the memory table
-			entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_32*)node)->key, node->keyLen);
-			if (node->valueLength > 0)
-			{
-				// If the value is not empty, we need to create/overwrite this value in memory
-				if (entry == NULL) { ++count;  entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL); }
-				memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
-				entry->valueLength = node->valueLength;
-				entry->valueOffset = ILibSimpleDataStore_RecordHeader_ValueOffset(node);
-				ILibHashtable_Put(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_32*)node)->key, node->keyLen, entry);
-			}
-			else if (entry != NULL)
-			{
-				// If value is empty, remove the in-memory entry.
-				--count;
-				ILibHashtable_Remove(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_32*)node)->key, node->keyLen);
-				free(entry);
-			}
-		}
+// Check if a key is the key of a compressed record, which is stored with the crc32c of the key appended
+int ILibSimpleDataStore_IsCompressedKey(char *key, int keyLen)
+{
+	return((keyLen > (int)sizeof(uint32_t) && crc32c(0, (unsigned char*)key, (uint32_t)(keyLen - sizeof(uint32_t))) == ((uint32_t*)(key + keyLen - sizeof(uint32_t)))[0]) ? 1 : 0);
+}
 
-		if (count == 0)
-		{
-			// Check if this is Legacy64 Format
-			ILibHashtable_ClearEx(root->keyTable, ILibSimpleDataStore_TableClear_Sink, root); // Wipe the key table, we will rebulit it
-			fseek(root->dataFile, 0, SEEK_SET); // See the start of the file
-			root->fileSize = -1; // Indicate we can't write to the data store
+// Key of the chunked record for a key, free with ILibMemory_Free()
+char* ILibSimpleDataStore_ChunkedKey(char *key, size_t keyLen)
+{
+	char *tmpkey = (char*)ILibMemory_SmartAllocate(keyLen + sizeof(uint32_t));
+	memcpy_s(tmpkey, ILibMemory_Size(tmpkey), key, keyLen);
+	((uint32_t*)(tmpkey + keyLen))[0] = ~crc32c(0, (unsigned char*)key, (uint32_t)keyLen); // No dataloss, capped to INT32_MAX
+	return(tmpkey);
+}
 
-			while ((node = ILibSimpleDataStore_ReadNextRecord(root, 64)) != NULL)
-			{
-				// Get the entry from the memory table
-				entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_64*)node)->key, node->keyLen);
-				if (node->valueLength > 0)
-				{
-					// If the value is not empty, we need to create/overwrite this value in memory
-					if (entry == NULL) { ++count;  entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL); }
-					memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
-					entry->valueLength = node->valueLength;
-					entry->valueOffset = ILibSimpleDataStore_RecordHeader_ValueOffset(node);
-					ILibHashtable_Put(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_64*)node)->key, node->keyLen, entry);
-				}
-				else if (entry != NULL)
-				{
-					// If value is empty, remove the in-memory entry.
-					--count;
-					ILibHashtable_Remove(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_64*)node)->key, node->keyLen);
-					free(entry);
-				}
-			}
-		}
+int ILibSimpleDataStore_KeyIndex_Compare(ILibSimpleDataStore_KeyIndexNode *node, char *key, size_t keyLen)
+{
+	int r = memcmp(ILibSimpleDataStore_KeyIndexNode_Key(node), key, (size_t)node->keyLen < keyLen ? (size_t)node->keyLen : keyLen);
+	if (r != 0) { return(r); }
+	return((size_t)node->keyLen < keyLen ? -1 : ((size_t)node->keyLen > keyLen ? 1 : 0));
+}
 
-		// Set the size of the entire data store file, and call 'Compact', to convert the db to NG format
-		root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
-		ILibSimpleDataStore_Compact((ILibSimpleDataStore)root);
-	}
-	else
+// Find the first key in the index that is >= key. If update is not NULL, it is set to the link at each level that points at that key
+ILibSimpleDataStore_KeyIndexNode* ILibSimpleDataStore_KeyIndex_Seek(ILibSimpleDataStore_Root *root, char *key, size_t keyLen, ILibSimpleDataStore_KeyIndexNode ***update)
+{
+	ILibSimpleDataStore_KeyIndexNode **links = root->keyIndex;
+	int level;
+
+	for (level = ILibSimpleDataStore_KeyIndex_MaxLevel - 1; level >= 0; --level)
 	{
-		// No need to convert db format, because we're already NG format
-		if ((newoffset = ILibSimpleDataStore_GetPosition(root->dataFile)) != root->fileSize)
+		while (links[level] != NULL && ILibSimpleDataStore_KeyIndex_Compare(links[level], key, keyLen) < 0) { links = links[level]->next; }
+		if (update != NULL) { update[level] = &(links[level]); }
+	}
+	return(links[0]);
+}
+
+// Last key in the index, NULL if the index is empty
+ILibSimpleDataStore_KeyIndexNode* ILibSimpleDataStore_KeyIndex_Last(ILibSimpleDataStore_Root *root)
+{
+	if (root->keyIndexTail[0] == &(root->keyIndex[0])) { return(NULL); }
+	return((ILibSimpleDataStore_KeyIndexNode*)((char*)root->keyIndexTail[0] - offsetof(ILibSimpleDataStore_KeyIndexNode, next)));
+}
+
+// Add a (user) key to the index, or another reference to it if it's already there. Keys that sort after the last key are appended without a search
+void ILibSimpleDataStore_KeyIndex_InsertEx(ILibSimpleDataStore_Root *root, char *key, int keyLen)
+{
+	ILibSimpleDataStore_KeyIndexNode **update[ILibSimpleDataStore_KeyIndex_MaxLevel];
+	ILibSimpleDataStore_KeyIndexNode *node = ILibSimpleDataStore_KeyIndex_Last(root);
+	int level = 1, i;
+
+	if (node == NULL || ILibSimpleDataStore_KeyIndex_Compare(node, key, (size_t)keyLen) < 0)
+	{
+		memcpy_s(update, sizeof(update), root->keyIndexTail, sizeof(root->keyIndexTail));
+	}
+	else
+	{
+		node = ILibSimpleDataStore_KeyIndex_Seek(root, key, (size_t)keyLen, update);
+		if (node != NULL && ILibSimpleDataStore_KeyIndex_Compare(node, key, (size_t)keyLen) == 0) { ++node->refCount; return; }
+	}
+
+	// Each level holds about a quarter of the keys of the level below it
+	do
+	{
+		root->keyIndexSeed ^= root->keyIndexSeed << 13;
+		root->keyIndexSeed ^= root->keyIndexSeed >> 17;
+		root->keyIndexSeed ^= root->keyIndexSeed << 5;
+	} while ((root->keyIndexSeed & 3) == 0 && ++level < ILibSimpleDataStore_KeyIndex_MaxLevel);
+
+	if ((node = (ILibSimpleDataStore_KeyIndexNode*)malloc(sizeof(ILibSimpleDataStore_KeyIndexNode) + (level * sizeof(ILibSimpleDataStore_KeyIndexNode*)) + keyLen)) == NULL) { ILIBCRITICALEXIT(254); }
+	node->keyLen = keyLen;
+	node->refCount = 1;
+	node->level = level;
+	memcpy_s(ILibSimpleDataStore_KeyIndexNode_Key(node), keyLen, key, keyLen);
+	for (i = 0; i < level; ++i)
+	{
+		node->next[i] = *(update[i]);
+		*(update[i]) = node;
+		if (node->next[i] == NULL) { root->keyIndexTail[i] = &(node->next[i]); }
+	}
+}
+#define ILibSimpleDataStore_KeyIndex_Insert(root, key, keyLen) ILibSimpleDataStore_KeyIndex_InsertEx(root, key, ILibSimpleDataStore_UserKeyLen(key, keyLen))
+
+void ILibSimpleDataStore_KeyIndex_Remove(ILibSimpleDataStore_Root *root, char *key, int keyLen)
+{
+	ILibSimpleDataStore_KeyIndexNode **update[ILibSimpleDataStore_KeyIndex_MaxLevel];
+	ILibSimpleDataStore_KeyIndexNode *node;
+	int i;
+
+	keyLen = ILibSimpleDataStore_UserKeyLen(key, keyLen);
+	node = ILibSimpleDataStore_KeyIndex_Seek(root, key, (size_t)keyLen, update);
+	if (node == NULL || ILibSimpleDataStore_KeyIndex_Compare(node, key, (size_t)keyLen) != 0 || --node->refCount > 0) { return; }
+	for (i = 0; i < node->level; ++i)
+	{
+		*(update[i]) = node->next[i];
+		if (root->keyIndexTail[i] == &(node->next[i])) { root->keyIndexTail[i] = update[i]; }
+	}
+	free(node);
+	++root->keyIndexVersion;
+}
+
+// Drop the index, it is built again by the next ordered enumeration
+void ILibSimpleDataStore_KeyIndex_Clear(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_KeyIndexNode *node = root->keyIndex[0], *next;
+	int i;
+
+	while (node != NULL)
+	{
+		next = node->next[0];
+		free(node);
+		node = next;
+	}
+	for (i = 0; i < ILibSimpleDataStore_KeyIndex_MaxLevel; ++i)
+	{
+		root->keyIndex[i] = NULL;
+		root->keyIndexTail[i] = &(root->keyIndex[i]);
+	}
+	root->keyIndexValid = 0;
+	++root->keyIndexVersion;
+}
+
+typedef struct ILibSimpleDataStore_KeyIndex_BuildKey
+{
+	char *key;
+	int keyLen;
+} ILibSimpleDataStore_KeyIndex_BuildKey;
+void ILibSimpleDataStore_KeyIndex_Build_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_KeyIndex_BuildKey *keys = (ILibSimpleDataStore_KeyIndex_BuildKey*)((void**)user)[0];
+	size_t *count = (size_t*)((void**)user)[1];
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+	UNREFERENCED_PARAMETER(Data);
+
+	if (keys != NULL)
+	{
+		keys[*count].key = Key2;
+		keys[*count].keyLen = ILibSimpleDataStore_UserKeyLen(Key2, Key2Len);
+	}
+	*count += 1;
+}
+int ILibSimpleDataStore_KeyIndex_Build_Compare(const void *a, const void *b)
+{
+	const ILibSimpleDataStore_KeyIndex_BuildKey *x = (const ILibSimpleDataStore_KeyIndex_BuildKey*)a, *y = (const ILibSimpleDataStore_KeyIndex_BuildKey*)b;
+	int r = memcmp(x->key, y->key, x->keyLen < y->keyLen ? x->keyLen : y->keyLen);
+	return(r != 0 ? r : (x->keyLen - y->keyLen));
+}
+
+// Build the index from the key table. Keys are sorted first, so every insert is an append
+void ILibSimpleDataStore_KeyIndex_Build(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_KeyIndex_BuildKey *keys;
+	size_t count = 0, i;
+	void *state[] = { NULL, &count };
+
+	ILibSimpleDataStore_KeyIndex_Clear(root);
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_KeyIndex_Build_Sink, state);
+	if ((keys = (ILibSimpleDataStore_KeyIndex_BuildKey*)malloc((count + 1) * sizeof(ILibSimpleDataStore_KeyIndex_BuildKey))) == NULL) { ILIBCRITICALEXIT(254); }
+	state[0] = keys; count = 0;
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_KeyIndex_Build_Sink, state);
+
+	qsort(keys, count, sizeof(ILibSimpleDataStore_KeyIndex_BuildKey), ILibSimpleDataStore_KeyIndex_Build_Compare);
+	for (i = 0; i < count; ++i) { ILibSimpleDataStore_KeyIndex_InsertEx(root, keys[i].key, keys[i].keyLen); }
+	free(keys);
+	root->keyIndexValid = 1;
+}
+
+// Call an enumeration handler for a node, and return the node after it. The handler is given a copy of the key, so it can delete
+// that key or any other. If it did, the node may be gone, so the next node is found by seeking past the copy
+ILibSimpleDataStore_KeyIndexNode* ILibSimpleDataStore_KeyIndex_Visit(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_KeyIndexNode *node, char **copy, size_t *copySize, ILibSimpleDataStore_KeyEnumerationHandler handler, void *user)
+{
+	uint32_t version = root->keyIndexVersion;
+	int keyLen = node->keyLen;
+
+	if ((size_t)keyLen + 1 > *copySize)
+	{
+		*copySize = (size_t)keyLen + 1;
+		if ((*copy = (char*)realloc(*copy, *copySize)) == NULL) { ILIBCRITICALEXIT(254); }
+	}
+	memcpy_s(*copy, *copySize, ILibSimpleDataStore_KeyIndexNode_Key(node), keyLen);
+	handler((ILibSimpleDataStore)root, *copy, keyLen, user);
+
+	if (root->keyIndexVersion == version) { return(node->next[0]); }
+	if (root->keyIndexValid == 0) { ILibSimpleDataStore_KeyIndex_Build(root); }
+	node = ILibSimpleDataStore_KeyIndex_Seek(root, *copy, (size_t)keyLen, NULL);
+	if (node != NULL && ILibSimpleDataStore_KeyIndex_Compare(node, *copy, (size_t)keyLen) == 0) { node = node->next[0]; }
+	return(node);
+}
+
+// Discard the pending value of an entry, because a newer value or a delete replaced it
+void ILibSimpleDataStore_WriteBack_Drop(ILibSimpleDataStore_Root *root, char *key, int keyLen, ILibSimpleDataStore_TableEntry *entry)
+{
+	if (entry->pending == NULL) { return; }
+	if (root->writeBack != NULL)
+	{
+		ILibHashtable_Remove(root->writeBack->dirty, NULL, key, keyLen);
+		root->writeBack->dirtyBytes -= entry->pending->valueLength;
+	}
+	free(entry->pending);
+	entry->pending = NULL;
+}
+void ILibSimpleDataStore_WriteBack_Clear_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+	UNREFERENCED_PARAMETER(Key2);
+	UNREFERENCED_PARAMETER(Key2Len);
+	UNREFERENCED_PARAMETER(user);
+
+	free(entry->pending);
+	entry->pending = NULL;
+}
+
+// Key table updates go through these, so the sorted key index and the write-back tier stay in sync with it
+void ILibSimpleDataStore_TablePut(ILibSimpleDataStore_Root *root, char *key, int keyLen, ILibSimpleDataStore_TableEntry *entry)
+{
+	if (root->keyIndexValid != 0 && ILibHashtable_Get(root->keyTable, NULL, key, keyLen) == NULL) { ILibSimpleDataStore_KeyIndex_Insert(root, key, keyLen); }
+	if (root->contentHashes != NULL) { free(ILibHashtable_Remove(root->contentHashes, NULL, key, keyLen)); }
+	ILibHashtable_Put(root->keyTable, NULL, key, keyLen, entry);
+}
+ILibSimpleDataStore_TableEntry* ILibSimpleDataStore_TableRemove(ILibSimpleDataStore_Root *root, char *key, int keyLen)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Remove(root->keyTable, NULL, key, keyLen);
+	if (entry != NULL && root->keyIndexValid != 0) { ILibSimpleDataStore_KeyIndex_Remove(root, key, keyLen); }
+	if (entry != NULL) { ILibSimpleDataStore_WriteBack_Drop(root, key, keyLen, entry); }
+	if (root->contentHashes != NULL) { free(ILibHashtable_Remove(root->contentHashes, NULL, key, keyLen)); }
+	return(entry);
+}
+void ILibSimpleDataStore_TableClear(ILibSimpleDataStore_Root *root)
+{
+	if (root->writeBack != NULL)
+	{
+		ILibHashtable_ClearEx(root->writeBack->dirty, ILibSimpleDataStore_WriteBack_Clear_Sink, root);
+		root->writeBack->dirtyBytes = 0;
+	}
+	ILibHashtable_ClearEx(root->keyTable, ILibSimpleDataStore_TableClear_Sink, root);
+	if (root->contentHashes != NULL) { ILibHashtable_ClearEx(root->contentHashes, ILibSimpleDataStore_TableClear_Sink, root); }
+	ILibSimpleDataStore_KeyIndex_Clear(root);
+}
+
+// Replay NG records from the current file position into the key table, returns the change in the number of live keys
+int ILibSimpleDataStore_ReplayRecords(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_RecordHeader_NG *node = NULL;
+	ILibSimpleDataStore_TableEntry *entry;
+	int count = 0;
+
+	while ((node = ILibSimpleDataStore_ReadNextRecord(root, 0)) != NULL)
+	{
+		// Get the entry from the memory table
+		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, node->key, node->keyLen);
+		if (node->valueLength > 0)
+		{
+			// If the value is not empty, we need to create/overwrite this value in memory
+			if (entry == NULL) 
+			{
+				// Create new entry in table
+				++count;  
+				entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL);
+			}
+			else
+			{
+				// Entry already exists in table
+				root->dirtySize += entry->valueLength;
+			}
+			memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
+			entry->valueLength = node->valueLength;
+			entry->valueOffset = ILibSimpleDataStore_RecordHeader_ValueOffset(node);
+			entry->verified = 0;
+			ILibSimpleDataStore_TablePut(root, node->key, node->keyLen, entry);
+		}
+		else if (entry != NULL)
+		{
+			// If value is empty, remove the in-memory entry.
+			root->dirtySize += entry->valueLength;
+			--count;
+			ILibSimpleDataStore_TableRemove(root, node->key, node->keyLen);
+			free(entry);
+		}
+	}
+	return(count);
+}
+
+// Hash of the data file bytes that precede endOffset, used to check that an index snapshot still belongs to this file
+int ILibSimpleDataStore_TailHash(ILibSimpleDataStore_Root *root, uint64_t endOffset, char *result)
+{
+	size_t len = endOffset < sizeof(root->scratchPad) ? (size_t)endOffset : sizeof(root->scratchPad);
+
+	if (ILibSimpleDataStore_SeekPosition(root->dataFile, endOffset - len, SEEK_SET) != 0) { return(1); }
+	if (fread(root->scratchPad, 1, len, root->dataFile) != len) { return(1); }
+	ILibSimpleDataStore_SHA384(root->scratchPad, len, result);
+	return(0);
+}
+
+void ILibSimpleDataStore_DeleteFile(char *path)
+{
+#ifdef WIN32
+	DeleteFileW(ILibUTF8ToWide(path, -1));
+#else
+	remove(path);
+#endif
+}
+
+void ILibSimpleDataStore_DeleteIndexSnapshot(ILibSimpleDataStore_Root *root)
+{
+	char *idxPath = ILibString_Cat(root->filePath, -1, ".idx", -1);
+	ILibSimpleDataStore_DeleteFile(idxPath);
+	free(idxPath);
+}
+
+void ILibSimpleDataStore_WriteIndexSnapshot_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+	char *buffer = (char*)((void**)user)[0];
+	size_t *offset = (size_t*)((void**)user)[1];
+	ILibSimpleDataStore_IndexRecord *record;
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+
+	if (entry->valueOffset == 0) { return; }		// Only pending in the write-back tier, not in the file yet
+	if (buffer != NULL)
+	{
+		record = (ILibSimpleDataStore_IndexRecord*)(buffer + *offset);
+		record->keyLen = Key2Len;
+		record->valueLength = entry->valueLength;
+		record->valueOffset = entry->valueOffset;
+		memcpy_s(record->valueHash, sizeof(record->valueHash), entry->valueHash, SHA384HASHSIZE);
+		memcpy_s(record->key, Key2Len, Key2, Key2Len);
+	}
+	*offset += sizeof(ILibSimpleDataStore_IndexRecord) + Key2Len;
+	((unsigned int*)((void**)user)[2])[0] += 1;
+}
+
+// Save the key table, so the next open doesn't have to re-read and re-hash the whole file
+void ILibSimpleDataStore_WriteIndexSnapshot(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_IndexHeader *header;
+	char *buffer = NULL, *idxPath;
+	size_t len = sizeof(ILibSimpleDataStore_IndexHeader);
+	unsigned int count = 0;
+	void *state[] = { NULL, &len, &count };
+
+	if (root->filePath == NULL || root->dataFile == NULL || root->readonly != 0) { return; }
+
+	// First pass to size the snapshot, second pass to fill it in
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_WriteIndexSnapshot_Sink, state);
+	if (len + SHA384HASHSIZE > INT32_MAX) { return; }
+	if ((buffer = (char*)malloc(len + SHA384HASHSIZE)) == NULL) { ILIBCRITICALEXIT(254); }
+	state[0] = buffer; len = sizeof(ILibSimpleDataStore_IndexHeader); count = 0;
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_WriteIndexSnapshot_Sink, state);
+
+	header = (ILibSimpleDataStore_IndexHeader*)buffer;
+	header->magic = ILibSimpleDataStore_IndexSnapshot_MAGIC;
+	header->entryCount = count;
+	fseek(root->dataFile, 0, SEEK_END);
+	header->endOffset = ILibSimpleDataStore_GetPosition(root->dataFile);
+	header->dirtySize = root->dirtySize;
+	if (ILibSimpleDataStore_TailHash(root, header->endOffset, header->tailHash) == 0)
+	{
+		ILibSimpleDataStore_SHA384(buffer, len, buffer + len);
+		idxPath = ILibString_Cat(root->filePath, -1, ".idx", -1);
+		ILibWriteStringToDiskEx(idxPath, buffer, (int)(len + SHA384HASHSIZE));
+		free(idxPath);
+	}
+	free(buffer);
+}
+
+// Load the key table from the index snapshot, and position the file at the first record the snapshot doesn't cover. Returns 0 on success
+int ILibSimpleDataStore_LoadIndexSnapshot(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_IndexHeader *header;
+	ILibSimpleDataStore_IndexRecord *record;
+	ILibSimpleDataStore_TableEntry *entry;
+	char hash[SHA384HASHSIZE];
+	char *buffer, *idxPath;
+	int bufferLen;
+	size_t offset;
+	unsigned int i;
+
+	if (root->filePath == NULL) { return(1); }
+	idxPath = ILibString_Cat(root->filePath, -1, ".idx", -1);
+	bufferLen = ILibReadFileFromDiskEx(&buffer, idxPath);
+	free(idxPath);
+	if (buffer == NULL) { return(1); }
+
+	header = (ILibSimpleDataStore_IndexHeader*)buffer;
+	if (bufferLen < (int)(sizeof(ILibSimpleDataStore_IndexHeader) + SHA384HASHSIZE) || header->magic != ILibSimpleDataStore_IndexSnapshot_MAGIC ||
+		header->endOffset > root->fileSize) { free(buffer); return(1); }
+	ILibSimpleDataStore_SHA384(buffer, bufferLen - SHA384HASHSIZE, hash);
+	if (memcmp(hash, buffer + bufferLen - SHA384HASHSIZE, SHA384HASHSIZE) != 0) { free(buffer); return(1); }				// Snapshot is damaged
+	if (ILibSimpleDataStore_TailHash(root, header->endOffset, hash) != 0 || memcmp(hash, header->tailHash, SHA384HASHSIZE) != 0)
+	{
+		// Data file was replaced or rewritten since the snapshot was taken
+		free(buffer);
+		return(1);
+	}
+
+	offset = sizeof(ILibSimpleDataStore_IndexHeader);
+	for (i = 0; i < header->entryCount; ++i)
+	{
+		record = (ILibSimpleDataStore_IndexRecord*)(buffer + offset);
+		if (offset + sizeof(ILibSimpleDataStore_IndexRecord) > (size_t)(bufferLen - SHA384HASHSIZE) || record->keyLen <= 0 ||
+			offset + sizeof(ILibSimpleDataStore_IndexRecord) + record->keyLen > (size_t)(bufferLen - SHA384HASHSIZE) ||
+			record->valueOffset + (uint64_t)record->valueLength > header->endOffset) { break; }
+
+		entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL);
+		memcpy_s(entry->valueHash, sizeof(entry->valueHash), record->valueHash, SHA384HASHSIZE);
+		entry->valueLength = record->valueLength;
+		entry->valueOffset = record->valueOffset;
+		ILibSimpleDataStore_TablePut(root, record->key, record->keyLen, entry);
+		offset += sizeof(ILibSimpleDataStore_IndexRecord) + record->keyLen;
+	}
+	if (i != header->entryCount)
+	{
+		ILibSimpleDataStore_TableClear(root);
+		free(buffer);
+		return(1);
+	}
+
+	root->dirtySize = header->dirtySize;
+	ILibSimpleDataStore_SeekPosition(root->dataFile, header->endOffset, SEEK_SET);
+	free(buffer);
+	return(0);
+}
+
+// Rebuild the in-memory key to record table, done when starting up the data store
+void ILibSimpleDataStore_RebuildKeyTable(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_RecordHeader_NG *node = NULL;
+	ILibSimpleDataStore_TableEntry *entry;
+	int count, snapshot;
+	uint64_t newoffset;
+
+	if (root == NULL) return;
+
+	ILibSimpleDataStore_TableClear(root); // Wipe the key table, we will rebulit it
+	fseek(root->dataFile, 0, SEEK_END); // See the start of the file
+	root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
+	fseek(root->dataFile, 0, SEEK_SET); // See the start of the file
+
+
+	// First, try the index snapshot, and then NG Format. If the snapshot is good, only the records appended after it are read
+	snapshot = ILibSimpleDataStore_LoadIndexSnapshot(root) == 0 ? 1 : 0;
+	if (snapshot == 0) { fseek(root->dataFile, 0, SEEK_SET); } // A rejected snapshot may have moved the file position
+	count = ILibSimpleDataStore_ReplayRecords(root);
+
+	if (count == 0 && snapshot == 0)
+	{
+		ILibSimpleDataStore_TableClear(root); // Wipe the key table, we will rebulit it
+		fseek(root->dataFile, 0, SEEK_SET); // See the start of the file
+		root->fileSize = -1; // Indicate we can't write to the data store
+
+		// Check if this is Legacy32 Format
+		count = 0;
+		while ((node = ILibSimpleDataStore_ReadNextRecord(root, 32)) != NULL)
+		{
+			// Get the entry from the memory table
+			entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_32*)node)->key, node->keyLen);
+			if (node->valueLength > 0)
+			{
+				// If the value is not empty, we need to create/overwrite this value in memory
+				if (entry == NULL) { ++count;  entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL); }
+				memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
+				entry->valueLength = node->valueLength;
+				entry->valueOffset = ILibSimpleDataStore_RecordHeader_ValueOffset(node);
+				ILibSimpleDataStore_TablePut(root, ((ILibSimpleDataStore_RecordHeader_32*)node)->key, node->keyLen, entry);
+			}
+			else if (entry != NULL)
+			{
+				// If value is empty, remove the in-memory entry.
+				--count;
+				ILibSimpleDataStore_TableRemove(root, ((ILibSimpleDataStore_RecordHeader_32*)node)->key, node->keyLen);
+				free(entry);
+			}
+		}
+
+		if (count == 0)
+		{
+			// Check if this is Legacy64 Format
+			ILibSimpleDataStore_TableClear(root); // Wipe the key table, we will rebulit it
+			fseek(root->dataFile, 0, SEEK_SET); // See the start of the file
+			root->fileSize = -1; // Indicate we can't write to the data store
+
+			while ((node = ILibSimpleDataStore_ReadNextRecord(root, 64)) != NULL)
+			{
+				// Get the entry from the memory table
+				entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, ((ILibSimpleDataStore_RecordHeader_64*)node)->key, node->keyLen);
+				if (node->valueLength > 0)
+				{
+					// If the value is not empty, we need to create/overwrite this value in memory
+					if (entry == NULL) { ++count;  entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL); }
+					memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
+					entry->valueLength = node->valueLength;
+					entry->valueOffset = ILibSimpleDataStore_RecordHeader_ValueOffset(node);
+					ILibSimpleDataStore_TablePut(root, ((ILibSimpleDataStore_RecordHeader_64*)node)->key, node->keyLen, entry);
+				}
+				else if (entry != NULL)
+				{
+					// If value is empty, remove the in-memory entry.
+					--count;
+					ILibSimpleDataStore_TableRemove(root, ((ILibSimpleDataStore_RecordHeader_64*)node)->key, node->keyLen);
+					free(entry);
+				}
+			}
+		}
+
+		// Set the size of the entire data store file, and call 'Compact', to convert the db to NG format
+		root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
+		ILibSimpleDataStore_Compact((ILibSimpleDataStore)root);
+	}
+	else
+	{
+		// No need to convert db format, because we're already NG format
+		if ((newoffset = ILibSimpleDataStore_GetPosition(root->dataFile)) != root->fileSize)
 		{
 			// DB corruption detected
 			ILIBLOGMESSAGEX("DB Corruption Detected");
@@ -579,6 +1456,7 @@ __EXPORT_TYPE ILibSimpleDataStore ILibSimpleDataStore_CreateEx2(char* filePath,
 	{
 		retVal->filePath = ILibString_Copy(filePath, strnlen_s(filePath, ILibSimpleDataStore_MaxFilePath));
 		retVal->dataFile = ILibSimpleDataStore_OpenFileEx3(retVal->filePath, 0, readonly, &(retVal->createdAsNew));
+		retVal->readonly = readonly;
 
 		if (retVal->dataFile == NULL)
 		{
@@ -589,6 +1467,10 @@ __EXPORT_TYPE ILibSimpleDataStore ILibSimpleDataStore_CreateEx2(char* filePath,
 	}
 
 	retVal->keyTable = ILibHashtable_Create();
+	retVal->rwLock = ILibReaderWriterLock_Create();
+	sem_init(&(retVal->readerLock), 0, 1);
+	retVal->keyIndexSeed = 0x9E3779B9;
+	ILibSimpleDataStore_KeyIndex_Clear(retVal);
 	if (retVal->dataFile != NULL) { ILibSimpleDataStore_RebuildKeyTable(retVal); }
 	return retVal;
 }
@@ -596,6 +1478,11 @@ void ILibSimpleDataStore_ReOpenReadOnly(ILibSimpleDataStore dataStore, char* fil
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
 
+	ILibSimpleDataStore_ExclusiveLock(root);
+	ILibSimpleDataStore_CompactAbort(root);
+	ILibSimpleDataStore_PutStreamAbort(root);
+	ILibSimpleDataStore_WriteBack_Release(root);
+	ILibSimpleDataStore_Unmap(root);
 	if (root->dataFile != NULL)
 	{
 #ifdef _POSIX
@@ -608,7 +1495,9 @@ void ILibSimpleDataStore_ReOpenReadOnly(ILibSimpleDataStore dataStore, char* fil
 		root->filePath = ILibString_Copy(filePath, strnlen_s(filePath, ILibSimpleDataStore_MaxFilePath));
 	}
 	root->dataFile = ILibSimpleDataStore_OpenFileEx2(root->filePath, 0, 1);
+	root->readonly = 1;
 	if (root->dataFile != NULL) { ILibSimpleDataStore_RebuildKeyTable(root); }
+	ILibSimpleDataStore_ExclusiveUnLock(root);
 }
 void ILibSimpleDataStore_CacheClear_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
 {
@@ -627,7 +1516,18 @@ __EXPORT_TYPE void ILibSimpleDataStore_Close(ILibSimpleDataStore dataStore)
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
 
 	if (root == NULL) return;
+	ILibSimpleDataStore_ExclusiveLock(root);
+	ILibSimpleDataStore_CompactAbort(root);
+	ILibSimpleDataStore_PutStreamAbort(root);
+	ILibSimpleDataStore_BatchCommit(root);	// Staged changes are written, not discarded
+	ILibSimpleDataStore_Flush(root);
+	ILibSimpleDataStore_WriteBack_Release(root);
+	ILibSimpleDataStore_DecodedCache_Release(root);
+	ILibSimpleDataStore_WriteIndexSnapshot(root);
+	ILibSimpleDataStore_Unmap(root);
 	ILibHashtable_DestroyEx(root->keyTable, ILibSimpleDataStore_TableClear_Sink, root);
+	if (root->contentHashes != NULL) { ILibHashtable_DestroyEx(root->contentHashes, ILibSimpleDataStore_TableClear_Sink, root); }
+	ILibSimpleDataStore_KeyIndex_Clear(root);
 	if (root->cacheTable != NULL) { ILibHashtable_DestroyEx(root->cacheTable, ILibSimpleDataStore_CacheClear_Sink, NULL); }
 
 	if (root->filePath != NULL)
@@ -639,37 +1539,225 @@ __EXPORT_TYPE void ILibSimpleDataStore_Close(ILibSimpleDataStore dataStore)
 		fclose(root->dataFile);
 	}
 
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+	ILibReaderWriterLock_Destroy(root->rwLock);
+	sem_destroy(&(root->readerLock));
 	free(root);
 }
 
-// Store a key/value pair in the data store
-__EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen, char *vhash)
+// Flush the write-back tier when its interval is up
+void ILibSimpleDataStore_WriteBack_Sink(void *obj)
 {
-	if (valueLen > INT32_MAX || valueLen > INT32_MAX || keyLen > INT32_MAX) { return(1); }
-	int keyAllocated = 0;
-	int allocated = 0;
-	char hash[SHA384HASHSIZE];
-	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
-	ILibSimpleDataStore_TableEntry *entry;
-	char *origkey = key;
-	int origkeylen = (int)keyLen;
+	ILibSimpleDataStore_WriteBack *wb = (ILibSimpleDataStore_WriteBack*)obj;
+	ILibSimpleDataStore_Root *root = wb->root;
 
-	if (root == NULL) { return 0; }
-	if (root->dataFile == NULL)
+	ILibSimpleDataStore_ExclusiveLock(root);
+	wb->timerSet = 0;
+	if (root->batch != NULL)
 	{
-		ILibSimpleDataStore_CachedEx(dataStore, key, keyLen, value, valueLen, vhash);
-		return(0);
+		// Pending values can't be flushed while a batch is open, so try again later
+		wb->timerSet = 1;
+		ILibLifeTime_AddEx(ILibGetBaseTimer(wb->chain), wb, wb->flushInterval, ILibSimpleDataStore_WriteBack_Sink, NULL);
 	}
-
-	if (keyLen > 1 && key[keyLen - 1] == 0) { keyLen -= 1; }
-	if (vhash != NULL)
+	else
 	{
-		// If we're going to save a compressed record, then we should delete the corrosponding
-		// non compressed entry, to avoid confusion/conflicts
-		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Remove(root->keyTable, NULL, key, (int)keyLen); // No loss of data, capped to INT32_MAX
-		if (entry != NULL)
-		{
-			ILibSimpleDataStore_WriteRecord(root->dataFile, key, (int)keyLen, NULL, 0, NULL); // No dataloss, capped to INT32_MAX
+		ILibSimpleDataStore_Flush(root);
+	}
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+}
+
+// Hold a value in the write-back tier. Repeated puts to a key only keep the newest value, and a value that matches the file isn't held at all
+void ILibSimpleDataStore_WriteBack_Put(ILibSimpleDataStore_Root *root, char *key, int keyLen, char *value, int valueLen)
+{
+	ILibSimpleDataStore_WriteBack *wb = root->writeBack;
+	ILibSimpleDataStore_TableEntry *entry;
+	char *stored;
+
+	if ((entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, key, keyLen)) == NULL)
+	{
+		entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL);
+		ILibSimpleDataStore_TablePut(root, key, keyLen, entry);
+	}
+	else if (entry->pending != NULL)
+	{
+		if (entry->pending->valueLength == valueLen && memcmp(entry->pending->value, value, valueLen) == 0) { return; }
+		wb->dirtyBytes -= entry->pending->valueLength;
+		free(entry->pending);
+		entry->pending = NULL;
+	}
+	else if (entry->valueLength == valueLen && (stored = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) != NULL && memcmp(stored, value, valueLen) == 0)
+	{
+		return;
+	}
+
+	if ((entry->pending = (ILibSimpleDataStore_PendingValue*)malloc(sizeof(ILibSimpleDataStore_PendingValue) + valueLen)) == NULL) { ILIBCRITICALEXIT(254); }
+	entry->pending->valueLength = valueLen;
+	entry->pending->hashed = 0;
+	memcpy_s(entry->pending->value, valueLen, value, valueLen);
+	ILibHashtable_Put(wb->dirty, NULL, key, keyLen, entry);
+	wb->dirtyBytes += valueLen;
+
+	if (wb->flushThreshold > 0 && wb->dirtyBytes >= wb->flushThreshold)
+	{
+		ILibSimpleDataStore_Flush(root);
+	}
+	else if (wb->flushInterval > 0 && wb->timerSet == 0)
+	{
+		wb->timerSet = 1;
+		ILibLifeTime_AddEx(ILibGetBaseTimer(wb->chain), wb, wb->flushInterval, ILibSimpleDataStore_WriteBack_Sink, NULL);
+	}
+}
+
+// SHA384 of a pending value, computed the first time it is asked for
+char* ILibSimpleDataStore_WriteBack_Hash(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_PendingValue *pending)
+{
+	sem_wait(&(root->readerLock));
+	if (pending->hashed == 0)
+	{
+		ILibSimpleDataStore_SHA384(pending->value, pending->valueLength, pending->valueHash);
+		pending->hashed = 1;
+	}
+	sem_post(&(root->readerLock));
+	return(pending->valueHash);
+}
+
+void ILibSimpleDataStore_WriteBack_Flush_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)user;
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+	char hash[SHA384HASHSIZE];
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+
+	if (entry->pending->hashed != 0 && root->recordFormat == ILibSimpleDataStore_RecordFormat_SHA384)
+	{
+		memcpy_s(hash, sizeof(hash), entry->pending->valueHash, SHA384HASHSIZE);
+	}
+	else
+	{
+		ILibSimpleDataStore_Checksum(root->recordFormat, entry->pending->value, entry->pending->valueLength, hash);
+	}
+	ILibSimpleDataStore_BatchRecord(root, Key2, Key2Len, entry->pending->value, entry->pending->valueLength, hash);
+	free(entry->pending);
+	entry->pending = NULL;
+}
+
+// Write the pending values of the write-back tier to the file with a single write, one record per key. Returns 0 on success
+int ILibSimpleDataStore_Flush_Locked(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+
+	if (root == NULL || root->writeBack == NULL || root->writeBack->dirtyBytes == 0) { return(0); }
+	if (ILibSimpleDataStore_BatchBegin(root) != 0) { return(1); }
+
+	// The records are applied to the key table when the batch is committed. If the write fails, they are put in the cache instead
+	ILibHashtable_ClearEx(root->writeBack->dirty, ILibSimpleDataStore_WriteBack_Flush_Sink, root);
+	root->writeBack->dirtyBytes = 0;
+	return(ILibSimpleDataStore_BatchCommitEx(root, 0));
+}
+__EXPORT_TYPE int ILibSimpleDataStore_Flush(ILibSimpleDataStore dataStore)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_Flush_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+void ILibSimpleDataStore_WriteBack_Cache_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+
+	ILibSimpleDataStore_CachedEx((ILibSimpleDataStore_Root*)user, Key2, Key2Len, entry->pending->value, entry->pending->valueLength, NULL);
+	free(entry->pending);
+	entry->pending = NULL;
+}
+
+// Remove the write-back tier. Values that are still pending are kept in the cache, like the values of a failed write
+void ILibSimpleDataStore_WriteBack_Release(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_WriteBack *wb = root->writeBack;
+
+	if (wb == NULL) { return; }
+	if (wb->timerSet != 0) { ILibLifeTime_Remove(ILibGetBaseTimer(wb->chain), wb); }
+	root->writeBack = NULL;
+	ILibHashtable_DestroyEx(wb->dirty, ILibSimpleDataStore_WriteBack_Cache_Sink, root);
+	free(wb);
+}
+
+// Returns nonzero if the record of entry already holds this value
+int ILibSimpleDataStore_IsUnchanged(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_TableEntry *entry, char *hash, char *value, size_t valueLen)
+{
+	char *stored;
+
+	if (memcmp(entry->valueHash, hash, SHA384HASHSIZE) != 0) { return(0); }
+
+	// A matching CRC32C doesn't prove the value is unchanged, so it is compared with the stored value
+	if (ILibSimpleDataStore_ChecksumFormat(hash) == ILibSimpleDataStore_RecordFormat_SHA384) { return(1); }
+	return(entry->valueLength == (int)valueLen && (stored = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) != NULL && memcmp(stored, value, valueLen) == 0);
+}
+
+// Store a key/value pair in the data store
+int ILibSimpleDataStore_PutEx2_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen, char *vhash)
+{
+	if (valueLen > INT32_MAX || valueLen > INT32_MAX || keyLen > INT32_MAX) { return(1); }
+	int keyAllocated = 0;
+	int allocated = 0;
+	char hash[SHA384HASHSIZE];
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_TableEntry *entry;
+	char *origkey = key;
+	int origkeylen = (int)keyLen;
+	char *chunkedKey;
+
+	if (root == NULL) { return 0; }
+	if (root->dataFile == NULL)
+	{
+		ILibSimpleDataStore_CachedEx(dataStore, key, keyLen, value, valueLen, vhash);
+		return(0);
+	}
+
+	if (keyLen > 1 && key[keyLen - 1] == 0) { keyLen -= 1; }
+
+	// A chunked record is shadowed by plain and compressed records, so it is deleted when one of them is written
+	chunkedKey = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+	if (root->batch == NULL)
+	{
+		ILibSimpleDataStore_PutStream_Replace(root, chunkedKey, (int)ILibMemory_Size(chunkedKey));
+	}
+	else if (ILibHashtable_Get(root->keyTable, NULL, chunkedKey, (int)ILibMemory_Size(chunkedKey)) != NULL)
+	{
+		ILibSimpleDataStore_BatchRecord(root, chunkedKey, (int)ILibMemory_Size(chunkedKey), NULL, 0, NULL);
+	}
+	ILibMemory_Free(chunkedKey);
+
+	if (vhash == NULL && valueLen > 0 && root->batch == NULL && root->writeBack != NULL)
+	{
+		// The value is held in memory, until the write-back tier is flushed
+		ILibSimpleDataStore_WriteBack_Put(root, key, (int)keyLen, value, (int)valueLen); // No dataloss, capped to INT32_MAX
+		return(0);
+	}
+	if (vhash != NULL)
+	{
+		// If we're going to save a compressed record, then we should delete the corrosponding
+		// non compressed entry, to avoid confusion/conflicts
+		if (root->batch != NULL)
+		{
+			// The key table is only updated when the batch is committed
+			if (ILibHashtable_Get(root->keyTable, NULL, key, (int)keyLen) != NULL || ILibHashtable_Get(root->batchKeys, NULL, key, (int)keyLen) != NULL) // No dataloss, capped to INT32_MAX
+			{
+				ILibSimpleDataStore_BatchRecord(root, key, (int)keyLen, NULL, 0, NULL); // No dataloss, capped to INT32_MAX
+			}
+		}
+		else if ((entry = ILibSimpleDataStore_TableRemove(root, key, (int)keyLen)) != NULL) // No loss of data, capped to INT32_MAX
+		{
+			ILibSimpleDataStore_AppendRecord(root, key, (int)keyLen, NULL, 0, NULL); // No dataloss, capped to INT32_MAX
+			free(entry);
 		}
 
 		// Calculate the key to use for the compressed record entry
@@ -682,8 +1770,20 @@ __EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char
 		memcpy_s(hash, sizeof(hash), vhash, SHA384HASHSIZE);
 	}
 
+	if (vhash == NULL) { ILibSimpleDataStore_Checksum(root->recordFormat, value, valueLen, hash); }  // Hash the value
+	if (root->batch != NULL)
+	{
+		// An unchanged value isn't staged, unless an earlier put or delete in this batch already changed the key
+		if (ILibHashtable_Get(root->batchKeys, NULL, key, (int)keyLen) != NULL ||																	// No dataloss, capped to INT32_MAX
+			(entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, key, (int)keyLen)) == NULL ||						// No dataloss, capped to INT32_MAX
+			entry->pending != NULL || ILibSimpleDataStore_IsUnchanged(root, entry, hash, value, valueLen) == 0)
+		{
+			ILibSimpleDataStore_BatchRecord(root, key, (int)keyLen, value, (int)valueLen, hash); // No dataloss, capped to INT32_MAX
+		}
+		if (keyAllocated) { ILibMemory_Free(key); }
+		return(0);
+	}
 	entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, key, (int)keyLen); // No dataloss, capped to INT32_MAX
-	if (vhash == NULL) { ILibSimpleDataStore_SHA384(value, valueLen, hash); }  // Hash the value
 
 	// Create a new record for the key and value
 	if (entry == NULL) 
@@ -693,13 +1793,19 @@ __EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char
 	}
 	else 
 	{
-		if (memcmp(entry->valueHash, hash, SHA384HASHSIZE) == 0) { return 0; }
+		ILibSimpleDataStore_WriteBack_Drop(root, key, (int)keyLen, entry); // The value about to be written replaces any pending value
+		if (ILibSimpleDataStore_IsUnchanged(root, entry, hash, value, valueLen) != 0)
+		{
+			if (keyAllocated) { ILibMemory_Free(key); }
+			return 0;
+		}
 		root->dirtySize += entry->valueLength;
 	}
 
 	memcpy_s(entry->valueHash, sizeof(entry->valueHash), hash, SHA384HASHSIZE);
 	entry->valueLength = (int)valueLen; // No dataloss, capped to INT32_MAX
-	entry->valueOffset = ILibSimpleDataStore_WriteRecord(root->dataFile, key, (int)keyLen, value, (int)valueLen, entry->valueHash); // Write the key and value, no dataloss, capped to INT32_MAX
+	entry->valueOffset = ILibSimpleDataStore_AppendRecord(root, key, (int)keyLen, value, (int)valueLen, entry->valueHash); // Write the key and value, no dataloss, capped to INT32_MAX
+	entry->verified = 1; // Hash was just computed from the caller's buffer
 	root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile); // Update the size of the data store;
 
 	if (entry->valueOffset == 0)
@@ -717,7 +1823,7 @@ __EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char
 	}
 
 	// Add the record to the data store
-	ILibHashtable_Put(root->keyTable, NULL, key, (int)keyLen, entry); // No dataloss, capped to INT32_MAX
+	ILibSimpleDataStore_TablePut(root, key, (int)keyLen, entry); // No dataloss, capped to INT32_MAX
 	if (root->warningSize > 0 && root->fileSize > root->warningSize && root->warningSink != NULL)
 	{
 		root->warningSink(root, root->fileSize, root->warningSinkUser);
@@ -725,6 +1831,15 @@ __EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char
 	if (keyAllocated) { ILibMemory_Free(key); }
 	return(0);
 }
+__EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen, char *vhash)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_PutEx2_Locked(dataStore, key, keyLen, value, valueLen, vhash);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
 
 int ILibSimpleDataStore_PutCompressed(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen)
 {
@@ -748,21 +1863,394 @@ int ILibSimpleDataStore_PutCompressed(ILibSimpleDataStore dataStore, char* key,
 	return(ret);
 }
 
+// Free a put stream and remove its temporary file, the hashes must already be finished
+void ILibSimpleDataStore_PutStream_Free(ILibSimpleDataStore_PutStream *stream)
+{
+	fclose(stream->tmp);
+	ILibSimpleDataStore_DeleteFile(stream->tmpPath);
+	free(stream->tmpPath);
+	ILibMemory_Free(stream->key);
+	free(stream->chunk);
+	free(stream->infos);
+	free(stream);
+}
+
+// Add stored bytes to the check value of the chunked record
+void ILibSimpleDataStore_PutStream_UpdateCheck(ILibSimpleDataStore_PutStream *stream, char *data, size_t dataLen)
+{
+	if (stream->format == ILibSimpleDataStore_RecordFormat_CRC32C)
+	{
+		stream->storedCrc = crc32c(stream->storedCrc, (unsigned char*)data, (uint32_t)dataLen); // No dataloss, stored length is capped to INT32_MAX
+	}
+	else
+	{
+		SHA384_Update(&(stream->storedHash), data, dataLen);
+	}
+}
+
+// Hash, compress and write out the chunk being filled, returns 0 on success
+int ILibSimpleDataStore_PutStream_FlushChunk(ILibSimpleDataStore_PutStream *stream)
+{
+	ILibSimpleDataStore_ChunkInfo *info;
+	char *stored = stream->chunk;
+	size_t storedLen = stream->chunkLen;
+	size_t deflatedLen;
+	unsigned int flags = 0;
+
+	if (stream->chunkLen == 0) { return(0); }
+	if (stream->infosLen + sizeof(ILibSimpleDataStore_ChunkInfo) > stream->infosSize)
+	{
+		stream->infosSize *= 2;
+		if ((stream->infos = (char*)realloc(stream->infos, stream->infosSize)) == NULL) { ILIBCRITICALEXIT(254); }
+	}
+	info = (ILibSimpleDataStore_ChunkInfo*)(stream->infos + stream->infosLen);
+	ILibSimpleDataStore_SHA384(stream->chunk, stream->chunkLen, info->hash);
+	if (stream->compressed != 0)
+	{
+		// Only keep the deflated chunk if it is smaller, ILibDeflate() fails if it doesn't fit
+		deflatedLen = stream->chunkLen - 1;
+		if (ILibDeflate(stream->chunk, stream->chunkLen, stream->chunk + ILibSimpleDataStore_ChunkSize, &deflatedLen, NULL) == 0)
+		{
+			stored = stream->chunk + ILibSimpleDataStore_ChunkSize;
+			storedLen = deflatedLen;
+			flags = ILibSimpleDataStore_ChunkFlags_Compressed;
+		}
+	}
+	if (stream->storedLen + storedLen > INT32_MAX || fwrite(stored, 1, storedLen, stream->tmp) != storedLen) { return(1); }
+	ILibSimpleDataStore_PutStream_UpdateCheck(stream, stored, storedLen);
+
+	info->offset = htonl((unsigned int)stream->storedLen);
+	info->length = htonl((unsigned int)storedLen);
+	info->flags = htonl(flags);
+	stream->storedLen += storedLen;
+	stream->infosLen += sizeof(ILibSimpleDataStore_ChunkInfo);
+	stream->chunkLen = 0;
+	return(0);
+}
+
+// Start a streaming put, the value is written with ILibSimpleDataStore_PutStreamWrite() and stored when ILibSimpleDataStore_PutStreamEnd() is called
+int ILibSimpleDataStore_PutStreamBegin_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen, int compressed)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_PutStream *stream;
+
+	if (root == NULL || keyLen > INT32_MAX || root->filePath == NULL || root->dataFile == NULL || root->readonly != 0 || root->putStream != NULL) { return(1); }
+	if (keyLen > 1 && key[keyLen - 1] == 0) { keyLen -= 1; }
+
+	stream = (ILibSimpleDataStore_PutStream*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_PutStream), 0, NULL, NULL);
+	stream->tmpPath = ILibString_Cat(root->filePath, -1, ".stream", -1);
+	if ((stream->tmp = ILibSimpleDataStore_OpenFileEx(stream->tmpPath, 1)) == NULL) { free(stream->tmpPath); free(stream); return(1); }
+	stream->key = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+	stream->compressed = compressed;
+	stream->format = root->recordFormat;
+	if ((stream->chunk = (char*)malloc(2 * ILibSimpleDataStore_ChunkSize)) == NULL) { ILIBCRITICALEXIT(254); }
+	stream->infosSize = 16 * sizeof(ILibSimpleDataStore_ChunkInfo);
+	if ((stream->infos = (char*)malloc(stream->infosSize)) == NULL) { ILIBCRITICALEXIT(254); }
+	SHA384_Init(&(stream->valueHash));
+	SHA384_Init(&(stream->storedHash));
+	root->putStream = stream;
+	return(0);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_PutStreamBegin(ILibSimpleDataStore dataStore, char* key, size_t keyLen, int compressed)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_PutStreamBegin_Locked(dataStore, key, keyLen, compressed);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Add data to the value of the open streaming put, returns 0 on success. After an error, the stream can only be aborted
+int ILibSimpleDataStore_PutStreamWrite_Locked(ILibSimpleDataStore dataStore, char* data, size_t dataLen)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_PutStream *stream;
+	size_t len;
+
+	if (root == NULL || (stream = root->putStream) == NULL || stream->error != 0) { return(1); }
+	if (stream->length + dataLen > INT32_MAX) { stream->error = 1; return(1); }
+	SHA384_Update(&(stream->valueHash), data, dataLen);
+	stream->length += dataLen;
+
+	while (dataLen > 0)
+	{
+		len = ILibSimpleDataStore_ChunkSize - stream->chunkLen;
+		if (len > dataLen) { len = dataLen; }
+		memcpy_s(stream->chunk + stream->chunkLen, ILibSimpleDataStore_ChunkSize - stream->chunkLen, data, len);
+		stream->chunkLen += len;
+		data += len;
+		dataLen -= len;
+		if (stream->chunkLen == ILibSimpleDataStore_ChunkSize && ILibSimpleDataStore_PutStream_FlushChunk(stream) != 0) { stream->error = 1; return(1); }
+	}
+	return(0);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_PutStreamWrite(ILibSimpleDataStore dataStore, char* data, size_t dataLen)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_PutStreamWrite_Locked(dataStore, data, dataLen);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Abandon the open streaming put, the key keeps its previous value
+void ILibSimpleDataStore_PutStreamAbort_Locked(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	char hash[SHA384HASHSIZE];
+
+	if (root == NULL || root->putStream == NULL) { return; }
+	SHA384_Final((unsigned char*)hash, &(root->putStream->valueHash));
+	SHA384_Final((unsigned char*)hash, &(root->putStream->storedHash));
+	ILibSimpleDataStore_PutStream_Free(root->putStream);
+	root->putStream = NULL;
+}
+__EXPORT_TYPE void ILibSimpleDataStore_PutStreamAbort(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	ILibSimpleDataStore_PutStreamAbort_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+}
+
+// Remove the table entry for a key, and record the delete in the data file
+void ILibSimpleDataStore_PutStream_Replace(ILibSimpleDataStore_Root *root, char *key, int keyLen)
+{
+	ILibSimpleDataStore_TableEntry *entry;
+
+	if ((entry = ILibSimpleDataStore_TableRemove(root, key, keyLen)) != NULL)
+	{
+		ILibSimpleDataStore_AppendRecord(root, key, keyLen, NULL, 0, NULL);
+		root->dirtySize += entry->valueLength;
+		free(entry);
+	}
+}
+
+// Store the value of the open streaming put as a chunked record, replacing any plain or compressed value of the key. Returns 0 on success
+int ILibSimpleDataStore_PutStreamEnd_Locked(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_PutStream *stream;
+	ILibSimpleDataStore_ChunkTrailer trailer;
+	ILibSimpleDataStore_TableEntry *entry;
+	char hash[SHA384HASHSIZE];
+	char *tmpkey;
+	int keyLen, userKeyLen;
+	uint64_t valueLength, offset = 0, copied = 0;
+	size_t len;
+
+	if (root == NULL || (stream = root->putStream) == NULL) { return(1); }
+	root->putStream = NULL;
+	if (stream->error == 0 && ILibSimpleDataStore_PutStream_FlushChunk(stream) != 0) { stream->error = 1; }
+
+	// The record check value covers the chunks, the chunk table and the trailer, in the order they are stored
+	SHA384_Final((unsigned char*)trailer.hash, &(stream->valueHash));
+	trailer.length = htonl((unsigned int)stream->length);
+	trailer.chunkSize = htonl(ILibSimpleDataStore_ChunkSize);
+	trailer.chunkCount = htonl((unsigned int)(stream->infosLen / sizeof(ILibSimpleDataStore_ChunkInfo)));
+	trailer.magic = htonl(ILibSimpleDataStore_ChunkTrailer_MAGIC);
+	ILibSimpleDataStore_PutStream_UpdateCheck(stream, stream->infos, stream->infosLen);
+	ILibSimpleDataStore_PutStream_UpdateCheck(stream, (char*)&trailer, sizeof(trailer));
+	SHA384_Final((unsigned char*)hash, &(stream->storedHash));
+	if (stream->format == ILibSimpleDataStore_RecordFormat_CRC32C) { ILibSimpleDataStore_CRC32CCheck(stream->storedCrc, hash); }
+
+	valueLength = stream->storedLen + stream->infosLen + sizeof(trailer);
+	keyLen = (int)ILibMemory_Size(stream->key);
+	if (stream->error != 0 || valueLength > INT32_MAX || root->batch != NULL || root->dataFile == NULL || root->readonly != 0 || fflush(stream->tmp) != 0)
+	{
+		ILibSimpleDataStore_PutStream_Free(stream);
+		return(1);
+	}
+
+	if ((offset = ILibSimpleDataStore_AppendRecord(root, stream->key, keyLen, NULL, (int)valueLength, hash)) != 0)
+	{
+		// Copy the chunks in after the record header, then the chunk table and trailer
+		ILibSimpleDataStore_SeekPosition(stream->tmp, 0, SEEK_SET);
+		while ((len = fread(root->scratchPad, 1, sizeof(root->scratchPad), stream->tmp)) > 0)
+		{
+			if (fwrite(root->scratchPad, 1, len, root->dataFile) != len) { break; }
+			copied += len;
+		}
+		if (copied != stream->storedLen || fwrite(stream->infos, 1, stream->infosLen, root->dataFile) != stream->infosLen ||
+			fwrite(&trailer, 1, sizeof(trailer), root->dataFile) != sizeof(trailer) || fflush(root->dataFile) != 0)
+		{
+			// Undo the partial record, so we don't corrupt the db
+			ILibSimpleDataStore_Truncate(root->dataFile, offset - sizeof(ILibSimpleDataStore_RecordHeader_NG) - keyLen);
+			offset = 0;
+		}
+	}
+	if (offset == 0)
+	{
+		ILibSimpleDataStore_PutStream_Free(stream);
+		if (root->ErrorHandler != NULL) { root->ErrorHandler(root, root->ErrorHandlerUser); }
+		return(1);
+	}
+	root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
+
+	// Plain and compressed records are read before chunked records, so they must go
+	userKeyLen = keyLen - (int)sizeof(uint32_t);
+	ILibSimpleDataStore_PutStream_Replace(root, stream->key, userKeyLen);
+	tmpkey = (char*)ILibMemory_SmartAllocate(userKeyLen + sizeof(uint32_t));
+	memcpy_s(tmpkey, ILibMemory_Size(tmpkey), stream->key, userKeyLen);
+	((uint32_t*)(tmpkey + userKeyLen))[0] = crc32c(0, (unsigned char*)tmpkey, (uint32_t)userKeyLen);
+	ILibSimpleDataStore_PutStream_Replace(root, tmpkey, (int)ILibMemory_Size(tmpkey));
+	ILibMemory_Free(tmpkey);
+
+	if ((entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, stream->key, keyLen)) == NULL)
+	{
+		entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL);
+	}
+	else
+	{
+		root->dirtySize += entry->valueLength;
+	}
+	memcpy_s(entry->valueHash, sizeof(entry->valueHash), hash, SHA384HASHSIZE);
+	entry->valueLength = (int)valueLength;
+	entry->valueOffset = offset;
+	entry->verified = 1; // Every chunk was hashed from the caller's data
+	ILibSimpleDataStore_TablePut(root, stream->key, keyLen, entry);
+	ILibSimpleDataStore_PutStream_Free(stream);
+
+	if (root->warningSize > 0 && root->fileSize > root->warningSize && root->warningSink != NULL)
+	{
+		root->warningSink(root, root->fileSize, root->warningSinkUser);
+	}
+	return(0);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_PutStreamEnd(ILibSimpleDataStore dataStore)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_PutStreamEnd_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Get part of a value, from the mapped view when possible, otherwise it is read into buffer. Returns NULL on error
+char* ILibSimpleDataStore_ReadValue(ILibSimpleDataStore_Root *root, uint64_t offset, size_t length, char *buffer)
+{
+	char *view;
+
+	if ((view = ILibSimpleDataStore_MapValue(root, offset, (int)length)) != NULL) { return(view); }
+	return(ILibSimpleDataStore_ReadFile(root, offset, buffer, length) == 0 ? buffer : NULL);
+}
+
+// Read and check the trailer of a chunked record, returns 0 if it is valid
+int ILibSimpleDataStore_ReadChunkTrailer(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_TableEntry *entry, ILibSimpleDataStore_ChunkTrailer *trailer)
+{
+	char *value;
+
+	if (entry->valueLength < (int)sizeof(ILibSimpleDataStore_ChunkTrailer)) { return(1); }
+	if ((value = ILibSimpleDataStore_ReadValue(root, entry->valueOffset + entry->valueLength - sizeof(ILibSimpleDataStore_ChunkTrailer), sizeof(ILibSimpleDataStore_ChunkTrailer), (char*)trailer)) == NULL) { return(1); }
+	if (value != (char*)trailer) { memcpy_s(trailer, sizeof(ILibSimpleDataStore_ChunkTrailer), value, sizeof(ILibSimpleDataStore_ChunkTrailer)); }
+
+	trailer->length = ntohl(trailer->length);
+	trailer->chunkSize = ntohl(trailer->chunkSize);
+	trailer->chunkCount = ntohl(trailer->chunkCount);
+	trailer->magic = ntohl(trailer->magic);
+	if (trailer->magic != ILibSimpleDataStore_ChunkTrailer_MAGIC || trailer->chunkSize == 0 || trailer->chunkSize > ILibSimpleDataStore_MaxChunkSize ||
+		trailer->chunkCount != (unsigned int)(((uint64_t)trailer->length + trailer->chunkSize - 1) / trailer->chunkSize) ||
+		(uint64_t)trailer->chunkCount * sizeof(ILibSimpleDataStore_ChunkInfo) + sizeof(ILibSimpleDataStore_ChunkTrailer) > (uint64_t)entry->valueLength) { return(1); }
+	return(0);
+}
+
+// Get chunk i of a chunked record, inflating it into buffer if it is compressed. Returns a pointer to the chunk, or NULL if it can't be read or fails the hash check
+char* ILibSimpleDataStore_ReadChunk(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_TableEntry *entry, ILibSimpleDataStore_ChunkTrailer *trailer, unsigned int i, char *buffer, char *stored)
+{
+	ILibSimpleDataStore_ChunkInfo info;
+	char hash[SHA384HASHSIZE];
+	char *data;
+	uint64_t table = (uint64_t)entry->valueLength - sizeof(ILibSimpleDataStore_ChunkTrailer) - (uint64_t)trailer->chunkCount * sizeof(ILibSimpleDataStore_ChunkInfo);
+	size_t len = i + 1 < trailer->chunkCount ? trailer->chunkSize : (size_t)(trailer->length - (uint64_t)i * trailer->chunkSize);
+	size_t tmplen = len;
+
+	if ((data = ILibSimpleDataStore_ReadValue(root, entry->valueOffset + table + (uint64_t)i * sizeof(info), sizeof(info), (char*)&info)) == NULL) { return(NULL); }
+	if (data != (char*)&info) { memcpy_s(&info, sizeof(info), data, sizeof(info)); }
+	info.offset = ntohl(info.offset);
+	info.length = ntohl(info.length);
+	info.flags = ntohl(info.flags);
+	if ((uint64_t)info.offset + info.length > table || info.length > trailer->chunkSize) { return(NULL); }
+
+	if ((info.flags & ILibSimpleDataStore_ChunkFlags_Compressed) == ILibSimpleDataStore_ChunkFlags_Compressed)
+	{
+		if ((data = ILibSimpleDataStore_ReadValue(root, entry->valueOffset + info.offset, info.length, stored)) == NULL) { return(NULL); }
+		if (ILibInflate(data, info.length, buffer, &tmplen, 0) != 0 || tmplen != len) { return(NULL); }
+		data = buffer;
+	}
+	else
+	{
+		if (info.length != len || (data = ILibSimpleDataStore_ReadValue(root, entry->valueOffset + info.offset, len, buffer)) == NULL) { return(NULL); }
+	}
+
+	if (entry->verified == 0)
+	{
+		ILibSimpleDataStore_SHA384(data, len, hash);
+		if (memcmp(hash, info.hash, SHA384HASHSIZE) != 0) { return(NULL); }
+	}
+	return(data);
+}
+
+// Copy up to bufferLen bytes of a chunked record from offset, one chunk at a time. Returns the number of bytes copied, or -1 on error
+int ILibSimpleDataStore_ReadChunked(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_TableEntry *entry, ILibSimpleDataStore_ChunkTrailer *trailer, uint64_t offset, char *buffer, size_t bufferLen)
+{
+	char *scratch, *data;
+	size_t done = 0, within, chunkLen, len;
+	unsigned int i;
+
+	if (offset >= trailer->length) { return(0); }
+	if (bufferLen > trailer->length - offset) { bufferLen = (size_t)(trailer->length - offset); }
+	if ((scratch = (char*)malloc(2 * (size_t)trailer->chunkSize)) == NULL) { ILIBCRITICALEXIT(254); }
+
+	while (done < bufferLen)
+	{
+		i = (unsigned int)(offset / trailer->chunkSize);
+		within = (size_t)(offset % trailer->chunkSize);
+		chunkLen = i + 1 < trailer->chunkCount ? trailer->chunkSize : (size_t)(trailer->length - (uint64_t)i * trailer->chunkSize);
+		len = chunkLen - within;
+		if (len > bufferLen - done) { len = bufferLen - done; }
+
+		// Whole chunks are inflated straight into the caller's buffer
+		if ((data = ILibSimpleDataStore_ReadChunk(root, entry, trailer, i, (within == 0 && len == chunkLen) ? buffer + done : scratch, scratch + trailer->chunkSize)) == NULL) { break; }
+		if (data + within != buffer + done) { memcpy_s(buffer + done, bufferLen - done, data + within, len); }
+		done += len;
+		offset += len;
+	}
+	free(scratch);
+	return(done == bufferLen ? (int)done : -1);
+}
+
+// Get the whole value of a chunked record, with the same return values as ILibSimpleDataStore_GetEx()
+int ILibSimpleDataStore_GetChunked(ILibSimpleDataStore_Root *root, ILibSimpleDataStore_TableEntry *entry, char *buffer, size_t bufferLen)
+{
+	ILibSimpleDataStore_ChunkTrailer trailer;
+
+	if (ILibSimpleDataStore_ReadChunkTrailer(root, entry, &trailer) != 0 || trailer.length > INT32_MAX) { return(0); }
+	if (buffer == NULL || bufferLen == 0) { return((int)trailer.length); }
+	if (bufferLen < trailer.length || ILibSimpleDataStore_ReadChunked(root, entry, &trailer, 0, buffer, trailer.length) != (int)trailer.length) { return(0); }
+	entry->verified = 1; // Every chunk passed its hash check
+	if (bufferLen > trailer.length) { buffer[trailer.length] = 0; } // Add a zero at the end to be nice, if the buffer can take it.
+	return((int)trailer.length);
+}
+
 
 __EXPORT_TYPE int ILibSimpleDataStore_GetInt(ILibSimpleDataStore dataStore, char* key, int defaultValue)
 {
-	int bufLen = ILibSimpleDataStore_Get(dataStore, key, ILibScratchPad, sizeof(ILibScratchPad));
-	if (bufLen == 0 || bufLen >= sizeof(ILibScratchPad)) { return(defaultValue); }
-	return(ILib_atoi2_int32(ILibScratchPad, sizeof(ILibScratchPad)));
+	char value[32];		// Not ILibScratchPad, this can be called from any thread
+	int bufLen = ILibSimpleDataStore_Get(dataStore, key, value, sizeof(value));
+	if (bufLen == 0 || bufLen >= (int)sizeof(value)) { return(defaultValue); }
+	return(ILib_atoi2_int32(value, sizeof(value)));
 }
 
 // Get a value from the data store given a key
-__EXPORT_TYPE int ILibSimpleDataStore_GetEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char *buffer, size_t bufferLen)
+int ILibSimpleDataStore_GetEx_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char *buffer, size_t bufferLen)
 {
 	if (keyLen > INT32_MAX || bufferLen > INT32_MAX) { return(0); }
 
 	int isCompressed = 0;
 	char hash[SHA384HASHSIZE];
+	char *value;
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
 	ILibSimpleDataStore_TableEntry *entry;
 	
@@ -822,32 +2310,61 @@ __EXPORT_TYPE int ILibSimpleDataStore_GetEx(ILibSimpleDataStore dataStore, char*
 		ILibMemory_Free(tmpkey);
 		if (entry != NULL) { isCompressed = 1; }
 	}
+	if (entry == NULL)
+	{
+		// Or a chunked record, which is read one chunk at a time
+		char *tmpkey = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey));
+		ILibMemory_Free(tmpkey);
+		if (entry != NULL) { return(ILibSimpleDataStore_GetChunked(root, entry, buffer, bufferLen)); }
+	}
 
 	if (entry == NULL) return 0; // If there is no in-memory entry for this key, return zero now.
-	if ((buffer != NULL) && (bufferLen >= (size_t)entry->valueLength) && isCompressed == 0) // If the buffer is not null and can hold the value, place the value in the buffer.
+	if (entry->pending != NULL)
 	{
-		if (ILibSimpleDataStore_SeekPosition(root->dataFile, entry->valueOffset, SEEK_SET) != 0) return 0; // Seek to the position of the value in the data store
-		if (fread(buffer, 1, entry->valueLength, root->dataFile) == 0) return 0; // Read the value into the buffer
-		util_sha384(buffer, entry->valueLength, hash); // Compute the hash of the read value
-		if (memcmp(hash, entry->valueHash, SHA384HASHSIZE) != 0) return 0; // Check the hash, return 0 if not valid
-		if (bufferLen > (size_t)entry->valueLength) { buffer[entry->valueLength] = 0; } // Add a zero at the end to be nice, if the buffer can take it.
+		// Newer value held by the write-back tier
+		if ((buffer != NULL) && (bufferLen >= (size_t)entry->pending->valueLength))
+		{
+			memcpy_s(buffer, bufferLen, entry->pending->value, entry->pending->valueLength);
+			if (bufferLen > (size_t)entry->pending->valueLength) { buffer[entry->pending->valueLength] = 0; } // Add a zero at the end to be nice, if the buffer can take it.
+		}
+		return((bufferLen == 0 || bufferLen >= (size_t)entry->pending->valueLength) ? entry->pending->valueLength : 0);
 	}
-	else if (isCompressed != 0)
+	if ((buffer != NULL) && (bufferLen >= (size_t)entry->valueLength) && isCompressed == 0) // If the buffer is not null and can hold the value, place the value in the buffer.
 	{
-		// This is a compressed record
-		char *compressed = ILibMemory_SmartAllocate(entry->valueLength);
+		if ((value = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) != NULL)
+		{
+			if (entry->verified == 0)
+			{
+				if (ILibSimpleDataStore_VerifyValue(value, entry->valueLength, entry->valueHash) != 0) return 0; // Only check the value the first time it is read, return 0 if not valid
+				entry->verified = 1;
+			}
+			memcpy_s(buffer, bufferLen, value, entry->valueLength);
+		}
+		else
+		{
+			if (ILibSimpleDataStore_ReadFile(root, entry->valueOffset, buffer, entry->valueLength) != 0) return 0; // Read the value into the buffer
+			if (ILibSimpleDataStore_VerifyValue(buffer, entry->valueLength, entry->valueHash) != 0) return 0; // Check the read value, return 0 if not valid
+		}
+		if (bufferLen > (size_t)entry->valueLength) { buffer[entry->valueLength] = 0; } // Add a zero at the end to be nice, if the buffer can take it.
+	}
+	else if (isCompressed != 0)
+	{
+		// This is a compressed record
+		char *compressed = ILibMemory_SmartAllocate(entry->valueLength);
 		size_t tmplen = bufferLen;
-		if (ILibSimpleDataStore_SeekPosition(root->dataFile, entry->valueOffset, SEEK_SET) != 0) return 0; // Seek to the position of the value in the data store
-		if (fread(compressed, 1, entry->valueLength, root->dataFile) == 0) return 0; // Read the value into the buffer
-		if (ILibInflate(compressed, entry->valueLength, buffer, &tmplen, 0) == 0)
+		if ((value = ILibSimpleDataStore_ReadValue(root, entry->valueOffset, entry->valueLength, compressed)) == NULL) { ILibMemory_Free(compressed); return(0); } // Inflated straight from the mapped view, when there is one
+		if (ILibInflate(value, entry->valueLength, buffer, &tmplen, 0) == 0)
 		{
 			ILibMemory_Free(compressed);
 			if (buffer == NULL) { return((int)tmplen); }
 
-			// Before we return, we need to check the HASH of the uncompressed data
+			// Before we return, we need to check the HASH of the uncompressed data, the first time it is read
+			if (entry->verified != 0) { return((int)tmplen); }
 			ILibSimpleDataStore_SHA384(buffer, (int)tmplen, hash);
 			if (memcmp(hash, entry->valueHash, SHA384HASHSIZE) == 0)
 			{
+				entry->verified = 1;
 				return((int)tmplen);
 			}
 			else
@@ -864,9 +2381,194 @@ __EXPORT_TYPE int ILibSimpleDataStore_GetEx(ILibSimpleDataStore dataStore, char*
 
 	return((bufferLen == 0 || bufferLen >= (size_t)entry->valueLength) ? entry->valueLength : 0);
 }
+__EXPORT_TYPE int ILibSimpleDataStore_GetEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char *buffer, size_t bufferLen)
+{
+	int retVal;
+
+	ILibSimpleDataStore_SharedLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_GetEx_Locked(dataStore, key, keyLen, buffer, bufferLen);
+	ILibSimpleDataStore_SharedUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+__EXPORT_TYPE char* ILibSimpleDataStore_GetCopyEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
+{
+	char *retVal = NULL;
+	int len;
+
+	// Size and copy under the same lock, so the value can't be replaced in between
+	ILibSimpleDataStore_SharedLock((ILibSimpleDataStore_Root*)dataStore);
+	if ((len = ILibSimpleDataStore_GetEx_Locked(dataStore, key, keyLen, NULL, 0)) > 0)
+	{
+		retVal = (char*)ILibMemory_SmartAllocate(len);
+		if (ILibSimpleDataStore_GetEx_Locked(dataStore, key, keyLen, retVal, len) != len) { ILibMemory_Free(retVal); retVal = NULL; }
+	}
+	ILibSimpleDataStore_SharedUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Read part of a value starting at offset, chunked records are read one chunk at a time
+int ILibSimpleDataStore_ReadAt_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen, uint64_t offset, char* buffer, size_t bufferLen)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_TableEntry *entry = NULL;
+	ILibSimpleDataStore_ChunkTrailer trailer;
+	char *tmpkey, *value;
+	int len;
+
+	if (root == NULL || buffer == NULL || keyLen > INT32_MAX || bufferLen > INT32_MAX) { return(-1); }
+	if (keyLen > 1 && key[keyLen - 1] == 0) { keyLen -= 1; }
+
+	if (root->cacheTable == NULL && (entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, key, (int)keyLen)) != NULL) // No dataloss, capped to INT32_MAX
+	{
+		if (entry->pending != NULL)
+		{
+			if (offset >= (uint64_t)entry->pending->valueLength) { return(0); }
+			if (bufferLen > (uint64_t)entry->pending->valueLength - offset) { bufferLen = (size_t)((uint64_t)entry->pending->valueLength - offset); }
+			memcpy_s(buffer, bufferLen, entry->pending->value + offset, bufferLen);
+			return((int)bufferLen);
+		}
+		if (entry->verified == 0)
+		{
+			// The check value covers the whole value, so it is checked in full the first time
+			if ((value = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) == NULL) { entry = NULL; }
+			else
+			{
+				if (ILibSimpleDataStore_VerifyValue(value, entry->valueLength, entry->valueHash) != 0) { return(-1); }
+				entry->verified = 1;
+			}
+		}
+		if (entry != NULL)
+		{
+			if (offset >= (uint64_t)entry->valueLength) { return(0); }
+			if (bufferLen > (uint64_t)entry->valueLength - offset) { bufferLen = (size_t)((uint64_t)entry->valueLength - offset); }
+			if ((value = ILibSimpleDataStore_ReadValue(root, entry->valueOffset + offset, bufferLen, buffer)) == NULL) { return(-1); }
+			if (value != buffer) { memcpy_s(buffer, bufferLen, value, bufferLen); }
+			return((int)bufferLen);
+		}
+	}
+	else if (root->cacheTable == NULL)
+	{
+		tmpkey = (char*)ILibMemory_SmartAllocate(keyLen + sizeof(uint32_t));
+		memcpy_s(tmpkey, ILibMemory_Size(tmpkey), key, keyLen);
+		((uint32_t*)(tmpkey + keyLen))[0] = crc32c(0, (unsigned char*)key, (uint32_t)keyLen); // No dataloss, capped to INT32_MAX
+		if (ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey)) == NULL)
+		{
+			ILibMemory_Free(tmpkey);
+			tmpkey = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+			entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey));
+			ILibMemory_Free(tmpkey);
+			if (entry == NULL) { return(-1); }
+			if (ILibSimpleDataStore_ReadChunkTrailer(root, entry, &trailer) != 0) { return(-1); }
+			return(ILibSimpleDataStore_ReadChunked(root, entry, &trailer, offset, buffer, bufferLen));
+		}
+		ILibMemory_Free(tmpkey);
+	}
+
+	// Cached values, compressed records, and values that can't be mapped, are read whole
+	if ((len = ILibSimpleDataStore_GetEx_Locked(root, key, keyLen, NULL, 0)) <= 0) { return(-1); }
+	if (offset >= (uint64_t)len) { return(0); }
+	value = (char*)ILibMemory_SmartAllocate(len);
+	if (ILibSimpleDataStore_GetEx_Locked(root, key, keyLen, value, len) != len) { ILibMemory_Free(value); return(-1); }
+	if (bufferLen > (uint64_t)len - offset) { bufferLen = (size_t)((uint64_t)len - offset); }
+	memcpy_s(buffer, bufferLen, value + offset, bufferLen);
+	ILibMemory_Free(value);
+	return((int)bufferLen);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_ReadAt(ILibSimpleDataStore dataStore, char* key, size_t keyLen, uint64_t offset, char* buffer, size_t bufferLen)
+{
+	int retVal;
+
+	ILibSimpleDataStore_SharedLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_ReadAt_Locked(dataStore, key, keyLen, offset, buffer, bufferLen);
+	ILibSimpleDataStore_SharedUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Get a borrowed pointer to a value, without copying it out of the data store
+char* ILibSimpleDataStore_GetPtrEx_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen, int *valueLen)
+{
+	char *value;
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_TableEntry *entry;
+
+	if (valueLen != NULL) { *valueLen = 0; }
+	if (root == NULL || keyLen > INT32_MAX) { return(NULL); }
+	if (keyLen > 1 && key[keyLen - 1] == 0) { keyLen -= 1; }
+
+	if (root->cacheTable != NULL)
+	{
+		ILibSimpleDataStore_CacheEntry *centry = (ILibSimpleDataStore_CacheEntry*)ILibHashtable_Get(root->cacheTable, NULL, key, (int)keyLen); // No dataloss, capped to INT32_MAX
+		if (centry != NULL)
+		{
+			if (valueLen != NULL) { *valueLen = centry->valueLength; }
+			return(centry->value);
+		}
+	}
+
+	// Compressed records are stored under a different key, so they aren't found here, and must be read with GetEx()
+	entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, key, (int)keyLen); // No dataloss, capped to INT32_MAX
+	if (entry != NULL && entry->pending != NULL)
+	{
+		if (valueLen != NULL) { *valueLen = entry->pending->valueLength; }
+		return(entry->pending->value);
+	}
+	if (entry == NULL || (value = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) == NULL) { return(NULL); }
+	if (entry->verified == 0)
+	{
+		if (ILibSimpleDataStore_VerifyValue(value, entry->valueLength, entry->valueHash) != 0) { return(NULL); }
+		entry->verified = 1;
+	}
+	if (valueLen != NULL) { *valueLen = entry->valueLength; }
+	return(value);
+}
+__EXPORT_TYPE char* ILibSimpleDataStore_GetPtrEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, int *valueLen)
+{
+	char* retVal;
+
+	ILibSimpleDataStore_SharedLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_GetPtrEx_Locked(dataStore, key, keyLen, valueLen);
+	ILibSimpleDataStore_SharedUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Get the SHA384 of a value stored with a CRC32C check value, it is computed the first time it is asked for
+char* ILibSimpleDataStore_GetContentHash(ILibSimpleDataStore_Root *root, char *key, int keyLen, ILibSimpleDataStore_TableEntry *entry)
+{
+	ILibSimpleDataStore_ContentHash *content = NULL;
+	char hash[SHA384HASHSIZE];
+	char *value, *buffer = NULL;
+
+	// Readers can ask for the same hash together, so the table is only touched under readerLock
+	sem_wait(&(root->readerLock));
+	if (root->contentHashes != NULL) { content = (ILibSimpleDataStore_ContentHash*)ILibHashtable_Get(root->contentHashes, NULL, key, keyLen); }
+	sem_post(&(root->readerLock));
+	if (content != NULL) { return(content->hash); }
+
+	if ((value = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) == NULL)
+	{
+		if ((buffer = (char*)malloc(entry->valueLength + 1)) == NULL) { ILIBCRITICALEXIT(254); }
+		value = ILibSimpleDataStore_ReadValue(root, entry->valueOffset, entry->valueLength, buffer);
+	}
+	if (value != NULL && ILibSimpleDataStore_VerifyValue(value, entry->valueLength, entry->valueHash) == 0)
+	{
+		entry->verified = 1;
+		ILibSimpleDataStore_SHA384(value, entry->valueLength, hash);
+		sem_wait(&(root->readerLock));
+		if (root->contentHashes == NULL) { root->contentHashes = ILibHashtable_Create(); }
+		if ((content = (ILibSimpleDataStore_ContentHash*)ILibHashtable_Get(root->contentHashes, NULL, key, keyLen)) == NULL)
+		{
+			content = (ILibSimpleDataStore_ContentHash*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_ContentHash), 0, NULL, NULL);
+			memcpy_s(content->hash, sizeof(content->hash), hash, SHA384HASHSIZE);
+			ILibHashtable_Put(root->contentHashes, NULL, key, keyLen, content);
+		}
+		sem_post(&(root->readerLock));
+	}
+	free(buffer);
+	return(content != NULL ? content->hash : NULL);
+}
 
 // Get the reference to the SHA384 hash value from the datastore for a given a key.
-__EXPORT_TYPE char* ILibSimpleDataStore_GetHashEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
+char* ILibSimpleDataStore_GetHashEx_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
 {
 	if (keyLen > INT32_MAX) { return(NULL); }
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
@@ -905,34 +2607,261 @@ __EXPORT_TYPE char* ILibSimpleDataStore_GetHashEx(ILibSimpleDataStore dataStore,
 		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey));
 		ILibMemory_Free(tmpkey);
 	}
+	if (entry == NULL)
+	{
+		// The hash of a chunked value is at the start of its trailer, the hash in the table is of the record as stored
+		char *tmpkey = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+		char *trailer = NULL;
+		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey));
+		ILibMemory_Free(tmpkey);
+		if (entry != NULL && entry->valueLength >= (int)sizeof(ILibSimpleDataStore_ChunkTrailer))
+		{
+			trailer = ILibSimpleDataStore_MapValue(root, entry->valueOffset + entry->valueLength - sizeof(ILibSimpleDataStore_ChunkTrailer), sizeof(ILibSimpleDataStore_ChunkTrailer));
+		}
+		return((trailer != NULL && ntohl(((ILibSimpleDataStore_ChunkTrailer*)trailer)->magic) == ILibSimpleDataStore_ChunkTrailer_MAGIC) ? trailer : NULL);
+	}
 
 	if (entry == NULL) return NULL; // If there is no in-memory entry for this key, return zero now.
+	if (entry->pending != NULL) { return(ILibSimpleDataStore_WriteBack_Hash(root, entry->pending)); }
+	if (ILibSimpleDataStore_ChecksumFormat(entry->valueHash) == ILibSimpleDataStore_RecordFormat_CRC32C) { return(ILibSimpleDataStore_GetContentHash(root, key, (int)keyLen, entry)); }
 	return entry->valueHash;
 }
+__EXPORT_TYPE char* ILibSimpleDataStore_GetHashEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
+{
+	char* retVal;
+
+	ILibSimpleDataStore_SharedLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_GetHashEx_Locked(dataStore, key, keyLen);
+	ILibSimpleDataStore_SharedUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_GetHashCopyEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char *hash)
+{
+	char *ref;
+	int retVal = 0;
+
+	// The hash is copied before the lock is released, after which a write can replace it
+	ILibSimpleDataStore_SharedLock((ILibSimpleDataStore_Root*)dataStore);
+	if ((ref = ILibSimpleDataStore_GetHashEx_Locked(dataStore, key, keyLen)) != NULL)
+	{
+		memcpy_s(hash, SHA384HASHSIZE, ref, SHA384HASHSIZE);
+		retVal = SHA384HASHSIZE;
+	}
+	ILibSimpleDataStore_SharedUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
 int ILibSimpleDataStore_GetHashSize()
 {
 	ILibSimpleDataStore_TableEntry e;
 	return((int)sizeof(e.valueHash));
 }
+
+void ILibSimpleDataStore_DecodedCache_Unlink(ILibSimpleDataStore_DecodedCache *cache, ILibSimpleDataStore_DecodedValue *decoded)
+{
+	if (decoded->prev != NULL) { decoded->prev->next = decoded->next; } else { cache->head = decoded->next; }
+	if (decoded->next != NULL) { decoded->next->prev = decoded->prev; } else { cache->tail = decoded->prev; }
+}
+void ILibSimpleDataStore_DecodedCache_LinkHead(ILibSimpleDataStore_DecodedCache *cache, ILibSimpleDataStore_DecodedValue *decoded)
+{
+	decoded->prev = NULL;
+	decoded->next = cache->head;
+	if (cache->head != NULL) { cache->head->prev = decoded; } else { cache->tail = decoded; }
+	cache->head = decoded;
+}
+
+// Drop the least recently used values until the cache fits in maxBytes. Values still held by a caller are freed when they are released. readerLock must be held
+void ILibSimpleDataStore_DecodedCache_Trim(ILibSimpleDataStore_DecodedCache *cache, size_t maxBytes)
+{
+	ILibSimpleDataStore_DecodedValue *decoded;
+
+	while ((decoded = cache->tail) != NULL && cache->bytes > maxBytes)
+	{
+		ILibHashtable_Remove(cache->table, NULL, decoded->hash, SHA384HASHSIZE);
+		ILibSimpleDataStore_DecodedCache_Unlink(cache, decoded);
+		cache->bytes -= decoded->valueLen;
+		decoded->cached = 0;
+		if (decoded->refs == 0) { free(decoded); }
+	}
+}
+
+// Empty and free the decoded cache, the caller holds the exclusive lock
+void ILibSimpleDataStore_DecodedCache_Release(ILibSimpleDataStore_Root *root)
+{
+	if (root->decoded == NULL) { return; }
+	sem_wait(&(root->readerLock));
+	ILibSimpleDataStore_DecodedCache_Trim(root->decoded, 0);
+	ILibHashtable_Destroy(root->decoded->table);
+	free(root->decoded);
+	root->decoded = NULL;
+	sem_post(&(root->readerLock));
+}
+
+__EXPORT_TYPE void ILibSimpleDataStore_ConfigDecodedCache(ILibSimpleDataStore dataStore, size_t maxBytes)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+
+	if (root == NULL) { return; }
+	ILibSimpleDataStore_ExclusiveLock(root);
+	if (maxBytes == 0)
+	{
+		ILibSimpleDataStore_DecodedCache_Release(root);
+	}
+	else
+	{
+		sem_wait(&(root->readerLock)); // Released values are freed under readerLock, without the shared lock
+		if (root->decoded == NULL)
+		{
+			if ((root->decoded = (ILibSimpleDataStore_DecodedCache*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_DecodedCache), 0, NULL, NULL)) == NULL) { ILIBCRITICALEXIT(254); }
+			root->decoded->table = ILibHashtable_Create();
+		}
+		root->decoded->maxBytes = maxBytes;
+		ILibSimpleDataStore_DecodedCache_Trim(root->decoded, maxBytes);
+		sem_post(&(root->readerLock));
+	}
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+}
+
+// Get a value, inflated if it was stored compressed. Values are found in the cache by their hash, so they are only read and decoded once, whatever key they are under
+char* ILibSimpleDataStore_GetDecodedEx_Locked(ILibSimpleDataStore_Root *root, char* key, size_t keyLen, size_t *valueLen)
+{
+	ILibSimpleDataStore_DecodedValue *decoded = NULL, *existing;
+	char hash[SHA384HASHSIZE], *check;
+	int len;
+
+	if (keyLen > 1 && key[keyLen - 1] == 0) { keyLen -= 1; }
+	if ((check = ILibSimpleDataStore_GetHashEx_Locked(root, key, keyLen)) == NULL) { return(NULL); }
+	memcpy_s(hash, sizeof(hash), check, SHA384HASHSIZE);
+
+	if (root->decoded != NULL)
+	{
+		sem_wait(&(root->readerLock));
+		if ((decoded = (ILibSimpleDataStore_DecodedValue*)ILibHashtable_Get(root->decoded->table, NULL, hash, SHA384HASHSIZE)) != NULL)
+		{
+			++decoded->refs;
+			ILibSimpleDataStore_DecodedCache_Unlink(root->decoded, decoded);
+			ILibSimpleDataStore_DecodedCache_LinkHead(root->decoded, decoded);
+		}
+		sem_post(&(root->readerLock));
+		if (decoded != NULL)
+		{
+			if (valueLen != NULL) { *valueLen = decoded->valueLen; }
+			return(ILibSimpleDataStore_DecodedValue_Value(decoded));
+		}
+	}
+
+	if ((len = ILibSimpleDataStore_GetEx_Locked(root, key, keyLen, NULL, 0)) <= 0) { return(NULL); }
+	if ((decoded = (ILibSimpleDataStore_DecodedValue*)malloc(sizeof(ILibSimpleDataStore_DecodedValue) + (size_t)len + 1)) == NULL) { ILIBCRITICALEXIT(254); }
+	if (ILibSimpleDataStore_GetEx_Locked(root, key, keyLen, ILibSimpleDataStore_DecodedValue_Value(decoded), (size_t)len + 1) != len) { free(decoded); return(NULL); }
+	ILibSimpleDataStore_DecodedValue_Value(decoded)[len] = 0;
+	memcpy_s(decoded->hash, sizeof(decoded->hash), hash, SHA384HASHSIZE);
+	decoded->valueLen = (size_t)len;
+	decoded->refs = 1;
+	decoded->cached = 0;
+	decoded->prev = decoded->next = NULL;
+
+	if (root->decoded != NULL && (size_t)len <= root->decoded->maxBytes)
+	{
+		sem_wait(&(root->readerLock));
+		if ((existing = (ILibSimpleDataStore_DecodedValue*)ILibHashtable_Get(root->decoded->table, NULL, hash, SHA384HASHSIZE)) != NULL)
+		{
+			// Another reader decoded the same value first
+			++existing->refs;
+			free(decoded);
+			decoded = existing;
+		}
+		else
+		{
+			ILibHashtable_Put(root->decoded->table, NULL, decoded->hash, SHA384HASHSIZE, decoded);
+			ILibSimpleDataStore_DecodedCache_LinkHead(root->decoded, decoded);
+			root->decoded->bytes += decoded->valueLen;
+			decoded->cached = 1;
+			ILibSimpleDataStore_DecodedCache_Trim(root->decoded, root->decoded->maxBytes);
+		}
+		sem_post(&(root->readerLock));
+	}
+	if (valueLen != NULL) { *valueLen = decoded->valueLen; }
+	return(ILibSimpleDataStore_DecodedValue_Value(decoded));
+}
+__EXPORT_TYPE char* ILibSimpleDataStore_GetDecodedEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, size_t *valueLen)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	char *retVal;
+
+	if (root == NULL || keyLen > INT32_MAX) { return(NULL); }
+	ILibSimpleDataStore_SharedLock(root);
+	retVal = ILibSimpleDataStore_GetDecodedEx_Locked(root, key, keyLen, valueLen);
+	ILibSimpleDataStore_SharedUnLock(root);
+	return(retVal);
+}
+__EXPORT_TYPE void ILibSimpleDataStore_ReleaseDecoded(ILibSimpleDataStore dataStore, char *value)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_DecodedValue *decoded;
+
+	if (root == NULL || value == NULL) { return; }
+	decoded = (ILibSimpleDataStore_DecodedValue*)(value - sizeof(ILibSimpleDataStore_DecodedValue));
+	sem_wait(&(root->readerLock));
+	if (--decoded->refs == 0 && decoded->cached == 0) { free(decoded); }
+	sem_post(&(root->readerLock));
+}
 // Delete a key and value from the data store
-__EXPORT_TYPE int ILibSimpleDataStore_DeleteEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
+int ILibSimpleDataStore_DeleteEx_Locked(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
 {
 	if (keyLen > INT32_MAX) { return(0); }
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
 	ILibSimpleDataStore_TableEntry *entry;
+	char *chunkedKey;
+	int deletedChunked = 0;
 	
 	if (root == NULL) return 0;
-	entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Remove(root->keyTable, NULL, key, (int)keyLen); // no dataloss, capped to INT32_MAX
+	if (root->batch != NULL)
+	{
+		// Stage the delete, the key table is only updated when the batch is committed
+		int retVal = ILibHashtable_Get(root->keyTable, NULL, key, (int)keyLen) != NULL ? 1 : 0; // no dataloss, capped to INT32_MAX
+		char *tmpkey = (char*)ILibMemory_SmartAllocate(keyLen + sizeof(uint32_t));
+		memcpy_s(tmpkey, ILibMemory_Size(tmpkey), key, keyLen);
+		((uint32_t*)(tmpkey + keyLen))[0] = crc32c(0, (unsigned char*)key, (uint32_t)keyLen); // no dataloss, capped to INT32_MAX
+		ILibSimpleDataStore_BatchRecord(root, key, (int)keyLen, NULL, 0, NULL);
+		if (ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey)) != NULL)
+		{
+			ILibSimpleDataStore_BatchRecord(root, tmpkey, (int)ILibMemory_Size(tmpkey), NULL, 0, NULL);
+			retVal = 1;
+		}
+		ILibMemory_Free(tmpkey);
+		tmpkey = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+		if (ILibHashtable_Get(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey)) != NULL)
+		{
+			ILibSimpleDataStore_BatchRecord(root, tmpkey, (int)ILibMemory_Size(tmpkey), NULL, 0, NULL);
+			retVal = 1;
+		}
+		ILibMemory_Free(tmpkey);
+		return(retVal);
+	}
+
+	// A chunked record is shadowed by plain and compressed records, so it is deleted along with them
+	chunkedKey = ILibSimpleDataStore_ChunkedKey(key, keyLen);
+	if ((entry = ILibSimpleDataStore_TableRemove(root, chunkedKey, (int)ILibMemory_Size(chunkedKey))) != NULL)
+	{
+		if (ILibSimpleDataStore_AppendRecord(root, chunkedKey, (int)ILibMemory_Size(chunkedKey), NULL, 0, NULL) == 0)
+		{
+			if (root->ErrorHandler != NULL) { root->ErrorHandler(root, root->ErrorHandlerUser); }
+		}
+		free(entry);
+		deletedChunked = 1;
+	}
+	ILibMemory_Free(chunkedKey);
+
+	entry = ILibSimpleDataStore_TableRemove(root, key, (int)keyLen); // no dataloss, capped to INT32_MAX
 	if (entry == NULL)
 	{
 		// Check to see if this is a compressed record, before we return an error
 		char *tmpkey = (char*)ILibMemory_SmartAllocate(keyLen + sizeof(uint32_t));
 		memcpy_s(tmpkey, ILibMemory_Size(tmpkey), key, keyLen);
 		((uint32_t*)(tmpkey + keyLen))[0] = crc32c(0, (unsigned char*)key, (uint32_t)keyLen); // no dataloss, capped to INT32_MAX
-		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Remove(root->keyTable, NULL, tmpkey, (int)ILibMemory_Size(tmpkey));
+		entry = ILibSimpleDataStore_TableRemove(root, tmpkey, (int)ILibMemory_Size(tmpkey));
 		if (entry != NULL)
 		{
-			if (ILibSimpleDataStore_WriteRecord(root->dataFile, tmpkey, (int)ILibMemory_Size(tmpkey), NULL, 0, NULL) == 0)
+			if (ILibSimpleDataStore_AppendRecord(root, tmpkey, (int)ILibMemory_Size(tmpkey), NULL, 0, NULL) == 0)
 			{
 				if (root->ErrorHandler != NULL) { root->ErrorHandler(root, root->ErrorHandlerUser); }
 			}
@@ -944,152 +2873,466 @@ __EXPORT_TYPE int ILibSimpleDataStore_DeleteEx(ILibSimpleDataStore dataStore, ch
 	}
 	else
 	{
-		if (ILibSimpleDataStore_WriteRecord(root->dataFile, key, (int)keyLen, NULL, 0, NULL) == 0) // no dataloss, capped to INT32_MAX
+		// A key that was only pending in the write-back tier was never written, so there is nothing to delete from the file
+		if (entry->valueOffset != 0 && ILibSimpleDataStore_AppendRecord(root, key, (int)keyLen, NULL, 0, NULL) == 0) // no dataloss, capped to INT32_MAX
 		{
 			if (root->ErrorHandler != NULL) { root->ErrorHandler(root, root->ErrorHandlerUser); }
 		}
 		free(entry); 
 		return 1;
 	}
-	return 0;
+	return(deletedChunked);
 }
+__EXPORT_TYPE int ILibSimpleDataStore_DeleteEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen)
+{
+	int retVal;
 
-// Lock the data store file
-__EXPORT_TYPE void ILibSimpleDataStore_Lock(ILibSimpleDataStore dataStore)
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_DeleteEx_Locked(dataStore, key, keyLen);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Start staging puts and deletes, so they can be written to the file together
+int ILibSimpleDataStore_BatchBegin_Locked(ILibSimpleDataStore dataStore)
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
-	if (root == NULL) return;
-	ILibHashtable_Lock(root->keyTable);
+
+	if (root == NULL || root->dataFile == NULL || root->readonly != 0 || root->batch != NULL) { return(1); }
+	root->batchSize = 4096;
+	root->batchLen = 0;
+	if ((root->batch = (char*)malloc(root->batchSize)) == NULL) { ILIBCRITICALEXIT(254); }
+	root->batchKeys = ILibHashtable_Create();
+	return(0);
 }
+__EXPORT_TYPE int ILibSimpleDataStore_BatchBegin(ILibSimpleDataStore dataStore)
+{
+	int retVal;
 
-// Unlock the data store file
-__EXPORT_TYPE void ILibSimpleDataStore_UnLock(ILibSimpleDataStore dataStore)
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_BatchBegin_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Discard everything staged since ILibSimpleDataStore_BatchBegin()
+void ILibSimpleDataStore_BatchAbort_Locked(ILibSimpleDataStore dataStore)
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
-	if (root == NULL) return;
-	ILibHashtable_UnLock(root->keyTable);
-}
 
-// Called by the compaction method, for each key in the enumeration we write the key/value to the temporary data store
-void ILibSimpleDataStore_Compact_EnumerateSink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+	if (root == NULL || root->batch == NULL) { return; }
+	free(root->batch);
+	root->batch = NULL;
+	root->batchLen = root->batchSize = 0;
+	ILibHashtable_Destroy(root->batchKeys);
+	root->batchKeys = NULL;
+}
+__EXPORT_TYPE void ILibSimpleDataStore_BatchAbort(ILibSimpleDataStore dataStore)
 {
-	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
-	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)((void**)user)[0];
-	FILE *compacted = (FILE*)((void**)user)[1];
-	uint64_t offset;
-	char value[4096];
-	int valueLen;
-	int bytesLeft = entry->valueLength;
-	int totalBytesWritten = 0;
-	int bytesWritten = 0;
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	ILibSimpleDataStore_BatchAbort_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+}
 
-	if (root == NULL) return;
-	if (root->error != 0) return; // There was an error, ABORT!
+// Write the staged records with a single write and flush, then apply them to the key table
+int ILibSimpleDataStore_BatchCommitEx_Locked(ILibSimpleDataStore dataStore, int durable)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_RecordHeader_NG *node;
+	ILibSimpleDataStore_TableEntry *entry;
+	uint64_t base;
+	size_t ptr;
+	char *batch;
+	int keyLen, valueLength;
+
+	if (root == NULL || root->batch == NULL) { return(1); }
+	batch = root->batch;
+	root->batch = NULL;		// Any puts from here on, including the error path below, go straight to the file/cache
+	ILibHashtable_Destroy(root->batchKeys);
+	root->batchKeys = NULL;
+	if (root->batchLen == 0) { free(batch); return(0); }
 
-	if (Key2Len > 1)
+#ifdef WIN32
+	ILibSimpleDataStore_Unmap(root); // A mapped view prevents SetEndOfFile(), which is used to undo a partial write
+#endif
+	fseek(root->dataFile, 0, SEEK_END);
+	base = ILibSimpleDataStore_GetPosition(root->dataFile);
+	if (fwrite(batch, 1, root->batchLen, root->dataFile) != root->batchLen || fflush(root->dataFile) != 0)
 	{
-		if (Key2[Key2Len - 1] == 0)
+		//
+		// Write Error, undo the partial write, switch to readonly mode,
+		// and put the staged values into the cache, like ILibSimpleDataStore_PutEx2() does
+		//
+		ILibSimpleDataStore_Truncate(root->dataFile, base);
+		for (ptr = 0; ptr < root->batchLen; ptr += sizeof(ILibSimpleDataStore_RecordHeader_NG) + keyLen + valueLength)
 		{
-			Key2Len -= 1;
+			node = (ILibSimpleDataStore_RecordHeader_NG*)(batch + ptr);
+			keyLen = (int)ntohl(node->keyLen);
+			valueLength = (int)ntohl(node->valueLength);
+			if (valueLength == 0) { continue; }
+			if (keyLen > (int)sizeof(uint32_t) && crc32c(0, (unsigned char*)node->key, keyLen - sizeof(uint32_t)) == ((uint32_t*)(node->key + keyLen - sizeof(uint32_t)))[0])
+			{
+				ILibSimpleDataStore_CachedEx(root, node->key, keyLen - sizeof(uint32_t), node->key + keyLen, valueLength, node->hash);
+			}
+			else
+			{
+				ILibSimpleDataStore_CachedEx(root, node->key, keyLen, node->key + keyLen, valueLength, NULL);
+			}
 		}
+		free(batch);
+		root->batchLen = root->batchSize = 0;
+		ILibSimpleDataStore_ReOpenReadOnly(root, NULL);
+		if (root->ErrorHandler != NULL) { root->ErrorHandler(root, root->ErrorHandlerUser); }
+		return(1);
 	}
-	offset = ILibSimpleDataStore_WriteRecord(compacted, Key2, Key2Len, NULL, entry->valueLength, entry->valueHash);
-	if (offset == 0) { root->error = 1; return; }
-	while (bytesLeft > 0)
+	if (durable != 0)
+	{
+#ifdef WIN32
+		FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(root->dataFile)));
+#elif defined(__APPLE__)
+		fsync(fileno(root->dataFile));
+#else
+		fdatasync(fileno(root->dataFile));
+#endif
+	}
+
+	// The write succeeded, so now apply the records to the key table, the same way they are replayed when the file is opened
+	for (ptr = 0; ptr < root->batchLen; ptr += sizeof(ILibSimpleDataStore_RecordHeader_NG) + keyLen + valueLength)
 	{
-		if (ILibSimpleDataStore_SeekPosition(root->dataFile, entry->valueOffset + totalBytesWritten, SEEK_SET) == 0)
+		node = (ILibSimpleDataStore_RecordHeader_NG*)(batch + ptr);
+		keyLen = (int)ntohl(node->keyLen);
+		valueLength = (int)ntohl(node->valueLength);
+		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, node->key, keyLen);
+		if (valueLength > 0)
 		{
-			valueLen = (int)fread(value, 1, bytesLeft > 4096 ? 4096 : bytesLeft, root->dataFile);
-			bytesWritten = (int)fwrite(value, 1, valueLen, compacted);
-			if (bytesWritten != valueLen)
+			if (entry == NULL)
 			{
-				// Error
-				root->error = 1;
-				break;
+				entry = (ILibSimpleDataStore_TableEntry*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_TableEntry), 0, NULL, NULL);
+			}
+			else
+			{
+				root->dirtySize += entry->valueLength;
+				ILibSimpleDataStore_WriteBack_Drop(root, node->key, keyLen, entry); // The committed value replaces any pending value
 			}
-			totalBytesWritten += bytesWritten;
-			bytesLeft -= valueLen;
+			memcpy_s(entry->valueHash, sizeof(entry->valueHash), node->hash, SHA384HASHSIZE);
+			entry->valueLength = valueLength;
+			entry->valueOffset = base + ptr + sizeof(ILibSimpleDataStore_RecordHeader_NG) + keyLen;
+			entry->verified = 1;
+			ILibSimpleDataStore_TablePut(root, node->key, keyLen, entry);
 		}
-		else
+		else if (entry != NULL)
 		{
-			// Error
-			root->error = 1;
-			break;
+			root->dirtySize += entry->valueLength;
+			ILibSimpleDataStore_TableRemove(root, node->key, keyLen);
+			free(entry);
 		}
 	}
-	
-	if (root->error == 0) { entry->valueOffset = offset; }
+	free(batch);
+	root->batchLen = root->batchSize = 0;
+	root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
+	if (root->warningSize > 0 && root->fileSize > root->warningSize && root->warningSink != NULL)
+	{
+		root->warningSink(root, root->fileSize, root->warningSinkUser);
+	}
+	return(0);
 }
+__EXPORT_TYPE int ILibSimpleDataStore_BatchCommitEx(ILibSimpleDataStore dataStore, int durable)
+{
+	int retVal;
 
-// Used to help with key enumeration
-void ILibSimpleDataStore_EnumerateKeysSink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_BatchCommitEx_Locked(dataStore, durable);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Lock the data store, for a sequence of calls that must not be interleaved with other threads. Can be taken again by the thread that holds it
+__EXPORT_TYPE void ILibSimpleDataStore_Lock(ILibSimpleDataStore dataStore)
 {
-	ILibSimpleDataStore_KeyEnumerationHandler handler = (ILibSimpleDataStore_KeyEnumerationHandler)((void**)user)[0];
-	ILibSimpleDataStore_KeyEnumerationHandler dataStore = (ILibSimpleDataStore)((void**)user)[1];
-	ILibSimpleDataStore_KeyEnumerationHandler userX = ((void**)user)[2];
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+}
 
-	UNREFERENCED_PARAMETER(sender);
-	UNREFERENCED_PARAMETER(Key1);
-	UNREFERENCED_PARAMETER(Key2);
-	UNREFERENCED_PARAMETER(Key2Len);
+// Unlock the data store
+__EXPORT_TYPE void ILibSimpleDataStore_UnLock(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+}
 
-	if (Key2Len > sizeof(uint32_t))
+// Monotonic time in microseconds, used to measure how long compaction blocks the caller
+uint64_t ILibSimpleDataStore_Microseconds()
+{
+#ifdef WIN32
+	LARGE_INTEGER f, c;
+	QueryPerformanceFrequency(&f);
+	QueryPerformanceCounter(&c);
+	return((uint64_t)(c.QuadPart / f.QuadPart) * 1000000 + (uint64_t)(c.QuadPart % f.QuadPart) * 1000000 / (uint64_t)f.QuadPart);
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return((uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec);
+#endif
+}
+
+// Append a range of the data file to another file, returns 0 on success
+int ILibSimpleDataStore_CopyRange(ILibSimpleDataStore_Root *root, FILE *dest, uint64_t offset, uint64_t length)
+{
+	char *view;
+	size_t len;
+
+	if (length <= INT32_MAX && (view = ILibSimpleDataStore_MapValue(root, offset, (int)length)) != NULL)
+	{
+		return(fwrite(view, 1, (size_t)length, dest) == (size_t)length ? 0 : 1);
+	}
+	while (length > 0)
 	{
-		// Check if this is a compressed entry
-		if (crc32c(0, (unsigned char*)Key2, Key2Len - sizeof(uint32_t)) == ((uint32_t*)(Key2 + Key2Len - sizeof(uint32_t)))[0])
+		// Can't map the file, so copy it in pieces
+		len = length > sizeof(root->scratchPad) ? sizeof(root->scratchPad) : (size_t)length;
+		if (ILibSimpleDataStore_ReadFile(root, offset, root->scratchPad, len) != 0 || fwrite(root->scratchPad, 1, len, dest) != len) { return(1); }
+		offset += len;
+		length -= len;
+	}
+	return(0);
+}
+
+// Append the record of a live entry to another file, returns the offset of the value in that file, or 0 on error. The caller flushes the file when done
+uint64_t ILibSimpleDataStore_CopyRecord(ILibSimpleDataStore_Root *root, FILE *dest, char *key, int keyLen, ILibSimpleDataStore_TableEntry *entry)
+{
+	ILibSimpleDataStore_RecordHeader_NG header;
+	uint64_t offset;
+	char *value;
+
+	// Rewrite the check value in the configured format, unless the value fails its check. Compressed records keep the hash of the uncompressed value
+	if (ILibSimpleDataStore_ChecksumFormat(entry->valueHash) != root->recordFormat && ILibSimpleDataStore_IsCompressedKey(key, keyLen) == 0 &&
+		(value = ILibSimpleDataStore_MapValue(root, entry->valueOffset, entry->valueLength)) != NULL && ILibSimpleDataStore_VerifyValue(value, entry->valueLength, entry->valueHash) == 0)
+	{
+		ILibSimpleDataStore_Checksum(root->recordFormat, value, entry->valueLength, entry->valueHash);
+		entry->verified = 1;
+	}
+
+	header.nodeSize = htonl((int)sizeof(ILibSimpleDataStore_RecordHeader_NG) + keyLen + entry->valueLength);
+	header.keyLen = htonl(keyLen);
+	header.valueLength = htonl(entry->valueLength);
+	memcpy_s(header.hash, sizeof(header.hash), entry->valueHash, SHA384HASHSIZE);
+	if (fwrite(&header, 1, sizeof(header), dest) != sizeof(header) || fwrite(key, 1, keyLen, dest) != (size_t)keyLen) { return(0); }
+	offset = ILibSimpleDataStore_GetPosition(dest);
+	if (ILibSimpleDataStore_CopyRange(root, dest, entry->valueOffset, (uint64_t)entry->valueLength) != 0) { return(0); }
+	return(offset);
+}
+
+// Called by the compaction method, for each key in the enumeration we write the key/value to the temporary data store
+void ILibSimpleDataStore_Compact_EnumerateSink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)((void**)user)[0];
+	FILE *compacted = (FILE*)((void**)user)[1];
+	uint64_t offset;
+
+	if (root == NULL) return;
+	if (root->error != 0) return; // There was an error, ABORT!
+
+	if (Key2Len > 1)
+	{
+		if (Key2[Key2Len - 1] == 0)
 		{
-			Key2Len -= sizeof(uint32_t);
+			Key2Len -= 1;
 		}
 	}
-
-	handler(dataStore, Key2, Key2Len, userX); // Call the user
+	if ((offset = ILibSimpleDataStore_CopyRecord(root, compacted, Key2, Key2Len, entry)) == 0) { root->error = 1; return; }
+	entry->valueOffset = offset;
+	entry->verified = 0;
 }
 
-// Enumerate each key in the data store, call the handler for each key
+// Enumerate each key in the data store in sorted order, call the handler for each key
 __EXPORT_TYPE void ILibSimpleDataStore_EnumerateKeys(ILibSimpleDataStore dataStore, ILibSimpleDataStore_KeyEnumerationHandler handler, void * user)
 {
-	void* users[3];
-	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
-	if (root == NULL) return;
+	ILibSimpleDataStore_EnumerateRange(dataStore, NULL, 0, NULL, 0, handler, user);
+}
 
-	users[0] = (void*)handler;
-	users[1] = (void*)dataStore;
-	users[2] = (void*)user;
+// Enumerate the keys from the first key >= start, up to but not including the first key >= end. A NULL start or end leaves that side open
+__EXPORT_TYPE void ILibSimpleDataStore_EnumerateRange(ILibSimpleDataStore dataStore, char* start, size_t startLen, char* end, size_t endLen, ILibSimpleDataStore_KeyEnumerationHandler handler, void *user)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_KeyIndexNode *node;
+	char *copy = NULL;
+	size_t copySize = 0;
+
+	if (root == NULL || handler == NULL) { return; }
+	ILibSimpleDataStore_ExclusiveLock(root); // Held across the handlers, so they can change the store
+	if (root->keyIndexValid == 0) { ILibSimpleDataStore_KeyIndex_Build(root); }
+	node = start != NULL ? ILibSimpleDataStore_KeyIndex_Seek(root, start, startLen, NULL) : root->keyIndex[0];
+	while (node != NULL && (end == NULL || ILibSimpleDataStore_KeyIndex_Compare(node, end, endLen) < 0))
+	{
+		node = ILibSimpleDataStore_KeyIndex_Visit(root, node, &copy, &copySize, handler, user);
+	}
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+	free(copy);
+}
 
-	if (handler != NULL) { ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_EnumerateKeysSink, users); }
+// Enumerate the keys that start with prefix, in sorted order
+__EXPORT_TYPE void ILibSimpleDataStore_EnumeratePrefix(ILibSimpleDataStore dataStore, char* prefix, size_t prefixLen, ILibSimpleDataStore_KeyEnumerationHandler handler, void *user)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_KeyIndexNode *node;
+	char *copy = NULL;
+	size_t copySize = 0;
+
+	if (root == NULL || handler == NULL) { return; }
+	ILibSimpleDataStore_ExclusiveLock(root);
+	if (root->keyIndexValid == 0) { ILibSimpleDataStore_KeyIndex_Build(root); }
+	node = ILibSimpleDataStore_KeyIndex_Seek(root, prefix, prefixLen, NULL);
+	while (node != NULL && (size_t)node->keyLen >= prefixLen && memcmp(ILibSimpleDataStore_KeyIndexNode_Key(node), prefix, prefixLen) == 0)
+	{
+		node = ILibSimpleDataStore_KeyIndex_Visit(root, node, &copy, &copySize, handler, user);
+	}
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+	free(copy);
 }
+
 void ILibSimpleDataStore_ConfigWriteErrorHandler(ILibSimpleDataStore dataStore, ILibSimpleDataStore_WriteErrorHandler handler, void *user)
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_ExclusiveLock(root);
 	root->ErrorHandler = handler;
 	root->ErrorHandlerUser = user;
+	ILibSimpleDataStore_ExclusiveUnLock(root);
 }
 __EXPORT_TYPE void ILibSimpleDataStore_ConfigSizeLimit(ILibSimpleDataStore dataStore, uint64_t sizeLimit, ILibSimpleDataStore_SizeWarningHandler handler, void *user)
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_ExclusiveLock(root);
 	root->warningSize = sizeLimit;
 	root->warningSink = sizeLimit > 0 ? handler : NULL;
 	root->warningSinkUser = sizeLimit > 0 ? user : NULL;
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+}
+__EXPORT_TYPE void ILibSimpleDataStore_ConfigRecordFormat(ILibSimpleDataStore dataStore, ILibSimpleDataStore_RecordFormats format)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_ExclusiveLock(root);
+	root->recordFormat = format;
+	ILibSimpleDataStore_ExclusiveUnLock(root);
 }
 __EXPORT_TYPE void ILibSimpleDataStore_ConfigCompact(ILibSimpleDataStore dataStore, uint64_t minimumDirtySize)
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_ExclusiveLock(root);
 	root->minimumDirtySize = minimumDirtySize;
+	ILibSimpleDataStore_ExclusiveUnLock(root);
 }
-// Compact the data store
-__EXPORT_TYPE int ILibSimpleDataStore_Compact(ILibSimpleDataStore dataStore)
+
+// Enable, reconfigure or disable (flushInterval and flushThreshold both 0) the write-back tier. Returns 0 on success
+int ILibSimpleDataStore_ConfigWriteBack_Locked(ILibSimpleDataStore dataStore, void *chain, int flushInterval, size_t flushThreshold)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_WriteBack *wb;
+
+	if (root == NULL || root->dataFile == NULL || root->readonly != 0 || (flushInterval > 0 && chain == NULL)) { return(1); }
+	if (flushInterval <= 0 && flushThreshold == 0)
+	{
+		// Write what the tier holds before removing it
+		if (ILibSimpleDataStore_Flush(root) != 0) { return(1); }
+		ILibSimpleDataStore_WriteBack_Release(root);
+		return(0);
+	}
+
+	if ((wb = root->writeBack) == NULL)
+	{
+		wb = (ILibSimpleDataStore_WriteBack*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_WriteBack), 0, NULL, NULL);
+		wb->root = root;
+		wb->dirty = ILibHashtable_Create();
+		root->writeBack = wb;
+	}
+	else if (wb->timerSet != 0)
+	{
+		ILibLifeTime_Remove(ILibGetBaseTimer(wb->chain), wb);
+		wb->timerSet = 0;
+	}
+	wb->chain = chain;
+	wb->flushInterval = flushInterval > 0 ? flushInterval : 0;
+	wb->flushThreshold = flushThreshold;
+	if (wb->dirtyBytes > 0 && wb->flushInterval > 0)
+	{
+		wb->timerSet = 1;
+		ILibLifeTime_AddEx(ILibGetBaseTimer(wb->chain), wb, wb->flushInterval, ILibSimpleDataStore_WriteBack_Sink, NULL);
+	}
+	return(0);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_ConfigWriteBack(ILibSimpleDataStore dataStore, void *chain, int flushInterval, size_t flushThreshold)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_ConfigWriteBack_Locked(dataStore, chain, flushInterval, flushThreshold);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+// Replace the data file with its compacted copy, and re-open it. Returns 0 on success, if the copy couldn't be moved in place the old file is re-read
+int ILibSimpleDataStore_SwapFile(ILibSimpleDataStore_Root *root, FILE *compacted, char *tmp)
+{
+	int retVal = 0;
+
+	ILibSimpleDataStore_Unmap(root);
+#ifdef _POSIX
+	flock(fileno(root->dataFile), LOCK_UN);
+#endif
+	fclose(root->dataFile); // Close the data store
+	fclose(compacted); // Close the temporary data store
+	ILibSimpleDataStore_DeleteIndexSnapshot(root); // The offsets in the old snapshot are about to become invalid
+
+	// Now we copy the temporary data store over the data store, making it the new valid version
+#ifdef WIN32
+	WCHAR tmptmp[4096];
+	MultiByteToWideChar(CP_UTF8, 0, (LPCCH)tmp, -1, (LPWSTR)tmptmp, (int)sizeof(tmptmp) / 2);
+	if (CopyFileW(tmptmp, ILibUTF8ToWide(root->filePath, -1), FALSE) == FALSE) { retVal = 1; }
+	DeleteFileW(tmptmp);
+#else
+	if (rename(tmp, root->filePath) != 0) { retVal = 1; ILibSimpleDataStore_DeleteFile(tmp); }
+#endif
+
+	// We then open the newly compacted data store
+	if ((root->dataFile = ILibSimpleDataStore_OpenFile(root->filePath)) == NULL) { return(1); }
+	if (retVal != 0)
+	{
+		// The key table already points into the compacted copy, so it has to be rebuilt from the file that is still in place
+		ILibSimpleDataStore_RebuildKeyTable(root);
+		return(1);
+	}
+	fseek(root->dataFile, 0, SEEK_END);
+	root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile);
+	return(0);
+}
+
+// Record the outcome of a compaction step
+void ILibSimpleDataStore_CompactionStats_AddStep(ILibSimpleDataStore_Root *root, uint64_t start)
+{
+	uint64_t stall = ILibSimpleDataStore_Microseconds() - start;
+
+	root->compactionStats.steps += 1;
+	root->compactionStats.totalStallMicroseconds += stall;
+	if (stall > root->compactionStats.longestStallMicroseconds) { root->compactionStats.longestStallMicroseconds = stall; }
+}
+
+// Compacts the data store in one go, blocking the caller until it's done
+int ILibSimpleDataStore_Compact_Locked(ILibSimpleDataStore dataStore)
 {
 	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
 	char* tmp;
 	FILE* compacted;
 	void* state[2];
-	int retVal = 0;
+	int retVal = 1;
+	uint64_t start = ILibSimpleDataStore_Microseconds();
+	uint64_t oldSize;
 
+	if (ILibSimpleDataStore_Flush(root) != 0) { return(1); } // Pending values are written first, so they are compacted with the rest
 	if (root == NULL || root->dirtySize < root->minimumDirtySize || root->filePath == NULL) return 1; // Error
+	ILibSimpleDataStore_CompactAbort(root);
 	tmp = ILibString_Cat(root->filePath, -1, ".tmp", -1); // Create the name of the temporary data store
 
 	// Start by opening a temporary .tmp file. Will be used to write the compacted data store.
 	if ((compacted = ILibSimpleDataStore_OpenFileEx(tmp, 1)) == NULL) { free(tmp); return 1; }
+	memset(&(root->compactionStats), 0, sizeof(root->compactionStats));
+	fseek(root->dataFile, 0, SEEK_END);
+	oldSize = ILibSimpleDataStore_GetPosition(root->dataFile);
 
 	// Enumerate all keys and write them all into the temporary data store
 	state[0] = root;
@@ -1098,32 +3341,288 @@ __EXPORT_TYPE int ILibSimpleDataStore_Compact(ILibSimpleDataStore dataStore)
 	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_Compact_EnumerateSink, state);
 
 	// Check if the enumeration went as planned
-	if (root->error == 0)
+	if (root->error == 0 && fflush(compacted) == 0)
 	{
 		// Success in writing new temporary file
-#ifdef _POSIX
-		flock(fileno(root->dataFile), LOCK_UN);
-#endif
-		fclose(root->dataFile); // Close the data store
-		fclose(compacted); // Close the temporary data store
-
-		// Now we copy the temporary data store over the data store, making it the new valid version
-#ifdef WIN32
-		WCHAR tmptmp[4096];
-		MultiByteToWideChar(CP_UTF8, 0, (LPCCH)tmp, -1, (LPWSTR)tmptmp, (int)sizeof(tmptmp) / 2);
-		if (CopyFileW(tmptmp, ILibUTF8ToWide(root->filePath, -1), FALSE) == FALSE) { retVal = 1; }
-		DeleteFileW(tmptmp);
-#else
-		if (rename(tmp, root->filePath) != 0) { retVal = 1; }
-#endif
-
-		// We then open the newly compacted data store
-		if ((root->dataFile = ILibSimpleDataStore_OpenFile(root->filePath)) != NULL) { root->fileSize = ILibSimpleDataStore_GetPosition(root->dataFile); } else { retVal = 1; }
+		if ((retVal = ILibSimpleDataStore_SwapFile(root, compacted, tmp)) == 0)
+		{
+			root->dirtySize = 0;
+			root->compactionStats.bytesReclaimed = oldSize > root->fileSize ? oldSize - root->fileSize : 0;
+			ILibSimpleDataStore_WriteIndexSnapshot(root);
+		}
 	}
+	else
+	{
+		// The key table may already point into the temporary file
+		fclose(compacted);
+		ILibSimpleDataStore_DeleteFile(tmp);
+		ILibSimpleDataStore_RebuildKeyTable(root);
+	}
+	ILibSimpleDataStore_CompactionStats_AddStep(root, start);
 
 	free(tmp); // Free the temporary file name
 	return retVal; // Return 1 if we got an error, 0 if everything finished correctly
 }
+__EXPORT_TYPE int ILibSimpleDataStore_Compact(ILibSimpleDataStore dataStore)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_Compact_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Collect the keys that are live when an incremental compaction starts. First pass sizes the list, second pass fills it in
+void ILibSimpleDataStore_CompactBegin_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)user;
+	ILibSimpleDataStore_CompactionState *state = root->compaction;
+	ILibSimpleDataStore_CompactionKey *k;
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+
+	if (state->keys != NULL)
+	{
+		k = (ILibSimpleDataStore_CompactionKey*)(state->keys + state->keysLen);
+		k->oldOffset = entry->valueOffset;
+		k->newOffset = 0;
+		k->keyLen = Key2Len;
+		memcpy_s(k->key, Key2Len, Key2, Key2Len);
+		root->compactionStats.bytesToCopy += sizeof(ILibSimpleDataStore_RecordHeader_NG) + Key2Len + entry->valueLength;
+	}
+	state->keysLen += sizeof(ILibSimpleDataStore_CompactionKey) + Key2Len;
+}
+
+// Start an incremental compaction. Returns 0 on success
+int ILibSimpleDataStore_CompactBegin_Locked(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_CompactionState *state;
+
+	if (root == NULL || root->compaction != NULL || ILibSimpleDataStore_Flush(root) != 0) { return(1); } // Every key has to be in the file when the keys are listed
+	if (root->filePath == NULL || root->dataFile == NULL || root->readonly != 0 || root->dirtySize < root->minimumDirtySize) { return(1); }
+	state = (ILibSimpleDataStore_CompactionState*)ILibMemory_Allocate(sizeof(ILibSimpleDataStore_CompactionState), 0, NULL, NULL);
+	state->tmpPath = ILibString_Cat(root->filePath, -1, ".tmp", -1);
+	if ((state->compacted = ILibSimpleDataStore_OpenFileEx(state->tmpPath, 1)) == NULL) { free(state->tmpPath); free(state); return(1); }
+
+	memset(&(root->compactionStats), 0, sizeof(root->compactionStats));
+	root->compaction = state;
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_CompactBegin_Sink, root);
+	if ((state->keys = (char*)malloc(state->keysLen + 1)) == NULL) { ILIBCRITICALEXIT(254); }
+	state->keysLen = 0;
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_CompactBegin_Sink, root);
+
+	fseek(root->dataFile, 0, SEEK_END);
+	state->endOffset = ILibSimpleDataStore_GetPosition(root->dataFile);
+	state->dirtySize = root->dirtySize;
+	root->compactionStats.inProgress = 1;
+	return(0);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_CompactBegin(ILibSimpleDataStore dataStore)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_CompactBegin_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+// Abandon the incremental compaction, also used to clean up after one finishes
+void ILibSimpleDataStore_CompactAbort_Locked(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_CompactionState *state;
+
+	if (root == NULL || (state = root->compaction) == NULL) { return; }
+	root->compaction = NULL;
+	root->compactionStats.inProgress = 0;
+	if (state->chain != NULL) { ILibLifeTime_Remove(ILibGetBaseTimer(state->chain), root); }
+	if (state->compacted != NULL)
+	{
+		fclose(state->compacted);
+		ILibSimpleDataStore_DeleteFile(state->tmpPath);
+	}
+	free(state->tmpPath);
+	free(state->keys);
+	free(state);
+}
+__EXPORT_TYPE void ILibSimpleDataStore_CompactAbort(ILibSimpleDataStore dataStore)
+{
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	ILibSimpleDataStore_CompactAbort_Locked(dataStore);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+}
+
+// Move entries written during the compaction to where the tail lands in the compacted file
+void ILibSimpleDataStore_CompactFinish_Sink(ILibHashtable sender, void *Key1, char* Key2, int Key2Len, void *Data, void *user)
+{
+	ILibSimpleDataStore_TableEntry *entry = (ILibSimpleDataStore_TableEntry*)Data;
+	uint64_t endOffset = ((uint64_t*)user)[0];
+	uint64_t tailOffset = ((uint64_t*)user)[1];
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(Key1);
+	UNREFERENCED_PARAMETER(Key2);
+	UNREFERENCED_PARAMETER(Key2Len);
+
+	if (entry->valueOffset >= endOffset) { entry->valueOffset = entry->valueOffset - endOffset + tailOffset; }
+}
+
+// Append the records written during the compaction, point the key table at the compacted file and swap it in. Returns 0 on success
+int ILibSimpleDataStore_CompactFinish(ILibSimpleDataStore_Root *root)
+{
+	ILibSimpleDataStore_CompactionState *state;
+	ILibSimpleDataStore_CompactionKey *k;
+	ILibSimpleDataStore_TableEntry *entry;
+	uint64_t offsets[2];
+	uint64_t oldSize;
+	size_t i;
+
+	// Values that became pending during the compaction are written now, so they are carried over with the tail. A failed write abandons the compaction
+	if (root->batch == NULL && ILibSimpleDataStore_Flush(root) != 0) { return(1); }
+	state = root->compaction;
+
+	fseek(root->dataFile, 0, SEEK_END);
+	oldSize = ILibSimpleDataStore_GetPosition(root->dataFile);
+	fseek(state->compacted, 0, SEEK_END);
+	offsets[0] = state->endOffset;
+	offsets[1] = ILibSimpleDataStore_GetPosition(state->compacted);
+	if (ILibSimpleDataStore_CopyRange(root, state->compacted, state->endOffset, oldSize - state->endOffset) != 0 || fflush(state->compacted) != 0) { return(1); }
+
+	// Copied values all land before endOffset, so they are moved first and won't be shifted again with the tail
+	for (i = 0; i < state->keysLen; i += sizeof(ILibSimpleDataStore_CompactionKey) + k->keyLen)
+	{
+		k = (ILibSimpleDataStore_CompactionKey*)(state->keys + i);
+		if (k->newOffset != 0 && (entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, k->key, k->keyLen)) != NULL && entry->valueOffset == k->oldOffset)
+		{
+			entry->valueOffset = k->newOffset;
+			entry->verified = 0;
+		}
+	}
+	ILibHashtable_Enumerate(root->keyTable, ILibSimpleDataStore_CompactFinish_Sink, offsets);
+
+	i = (size_t)ILibSimpleDataStore_SwapFile(root, state->compacted, state->tmpPath);
+	state->compacted = NULL;
+	if (i != 0) { return(1); }
+
+	root->dirtySize = root->dirtySize > state->dirtySize ? root->dirtySize - state->dirtySize : 0;
+	root->compactionStats.bytesReclaimed = oldSize > root->fileSize ? oldSize - root->fileSize : 0;
+	ILibSimpleDataStore_WriteIndexSnapshot(root);
+	return(0);
+}
+
+// Copy about maxBytes of live records into the compacted file, and swap it in once all of them are copied
+int ILibSimpleDataStore_CompactStep_Locked(ILibSimpleDataStore dataStore, size_t maxBytes)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	ILibSimpleDataStore_CompactionState *state;
+	ILibSimpleDataStore_CompactionKey *k;
+	ILibSimpleDataStore_TableEntry *entry;
+	uint64_t start, offset;
+	size_t copied = 0;
+	int retVal = 1;
+
+	if (root == NULL || (state = root->compaction) == NULL) { return(-1); }
+	start = ILibSimpleDataStore_Microseconds();
+
+	while (state->cursor < state->keysLen && copied < maxBytes)
+	{
+		k = (ILibSimpleDataStore_CompactionKey*)(state->keys + state->cursor);
+		state->cursor += sizeof(ILibSimpleDataStore_CompactionKey) + k->keyLen;
+
+		// Deleted or overwritten since the compaction started, in which case the new record is past endOffset
+		entry = (ILibSimpleDataStore_TableEntry*)ILibHashtable_Get(root->keyTable, NULL, k->key, k->keyLen);
+		if (entry == NULL || entry->valueOffset != k->oldOffset) { continue; }
+
+		if ((offset = ILibSimpleDataStore_CopyRecord(root, state->compacted, k->key, k->keyLen, entry)) == 0) { retVal = -1; break; }
+		k->newOffset = offset;
+		copied += sizeof(ILibSimpleDataStore_RecordHeader_NG) + k->keyLen + entry->valueLength;
+	}
+	root->compactionStats.bytesCopied += copied;
+
+	if (retVal == 1 && state->cursor >= state->keysLen) { retVal = ILibSimpleDataStore_CompactFinish(root) == 0 ? 0 : -1; }
+	if (retVal != 1) { ILibSimpleDataStore_CompactAbort(root); }
+	ILibSimpleDataStore_CompactionStats_AddStep(root, start);
+	return(retVal);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_CompactStep(ILibSimpleDataStore dataStore, size_t maxBytes)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_CompactStep_Locked(dataStore, maxBytes);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
+
+__EXPORT_TYPE void ILibSimpleDataStore_GetCompactionStats(ILibSimpleDataStore dataStore, ILibSimpleDataStore_CompactionStats *stats)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+	if (root == NULL) { memset(stats, 0, sizeof(ILibSimpleDataStore_CompactionStats)); return; }
+	ILibSimpleDataStore_SharedLock(root);
+	memcpy_s(stats, sizeof(ILibSimpleDataStore_CompactionStats), &(root->compactionStats), sizeof(ILibSimpleDataStore_CompactionStats));
+	ILibSimpleDataStore_SharedUnLock(root);
+}
+
+// The timer was removed, or the chain is shutting down, so the chain can no longer drive the compaction
+void ILibSimpleDataStore_CompactInBackground_Destroy(void *obj)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)obj;
+	ILibSimpleDataStore_ExclusiveLock(root);
+	if (root->compaction != NULL) { root->compaction->chain = NULL; }
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+}
+
+void ILibSimpleDataStore_CompactInBackground_Sink(void *obj)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)obj;
+	ILibSimpleDataStore_CompactionState *state;
+	ILibSimpleDataStore_CompactionHandler handler;
+	ILibSimpleDataStore_CompactionStats stats;
+	void *user;
+	int status;
+
+	ILibSimpleDataStore_ExclusiveLock(root);
+	if ((state = root->compaction) == NULL) { ILibSimpleDataStore_ExclusiveUnLock(root); return; }
+	handler = state->handler;
+	user = state->user;
+	if ((status = ILibSimpleDataStore_CompactStep_Locked(root, state->sliceSize)) == 1)
+	{
+		// Yield to the chain, and do the next slice on the next iteration
+		ILibLifeTime_AddEx(ILibGetBaseTimer(state->chain), root, 0, ILibSimpleDataStore_CompactInBackground_Sink, ILibSimpleDataStore_CompactInBackground_Destroy);
+	}
+	memcpy_s(&stats, sizeof(stats), &(root->compactionStats), sizeof(stats));
+	ILibSimpleDataStore_ExclusiveUnLock(root);
+
+	if (status != 1 && handler != NULL) { handler(root, status == 0 ? 0 : 1, &stats, user); }
+}
+
+// Compact the data store a slice at a time from the chain thread. Returns 0 if the compaction was started
+int ILibSimpleDataStore_CompactInBackground_Locked(ILibSimpleDataStore dataStore, void *chain, size_t sliceSize, ILibSimpleDataStore_CompactionHandler handler, void *user)
+{
+	ILibSimpleDataStore_Root *root = (ILibSimpleDataStore_Root*)dataStore;
+
+	if (chain == NULL || ILibSimpleDataStore_CompactBegin(root) != 0) { return(1); }
+	root->compaction->chain = chain;
+	root->compaction->sliceSize = sliceSize != 0 ? sliceSize : ILibSimpleDataStore_CompactionSliceSize;
+	root->compaction->handler = handler;
+	root->compaction->user = user;
+	ILibLifeTime_AddEx(ILibGetBaseTimer(chain), root, 0, ILibSimpleDataStore_CompactInBackground_Sink, ILibSimpleDataStore_CompactInBackground_Destroy);
+	return(0);
+}
+__EXPORT_TYPE int ILibSimpleDataStore_CompactInBackground(ILibSimpleDataStore dataStore, void *chain, size_t sliceSize, ILibSimpleDataStore_CompactionHandler handler, void *user)
+{
+	int retVal;
+
+	ILibSimpleDataStore_ExclusiveLock((ILibSimpleDataStore_Root*)dataStore);
+	retVal = ILibSimpleDataStore_CompactInBackground_Locked(dataStore, chain, sliceSize, handler, user);
+	ILibSimpleDataStore_ExclusiveUnLock((ILibSimpleDataStore_Root*)dataStore);
+	return(retVal);
+}
 
 int ILibSimpleDataStore_IsCacheOnly(ILibSimpleDataStore ds)
 {
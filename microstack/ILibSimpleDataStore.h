@@ -17,6 +17,8 @@ limitations under the License.
 /*
 This is a simple data store that implements a hash table in a file. New keys are appended at the end of the file and the file can be compacted when needed.
 The store will automatically create a hash of each value and store the hash. Upon reading the data, the hash is always checked.
+On close and after compaction, a snapshot of the key index is saved next to the file (.idx), so the next open only has to read the records appended after it.
+The first enumeration builds a sorted index of the keys in memory, which is then kept up to date, so keys can be listed by prefix or range without visiting every key.
 */
 
 #ifndef __ILIBSIMPLEDATASTORE__
@@ -43,6 +45,24 @@ typedef void(*ILibSimpleDataStore_SizeWarningHandler)(ILibSimpleDataStore sender
 typedef void(*ILibSimpleDataStore_WriteErrorHandler)(ILibSimpleDataStore sender, void *user);
 typedef void(*ILibSimpleDataStore_GetValuesHandler)(ILibSimpleDataStore sender, char* Key, size_t KeyLen, char* Value, size_t ValueLen, void *user);
 
+typedef struct ILibSimpleDataStore_CompactionStats
+{
+	int inProgress;
+	uint64_t bytesToCopy;				// Live bytes when the compaction started
+	uint64_t bytesCopied;				// Live bytes copied so far
+	uint64_t bytesReclaimed;			// File size reduction of the last finished compaction
+	uint64_t steps;
+	uint64_t totalStallMicroseconds;	// Time the caller was blocked by compaction
+	uint64_t longestStallMicroseconds;
+}ILibSimpleDataStore_CompactionStats;
+typedef void(*ILibSimpleDataStore_CompactionHandler)(ILibSimpleDataStore sender, int status, ILibSimpleDataStore_CompactionStats *stats, void *user);
+
+typedef enum ILibSimpleDataStore_RecordFormats
+{
+	ILibSimpleDataStore_RecordFormat_SHA384 = 0,	// Readable by every version of the data store
+	ILibSimpleDataStore_RecordFormat_CRC32C = 1		// Much cheaper to check, but older versions treat these records as corrupt
+}ILibSimpleDataStore_RecordFormats;
+
 
 // Create the data store.
 __EXPORT_TYPE ILibSimpleDataStore ILibSimpleDataStore_CreateEx2(char* filePath, int userExtraMemorySize, int readonly);
@@ -63,6 +83,16 @@ __EXPORT_TYPE void ILibSimpleDataStore_CachedEx(ILibSimpleDataStore dataStore, c
 __EXPORT_TYPE int ILibSimpleDataStore_Cached_GetValues(ILibSimpleDataStore dataStore, ILibSimpleDataStore_GetValuesHandler handler, void *user);
 
 __EXPORT_TYPE void ILibSimpleDataStore_ConfigCompact(ILibSimpleDataStore dataStore, uint64_t minimumDirtySize);
+
+// Set the check value written with new records. Records in either format can be read, and Compact rewrites the existing records in this format.
+// GetHash still returns the SHA384 of a value stored with a CRC32C check value, it is computed on first use.
+__EXPORT_TYPE void ILibSimpleDataStore_ConfigRecordFormat(ILibSimpleDataStore dataStore, ILibSimpleDataStore_RecordFormats format);
+
+// Write-back tier, for keys that are rewritten often. Plain puts are held in memory, and repeated puts to a key are coalesced into one record when they are flushed.
+// Pending values are flushed every flushInterval milliseconds on the chain thread, once they add up to flushThreshold bytes, by Flush, and by Compact and Close.
+// Either limit can be 0, and both 0 flushes and disables the tier. If a write fails, the pending values are kept in the cache, like a failed Put. Returns 0 on success.
+__EXPORT_TYPE int ILibSimpleDataStore_ConfigWriteBack(ILibSimpleDataStore dataStore, void *chain, int flushInterval, size_t flushThreshold);
+__EXPORT_TYPE int ILibSimpleDataStore_Flush(ILibSimpleDataStore dataStore);
 __EXPORT_TYPE void ILibSimpleDataStore_ConfigSizeLimit(ILibSimpleDataStore dataStore, uint64_t sizeLimit, ILibSimpleDataStore_SizeWarningHandler handler, void *user);
 void ILibSimpleDataStore_ConfigWriteErrorHandler(ILibSimpleDataStore dataStore, ILibSimpleDataStore_WriteErrorHandler handler, void *user);
 
@@ -71,27 +101,85 @@ __EXPORT_TYPE int ILibSimpleDataStore_PutEx2(ILibSimpleDataStore dataStore, char
 #define ILibSimpleDataStore_PutEx(dataStore, key, keyLen, value, valueLen) ILibSimpleDataStore_PutEx2(dataStore, key, keyLen, value, valueLen, NULL)
 int ILibSimpleDataStore_PutCompressed(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* value, size_t valueLen);
 
+// Streaming put, for values too large to hold in memory. The value is hashed, and optionally compressed, in ILibSimpleDataStore_ChunkSize blocks as it is written,
+// and replaces the key's value when the stream ends. One stream can be open at a time, and it can't be ended while a batch is open. Returns 0 on success.
+__EXPORT_TYPE int ILibSimpleDataStore_PutStreamBegin(ILibSimpleDataStore dataStore, char* key, size_t keyLen, int compressed);
+__EXPORT_TYPE int ILibSimpleDataStore_PutStreamWrite(ILibSimpleDataStore dataStore, char* data, size_t dataLen);
+__EXPORT_TYPE int ILibSimpleDataStore_PutStreamEnd(ILibSimpleDataStore dataStore);
+__EXPORT_TYPE void ILibSimpleDataStore_PutStreamAbort(ILibSimpleDataStore dataStore);
+#define ILibSimpleDataStore_ChunkSize 65536
+
 // Get a value from the datastore of given a key.
 __EXPORT_TYPE int ILibSimpleDataStore_GetEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char* buffer, size_t bufferLen);
 #define ILibSimpleDataStore_Get(dataStore, key, buffer, bufferLen) ILibSimpleDataStore_GetEx(dataStore, key, strnlen_s(key, ILibSimpleDataStore_MaxKeyLength), buffer, bufferLen)
 __EXPORT_TYPE int ILibSimpleDataStore_GetInt(ILibSimpleDataStore dataStore, char* key, int defaultValue);
 
-// Get the SHA384 hash value from the datastore for a given a key.
+// Get a copy of a value in one call, free it with ILibMemory_Free(). The length is ILibMemory_Size() of the copy. Returns NULL if the key doesn't exist or the value is empty.
+__EXPORT_TYPE char* ILibSimpleDataStore_GetCopyEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen);
+
+// Read up to bufferLen bytes of a value, starting at offset. Values from a streaming put are read and verified one block at a time, other compressed values are inflated in full.
+// Returns the number of bytes read, 0 past the end of the value, or -1 if the key doesn't exist or the value is corrupt.
+__EXPORT_TYPE int ILibSimpleDataStore_ReadAt(ILibSimpleDataStore dataStore, char* key, size_t keyLen, uint64_t offset, char* buffer, size_t bufferLen);
+
+// Get a read-only pointer to a value without copying it. Only call this between ILibSimpleDataStore_Lock() and UnLock(): once the lock is
+// released, another thread's write can unmap the value. The pointer is valid until the next write or UnLock(), whichever comes first.
+// Returns NULL for compressed values and values from a streaming put, which must be read with GetEx or ReadAt.
+__EXPORT_TYPE char* ILibSimpleDataStore_GetPtrEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, int *valueLen);
+#define ILibSimpleDataStore_GetPtr(dataStore, key, valueLen) ILibSimpleDataStore_GetPtrEx(dataStore, key, strnlen_s(key, ILibSimpleDataStore_MaxKeyLength), valueLen)
+
+// Get a reference to the SHA384 hash value from the datastore for a given a key. Only call this between ILibSimpleDataStore_Lock() and UnLock(), like GetPtr:
+// once the lock is released, another thread's write can free or replace the hash. Other callers should use GetHashCopy.
 __EXPORT_TYPE char* ILibSimpleDataStore_GetHashEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen);
 #define ILibSimpleDataStore_GetHash(dataStore, key) ILibSimpleDataStore_GetHashEx(dataStore, key, strnlen_s(key, ILibSimpleDataStore_MaxKeyLength))
+
+// Copy the SHA384 hash value for a given key into hash, which must hold ILibSimpleDataStore_GetHashSize() bytes. Returns the size of the hash, or 0 if the key doesn't exist
+__EXPORT_TYPE int ILibSimpleDataStore_GetHashCopyEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, char *hash);
+#define ILibSimpleDataStore_GetHashCopy(dataStore, key, hash) ILibSimpleDataStore_GetHashCopyEx(dataStore, key, strnlen_s(key, ILibSimpleDataStore_MaxKeyLength), hash)
 int ILibSimpleDataStore_GetHashSize();
 
+// Get a value, inflated if it was stored compressed, without copying it. The value is held until ReleaseDecoded, which must be called before the data store is closed.
+// With a decoded cache, up to maxBytes of released values are kept in memory by their SHA384, so keys with the same value share one copy. 0 disables the cache.
+__EXPORT_TYPE void ILibSimpleDataStore_ConfigDecodedCache(ILibSimpleDataStore dataStore, size_t maxBytes);
+__EXPORT_TYPE char* ILibSimpleDataStore_GetDecodedEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen, size_t *valueLen);
+__EXPORT_TYPE void ILibSimpleDataStore_ReleaseDecoded(ILibSimpleDataStore dataStore, char *value);
+
 // Delete a key from the data store
 __EXPORT_TYPE int ILibSimpleDataStore_DeleteEx(ILibSimpleDataStore dataStore, char* key, size_t keyLen);
 #define ILibSimpleDataStore_Delete(dataStore, key) ILibSimpleDataStore_DeleteEx(dataStore, key, strnlen_s(key, ILibSimpleDataStore_MaxKeyLength))
 
-// Enumerate all keys from the data store
+// Group puts and deletes into one write/flush. Staged changes are only visible to Get after a successful commit.
+// Durable commits also sync the file to disk. If the write fails, the store switches to read-only and the staged values are kept in the cache, like a failed Put.
+// Puts that don't change the stored value are not staged. ILibSimpleDataStore_Close() commits a batch that is still open.
+__EXPORT_TYPE int ILibSimpleDataStore_BatchBegin(ILibSimpleDataStore dataStore);
+__EXPORT_TYPE int ILibSimpleDataStore_BatchCommitEx(ILibSimpleDataStore dataStore, int durable);
+#define ILibSimpleDataStore_BatchCommit(dataStore) ILibSimpleDataStore_BatchCommitEx(dataStore, 0)
+__EXPORT_TYPE void ILibSimpleDataStore_BatchAbort(ILibSimpleDataStore dataStore);
+
+// Enumerate all keys from the data store, in sorted (byte) order
 __EXPORT_TYPE void ILibSimpleDataStore_EnumerateKeys(ILibSimpleDataStore dataStore, ILibSimpleDataStore_KeyEnumerationHandler handler, void *user);
 
+// Enumerate the keys in [start, end) or the keys that begin with prefix, in sorted order. A NULL start or end leaves that side of the range open.
+// The handler runs with the store locked. It can get, put and delete keys; deleted keys are not enumerated, keys put ahead of the enumeration may be.
+__EXPORT_TYPE void ILibSimpleDataStore_EnumerateRange(ILibSimpleDataStore dataStore, char* start, size_t startLen, char* end, size_t endLen, ILibSimpleDataStore_KeyEnumerationHandler handler, void *user);
+__EXPORT_TYPE void ILibSimpleDataStore_EnumeratePrefix(ILibSimpleDataStore dataStore, char* prefix, size_t prefixLen, ILibSimpleDataStore_KeyEnumerationHandler handler, void *user);
+
 // Compacts the data store
 __EXPORT_TYPE int ILibSimpleDataStore_Compact(ILibSimpleDataStore dataStore);
 
-// Lock and unlock the data store. This is useful if we need to access this store from many threads.
+// Incremental compaction. Each step copies about maxBytes of live records, puts and deletes may happen between steps.
+// CompactStep returns 1 if there is more to do, 0 when the compacted file has replaced the data store, and -1 on error (the compaction is abandoned).
+// A full Compact, ReOpenReadOnly or Close abandons an incremental compaction.
+__EXPORT_TYPE int ILibSimpleDataStore_CompactBegin(ILibSimpleDataStore dataStore);
+__EXPORT_TYPE int ILibSimpleDataStore_CompactStep(ILibSimpleDataStore dataStore, size_t maxBytes);
+__EXPORT_TYPE void ILibSimpleDataStore_CompactAbort(ILibSimpleDataStore dataStore);
+__EXPORT_TYPE void ILibSimpleDataStore_GetCompactionStats(ILibSimpleDataStore dataStore, ILibSimpleDataStore_CompactionStats *stats);
+
+// Run an incremental compaction on the chain thread, one step per chain iteration. The handler (optional) is called with status 0 on success, 1 on error.
+__EXPORT_TYPE int ILibSimpleDataStore_CompactInBackground(ILibSimpleDataStore dataStore, void *chain, size_t sliceSize, ILibSimpleDataStore_CompactionHandler handler, void *user);
+#define ILibSimpleDataStore_CompactionSliceSize 262144
+
+// Gets from many threads run concurrently, anything that changes the store runs alone. Lock and unlock the data store,
+// for a sequence of calls that must not be interleaved with other threads. The thread holding the lock can take it again.
 __EXPORT_TYPE void ILibSimpleDataStore_Lock(ILibSimpleDataStore dataStore);
 __EXPORT_TYPE void ILibSimpleDataStore_UnLock(ILibSimpleDataStore dataStore);
 
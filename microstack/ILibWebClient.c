@@ -77,6 +77,7 @@ void WebClient_TrackUnLock(const char* MethodName, int Occurance, void *data)
 #include "ILibAsyncSocket.h"
 #include "ILibRemoteLogging.h"
 #include "ILibCrypto.h"
+#include "meshcore/zlib/zlib.h"
 
 extern ILibSpinLock *ILibAsyncSocket_GetSpinLock(ILibAsyncSocket_SocketModule socketModule);
 
@@ -265,6 +266,7 @@ typedef struct ILibWebClient_PipelineRequestToken
 	char* WebSocketKey;
 	int WebSocketMaxBuffer;
 	ILibWebClient_OnSendOK WebSocketSendOK;
+	int WebSocketDeflateFlags;
 	struct ILibWebRequest *parent;
 	char host[255];
 	char reserved[29];
@@ -315,8 +317,34 @@ typedef struct ILibWebClient_WebSocketState
 	ILibWebClient_WebSocket_PingHandler pingHandler;
 	ILibWebClient_WebSocket_PongHandler pongHandler;
 	void* pingPongUser;
+
+	ILibWebClient_WebSocket_Deflater deflater;	// Set if permessage-deflate was negotiated
+	char  WebSocketCompressedMessage;		// Set while receiving the frames of a compressed message
+
+	char  WebSocketStreaming;				// Set if frame payloads are delivered as they arrive (WEBSOCKET_STREAMING_RECEIVE)
+	char  WebSocketStreamFIN;				// FIN flag of the frame currently being streamed
+	unsigned char WebSocketStreamOPCODE;	// OPCODE of the frame currently being streamed
+	char  WebSocketStreamMask[4];			// Masking key of the frame currently being streamed
+	int   WebSocketStreamMaskOffset;		// Number of payload bytes of the current frame already unmasked
+	int   WebSocketStreamRemaining;			// Number of payload bytes of the current frame not yet received
 }ILibWebClient_WebSocketState;
 
+typedef struct ILibWebClient_WebSocket_DeflateState
+{
+	z_stream deflater;
+	z_stream inflater;
+	int isServer;
+	int flags;
+	char *deflateBuffer;
+	size_t deflateBufferSize;
+
+	int inflateFin;
+	int inflateTail;
+	int inflateDone;
+	char inflateBuffer[WEBSOCKET_DEFLATE_CHUNKSIZE];
+}ILibWebClient_WebSocket_DeflateState;
+const char ILibWebClient_WebSocket_Deflate_Trailer[] = { 0x00, 0x00, (char)0xFF, (char)0xFF };
+
 int ILibWebClient_GetDescriptorValue_FromStateObject(ILibWebClient_StateObject state)
 {
 	return((state != NULL ? ((ILibWebClientDataObject*)state)->__tmpDescriptor : -1));
@@ -487,6 +515,7 @@ void ILibWebClient_DestroyWebClientDataObject(ILibWebClient_StateObject token)
 		if (wcdo->IsWebSocket != 0)
 		{
 			free(((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentBuffer);
+			ILibWebClient_WebSocket_Deflate_Destroy(((ILibWebClient_WebSocketState*)wr->Buffer[0])->deflater);
 		}
 		wr->connectionCloseWasSpecified = 2;
 		ILibWebClient_DestroyWebRequest(wr);
@@ -1198,6 +1227,250 @@ void ILibWebClient_ProcessChunk(ILibAsyncSocket_SocketModule socketModule, struc
 //{{{ <--REMOVE_THIS_FOR_HTTP/1.0_ONLY_SUPPORT }}}
 extern int ILibWebServer_WebSocket_CreateHeader(char* header, unsigned short FLAGS, unsigned short OPCODE, int payloadLength);
 
+//
+// Parses a Sec-WebSocket-Extensions header value, looking for the first acceptable permessage-deflate offer/response
+//
+// <param name="extensions">Header value</param>
+// <param name="extensionsLen">Length of the header value</param>
+// <param name="flags">Negotiated ILibWebClient_WebSocket_DeflateFlags</param>
+// <param name="clientWindowBits">client_max_window_bits parameter (15 if not specified)</param>
+// <param name="serverWindowBits">server_max_window_bits parameter (15 if not specified)</param>
+// <returns>0 if permessage-deflate was found with acceptable parameters, nonzero otherwise</returns>
+int ILibWebClient_WebSocket_Deflate_ParseExtensions(char *extensions, int extensionsLen, int *flags, int *clientWindowBits, int *serverWindowBits)
+{
+	struct parser_result *offers, *params;
+	struct parser_result_field *offer, *param;
+	char *token, *name, *value;
+	size_t tokenLen, nameLen, valueLen, x;
+	int declined = 1;
+	int i, bits;
+
+	*flags = ILibWebClient_WebSocket_DeflateFlag_NONE;
+	*clientWindowBits = *serverWindowBits = 15;
+	if (extensions == NULL || extensionsLen <= 0) { return(1); }
+
+	offers = ILibParseString(extensions, 0, (size_t)extensionsLen, ",", 1);
+	for (offer = offers->FirstResult; offer != NULL && declined != 0; offer = offer->NextResult)
+	{
+		params = ILibParseString(offer->data, 0, offer->datalength, ";", 1);
+		param = params->FirstResult;
+		token = param->data;
+		tokenLen = ILibTrimString(&token, param->datalength);
+		if (tokenLen == 18 && strncasecmp(token, "permessage-deflate", 18) == 0)
+		{
+			declined = 0;
+			*flags = ILibWebClient_WebSocket_DeflateFlag_ENABLED;
+			*clientWindowBits = *serverWindowBits = 15;
+
+			for (param = param->NextResult; param != NULL && declined == 0; param = param->NextResult)
+			{
+				token = param->data;
+				tokenLen = ILibTrimString(&token, param->datalength);
+				name = token; nameLen = tokenLen;
+				value = NULL; valueLen = 0;
+				bits = 15;
+				if ((i = ILibString_IndexOf(token, tokenLen, "=", 1)) >= 0)
+				{
+					nameLen = ILibTrimString(&name, (size_t)i);
+					value = token + i + 1;
+					valueLen = ILibTrimString(&value, tokenLen - (size_t)i - 1);
+					if (valueLen >= 2 && value[0] == '"' && value[valueLen - 1] == '"') { ++value; valueLen -= 2; }
+					for (x = 0, bits = 0; x < valueLen && x < 3; ++x)
+					{
+						if (value[x] < '0' || value[x] > '9') { bits = -1; break; }
+						bits = (bits * 10) + (value[x] - '0');
+					}
+				}
+
+				// zlib cannot produce raw deflate streams with a 256 byte window, so we decline a window size of 8
+				if (bits < 9 || bits > 15) { declined = 1; }
+				else if (value == NULL && nameLen == 26 && strncasecmp(name, "client_no_context_takeover", 26) == 0) { *flags |= ILibWebClient_WebSocket_DeflateFlag_CLIENT_NO_CONTEXT_TAKEOVER; }
+				else if (value == NULL && nameLen == 26 && strncasecmp(name, "server_no_context_takeover", 26) == 0) { *flags |= ILibWebClient_WebSocket_DeflateFlag_SERVER_NO_CONTEXT_TAKEOVER; }
+				else if (nameLen == 22 && strncasecmp(name, "client_max_window_bits", 22) == 0) { *clientWindowBits = bits; }
+				else if (value != NULL && nameLen == 22 && strncasecmp(name, "server_max_window_bits", 22) == 0) { *serverWindowBits = bits; }
+				else { declined = 1; } // Unknown extension parameter, so we must decline this offer
+			}
+			if (declined != 0)
+			{
+				*flags = ILibWebClient_WebSocket_DeflateFlag_NONE;
+				*clientWindowBits = *serverWindowBits = 15;
+			}
+		}
+		ILibDestructParserResults(params);
+	}
+	ILibDestructParserResults(offers);
+	return(declined);
+}
+
+//
+// Creates the per-connection zlib streams for a negotiated permessage-deflate extension
+//
+// <param name="isServer">Nonzero if this endpoint is the server side of the WebSocket</param>
+// <param name="negotiatedFlags">Negotiated ILibWebClient_WebSocket_DeflateFlags</param>
+// <param name="deflateWindowBits">LZ77 window size that the peer will accept from us</param>
+ILibWebClient_WebSocket_Deflater ILibWebClient_WebSocket_Deflate_Create(int isServer, int negotiatedFlags, int deflateWindowBits)
+{
+	ILibWebClient_WebSocket_DeflateState *state = (ILibWebClient_WebSocket_DeflateState*)ILibMemory_Allocate(sizeof(ILibWebClient_WebSocket_DeflateState), 0, NULL, NULL);
+
+	if (deflateWindowBits < 9 || deflateWindowBits > 15) { deflateWindowBits = 15; }
+	state->isServer = isServer;
+	state->flags = negotiatedFlags;
+	if (deflateInit2(&(state->deflater), Z_DEFAULT_COMPRESSION, Z_DEFLATED, -deflateWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		free(state);
+		return(NULL);
+	}
+	if (inflateInit2(&(state->inflater), -MAX_WBITS) != Z_OK)
+	{
+		ignore_result(deflateEnd(&(state->deflater)));
+		free(state);
+		return(NULL);
+	}
+	return(state);
+}
+void ILibWebClient_WebSocket_Deflate_Destroy(ILibWebClient_WebSocket_Deflater deflater)
+{
+	ILibWebClient_WebSocket_DeflateState *state = (ILibWebClient_WebSocket_DeflateState*)deflater;
+	if (state == NULL) { return; }
+
+	ignore_result(deflateEnd(&(state->deflater)));
+	ignore_result(inflateEnd(&(state->inflater)));
+	if (state->deflateBuffer != NULL) { free(state->deflateBuffer); }
+	free(state);
+}
+
+//
+// Returns nonzero if the payload starts with the signature of an already compressed format (JPEG, PNG, GZIP, ZIP)
+//
+int ILibWebClient_WebSocket_Deflate_IsCompressed(char *buffer, int bufferLen)
+{
+	unsigned char *b = (unsigned char*)buffer;
+	if (bufferLen < 4) { return(0); }
+	if (b[0] == 0xFF && b[1] == 0xD8 && b[2] == 0xFF) { return(1); }					// JPEG
+	if (b[0] == 0x89 && b[1] == 0x50 && b[2] == 0x4E && b[3] == 0x47) { return(1); }	// PNG
+	if (b[0] == 0x1F && b[1] == 0x8B) { return(1); }									// GZIP
+	if (b[0] == 0x50 && b[1] == 0x4B && b[2] == 0x03 && b[3] == 0x04) { return(1); }	// ZIP
+	return(0);
+}
+
+//
+// Compresses an entire message. Returns NULL if the message should be sent uncompressed, otherwise 
+// returns a pointer to a buffer owned by the deflater, that is valid until the next call.
+//
+char* ILibWebClient_WebSocket_Deflate_Compress(ILibWebClient_WebSocket_Deflater deflater, char *buffer, int bufferLen, int *compressedLen)
+{
+	ILibWebClient_WebSocket_DeflateState *state = (ILibWebClient_WebSocket_DeflateState*)deflater;
+	int noContextTakeover;
+	size_t bound;
+
+	if (state == NULL || bufferLen <= WEBSOCKET_DEFLATE_THRESHOLD || ILibWebClient_WebSocket_Deflate_IsCompressed(buffer, bufferLen) != 0) { return(NULL); }
+	noContextTakeover = state->flags & (state->isServer != 0 ? ILibWebClient_WebSocket_DeflateFlag_SERVER_NO_CONTEXT_TAKEOVER : ILibWebClient_WebSocket_DeflateFlag_CLIENT_NO_CONTEXT_TAKEOVER);
+
+	bound = (size_t)deflateBound(&(state->deflater), (uLong)bufferLen) + 16; // Extra room for the empty stored block of the sync flush
+	if (state->deflateBufferSize < bound)
+	{
+		if ((state->deflateBuffer = (char*)realloc(state->deflateBuffer, bound)) == NULL) { ILIBCRITICALEXIT(254); }
+		state->deflateBufferSize = bound;
+	}
+
+	state->deflater.next_in = (Bytef*)buffer;
+	state->deflater.avail_in = (uInt)bufferLen;
+	state->deflater.next_out = (Bytef*)state->deflateBuffer;
+	state->deflater.avail_out = (uInt)state->deflateBufferSize;
+	if (deflate(&(state->deflater), Z_SYNC_FLUSH) != Z_OK || state->deflater.avail_in != 0 || state->deflater.avail_out == 0)
+	{
+		ignore_result(deflateReset(&(state->deflater)));
+		return(NULL);
+	}
+
+	*compressedLen = (int)(state->deflateBufferSize - state->deflater.avail_out) - 4; // Strip the 0x00 0x00 0xFF 0xFF tail of the sync flush
+	if (*compressedLen >= bufferLen)
+	{
+		// Not worth it. Our history now contains data the peer will never see, so we must start over
+		ignore_result(deflateReset(&(state->deflater)));
+		return(NULL);
+	}
+	if (noContextTakeover != 0) { ignore_result(deflateReset(&(state->deflater))); }
+	return(state->deflateBuffer);
+}
+
+//
+// Sets the compressed payload of a received frame, to be decompressed with ILibWebClient_WebSocket_Deflate_Inflate
+//
+void ILibWebClient_WebSocket_Deflate_SetInput(ILibWebClient_WebSocket_Deflater deflater, char *buffer, int bufferLen, int fin)
+{
+	ILibWebClient_WebSocket_DeflateState *state = (ILibWebClient_WebSocket_DeflateState*)deflater;
+
+	state->inflater.next_in = (Bytef*)buffer;
+	state->inflater.avail_in = (uInt)bufferLen;
+	state->inflateFin = fin;
+	state->inflateTail = 0;
+	state->inflateDone = 0;
+}
+
+//
+// Decompresses the next piece of the payload set with ILibWebClient_WebSocket_Deflate_SetInput, into a bounded buffer owned by the deflater
+//
+// <param name="chunk">Decompressed data</param>
+// <param name="chunkLen">Length of the decompressed data</param>
+// <param name="last">Set to nonzero if this is the final piece of the message</param>
+// <returns>1 if a piece was produced, 0 if the input is exhausted, -1 on a decompression error</returns>
+int ILibWebClient_WebSocket_Deflate_Inflate(ILibWebClient_WebSocket_Deflater deflater, char **chunk, int *chunkLen, int *last)
+{
+	ILibWebClient_WebSocket_DeflateState *state = (ILibWebClient_WebSocket_DeflateState*)deflater;
+	int r;
+
+	*chunk = state->inflateBuffer;
+	*chunkLen = 0;
+	*last = 0;
+	if (state->inflateDone != 0) { return(0); }
+
+	while (1)
+	{
+		if (state->inflater.avail_in == 0 && state->inflateFin != 0 && state->inflateTail == 0)
+		{
+			// The sender stripped this from the end of the message
+			state->inflater.next_in = (Bytef*)ILibWebClient_WebSocket_Deflate_Trailer;
+			state->inflater.avail_in = sizeof(ILibWebClient_WebSocket_Deflate_Trailer);
+			state->inflateTail = 1;
+		}
+		state->inflater.next_out = (Bytef*)state->inflateBuffer;
+		state->inflater.avail_out = sizeof(state->inflateBuffer);
+
+		r = inflate(&(state->inflater), Z_SYNC_FLUSH);
+		*chunkLen = (int)(sizeof(state->inflateBuffer) - state->inflater.avail_out);
+		if (r == Z_STREAM_END)
+		{
+			// Sender finished the deflate stream with a final block, so anything left over is discarded
+			ignore_result(inflateReset(&(state->inflater)));
+			state->inflater.avail_in = 0;
+			state->inflateTail = 1;
+		}
+		else if (r != Z_OK && (r != Z_BUF_ERROR || (*chunkLen == 0 && state->inflater.avail_in != 0)))
+		{
+			state->inflateDone = 1;
+			return(-1);
+		}
+
+		if (state->inflater.avail_out != 0 && state->inflater.avail_in == 0 && (state->inflateFin == 0 || state->inflateTail != 0))
+		{
+			// All of the input was consumed
+			state->inflateDone = 1;
+			if (state->inflateFin != 0)
+			{
+				*last = 1;
+				if ((state->flags & (state->isServer != 0 ? ILibWebClient_WebSocket_DeflateFlag_CLIENT_NO_CONTEXT_TAKEOVER : ILibWebClient_WebSocket_DeflateFlag_SERVER_NO_CONTEXT_TAKEOVER)) != 0)
+				{
+					ignore_result(inflateReset(&(state->inflater)));
+				}
+			}
+			return((*chunkLen > 0 || *last != 0) ? 1 : 0);
+		}
+		if (*chunkLen > 0) { return(1); }
+	}
+}
+
+
 ILibWebClient_WebSocketState* ILibWebClient_WebSocket_GetState(ILibWebRequest *wr)
 {
 	if ((wr->Buffer[0])[0] != 0)
@@ -1212,9 +1485,17 @@ ILibWebClient_WebSocketState* ILibWebClient_WebSocket_GetState(ILibWebRequest *w
 			memset(wr->Buffer[0], 0, sizeof(ILibWebClient_WebSocketState));
 		}
 
-		((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentMaxBufferSize = wr->requestToken->WebSocketMaxBuffer;
-		((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentBufferSize = 4096;
-		((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentBuffer = ILibMemory_Allocate(4096, 0, NULL, NULL);
+		if (wr->requestToken->WebSocketMaxBuffer < 0)
+		{
+			// Payloads are passed up as they arrive, so there is nothing to re-assemble
+			((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketStreaming = 1;
+		}
+		else
+		{
+			((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentMaxBufferSize = wr->requestToken->WebSocketMaxBuffer;
+			((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentBufferSize = 4096;
+			((ILibWebClient_WebSocketState*)wr->Buffer[0])->WebSocketFragmentBuffer = ILibMemory_Allocate(4096, 0, NULL, NULL);
+		}
 		((ILibWebClient_WebSocketState*)wr->Buffer[0])->OnSendOK = wr->requestToken->WebSocketSendOK;
 	}
 	return((ILibWebClient_WebSocketState*)wr->Buffer[0]);
@@ -1231,6 +1512,9 @@ ILibAsyncSocket_SendStatus ILibWebClient_WebSocket_Send(ILibWebClient_StateObjec
 	int maskKeyInt;
 	int headerLen;
 	unsigned short flags = WEBSOCKET_MASK;
+	unsigned short rsv = 0;
+	char *compressed;
+	int compressedLen;
 	ILibAsyncSocket_SendStatus RetVal = ILibAsyncSocket_SEND_ON_CLOSED_SOCKET_ERROR;
 	ILibWebRequest *wr = (ILibWebRequest*)ILibQueue_PeekQueue(wcdo->RequestQueue);
 	ILibWebClient_WebSocketState *state;
@@ -1245,6 +1529,17 @@ ILibAsyncSocket_SendStatus ILibWebClient_WebSocket_Send(ILibWebClient_StateObjec
 	state = ILibWebClient_WebSocket_GetState(wr);
 
 	ILibSpinLock_Lock(ILibAsyncSocket_GetSpinLock(wcdo->SOCK));
+	if (state->deflater != NULL && state->WebSocketFragmentFlag == 0 && _bufferFragment == ILibWebClient_WebSocket_FragmentFlag_Complete &&
+		(bufferType == ILibWebClient_WebSocket_DataType_TEXT || bufferType == ILibWebClient_WebSocket_DataType_BINARY))
+	{
+		// Only whole messages are compressed, and the deflater must be used under the lock, to keep the message order in sync with the LZ77 history
+		if ((compressed = ILibWebClient_WebSocket_Deflate_Compress(state->deflater, _buffer, _bufferLen, &compressedLen)) != NULL)
+		{
+			_buffer = compressed;
+			_bufferLen = compressedLen;
+			rsv = WEBSOCKET_RSV1;
+		}
+	}
 	while (i < _bufferLen)
 	{
 		if (i < 0) { i = 0; }
@@ -1258,7 +1553,7 @@ ILibAsyncSocket_SendStatus ILibWebClient_WebSocket_Send(ILibWebClient_StateObjec
 			if (state->WebSocketFragmentFlag == 0)
 			{
 				// This is a self contained fragment
-				headerLen = ILibWebServer_WebSocket_CreateHeader(header, flags | WEBSOCKET_FIN, (unsigned short)bufferType, bufferLen);
+				headerLen = ILibWebServer_WebSocket_CreateHeader(header, flags | rsv | WEBSOCKET_FIN, (unsigned short)bufferType, bufferLen);
 			}
 			else
 			{
@@ -1273,7 +1568,7 @@ ILibAsyncSocket_SendStatus ILibWebClient_WebSocket_Send(ILibWebClient_StateObjec
 			{
 				// Start a new fragment
 				state->WebSocketFragmentFlag = 1;
-				headerLen = ILibWebServer_WebSocket_CreateHeader(header, flags, (unsigned short)bufferType, bufferLen);
+				headerLen = ILibWebServer_WebSocket_CreateHeader(header, flags | rsv, (unsigned short)bufferType, bufferLen);
 			}
 			else
 			{
@@ -1304,6 +1599,12 @@ ILibAsyncSocket_SendStatus ILibWebClient_WebSocket_Send(ILibWebClient_StateObjec
 	ILibSpinLock_UnLock(ILibAsyncSocket_GetSpinLock(wcdo->SOCK));
 	return RetVal;
 }
+int ILibWebClient_WebSocket_GetFrameRemaining(ILibWebClient_StateObject obj)
+{
+	if (!ILibMemory_CanaryOK(obj)) { return(0); }
+	ILibWebRequest *wr = (ILibWebRequest*)ILibQueue_PeekQueue(((ILibWebClientDataObject*)obj)->RequestQueue);
+	return(wr != NULL && ((ILibWebClientDataObject*)obj)->IsWebSocket != 0 ? ILibWebClient_WebSocket_GetState(wr)->WebSocketStreamRemaining : 0);
+}
 void ILibWebClient_WebSocket_SetPingPongHandler(ILibWebClient_StateObject obj, ILibWebClient_WebSocket_PingHandler pingHandler, ILibWebClient_WebSocket_PongHandler pongHandler, void *user)
 {
 	if (!ILibMemory_CanaryOK(obj)) { return; }
@@ -1317,6 +1618,98 @@ void ILibWebClient_WebSocket_SetPingPongHandler(ILibWebClient_StateObject obj, I
 		state->pingPongUser = user;
 	}
 }
+//
+// Delivers the payload of a data frame to the user, re-assembling fragments if requested
+//
+void ILibWebClient_WebSocket_Dispatch(ILibWebClientDataObject *wcdo, ILibWebRequest *wr, ILibWebClient_WebSocketState *state, char *payload, int payloadLen, int FIN, unsigned char OPCODE, int *PAUSE)
+{
+	int tempBegin = 0;
+
+	if (state->WebSocketFragmentMaxBufferSize == 0)
+	{
+		// We will just pass the data up, and let the app handle fragment re-assembly
+		state->WebSocketDataFrameType = (int)OPCODE;
+		tempBegin = 0;
+		wr->OnResponse(wcdo, 0, wcdo->header, payload, &tempBegin, payloadLen, FIN == 0 ? ILibWebClient_ReceiveStatus_Partial : ILibWebClient_ReceiveStatus_LastPartial, wr->user1, wr->user2, PAUSE);
+	}
+	else
+	{
+		// We will try to automatically re-assemble fragments, up to the max buffer size the user specified
+		if (OPCODE != 0) { state->WebSocketDataFrameType = (int)OPCODE; } // Set the DataFrame Type, so the user can query it
+
+		if (FIN != 0 && state->WebSocketFragmentIndex == 0 && state->WebSocketCouldNotAutoReassemble == 0)
+		{
+			// We have an entire fragment, and we didn't save any of it yet... We can just forward it up without copying the buffer
+			tempBegin = 0;
+			wr->OnResponse(wcdo, 0, wcdo->header, payload, &tempBegin, payloadLen, ILibWebClient_ReceiveStatus_MoreDataToBeReceived, wr->user1, wr->user2, PAUSE);
+		}
+		else
+		{
+			while (state->WebSocketFragmentIndex + payloadLen >= state->WebSocketFragmentBufferSize)
+			{
+				// Need to grow the buffer
+
+				if (state->WebSocketFragmentBufferSize == state->WebSocketFragmentMaxBufferSize)
+				{
+					// We are already maxed out, so just send what we have as an unfinished fragment	
+					state->WebSocketCouldNotAutoReassemble = 1; // Set this flag, becuase we can't reassemble, so our FIN flag will be different to reflect that					
+					tempBegin = 0;
+					wr->OnResponse(wcdo, 0, wcdo->header, state->WebSocketFragmentBuffer, &tempBegin, state->WebSocketFragmentIndex, ILibWebClient_ReceiveStatus_Partial, wr->user1, wr->user2, PAUSE);
+					state->WebSocketFragmentIndex = 0; // Reset the index, becuase new data is going to go to the front
+					if (payloadLen >= state->WebSocketFragmentBufferSize)
+					{
+						// This frame won't fit either, so pass it up as is
+						tempBegin = 0;
+						wr->OnResponse(wcdo, 0, wcdo->header, payload, &tempBegin, payloadLen, FIN == 0 ? ILibWebClient_ReceiveStatus_Partial : ILibWebClient_ReceiveStatus_LastPartial, wr->user1, wr->user2, PAUSE);
+						if (FIN != 0) { state->WebSocketCouldNotAutoReassemble = 0; }
+						return;
+					}
+				}
+				else
+				{
+					// We can grow the buffer
+					state->WebSocketFragmentBufferSize = state->WebSocketFragmentBufferSize * 2;
+					if (state->WebSocketFragmentBufferSize > state->WebSocketFragmentMaxBufferSize) { state->WebSocketFragmentBufferSize = state->WebSocketFragmentMaxBufferSize; }
+					if ((state->WebSocketFragmentBuffer = (char*)realloc(state->WebSocketFragmentBuffer, state->WebSocketFragmentBufferSize)) == NULL) { ILIBCRITICALEXIT(254); } // MS Static Analyser erroneously reports that this leaks the original memory block
+				}
+			}
+
+			memcpy_s(state->WebSocketFragmentBuffer + state->WebSocketFragmentIndex, state->WebSocketFragmentBufferSize - state->WebSocketFragmentIndex, payload, payloadLen);
+			state->WebSocketFragmentIndex += payloadLen;
+
+			if (FIN != 0)
+			{			
+				wr->OnResponse(wcdo, 0, wcdo->header, state->WebSocketFragmentBuffer, &tempBegin, state->WebSocketFragmentIndex, state->WebSocketCouldNotAutoReassemble == 0 ? ILibWebClient_ReceiveStatus_MoreDataToBeReceived : ILibWebClient_ReceiveStatus_LastPartial, wr->user1, wr->user2, PAUSE);	
+				state->WebSocketCouldNotAutoReassemble = 0; // Reset (We can try to auto-assemble)
+				state->WebSocketFragmentIndex = 0; // Reset (We can write to the start of the buffer)
+			}
+		}
+	}
+}
+//
+// Delivers (part of) the payload of a data frame, decompressing it first if necessary. Returns nonzero on a decompression error
+//
+int ILibWebClient_WebSocket_Deliver(ILibWebClientDataObject *wcdo, ILibWebRequest *wr, ILibWebClient_WebSocketState *state, char *payload, int payloadLen, int FIN, unsigned char OPCODE, int *PAUSE)
+{
+	char *chunk;
+	int chunkLen, last, r;
+
+	if (state->WebSocketCompressedMessage == 0)
+	{
+		ILibWebClient_WebSocket_Dispatch(wcdo, wr, state, payload, payloadLen, FIN, OPCODE, PAUSE);
+		return(0);
+	}
+
+	// Decompress in bounded pieces, so a small frame cannot force us to allocate a huge buffer
+	ILibWebClient_WebSocket_Deflate_SetInput(state->deflater, payload, payloadLen, FIN);
+	while ((r = ILibWebClient_WebSocket_Deflate_Inflate(state->deflater, &chunk, &chunkLen, &last)) > 0)
+	{
+		ILibWebClient_WebSocket_Dispatch(wcdo, wr, state, chunk, chunkLen, last, OPCODE, PAUSE);
+		OPCODE = WEBSOCKET_OPCODE_FRAMECONT;
+		if (wcdo->SOCK == NULL || ILibAsyncSocket_IsConnected(wcdo->SOCK) == 0) { break; }
+	}
+	return(r < 0 ? 1 : 0);
+}
 int ILibWebClient_ProcessWebSocketData(char* buffer, int offset, int length, ILibWebClientDataObject *wcdo, int *PAUSE)
 {
 	int x;
@@ -1326,7 +1719,7 @@ int ILibWebClient_ProcessWebSocketData(char* buffer, int offset, int length, ILi
 	char* maskingKey = NULL;
 	int FIN;
 	unsigned char OPCODE;
-	int tempBegin = 0;
+	int available;
 
 	if (wcdo == NULL) { return(length); }
 	ILibWebRequest *wr = (ILibWebRequest*)ILibQueue_PeekQueue(wcdo->RequestQueue);
@@ -1338,13 +1731,38 @@ int ILibWebClient_ProcessWebSocketData(char* buffer, int offset, int length, ILi
 		ILibWebClient_Disconnect(wcdo);
 		return(length);
 	}
-	if (length < 2) { return(offset); } // We need at least 2 bytes to read enough of the headers to know how long the frame is
 	state = (ILibWebClient_WebSocketState*)wr->Buffer[0];
+	if (state->WebSocketStreamRemaining > 0)
+	{
+		// Continuation of a frame payload that we already started passing up
+		available = (length - offset) < state->WebSocketStreamRemaining ? (length - offset) : state->WebSocketStreamRemaining;
+		if (available <= 0) { return(offset); }
+		for (x = 0; x < available; ++x)
+		{
+			buffer[offset + x] = buffer[offset + x] ^ state->WebSocketStreamMask[(state->WebSocketStreamMaskOffset + x) % 4];
+		}
+		state->WebSocketStreamMaskOffset += available;
+		state->WebSocketStreamRemaining -= available;
+		if (ILibWebClient_WebSocket_Deliver(wcdo, wr, state, buffer + offset, available, state->WebSocketStreamRemaining == 0 ? state->WebSocketStreamFIN : 0, state->WebSocketStreamOPCODE, PAUSE) != 0)
+		{
+			ILibWebClient_Disconnect(wcdo);
+			return(length);
+		}
+		return(offset + available);
+	}
+	if (length < 2) { return(offset); } // We need at least 2 bytes to read enough of the headers to know how long the frame is
 
 	hdr = ntohs(((unsigned short*)(buffer + offset))[0]);
 	FIN = (hdr & WEBSOCKET_FIN) != 0;
 	OPCODE = (hdr & WEBSOCKET_OPCODE) >> 8;
 
+	if ((hdr & WEBSOCKET_RSV) != 0 && ((hdr & WEBSOCKET_RSV) != WEBSOCKET_RSV1 || state->deflater == NULL || OPCODE == WEBSOCKET_OPCODE_FRAMECONT || OPCODE >= 0x8))
+	{
+		// RSV1 is only valid on the first frame of a data message, and only if permessage-deflate was negotiated
+		ILibWebClient_Disconnect(wcdo);
+		return(length);
+	}
+
 	plen = (unsigned char)(hdr & WEBSOCKET_PLEN);
 	if (plen == 126)
 	{
@@ -1376,9 +1794,15 @@ int ILibWebClient_ProcessWebSocketData(char* buffer, int offset, int length, ILi
 		}
 	}
 
+	available = plen;
 	if (length < (i + plen + ((unsigned char)(hdr & WEBSOCKET_MASK) != 0 ? 4 : 0)))
 	{
-		return(offset); // Don't have the entire packet
+		if (state->WebSocketStreaming == 0 || OPCODE >= 0x8 || length < (i + ((unsigned char)(hdr & WEBSOCKET_MASK) != 0 ? 4 : 0)))
+		{
+			return(offset); // Don't have the entire packet
+		}
+		// We'll pass up what we have now, and the rest as it arrives, so the receive buffer never has to hold the entire frame
+		available = length - i - ((unsigned char)(hdr & WEBSOCKET_MASK) != 0 ? 4 : 0);
 	}
 
 	maskingKey = ((unsigned char)(hdr & WEBSOCKET_MASK) == 0) ? NULL : (buffer + i);
@@ -1387,7 +1811,7 @@ int ILibWebClient_ProcessWebSocketData(char* buffer, int offset, int length, ILi
 		// Unmask the data
 		i += 4;	// Move ptr to start of data
 
-		for (x = 0; x < plen; ++x)
+		for (x = 0; x < available; ++x)
 		{
 			buffer[i + x] = buffer[i + x] ^ maskingKey[x % 4];
 		}
@@ -1396,58 +1820,23 @@ int ILibWebClient_ProcessWebSocketData(char* buffer, int offset, int length, ILi
 	if (OPCODE < 0x8)
 	{
 		// NON-CONTROL OP-CODE
-		if (state->WebSocketFragmentMaxBufferSize == 0)
+		if (OPCODE != 0) { state->WebSocketCompressedMessage = (hdr & WEBSOCKET_RSV1) != 0 ? 1 : 0; }
+		if (available < plen)
 		{
-			// We will just pass the data up, and let the app handle fragment re-assembly
-			state->WebSocketDataFrameType = (int)OPCODE;
-			tempBegin = 0;
-			wr->OnResponse(wcdo, 0, wcdo->header, buffer + i, &tempBegin, plen, FIN == 0 ? ILibWebClient_ReceiveStatus_Partial : ILibWebClient_ReceiveStatus_LastPartial, wr->user1, wr->user2, PAUSE);
+			state->WebSocketStreamRemaining = plen - available;
+			state->WebSocketStreamMaskOffset = available;
+			state->WebSocketStreamFIN = (char)FIN;
+			state->WebSocketStreamOPCODE = OPCODE;
+			if (maskingKey != NULL) { memcpy_s(state->WebSocketStreamMask, sizeof(state->WebSocketStreamMask), maskingKey, 4); }
+			else { memset(state->WebSocketStreamMask, 0, sizeof(state->WebSocketStreamMask)); }
+			FIN = 0;
 		}
-		else
+		if ((available > 0 || available == plen) && ILibWebClient_WebSocket_Deliver(wcdo, wr, state, buffer + i, available, FIN, OPCODE, PAUSE) != 0)
 		{
-			// We will try to automatically re-assemble fragments, up to the max buffer size the user specified
-			if (OPCODE != 0) { state->WebSocketDataFrameType = (int)OPCODE; } // Set the DataFrame Type, so the user can query it
-
-			if (FIN != 0 && state->WebSocketFragmentIndex == 0 && state->WebSocketCouldNotAutoReassemble == 0)
-			{
-				// We have an entire fragment, and we didn't save any of it yet... We can just forward it up without copying the buffer
-				tempBegin = 0;
-				wr->OnResponse(wcdo, 0, wcdo->header, buffer + i, &tempBegin, plen, ILibWebClient_ReceiveStatus_MoreDataToBeReceived, wr->user1, wr->user2, PAUSE);
-			}
-			else
-			{
-				if (state->WebSocketFragmentIndex + plen >= state->WebSocketFragmentBufferSize)
-				{
-					// Need to grow the buffer
-
-					if (state->WebSocketFragmentBufferSize == state->WebSocketFragmentMaxBufferSize)
-					{
-						// We are already maxed out, so just send what we have as an unfinished fragment	
-						state->WebSocketCouldNotAutoReassemble = 1; // Set this flag, becuase we can't reassemble, so our FIN flag will be different to reflect that					
-						tempBegin = 0;
-						wr->OnResponse(wcdo, 0, wcdo->header, state->WebSocketFragmentBuffer, &tempBegin, state->WebSocketFragmentIndex, ILibWebClient_ReceiveStatus_Partial, wr->user1, wr->user2, PAUSE);
-						state->WebSocketFragmentIndex = 0; // Reset the index, becuase new data is going to go to the front
-					}
-					else
-					{
-						// We can grow the buffer
-						state->WebSocketFragmentBufferSize = state->WebSocketFragmentBufferSize * 2;
-						if (state->WebSocketFragmentBufferSize > state->WebSocketFragmentMaxBufferSize) { state->WebSocketFragmentBufferSize = state->WebSocketFragmentMaxBufferSize; }
-						if ((state->WebSocketFragmentBuffer = (char*)realloc(state->WebSocketFragmentBuffer, state->WebSocketFragmentBufferSize)) == NULL) { ILIBCRITICALEXIT(254); } // MS Static Analyser erroneously reports that this leaks the original memory block
-					}
-				}
-
-				memcpy_s(state->WebSocketFragmentBuffer + state->WebSocketFragmentIndex, state->WebSocketFragmentBufferSize - state->WebSocketFragmentIndex, buffer + i, plen);
-				state->WebSocketFragmentIndex += plen;
-
-				if (FIN != 0)
-				{			
-					wr->OnResponse(wcdo, 0, wcdo->header, state->WebSocketFragmentBuffer, &tempBegin, state->WebSocketFragmentIndex, state->WebSocketCouldNotAutoReassemble == 0 ? ILibWebClient_ReceiveStatus_MoreDataToBeReceived : ILibWebClient_ReceiveStatus_LastPartial, wr->user1, wr->user2, PAUSE);	
-					state->WebSocketCouldNotAutoReassemble = 0; // Reset (We can try to auto-assemble)
-					state->WebSocketFragmentIndex = 0; // Reset (We can write to the start of the buffer)
-				}
-			}
+			ILibWebClient_Disconnect(wcdo);
+			return(length);
 		}
+		return(i + available);
 	}
 	else
 	{
@@ -1701,6 +2090,14 @@ ILibWebClient_DataResults ILibWebClient_OnData(ILibAsyncSocket_SocketModule sock
 							{
 								// WebSocket
 								char* skey = ILibGetHeaderLine(wcdo->header, "Sec-WebSocket-Accept", 20);
+								char* extensions = ILibGetHeaderLine(wcdo->header, "Sec-WebSocket-Extensions", 24);
+								int deflateFlags = 0, clientWindowBits, serverWindowBits;
+
+								if (extensions != NULL && (wr->requestToken->WebSocketDeflateFlags == 0 || 
+									ILibWebClient_WebSocket_Deflate_ParseExtensions(extensions, (int)strnlen_s(extensions, wcdo->HeaderLength), &deflateFlags, &clientWindowBits, &serverWindowBits) != 0))
+								{
+									skey = NULL; // Server accepted an extension that we did not offer
+								}
 								if (skey != NULL && strcmp(skey, wr->requestToken->WebSocketKey) == 0)
 								{
 									int zro = 0;
@@ -1712,6 +2109,11 @@ ILibWebClient_DataResults ILibWebClient_OnData(ILibAsyncSocket_SocketModule sock
 									// WebSocket Handshake Success! 
 									wcdo->IsWebSocket = 1;
 									ILibWebClient_WebSocket_GetState(wr); // If not done already, repurpose the buffer for WebSocket state
+									if (deflateFlags != 0)
+									{
+										// client_max_window_bits in the response limits the window we can compress with
+										((ILibWebClient_WebSocketState*)wr->Buffer[0])->deflater = ILibWebClient_WebSocket_Deflate_Create(0, deflateFlags, clientWindowBits);
+									}
 
 									if (wr->OnResponse != NULL) { wr->OnResponse(wcdo, 0, wcdo->header, NULL, &zro, 0, ILibWebClient_ReceiveStatus_Connection_Established, wr->user1, wr->user2, &(wcdo->PAUSE)); }
 									*p_beginPointer += hdrLen;
@@ -2619,6 +3021,8 @@ ILibWebClient_RequestToken ILibWebClient_PipelineRequest(
 		((ILibWebClient_PipelineRequestToken*)retVal)->WebSocketKey = tokenWebSocketKey;
 		((ILibWebClient_PipelineRequestToken*)retVal)->WebSocketMaxBuffer = u.i;
 		((ILibWebClient_PipelineRequestToken*)retVal)->WebSocketSendOK = ILibHTTPPacket_Stash_Get(packet, "_WebSocketOnSendOK", 18);
+		u.p = ILibHTTPPacket_Stash_Get(packet, "_WebSocketDeflate", 17);
+		((ILibWebClient_PipelineRequestToken*)retVal)->WebSocketDeflateFlags = u.i;
 
 		for (i = 0; i < wcm->MaxConnectionsToSameServer; ++i)
 		{
@@ -3425,19 +3829,19 @@ void ILibWebClient_Parse_ContentRange(char *contentRange, int *Start, int *End,
 		*TotalLength = -1;
 	}
 }
-/*! \fn int ILibWebClient_Parse_Range(char *Range, long *Start, long *Length, long TotalLength)
+/*! \fn int ILibWebClient_Parse_Range(char *Range, long long *Start, long long *Length, long long TotalLength)
 	\brief Parses the Range request header, to obtain the requested range
 	\param Range The Range header to parse. This can be obtained with a call to \a ILibGetHeaderLine
-	\param[out] Start Pointer to the long value where the Start byte position will be stored
-	\param[out] Length Pointer to the long value where the desired length will be stored.
+	\param[out] Start Pointer to the long long value where the Start byte position will be stored
+	\param[out] Length Pointer to the long long value where the desired length will be stored.
 	\param TotalLength The total length of available content.
 	\returns 0 = Success, 1 = Failure
 */
-enum ILibWebClient_Range_Result ILibWebClient_Parse_Range(char *Range, long *Start, long *Length, long TotalLength)
+enum ILibWebClient_Range_Result ILibWebClient_Parse_Range(char *Range, long long *Start, long long *Length, long long TotalLength)
 {
 	struct parser_result *pr,*pr2;
-	long x=-1;
-	long y=-1;
+	long long x=-1;
+	long long y=-1;
 	enum ILibWebClient_Range_Result RetVal = ILibWebClient_Range_Result_OK;
 
 	*Start = 0;
@@ -3456,7 +3860,7 @@ enum ILibWebClient_Range_Result ILibWebClient_Parse_Range(char *Range, long *Sta
 			else
 			{
 				pr2->FirstResult->data[pr2->FirstResult->datalength]=0;
-				x = atol(pr2->FirstResult->data);
+				x = atoll(pr2->FirstResult->data);
 			}
 			if (pr2->LastResult->datalength == 0)
 			{
@@ -3470,11 +3874,11 @@ enum ILibWebClient_Range_Result ILibWebClient_Parse_Range(char *Range, long *Sta
 				pr2->LastResult->data[pr2->LastResult->datalength] = 0;
 				if (x != -1)
 				{
-					y = 1 + atol(pr2->LastResult->data) - x;
+					y = 1 + atoll(pr2->LastResult->data) - x;
 				}
 				else
 				{
-					x = TotalLength - atol(pr2->LastResult->data);
+					x = TotalLength - atoll(pr2->LastResult->data);
 					y = TotalLength - x;
 				}
 			}
@@ -3782,9 +4186,14 @@ void ILibWebClient_GenerateAuthenticationHeader(ILibWebClient_StateObject state,
 	ILibAddHeaderLine(packet, "Authorization", 13, ILibScratchPad2, tmpLen);
 }
 void ILibWebClient_AddWebSocketRequestHeaders(ILibHTTPPacket *packet, int FragmentReassemblyMaxBufferSize, ILibWebClient_OnSendOK OnSendOK)
+{
+	ILibWebClient_AddWebSocketRequestHeadersEx(packet, FragmentReassemblyMaxBufferSize, OnSendOK, ILibWebClient_WebSocket_DeflateFlag_NONE);
+}
+void ILibWebClient_AddWebSocketRequestHeadersEx(ILibHTTPPacket *packet, int FragmentReassemblyMaxBufferSize, ILibWebClient_OnSendOK OnSendOK, int deflateFlags)
 {
 	char nonce[16];
 	char value[26];
+	char extensions[96];
 	int len;
 	union { int i; void* p; }u;
 	char *enc = value;
@@ -3796,10 +4205,23 @@ void ILibWebClient_AddWebSocketRequestHeaders(ILibHTTPPacket *packet, int Fragme
 	ILibAddHeaderLine(packet, "Connection", 10, "Upgrade", 7);
 	ILibAddHeaderLine(packet, "Sec-WebSocket-Key", 17, value, len);
 	ILibAddHeaderLine(packet, "Sec-WebSocket-Version", 21, "13", 2);
+	if ((deflateFlags & ILibWebClient_WebSocket_DeflateFlag_ENABLED) != 0)
+	{
+		len = sprintf_s(extensions, sizeof(extensions), "permessage-deflate; client_max_window_bits%s%s",
+			(deflateFlags & ILibWebClient_WebSocket_DeflateFlag_CLIENT_NO_CONTEXT_TAKEOVER) != 0 ? "; client_no_context_takeover" : "",
+			(deflateFlags & ILibWebClient_WebSocket_DeflateFlag_SERVER_NO_CONTEXT_TAKEOVER) != 0 ? "; server_no_context_takeover" : "");
+		ILibAddHeaderLine(packet, "Sec-WebSocket-Extensions", 24, extensions, len);
+	}
+	else
+	{
+		deflateFlags = ILibWebClient_WebSocket_DeflateFlag_NONE;
+	}
 
 	u.i = FragmentReassemblyMaxBufferSize;
 	ILibHTTPPacket_Stash_Put(packet, "_WebSocketBufferSize", 20, u.p);
 	ILibHTTPPacket_Stash_Put(packet, "_WebSocketOnSendOK", 18, OnSendOK);
+	u.p = NULL; u.i = deflateFlags;
+	ILibHTTPPacket_Stash_Put(packet, "_WebSocketDeflate", 17, u.p);
 }
 void ILibWebClient_RequestToken_ConnectionHandler_Set(ILibWebClient_RequestToken token, ILibWebClient_OnConnectHandler OnConnect, ILibWebClient_OnConnectHandler OnDisconnect)
 {
@@ -65,6 +65,19 @@ extern "C" {
 
 #define WEBSOCKET_MAX_OUTPUT_FRAMESIZE 4096
 
+/*! \def WEBSOCKET_DEFLATE_THRESHOLD
+	\brief Messages at or below this size are never compressed with permessage-deflate
+*/
+#define WEBSOCKET_DEFLATE_THRESHOLD		128
+/*! \def WEBSOCKET_DEFLATE_CHUNKSIZE
+	\brief Inflated permessage-deflate payloads are delivered in pieces of at most this size
+*/
+#define WEBSOCKET_DEFLATE_CHUNKSIZE		16384
+/*! \def WEBSOCKET_STREAMING_RECEIVE
+	\brief Pass as FragmentReassemblyMaxBufferSize, to have frame payloads passed up as they arrive, instead of waiting for the entire frame
+*/
+#define WEBSOCKET_STREAMING_RECEIVE		-1
+
 #define WEBSOCKET_OPCODE_FRAMECONT		0x0
 #define WEBSOCKET_OPCODE_TEXTFRAME		0x1
 #define WEBSOCKET_OPCODE_BINARYFRAME	0x2
@@ -256,7 +269,7 @@ void **ILibWebClient_RequestToken_GetUserObjects(ILibWebClient_RequestToken tok)
 void ILibWebClient_RequestToken_ConnectionHandler_Set(ILibWebClient_RequestToken tok, ILibWebClient_OnConnectHandler OnConnect, ILibWebClient_OnConnectHandler OnDisconnect);
 
 void ILibWebClient_Parse_ContentRange(char *contentRange, int *Start, int *End, int *TotalLength);
-enum ILibWebClient_Range_Result ILibWebClient_Parse_Range(char *Range, long *Start, long *Length, long TotalLength);
+enum ILibWebClient_Range_Result ILibWebClient_Parse_Range(char *Range, long long *Start, long long *Length, long long TotalLength);
 
 void ILibWebClient_SetMaxConcurrentSessionsToServer(ILibWebClient_RequestManager WebClient, int maxConnections);
 void ILibWebClient_SetUser(ILibWebClient_RequestManager manager, void *user);
@@ -298,9 +311,30 @@ typedef enum ILibWebClient_WebSocket_PingResponse
 }ILibWebClient_WebSocket_PingResponse;
 typedef ILibWebClient_WebSocket_PingResponse(*ILibWebClient_WebSocket_PingHandler)(ILibWebClient_StateObject state, void *user);
 typedef void(*ILibWebClient_WebSocket_PongHandler)(ILibWebClient_StateObject state, void *user);
+
+// permessage-deflate (RFC 7692)
+typedef enum ILibWebClient_WebSocket_DeflateFlags
+{
+	ILibWebClient_WebSocket_DeflateFlag_NONE						= 0x00,	/*!< Compression is not offered/accepted */
+	ILibWebClient_WebSocket_DeflateFlag_ENABLED						= 0x01,	/*!< Offer/Accept permessage-deflate */
+	ILibWebClient_WebSocket_DeflateFlag_CLIENT_NO_CONTEXT_TAKEOVER	= 0x02,	/*!< Client resets its compression context after every message */
+	ILibWebClient_WebSocket_DeflateFlag_SERVER_NO_CONTEXT_TAKEOVER	= 0x04	/*!< Server resets its compression context after every message */
+}ILibWebClient_WebSocket_DeflateFlags;
+typedef void* ILibWebClient_WebSocket_Deflater;
+
+int ILibWebClient_WebSocket_Deflate_ParseExtensions(char *extensions, int extensionsLen, int *flags, int *clientWindowBits, int *serverWindowBits);
+ILibWebClient_WebSocket_Deflater ILibWebClient_WebSocket_Deflate_Create(int isServer, int negotiatedFlags, int deflateWindowBits);
+void ILibWebClient_WebSocket_Deflate_Destroy(ILibWebClient_WebSocket_Deflater deflater);
+char* ILibWebClient_WebSocket_Deflate_Compress(ILibWebClient_WebSocket_Deflater deflater, char *buffer, int bufferLen, int *compressedLen);
+void ILibWebClient_WebSocket_Deflate_SetInput(ILibWebClient_WebSocket_Deflater deflater, char *buffer, int bufferLen, int fin);
+int ILibWebClient_WebSocket_Deflate_Inflate(ILibWebClient_WebSocket_Deflater deflater, char **chunk, int *chunkLen, int *last);
+
 void ILibWebClient_AddWebSocketRequestHeaders(ILibHTTPPacket *packet, int FragmentReassemblyMaxBufferSize, ILibWebClient_OnSendOK OnSendOK);
+void ILibWebClient_AddWebSocketRequestHeadersEx(ILibHTTPPacket *packet, int FragmentReassemblyMaxBufferSize, ILibWebClient_OnSendOK OnSendOK, int deflateFlags);
 ILibAsyncSocket_SendStatus ILibWebClient_WebSocket_Send(ILibWebClient_StateObject state, ILibWebClient_WebSocket_DataTypes bufferType, char* buffer, int bufferLen, ILibAsyncSocket_MemoryOwnership userFree, ILibWebClient_WebSocket_FragmentFlags bufferFragment);
 void ILibWebClient_WebSocket_SetPingPongHandler(ILibWebClient_StateObject state, ILibWebClient_WebSocket_PingHandler pingHandler, ILibWebClient_WebSocket_PongHandler pongHandler, void *user);
+// When streaming (WEBSOCKET_STREAMING_RECEIVE), returns the number of payload bytes of the current frame that have not been passed up yet. 0 means the last piece ended a frame
+int ILibWebClient_WebSocket_GetFrameRemaining(ILibWebClient_StateObject state);
 #define ILibWebClient_WebSocket_Ping(stateObject) ILibWebClient_WebSocket_Send((stateObject), (ILibWebClient_WebSocket_DataTypes)WEBSOCKET_OPCODE_PING, NULL, 0, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebClient_WebSocket_FragmentFlag_Complete)
 #define ILibWebClient_WebSocket_Pong(stateObject) ILibWebClient_WebSocket_Send((stateObject), (ILibWebClient_WebSocket_DataTypes)WEBSOCKET_OPCODE_PONG, NULL, 0, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebClient_WebSocket_FragmentFlag_Complete)
 
@@ -44,6 +44,44 @@ limitations under the License.
 	#define ILibWebRTC_LoggingServerPort 0
 #endif
 
+// Hardware CRC32C (SCTP checksum), selected at runtime. Define NO_HWCRC32C to always use the table driven version
+#if !defined(NO_HWCRC32C)
+	#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+		#define ILibSCTP_HWCRC32C_SSE42
+		#include <nmmintrin.h>
+		#define ILibSCTP_HWCRC32C_ATTR __attribute__((target("sse4.2")))
+	#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+		#define ILibSCTP_HWCRC32C_SSE42
+		#include <intrin.h>
+		#include <nmmintrin.h>
+		#define ILibSCTP_HWCRC32C_ATTR
+	#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+		#define ILibSCTP_HWCRC32C_ARMV8
+		#include <arm_acle.h>
+		#define ILibSCTP_HWCRC32C_ATTR
+	#elif defined(__aarch64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__)
+		#define ILibSCTP_HWCRC32C_ARMV8
+		#define ILibSCTP_HWCRC32C_ARMV8_ASM
+		#include <sys/auxv.h>
+		#include <asm/hwcap.h>
+		#define ILibSCTP_HWCRC32C_ATTR __attribute__((target("+crc")))
+	#endif
+#endif
+
+// DTLS cipher preference. AES-GCM is only preferred when the CPU can run it in hardware, otherwise ChaCha20-Poly1305 is faster
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	#define ILibStun_HWAES_X86
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+	#define ILibStun_HWAES_X86
+	#include <intrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+	#define ILibStun_HWAES_ARMV8
+	#include <sys/auxv.h>
+	#include <asm/hwcap.h>
+#endif
+#define ILibStun_DtlsCipherList_AES "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:HIGH:!aNULL:!MD5:!RC4"
+#define ILibStun_DtlsCipherList_ChaCha "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:HIGH:!aNULL:!MD5:!RC4"
+
 #define STUN_NUM_ADDR 5
 #define ILibStunClient_TIMEOUT 2
 #define ILibRUDP_WindowSize 32000
@@ -51,12 +89,20 @@ limitations under the License.
 #define ILibRUDP_StartMTU 1400
 #define ILibRUDP_MaxMTU 2048
 
+#define RTO_INITIAL 3000
 #define RTO_MIN 1000
 #define RTO_MAX 6000
 #define RTO_ALPHA 0.125
 #define RTO_BETA 0.25
 
-#define ILibSCTP_MaxReceiverCredits 100000
+#define ILibSCTP_MaxReceiverCredits 100000			// Initial receive window, this is what we advertise in INIT/INIT-ACK
+#define ILibSCTP_MaxReceiveWindow 1048576			// Upper bound for the dynamically sized receive window
+#define ILibSCTP_ReceiveWindowMinEpoch 100			// Minimum measurement interval (ms) used to size the receive window
+#define ILibSCTP_MaxCongestionWindow 4194304		// Upper bound for the congestion window
+#define ILibSCTP_InitialSSTHRESH ILibSCTP_MaxReceiverCredits
+#define ILibSCTP_PacingBurst (4 * ILibRUDP_StartMTU)	// Token bucket depth
+#define ILibSCTP_DelayCC_Alpha 2					// Delay-based CC: grow when fewer than this many packets are queued
+#define ILibSCTP_DelayCC_Beta 4						// Delay-based CC: shrink when more than this many packets are queued
 #define ILibSCTP_MaxSenderCredits 0				// When we do real-time traffic, reduce the buffering. In theory, this should never be used, leave to zero
 #define ILibSCTP_Stream_SparseArraySize 16		// Must be a power of 2
 #define ILibSCTP_Stream_MaximumCount 1024		// This is what Chrome/Firefox Support
@@ -65,6 +111,17 @@ limitations under the License.
 #define ILibSCTP_FastRetry_GAP 3
 
 #define ILibSCTP_UnorderedFlag 0x04
+#define ILibSCTP_InterleavedFlag 0x80			// Not on the wire. Marks chunk flags passed up from an I-DATA chunk (RFC 8260)
+
+#define ILibSCTP_PacketPool_SmallPayload 240	// DATA payload that fits in a small pooled packet buffer
+#define ILibSCTP_PacketPool_LargePayload 1232	// DATA payload that fits in a full MTU pooled packet buffer (Same as the fragment size)
+#define ILibSCTP_PacketPool_MaxFree 64			// Maximum number of idle buffers kept per size class, per session
+#define ILibSCTP_BundleMaxSize 1400				// Maximum size of an SCTP packet that outbound chunks are bundled into
+#define ILibSCTP_SchedulerQuantum 1232			// Bytes a stream may send per scheduler turn, for each unit of priority (Same as the fragment size)
+#define ILibSCTP_DelayedSackTimeout 200			// Milliseconds an in-sequence SACK may be delayed (RFC 4960, Section 6.2)
+#define ILibSCTP_DelayedSackPacketCount 2		// Number of packets with DATA after which a SACK is sent without delay
+#define ILibStun_DtlsCoalesceMax 1400			// Maximum size of a datagram that outbound DTLS records are coalesced into
+#define ILibStun_DtlsRecordOverhead 64			// Room reserved for the DTLS record header, explicit IV, MAC and padding
 
 //
 // NAT Keep Alive Interval. We'll use a random value between these two values
@@ -104,19 +161,15 @@ limitations under the License.
 #define ILibTURN_CHANNEL_BINDING_REFRESH_INTERVAL 480
 #define ILibTURN_PERMISSION_REFRESH_INTERVAL 210
 
-#define ReceiveHoldBuffer_Increment(list, value) {union{int i;void*p;}u; u.p = ILibLinkedList_GetTag(list); u.i += value; ILibLinkedList_SetTag(list, u.p);}
-#define ReceiveHoldBuffer_Decrement(list, value) {union{int i;void*p;}u; u.p = ILibLinkedList_GetTag(list); u.i -= value; ILibLinkedList_SetTag(list, u.p);}
+// Out of order DATA chunks are held in a ring indexed by TSN. Must be a power of 2, and bounds how far ahead of the user a chunk may be held
+#define ILibSCTP_ReorderBuffer_Capacity 4096
+#define ILibSCTP_ReorderBuffer_Slot(tsn) ((tsn) & (ILibSCTP_ReorderBuffer_Capacity - 1))
+// Receive window advertised per free slot of the ring, so the full window of average sized chunks always fits in the ring
+#define ILibSCTP_ReorderBuffer_SlotCredit (ILibSCTP_MaxReceiveWindow / ILibSCTP_ReorderBuffer_Capacity)
 #ifdef _REMOTELOGGING
 void ILibSctp_DebugSctpPacket(ILibRemoteLogging *logger, char *packet, int packetLen, char *note);
 #endif
 
-int ReceiveHoldBuffer_Used(ILibLinkedList list)
-{
-	union { int i; void *p; } u;
-	u.p = ILibLinkedList_GetTag(list);
-	return u.i;
-}
-
 static unsigned int ILibStun_CRC32_table[] = { /* CRC polynomial 0xedb88320 */
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
 	0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
@@ -271,9 +324,11 @@ typedef enum RCTP_CHUNK_TYPES
 	RCTP_CHUNK_TYPE_COOKIEECHO = 0x000A,
 	RCTP_CHUNK_TYPE_COOKIEACK = 0x000B,
 	RCTP_CHUNK_TYPE_ECNE = 0x000C,
+	RCTP_CHUNK_TYPE_IDATA = 0x0040,
 	RCTP_CHUNK_TYPE_RECONFIG = 0x0082,
 	RCTP_CHUNK_TYPE_FWDTSN = 0x00C0,
 	RCTP_CHUNK_TYPE_ASCONF = 0x00C1,
+	RCTP_CHUNK_TYPE_IFWDTSN = 0x00C2,
 	RCTP_CHUNK_TYPE_ASCONFACK = 0x0080
 } RCTP_CHUNK_TYPES;
 
@@ -443,6 +498,7 @@ typedef struct ILibSCTP_RPACKET
 	unsigned char PacketResendCounter;
 	unsigned char PacketGAPCounter;
 	unsigned short Reliability;
+	unsigned char PoolClass;
 	unsigned int CreationTimeStamp;
 	unsigned int LastSentTimeStamp;
 	char GAP[12];
@@ -460,6 +516,27 @@ typedef struct ILibSCTP_DataPayload
 	unsigned int ProtocolID;
 	char UserData[];
 }ILibSCTP_DataPayload;
+typedef struct ILibSCTP_IDataPayload
+{
+	unsigned char type;
+	unsigned char flags;
+	unsigned short length;
+	unsigned int TSN;
+	unsigned short StreamID;
+	unsigned short Reserved;
+	unsigned int MessageID;
+	unsigned int ProtocolID;	// Fragment Sequence Number, on all but the first fragment
+	char UserData[];
+}ILibSCTP_IDataPayload;
+typedef struct ILibSCTP_ReorderBuffer
+{
+	ILibSCTP_DataPayload **slots;			// Copy of the held DATA chunk for each TSN slot, or NULL
+	unsigned int *occupied;					// One bit per slot, so gap ack blocks can be found a word at a time
+	unsigned char *propagated;				// Non-zero if the chunk was already passed up to the user (Unordered Delivery)
+	int count;
+	int bytes;
+	unsigned int highTSN;					// Highest TSN held, only meaningful when count > 0
+}ILibSCTP_ReorderBuffer;
 typedef struct ILibSCTP_FwdTSNPayload_Stream
 {
 	unsigned int StreamNumber;
@@ -473,6 +550,20 @@ typedef struct ILibSCTP_FwdTSNPayload
 	unsigned int NewTSN;
 	ILibSCTP_FwdTSNPayload_Stream SkippedStreams[];
 }ILibSCTP_FwdTSNPayload;
+typedef struct ILibSCTP_IFwdTSNPayload_Stream
+{
+	unsigned short StreamNumber;
+	unsigned short Flags;		// Lowest bit is the U bit
+	unsigned int MessageID;
+}ILibSCTP_IFwdTSNPayload_Stream;
+typedef struct ILibSCTP_IFwdTSNPayload
+{
+	unsigned char type;
+	unsigned char flags;
+	unsigned short length;
+	unsigned int NewTSN;
+	ILibSCTP_IFwdTSNPayload_Stream SkippedStreams[];
+}ILibSCTP_IFwdTSNPayload;
 typedef union ILibSCTP_PendingTSN_Data
 {
 	struct 
@@ -504,8 +595,24 @@ typedef struct ILibSCTP_Accumulator
 	char *buffer;
 	int bufferPtr;
 	int bufferLen;
+	int pid;
+	unsigned int messageId;
+	unsigned char unordered;
+	struct ILibSCTP_Accumulator *next;	// I-DATA can interleave several messages on one stream, each is reassembled separately
 }ILibSCTP_Accumulator;
 
+// Outbound state of a stream, when User Message Interleaving (I-DATA) is in use
+typedef struct ILibSCTP_OutStream
+{
+	struct ILibSCTP_OutStream *next;	// Next stream in the scheduler ring
+	struct ILibSCTP_RPACKET *head;		// Fragments waiting for the scheduler. They are assigned a TSN when they leave
+	struct ILibSCTP_RPACKET *tail;
+	unsigned int nextMID;
+	int deficit;
+	unsigned char priority;
+	unsigned char scheduled;
+}ILibSCTP_OutStream;
+
 ILibSCTP_Accumulator* ILibSCTP_CreateAccumulator()
 {
 	ILibSCTP_Accumulator* retVal = (ILibSCTP_Accumulator*)malloc(sizeof(ILibSCTP_Accumulator));
@@ -726,6 +833,7 @@ typedef struct ILibStun_dTlsSession
 	ILibSparseArray DataChannelMetaDetaValues;
 	ILibSparseArray PeerFeatureSet;
 	ILibSparseArray DataAccumulator;
+	ILibSparseArray OutStreams;
 
 	unsigned short maxInStreams;
 	unsigned short maxOutStreams;
@@ -752,7 +860,12 @@ typedef struct ILibStun_dTlsSession
 	char* holdingQueueHead;
 	char* holdingQueueTail;
 
-	ILibLinkedList receiveHoldBuffer;
+	unsigned char interleaving;					// Non-zero when the peer supports User Message Interleaving (I-DATA)
+	ILibSCTP_StreamScheduler streamScheduler;
+	ILibSCTP_OutStream *schedCurrent;			// Stream whose turn it is to send. Held fragments are counted in holdingCount
+	ILibSCTP_OutStream *schedPrev;				// Stream before schedCurrent in the scheduler ring
+
+	ILibSCTP_ReorderBuffer receiveHold;
 	BIO *writeBIO;
 	BUF_MEM *writeBIOBuffer;
 
@@ -760,6 +873,16 @@ typedef struct ILibStun_dTlsSession
 	int rpacketptr;
 	int rpacketsize;
 
+	int outBundle;								// Non-zero when rpacket holds outbound chunks waiting to be flushed
+	unsigned char sackPacketCount;				// Packets with in-sequence DATA received since the last SACK was sent
+	unsigned char sackDelayed;					// Non-zero when the delayed SACK timer is running
+	unsigned char dtlsCoalesced;				// Non-zero when writeBIO holds DTLS records waiting to be sent as one datagram
+
+	struct ILibSCTP_RPACKET* packetPool[2];		// Idle DATA packet buffers, [0] = Small, [1] = Large
+	int packetPoolCount[2];
+	unsigned long long packetPoolHits;
+	unsigned long long packetPoolMisses;
+
 	long freshnessTimestampStart;
 	void* User2;
 	int User3;
@@ -790,8 +913,29 @@ typedef struct ILibStun_dTlsSession
 	int RTTVAR;
 	int RTO;
 	unsigned int T3RTXTIME;
+
+	const struct ILibSCTP_CongestionControlOps *congestionControl;
+	int baseRTT;								// Lowest RTT sample seen on this association (Delay-based CC)
+	int lastRTT;								// Most recent RTT sample (Delay-based CC)
+
+	int pacingEnabled;
+	int pacingTimerArmed;
+	long long pacingTokens;
+	unsigned int pacingLastRefill;
+
+	int receiveWindow;							// Current receive window, grows up to ILibSCTP_MaxReceiveWindow
+	int receiveWindowBytes;						// Bytes received during the current measurement interval
+	unsigned int receiveWindowEpoch;			// Start of the current measurement interval
 }ILibStun_dTlsSession;
 
+typedef struct ILibSCTP_CongestionControlOps
+{
+	void(*OnRTTSample)(struct ILibStun_dTlsSession *o, int rtt);
+	void(*OnAck)(struct ILibStun_dTlsSession *o, int bytesAcked, int bytesInFlight);
+	void(*OnFastRetransmit)(struct ILibStun_dTlsSession *o);
+	void(*OnTimeout)(struct ILibStun_dTlsSession *o);
+}ILibSCTP_CongestionControlOps;
+
 typedef struct ILibStun_Module
 {
 	ILibChain_Link ChainLink;
@@ -853,13 +997,34 @@ typedef struct ILibStun_Module
 
 	int consentFreshnessDisabled;
 
+	ILibSCTP_CongestionControl defaultCongestionControl;
+	int defaultPacing;
+
+	int bundlePending;							// Non-zero when at least one session has an outbound bundle to flush
+	int bundlePreSelectDone;					// Non-zero between our PreSelect and PostSelect, when the chain may be blocked in select
+	int dtlsCoalescePending;					// Non-zero when at least one session has coalesced DTLS records to send
+
 #ifdef _WEBRTCDEBUG
 	int lossPercentage;
 	int inboundDropPackets;
 	int outboundDropPackets;
+	int inboundDelayMilliseconds;
+	int inboundDelayReinjecting;
 #endif
 }ILibStun_Module;
 
+#ifdef _WEBRTCDEBUG
+// Inbound SCTP packet held back by ILibSCTP_SetSimulatedInboundDelay()
+typedef struct ILibStun_DelayedSctpPacket
+{
+	struct ILibStun_Module *obj;
+	struct ILibStun_dTlsSession *dtlsSession;
+	int session;
+	int bufferLength;
+	char buffer[];
+}ILibStun_DelayedSctpPacket;
+#endif
+
 unsigned int ILibStun_CRC32(char *buf, int len)
 {
 	unsigned int c = 0xFFFFFFFF;
@@ -871,6 +1036,10 @@ unsigned int ILibStun_CRC32(char *buf, int len)
 #define ILibWebRTC_DTLS_FROM_TIMER_OBJECT(d) ((struct ILibStun_dTlsSession*)((char*)d-16))
 #define ILibWebRTC_DTLS_TO_CONSENT_FRESHNESS_TIMER_OBJECT(d) ((char*)d+1)
 #define ILibWebRTC_DTLS_FROM_CONSENT_FRESHNESS_TIMER_OBJECT(d) ((ILibStun_dTlsSession*)((char*)d-1))
+#define ILibWebRTC_DTLS_TO_DELAYED_SACK_TIMER_OBJECT(d) ((char*)d+2)
+#define ILibWebRTC_DTLS_FROM_DELAYED_SACK_TIMER_OBJECT(d) ((ILibStun_dTlsSession*)((char*)d-2))
+#define ILibWebRTC_DTLS_TO_PACING_TIMER_OBJECT(d) ((char*)d+3)
+#define ILibWebRTC_DTLS_FROM_PACING_TIMER_OBJECT(d) ((ILibStun_dTlsSession*)((char*)d-3))
 #define ILibWebRTC_DTLS_TO_SCTP_HEARTBEAT_TIMER_OBJECT(d) d
 #define ILibWebRTC_DTLS_FROM_SCTP_HEARTBEAT_TIMER_OBJECT(d) ((ILibStun_dTlsSession*)d)
 #define ILibWebRTC_STUN_TO_CONNECTIVITY_CHECK_TIMER(s) ((char*)s+1)
@@ -889,6 +1058,7 @@ ILibTransport_DoneState ILibStun_SendSctpPacket(struct ILibStun_Module *obj, int
 void ILibStun_OnTimeout(void *object);
 void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char* buffer, int bufferLength);
 void ILibStun_SctpDisconnect(struct ILibStun_Module *obj, int session);
+void ILibSCTP_ReorderChunks(struct ILibStun_Module *obj, int sessionID, char *buffer, int bufferLen);
 void ILibStun_SendIceRequest(struct ILibStun_IceState *IceState, int SlotNumber, int useCandidate, struct sockaddr_in6* remoteInterface);
 void ILibStun_SendIceRequestEx(struct ILibStun_IceState *IceState, char* TransactionID, int useCandidate, struct sockaddr_in6* remoteInterface);
 void ILibStun_ICE_Start(struct ILibStun_IceState *state, int SelectedSlot);
@@ -931,13 +1101,6 @@ typedef enum ILibWebRTC_DTLS_HandshakeTypes_Def
 	ILibWebRTC_DTLSHandshakeType_finished = 20
 }ILibWebRTC_DTLS_HandshakeTypes;
 
-typedef struct ILibSCTP_HoldingQueueFlags
-{
-	char DataPropagated : 1;
-}ILibSCTP_HoldingQueueFlags;
-
-#define ILibSCTP_GetHoldingQueueFlags(node) ((ILibSCTP_HoldingQueueFlags*)ILibLinkedList_GetExtendedMemory(node))
-
 void* ILibWebRTC_Dtls2SSL(void *dtls)
 {
 	return((void*)((ILibStun_dTlsSession*)dtls)->ssl);
@@ -1028,10 +1191,32 @@ void ILibWebRTC_DestroySparseArrayTables_Accumulator(ILibSparseArray sender, int
 	UNREFERENCED_PARAMETER(index);
 	UNREFERENCED_PARAMETER(user);
 
-	if(acc != NULL)
+	while (acc != NULL)
 	{
+		ILibSCTP_Accumulator *next = acc->next;
 		free(acc->buffer);
 		free(acc);
+		acc = next;
+	}
+}
+void ILibWebRTC_DestroySparseArrayTables_OutStream(ILibSparseArray sender, int index, void *value, void *user)
+{
+	ILibSCTP_OutStream *s = (ILibSCTP_OutStream*)value;
+	ILibSCTP_RPACKET *next;
+
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(index);
+	UNREFERENCED_PARAMETER(user);
+
+	if (s != NULL)
+	{
+		while (s->head != NULL)
+		{
+			next = s->head->NextPacket;
+			free(s->head);
+			s->head = next;
+		}
+		free(s);
 	}
 }
 void ILibWebRTC_DestroySparseArrayTables(struct ILibStun_dTlsSession *obj)
@@ -1040,6 +1225,8 @@ void ILibWebRTC_DestroySparseArrayTables(struct ILibStun_dTlsSession *obj)
 	ILibSparseArray_Destroy(obj->PeerFeatureSet);
 	ILibSparseArray_Destroy(obj->DataChannelMetaDetaValues);
 	ILibSparseArray_DestroyEx(obj->DataAccumulator, &ILibWebRTC_DestroySparseArrayTables_Accumulator, NULL);
+	ILibSparseArray_DestroyEx(obj->OutStreams, &ILibWebRTC_DestroySparseArrayTables_OutStream, NULL);
+	obj->schedCurrent = obj->schedPrev = NULL;
 }
 void ILibWebRTC_CreateSparseArrayTables(struct ILibStun_dTlsSession *obj)
 {
@@ -1047,6 +1234,7 @@ void ILibWebRTC_CreateSparseArrayTables(struct ILibStun_dTlsSession *obj)
 	obj->PeerFeatureSet = ILibSparseArray_Create(ILibSCTP_Stream_SparseArraySize, &ILibWebRTC_DataChannelBucketizer);
 	obj->DataChannelMetaDetaValues = ILibSparseArray_Create(ILibSCTP_Stream_SparseArraySize, &ILibWebRTC_DataChannelBucketizer);
 	obj->DataAccumulator = ILibSparseArray_Create(ILibSCTP_Stream_SparseArraySize, &ILibWebRTC_DataChannelBucketizer);
+	obj->OutStreams = ILibSparseArray_Create(ILibSCTP_Stream_SparseArraySize, &ILibWebRTC_DataChannelBucketizer);
 }
 
 char* SCTP_ERROR_CAUSE_TO_STRING(ILibSCTP_ErrorCause_Header *cause)
@@ -1354,6 +1542,20 @@ int ILibSCTP_GetPendingBytesToSend(void* sctpSession)
 	if (r < 0) return 0 - r;
 	return 0;
 }
+//! Fetch the hit/miss counters of the outbound SCTP packet buffer pool
+/*!
+	\param sctpSession SCTP Session object
+	\param[out] hits Number of DATA chunks that reused a pooled buffer (Can be NULL)
+	\param[out] misses Number of DATA chunks that required a new allocation (Can be NULL)
+*/
+void ILibSCTP_GetPacketPoolStats(void* sctpSession, unsigned long long *hits, unsigned long long *misses)
+{
+	struct ILibStun_dTlsSession *o = (struct ILibStun_dTlsSession*)sctpSession;
+	ILibSpinLock_Lock(&(o->Lock));
+	if (hits != NULL) { *hits = o->packetPoolHits; }
+	if (misses != NULL) { *misses = o->packetPoolMisses; }
+	ILibSpinLock_UnLock(&(o->Lock));
+}
 //! Set SCTP Callback handlers
 /*!
 	\param StunModule Local Stun/ICE Client
@@ -3074,18 +3276,12 @@ void ILibORTC_AddRemoteCandidate(void *stunModule, char* localUsername, struct s
 	ILibStun_ProcessCandidates(stunModule, slot);
 }
 
-ILibTransport_DoneState ILibStun_SendDtls(struct ILibStun_Module *obj, int session, char* buffer, int bufferLength)
+// Sends the DTLS records in the session's write BIO as one datagram
+ILibTransport_DoneState ILibStun_SendDtlsBuffer(struct ILibStun_Module *obj, int session)
 {
 	ILibTransport_DoneState r = ILibTransport_DoneState_ERROR;
-	if (obj == NULL || session < 0 || session > (ILibSTUN_MaxSlots-1) || obj->dTlsSessions[session] == NULL || SSL_get_state(obj->dTlsSessions[session]->ssl) != TLS_ST_OK) return ILibTransport_DoneState_ERROR;
-
-#ifdef _WEBRTCDEBUG
-	// Simulated Inbound Packet Loss
-	if ((obj->lossPercentage) > 0 && ((rand() % 100) >= (100 - obj->lossPercentage))) { return(ILibTransport_DoneState_COMPLETE); }
-#endif
-
-	SSL_write(obj->dTlsSessions[session]->ssl, buffer, bufferLength);
 
+	obj->dTlsSessions[session]->dtlsCoalesced = 0;
 	if(obj->dTlsSessions[session]->writeBIOBuffer->length > 0)
 	{
 		BIO_clear_retry_flags(obj->dTlsSessions[session]->writeBIO); // Klocwork reports this could block, but this is a memory bio, so it will never block.
@@ -3131,6 +3327,61 @@ ILibTransport_DoneState ILibStun_SendDtls(struct ILibStun_Module *obj, int sessi
 	return r;
 }
 
+ILibTransport_DoneState ILibStun_SendDtls(struct ILibStun_Module *obj, int session, char* buffer, int bufferLength)
+{
+	struct ILibStun_dTlsSession *o;
+	int coalesce;
+	if (obj == NULL || session < 0 || session > (ILibSTUN_MaxSlots-1) || obj->dTlsSessions[session] == NULL || SSL_get_state(obj->dTlsSessions[session]->ssl) != TLS_ST_OK) return ILibTransport_DoneState_ERROR;
+	o = obj->dTlsSessions[session];
+
+#ifdef _WEBRTCDEBUG
+	// Simulated Inbound Packet Loss
+	if ((obj->lossPercentage) > 0 && ((rand() % 100) >= (100 - obj->lossPercentage))) { return(ILibTransport_DoneState_COMPLETE); }
+#endif
+
+	// Records written on the chain thread are coalesced into datagrams, and sent by ILibStun_PostSelect()/ILibStun_PreSelect().
+	// Once PreSelect has run the chain may block in select, so records are sent right away, as they are for TURN and other threads.
+	coalesce = obj->IceStates[o->iceStateSlot]->useTurn == 0 && obj->bundlePreSelectDone == 0 && ILibIsRunningOnChainThread(obj->ChainLink.ParentChain);
+	if (o->dtlsCoalesced != 0 && (coalesce == 0 || o->writeBIOBuffer->length + bufferLength + ILibStun_DtlsRecordOverhead > ILibStun_DtlsCoalesceMax))
+	{
+		// Send the records that are already waiting first, so they stay in order
+		ILibStun_SendDtlsBuffer(obj, session);
+	}
+
+	SSL_write(o->ssl, buffer, bufferLength);
+
+	if (coalesce != 0 && o->writeBIOBuffer->length > 0)
+	{
+		if (o->dtlsCoalesced == 0) { o->dtlsCoalesced = 1; obj->dtlsCoalescePending = 1; }
+		return(ILibTransport_DoneState_COMPLETE);
+	}
+	return(ILibStun_SendDtlsBuffer(obj, session));
+}
+void ILibStun_SendDtlsCoalesced(struct ILibStun_Module *obj)
+{
+	int i;
+	if (obj->dtlsCoalescePending == 0) { return; }
+	obj->dtlsCoalescePending = 0;
+
+	for (i = 0; i < ILibSTUN_MaxSlots; ++i)
+	{
+		if (obj->dTlsSessions[i] != NULL && obj->dTlsSessions[i]->state != 0 && obj->dTlsSessions[i]->dtlsCoalesced != 0)
+		{
+			ILibSpinLock_Lock(&(obj->dTlsSessions[i]->Lock));
+			ILibStun_SendDtlsBuffer(obj, i);
+			ILibSpinLock_UnLock(&(obj->dTlsSessions[i]->Lock));
+		}
+	}
+}
+// Reserves the write BIO's buffer up front, so coalescing records does not grow it on the data path
+void ILibStun_ReserveDtlsBuffer(BIO *write)
+{
+	char reserve[ILibRUDP_MaxMTU];
+	memset(reserve, 0, sizeof(reserve));
+	BIO_write(write, reserve, (int)sizeof(reserve));
+	ignore_result(BIO_reset(write));
+}
+
 // This method assumes the buffer has 12 byte available for the header.
 ILibTransport_DoneState ILibStun_SendSctpPacket(struct ILibStun_Module *obj, int session, char* buffer, int bufferLength)
 {
@@ -3193,7 +3444,7 @@ int ILibStun_AddSctpChunkHeader(char* buffer, int ptr, unsigned char chunktype,
 	if (ptr >= 12 && ((int*)buffer)[0] == 0 && ((int*)buffer)[1] == 0)
 	{
 		// This buffer contains a common buffer area, that has control flags
-		if (chunktype == RCTP_CHUNK_TYPE_DATA)
+		if (chunktype == RCTP_CHUNK_TYPE_DATA || chunktype == RCTP_CHUNK_TYPE_IDATA)
 		{ 
 			// Data Chunk
 			((int*)buffer)[2] |= SCTP_COMMON_HEADER_FLAGS_DATA;
@@ -3224,85 +3475,718 @@ int ILibStun_AddSctpChunkArg(char* buffer, int ptr, unsigned short otype, char*
 	return ptr + 4 + datalen;
 }
 
-int ILibStun_SctpAddSackChunk(struct ILibStun_Module *obj, int session, char* packet, int ptr)
+// Returns the held DATA chunk with the given TSN, or NULL if it was not received out of order
+ILibSCTP_DataPayload* ILibSCTP_ReorderBuffer_Get(ILibSCTP_ReorderBuffer *rb, unsigned int tsn)
+{
+	ILibSCTP_DataPayload *p;
+	if (rb->count == 0) { return(NULL); }
+
+	p = rb->slots[ILibSCTP_ReorderBuffer_Slot(tsn)];
+	return((p != NULL && ntohl(p->TSN) == tsn) ? p : NULL);
+}
+// Stores a copy of a DATA chunk. baseTSN is the lowest TSN that can be held, so the chunk must fall within ILibSCTP_ReorderBuffer_Capacity of it.
+// Returns the held copy (the existing one for a duplicate), or NULL if it does not fit
+ILibSCTP_DataPayload* ILibSCTP_ReorderBuffer_Add(ILibSCTP_ReorderBuffer *rb, unsigned int baseTSN, ILibSCTP_DataPayload *payload)
+{
+	unsigned int tsn = ntohl(payload->TSN);
+	unsigned int slot = ILibSCTP_ReorderBuffer_Slot(tsn);
+	unsigned short len = ntohs(payload->length);
+	ILibSCTP_DataPayload *retVal;
+
+	if (tsn - baseTSN >= ILibSCTP_ReorderBuffer_Capacity) { return(NULL); }
+	if (rb->slots == NULL)
+	{
+		size_t slotsLen = ILibSCTP_ReorderBuffer_Capacity * sizeof(ILibSCTP_DataPayload*);
+		size_t occupiedLen = (ILibSCTP_ReorderBuffer_Capacity / 32) * sizeof(unsigned int);
+		char *mem = (char*)malloc(slotsLen + occupiedLen + ILibSCTP_ReorderBuffer_Capacity);
+		if (mem == NULL) ILIBCRITICALEXIT(254);
+		memset(mem, 0, slotsLen + occupiedLen + ILibSCTP_ReorderBuffer_Capacity);
+
+		rb->slots = (ILibSCTP_DataPayload**)mem;
+		rb->occupied = (unsigned int*)(mem + slotsLen);
+		rb->propagated = (unsigned char*)(mem + slotsLen + occupiedLen);
+	}
+	if ((retVal = rb->slots[slot]) != NULL) { return(retVal); } // Every held TSN is within Capacity of baseTSN, so an occupied slot is this TSN
+
+	if ((retVal = (ILibSCTP_DataPayload*)malloc(len)) == NULL) ILIBCRITICALEXIT(254);
+	memcpy_s(retVal, len, payload, len);
+	rb->slots[slot] = retVal;
+	rb->occupied[slot >> 5] |= (1U << (slot & 31));
+	rb->propagated[slot] = 0;
+	if (rb->count == 0 || (int)(tsn - rb->highTSN) > 0) { rb->highTSN = tsn; }
+	++rb->count;
+	rb->bytes += len;
+	return(retVal);
+}
+void ILibSCTP_ReorderBuffer_Remove(ILibSCTP_ReorderBuffer *rb, unsigned int tsn)
+{
+	unsigned int slot = ILibSCTP_ReorderBuffer_Slot(tsn);
+	ILibSCTP_DataPayload *p = ILibSCTP_ReorderBuffer_Get(rb, tsn);
+	if (p == NULL) { return; }
+
+	--rb->count;
+	rb->bytes -= ntohs(p->length);
+	rb->slots[slot] = NULL;
+	rb->occupied[slot >> 5] &= ~(1U << (slot & 31));
+	free(p);
+}
+// Returns the first TSN in [fromTSN, toTSN] that is held (held != 0) or missing (held == 0), or toTSN + 1 if there is none
+unsigned int ILibSCTP_ReorderBuffer_Scan(ILibSCTP_ReorderBuffer *rb, unsigned int fromTSN, unsigned int toTSN, int held)
+{
+	unsigned int tsn = fromTSN;
+	unsigned int slot, word;
+
+	while ((int)(toTSN - tsn) >= 0)
+	{
+		slot = ILibSCTP_ReorderBuffer_Slot(tsn);
+		word = rb->occupied[slot >> 5];
+		if (held == 0) { word = ~word; }
+		word >>= (slot & 31);
+		if (word == 0)
+		{
+			tsn += 32 - (slot & 31); // Nothing left in this word
+		}
+		else
+		{
+			while ((word & 1) == 0) { word >>= 1; ++tsn; }
+			break;
+		}
+	}
+	return((int)(toTSN - tsn) >= 0 ? tsn : toTSN + 1);
+}
+void ILibSCTP_ReorderBuffer_Destroy(ILibSCTP_ReorderBuffer *rb)
+{
+	int i;
+	if (rb->slots != NULL)
+	{
+		for (i = 0; i < ILibSCTP_ReorderBuffer_Capacity; ++i)
+		{
+			if (rb->slots[i] != NULL) { free(rb->slots[i]); }
+		}
+		free(rb->slots);
+	}
+	memset(rb, 0, sizeof(ILibSCTP_ReorderBuffer));
+}
+
+int ILibStun_SctpAddSackChunk(struct ILibStun_Module *obj, int session, char* packet, int ptr)
+{
+	int clen = 16;
+	unsigned int tsn = obj->dTlsSessions[session]->intsn;
+	unsigned int bytecount = 0;
+	unsigned int rwnd, freeSlots;
+	ILibSCTP_ReorderBuffer *rb = &(obj->dTlsSessions[session]->receiveHold);
+	unsigned int gstart, gend;
+
+	if (rb->count > 0)
+	{
+		// Compute all selective ACK's. Held chunks at or below the cumulative TSN are only waiting on the user (PAUSE), so they are not gaps.
+		gstart = ILibSCTP_ReorderBuffer_Scan(rb, tsn + 1, rb->highTSN, 1);
+		while ((int)(rb->highTSN - gstart) >= 0 && clen < 500) // Cap the number of encoded gaps.
+		{
+			gend = ILibSCTP_ReorderBuffer_Scan(rb, gstart, rb->highTSN, 0) - 1;
+
+			((unsigned short*)(packet + ptr + clen))[0] = htons((unsigned short)(gstart - tsn));			// Start	
+			((unsigned short*)(packet + ptr + clen))[1] = htons((unsigned short)(gend - tsn));				// End
+			RCTPRCVDEBUG(printf("SACK %u + %u to %u\r\n", tsn, gstart, gend);)
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d SENT [SACK] %u + %u to %u", session, tsn, gstart, gend);
+			clen += 4;
+
+			gstart = ILibSCTP_ReorderBuffer_Scan(rb, gend + 1, rb->highTSN, 1);
+		}
+		bytecount = (unsigned int)rb->bytes;
+	}
+
+	// Create response
+	if (bytecount > (unsigned int)obj->dTlsSessions[session]->receiveWindow) bytecount = obj->dTlsSessions[session]->receiveWindow;
+	rwnd = obj->dTlsSessions[session]->receiveWindow - bytecount;
+
+	// The ring only holds TSNs up to userTSN + ILibSCTP_ReorderBuffer_Capacity, so don't offer the peer more than the free slots can take
+	freeSlots = tsn - obj->dTlsSessions[session]->userTSN < ILibSCTP_ReorderBuffer_Capacity ? ILibSCTP_ReorderBuffer_Capacity - (tsn - obj->dTlsSessions[session]->userTSN) : 0;
+	if (rwnd > freeSlots * ILibSCTP_ReorderBuffer_SlotCredit) { rwnd = freeSlots * ILibSCTP_ReorderBuffer_SlotCredit; }
+
+	ILibStun_AddSctpChunkHeader(packet, ptr, RCTP_CHUNK_TYPE_SACK, 0, (unsigned short)clen);
+	((unsigned int*)(packet + ptr + 4))[0] = htonl(obj->dTlsSessions[session]->intsn);		// Cumulative TSN Ack
+	((unsigned int*)(packet + ptr + 8))[0] = htonl(rwnd);									// Advertised Receiver Window Credit (a_rwnd) 
+	((unsigned short*)(packet + ptr + 12))[0] = htons(((unsigned short)clen - 16) / 4);		// Number of Gap Ack Blocks
+	((unsigned short*)(packet + ptr + 14))[0] = htons(0);									// Number of Duplicate TSNs
+
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d SENT [SACK] a_rwnd: %u Cumalative TSN: %u", session, rwnd, obj->dTlsSessions[session]->intsn);
+
+	return (ptr + clen);
+}
+
+// Fetch a DATA packet buffer from the session's pool, or allocate one if the pool is empty. Caller must hold the session lock.
+ILibSCTP_RPACKET* ILibSCTP_PacketPool_Get(struct ILibStun_dTlsSession *o, int datalen)
+{
+	ILibSCTP_RPACKET *rpacket;
+	int poolClass = datalen <= ILibSCTP_PacketPool_SmallPayload ? 1 : (datalen <= ILibSCTP_PacketPool_LargePayload ? 2 : 0);
+	size_t newlen;
+
+	if (poolClass != 0 && (rpacket = o->packetPool[poolClass - 1]) != NULL)
+	{
+		o->packetPool[poolClass - 1] = rpacket->NextPacket;
+		o->packetPoolCount[poolClass - 1]--;
+		o->packetPoolHits++;
+	}
+	else
+	{
+		// Pooled buffers are always sized for the largest payload of their class, so they can be reused by any chunk of that class
+		newlen = sizeof(ILibSCTP_RPACKET) + sizeof(ILibSCTP_IDataPayload) + (poolClass == 1 ? ILibSCTP_PacketPool_SmallPayload : (poolClass == 2 ? ILibSCTP_PacketPool_LargePayload : datalen));
+		newlen = FOURBYTEBOUNDARY(newlen);
+		if ((rpacket = (ILibSCTP_RPACKET*)malloc(newlen)) == NULL) ILIBCRITICALERREXIT(254);
+		if (poolClass != 0) { o->packetPoolMisses++; }
+	}
+	rpacket->PoolClass = (unsigned char)poolClass;
+	return(rpacket);
+}
+// Return a DATA packet buffer to the session's pool, or free it if the pool for its class is full. Caller must hold the session lock.
+void ILibSCTP_PacketPool_Put(struct ILibStun_dTlsSession *o, ILibSCTP_RPACKET *rpacket)
+{
+	int poolClass = rpacket->PoolClass;
+	if (poolClass == 0 || o->packetPoolCount[poolClass - 1] >= ILibSCTP_PacketPool_MaxFree)
+	{
+		free(rpacket);
+		return;
+	}
+	rpacket->NextPacket = o->packetPool[poolClass - 1];
+	o->packetPool[poolClass - 1] = rpacket;
+	o->packetPoolCount[poolClass - 1]++;
+}
+void ILibSCTP_PacketPool_Drain(struct ILibStun_dTlsSession *o)
+{
+	ILibSCTP_RPACKET *rpacket;
+	int i;
+	for (i = 0; i < 2; ++i)
+	{
+		while ((rpacket = o->packetPool[i]) != NULL)
+		{
+			o->packetPool[i] = rpacket->NextPacket;
+			free(rpacket);
+		}
+		o->packetPoolCount[i] = 0;
+	}
+}
+
+// Called whenever a SACK chunk went out, to reset the delayed SACK state. Caller must hold the session lock.
+void ILibStun_SctpSackSent(struct ILibStun_dTlsSession *o)
+{
+	o->sackPacketCount = 0;
+	if (o->sackDelayed != 0)
+	{
+		o->sackDelayed = 0;
+		ILibLifeTime_Remove(o->parent->Timer, ILibWebRTC_DTLS_TO_DELAYED_SACK_TIMER_OBJECT(o));
+	}
+}
+// Send a packet containing only a SACK chunk. Caller must hold the session lock, and rpacket must not be in use.
+void ILibStun_SctpSendSack(struct ILibStun_Module *obj, int session)
+{
+	struct ILibStun_dTlsSession *o = obj->dTlsSessions[session];
+	int ptr;
+
+	((int*)o->rpacket)[0] = ((int*)o->rpacket)[1] = ((int*)o->rpacket)[2] = 0;
+	ptr = ILibStun_SctpAddSackChunk(obj, session, o->rpacket, 12);
+	ILibStun_SendSctpPacket(obj, session, o->rpacket, ptr);
+}
+// Start collecting outbound chunks in rpacket, so they can be sent together in a single SCTP packet. Caller must hold the session lock.
+void ILibStun_SctpStartBundle(struct ILibStun_Module *obj, int session)
+{
+	struct ILibStun_dTlsSession *o = obj->dTlsSessions[session];
+
+	((int*)o->rpacket)[0] = ((int*)o->rpacket)[1] = ((int*)o->rpacket)[2] = 0;	// Common header area holds the control/data flags until the packet is sent
+	o->rpacketptr = 12;
+	o->outBundle = 1;
+	obj->bundlePending = 1;
+
+	// If our PreSelect already ran for this iteration, the chain may block in select before we get a chance to flush
+	if (obj->bundlePreSelectDone != 0) { ILibForceUnBlockChain(obj->ChainLink.ParentChain); }
+}
+// Send the outbound bundle, piggybacking a delayed SACK if one is due. Caller must hold the session lock.
+void ILibStun_SctpFlushBundle(struct ILibStun_Module *obj, int session)
+{
+	struct ILibStun_dTlsSession *o = obj->dTlsSessions[session];
+	int sendSack = 0;
+
+	if (o->outBundle == 0) { return; }
+	o->outBundle = 0;
+
+	if (o->sackDelayed != 0)
+	{
+		if (o->rpacketptr + 16 + (4 * o->receiveHold.count) < ILibSCTP_BundleMaxSize)
+		{
+			// Bundle the SACK with the outbound DATA
+			o->rpacketptr = ILibStun_SctpAddSackChunk(obj, session, o->rpacket, o->rpacketptr);
+		}
+		else
+		{
+			sendSack = 1;
+		}
+		ILibStun_SctpSackSent(o);
+	}
+
+	if (o->rpacketptr > 12)
+	{
+		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "SCTP[%d] Flushing %d byte bundle", session, o->rpacketptr);
+		if ((((int*)o->rpacket)[2] & SCTP_COMMON_HEADER_FLAGS_REORDER) == SCTP_COMMON_HEADER_FLAGS_REORDER)
+		{
+			// Need to reorder Control/Data Chunks to be spec-compliant
+			ILibSCTP_ReorderChunks(obj, session, o->rpacket, o->rpacketptr);
+		}
+		ILibStun_SendSctpPacket(obj, session, o->rpacket, o->rpacketptr);
+	}
+	o->rpacketptr = 0;
+	if (sendSack != 0) { ILibStun_SctpSendSack(obj, session); }
+}
+// Flush the outbound bundles of all sessions. Called from the chain thread, once before and once after select
+void ILibStun_SctpFlushAllBundles(struct ILibStun_Module *obj)
+{
+	int i;
+	if (obj->bundlePending == 0) { return; }
+	obj->bundlePending = 0;
+
+	for (i = 0; i < ILibSTUN_MaxSlots; ++i)
+	{
+		if (obj->dTlsSessions[i] != NULL && obj->dTlsSessions[i]->state != 0 && obj->dTlsSessions[i]->outBundle != 0)
+		{
+			ILibSpinLock_Lock(&(obj->dTlsSessions[i]->Lock));
+			ILibStun_SctpFlushBundle(obj, i);
+			ILibSpinLock_UnLock(&(obj->dTlsSessions[i]->Lock));
+		}
+	}
+}
+void ILibStun_SctpDelayedSack_Sink(void *object)
+{
+	struct ILibStun_dTlsSession *o = ILibWebRTC_DTLS_FROM_DELAYED_SACK_TIMER_OBJECT(object);
+
+	ILibSpinLock_Lock(&(o->Lock));
+	if (o->sackDelayed != 0 && o->state == 2)
+	{
+		// The timer already fired, so clear the flag here, so the timer is not removed from inside its own callback
+		o->sackDelayed = 0;
+		o->sackPacketCount = 0;
+		ILibRemoteLogging_printf(ILibChainGetLogger(o->parent->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d sending delayed SACK", o->sessionId);
+		if (o->outBundle != 0) { ILibStun_SctpFlushBundle(o->parent, o->sessionId); }
+		if (o->rpacketptr == 0) { ILibStun_SctpSendSack(o->parent, o->sessionId); }
+	}
+	ILibSpinLock_UnLock(&(o->Lock));
+}
+// RFC 4960 Slow-Start/Congestion Avoidance
+void ILibSCTP_Reno_OnAck(struct ILibStun_dTlsSession *o, int bytesAcked, int bytesInFlight)
+{
+	if (o->congestionWindowSize <= o->SSTHRESH && o->FastRetransmitExitPoint == 0 && bytesAcked != 0 && o->congestionWindowSize < ILibSCTP_MaxCongestionWindow)
+	{
+		// When our window is smaller than the Slow Start Threshold, we can only grow our Window by the MIN of the total bytes ACK'ed, or one MTU
+		o->congestionWindowSize += MIN(bytesAcked, ILibRUDP_StartMTU);
+	}
+	else if (o->congestionWindowSize > o->SSTHRESH && (int)(o->PARTIAL_BYTES_ACKED) >= o->congestionWindowSize && bytesInFlight >= o->congestionWindowSize && o->congestionWindowSize < ILibSCTP_MaxCongestionWindow)
+	{
+		// When our Congestion Window is greater than the Slow Start Threshold, we only grow our Window if we are fully utilizing our congestion window
+		o->congestionWindowSize += ILibRUDP_StartMTU;
+		o->PARTIAL_BYTES_ACKED = o->PARTIAL_BYTES_ACKED - o->congestionWindowSize;
+	}
+}
+void ILibSCTP_Reno_OnFastRetransmit(struct ILibStun_dTlsSession *o)
+{
+	o->SSTHRESH = MAX((o->congestionWindowSize / 2), (4 * ILibRUDP_StartMTU));
+	o->congestionWindowSize = o->SSTHRESH;
+}
+void ILibSCTP_Reno_OnTimeout(struct ILibStun_dTlsSession *o)
+{
+	o->SSTHRESH = MAX(o->congestionWindowSize / 2, 4 * ILibRUDP_StartMTU);			// Update Slow Start Threshold
+	o->congestionWindowSize = ILibRUDP_StartMTU;										// Reset the size of the Congestion Window, so that we'll initialy only have one SCTP packet in flight
+}
+
+// Delay-based (Vegas style) Congestion Control. The number of our packets sitting in queues along the path is estimated
+// from how far the RTT rose above the lowest RTT seen, and CWND is steered to keep that between Alpha and Beta packets.
+void ILibSCTP_Delay_OnRTTSample(struct ILibStun_dTlsSession *o, int rtt)
+{
+	if (rtt <= 0) { rtt = 1; }
+	if (o->baseRTT == 0 || rtt < o->baseRTT) { o->baseRTT = rtt; }
+	o->lastRTT = rtt;
+}
+int ILibSCTP_Delay_QueuedPackets(struct ILibStun_dTlsSession *o)
+{
+	if (o->baseRTT == 0 || o->lastRTT <= o->baseRTT) { return(0); }
+	return((int)(((long long)o->congestionWindowSize * (o->lastRTT - o->baseRTT) / o->lastRTT) / ILibRUDP_StartMTU));
+}
+void ILibSCTP_Delay_OnAck(struct ILibStun_dTlsSession *o, int bytesAcked, int bytesInFlight)
+{
+	int queued = ILibSCTP_Delay_QueuedPackets(o);
+
+	if (o->congestionWindowSize <= o->SSTHRESH && o->FastRetransmitExitPoint == 0 && bytesAcked != 0)
+	{
+		if (queued > 1)
+		{
+			// Queues are starting to build, so leave Slow-Start. SSTHRESH is set just below CWND, so we are now in Congestion Avoidance
+			o->SSTHRESH = o->congestionWindowSize - 1;
+		}
+		else if (o->congestionWindowSize < ILibSCTP_MaxCongestionWindow)
+		{
+			o->congestionWindowSize += MIN(bytesAcked, ILibRUDP_StartMTU);
+		}
+	}
+	else if (o->congestionWindowSize > o->SSTHRESH && (int)(o->PARTIAL_BYTES_ACKED) >= o->congestionWindowSize)
+	{
+		// Adjust once per window
+		o->PARTIAL_BYTES_ACKED = o->PARTIAL_BYTES_ACKED - o->congestionWindowSize;
+		if (queued < ILibSCTP_DelayCC_Alpha && bytesInFlight >= o->congestionWindowSize && o->congestionWindowSize < ILibSCTP_MaxCongestionWindow)
+		{
+			o->congestionWindowSize += ILibRUDP_StartMTU;
+		}
+		else if (queued > ILibSCTP_DelayCC_Beta)
+		{
+			o->congestionWindowSize = MAX(o->congestionWindowSize - ILibRUDP_StartMTU, 4 * ILibRUDP_StartMTU);
+		}
+	}
+}
+void ILibSCTP_Delay_OnFastRetransmit(struct ILibStun_dTlsSession *o)
+{
+	if (ILibSCTP_Delay_QueuedPackets(o) < ILibSCTP_DelayCC_Alpha)
+	{
+		// Loss on a path without queueing delay is likely not congestion (ie: Wi-Fi), so back off by 1/4 instead of 1/2
+		o->congestionWindowSize = MAX((o->congestionWindowSize / 4) * 3, (4 * ILibRUDP_StartMTU));
+		o->SSTHRESH = o->congestionWindowSize;
+	}
+	else
+	{
+		ILibSCTP_Reno_OnFastRetransmit(o);
+	}
+}
+
+const ILibSCTP_CongestionControlOps ILibSCTP_CongestionControl_Reno = { NULL, ILibSCTP_Reno_OnAck, ILibSCTP_Reno_OnFastRetransmit, ILibSCTP_Reno_OnTimeout };
+const ILibSCTP_CongestionControlOps ILibSCTP_CongestionControl_Delay = { ILibSCTP_Delay_OnRTTSample, ILibSCTP_Delay_OnAck, ILibSCTP_Delay_OnFastRetransmit, ILibSCTP_Reno_OnTimeout };
+
+const ILibSCTP_CongestionControlOps* ILibSCTP_GetCongestionControlOps(ILibSCTP_CongestionControl algorithm)
+{
+	switch (algorithm)
+	{
+		case ILibSCTP_CongestionControl_DELAY:
+			return(&ILibSCTP_CongestionControl_Delay);
+		default:
+			return(&ILibSCTP_CongestionControl_Reno);
+	}
+}
+//! Select the congestion control algorithm for an SCTP association
+/*!
+	\param sctpSession SCTP Session object
+	\param algorithm Congestion Control Algorithm to use
+	\param enablePacing Non-zero to spread outbound DATA evenly over each round trip, instead of sending a full window at once
+*/
+void ILibSCTP_SetCongestionControl(void* sctpSession, ILibSCTP_CongestionControl algorithm, int enablePacing)
+{
+	struct ILibStun_dTlsSession *o = (struct ILibStun_dTlsSession*)sctpSession;
+	ILibSpinLock_Lock(&(o->Lock));
+	o->congestionControl = ILibSCTP_GetCongestionControlOps(algorithm);
+	o->pacingEnabled = enablePacing;
+	ILibSpinLock_UnLock(&(o->Lock));
+}
+//! Select the congestion control algorithm used by new SCTP associations
+/*!
+	\param stunModule Local Stun/ICE Client
+	\param algorithm Congestion Control Algorithm to use
+	\param enablePacing Non-zero to spread outbound DATA evenly over each round trip, instead of sending a full window at once
+*/
+void ILibSCTP_SetDefaultCongestionControl(void* stunModule, ILibSCTP_CongestionControl algorithm, int enablePacing)
+{
+	((struct ILibStun_Module*)stunModule)->defaultCongestionControl = algorithm;
+	((struct ILibStun_Module*)stunModule)->defaultPacing = enablePacing;
+}
+
+// Token Bucket Pacer. Tokens refill at 1.25 x CWND/SRTT, so the pacer smooths bursts, without becoming the bottleneck.
+// Returns non-zero, and deducts the tokens, if 'len' bytes may be sent now. Caller must hold the session lock.
+int ILibSCTP_Pacing_TryConsume(struct ILibStun_dTlsSession *o, int len, unsigned int now)
+{
+	if (o->pacingEnabled == 0 || o->SRTT <= 0) { return(1); }
+
+	if (o->pacingLastRefill == 0) { o->pacingTokens = ILibSCTP_PacingBurst; }
+	else { o->pacingTokens += ((long long)(now - o->pacingLastRefill) * o->congestionWindowSize * 5) / (4 * (long long)o->SRTT); }
+	if (o->pacingTokens > ILibSCTP_PacingBurst) { o->pacingTokens = ILibSCTP_PacingBurst; }
+	o->pacingLastRefill = now;
+
+	if (o->pacingTokens < len) { return(0); }
+	o->pacingTokens -= len;
+	return(1);
+}
+void ILibSCTP_Pacing_Sink(void *object);
+// Wake up once roughly one full size packet worth of tokens is available. Caller must hold the session lock.
+void ILibSCTP_Pacing_ArmTimer(struct ILibStun_dTlsSession *o)
+{
+	int delay;
+	if (o->pacingEnabled == 0 || o->pacingTimerArmed != 0 || o->SRTT <= 0) { return; }
+
+	delay = (int)(((long long)ILibRUDP_StartMTU * 4 * o->SRTT) / (5 * (long long)MAX(o->congestionWindowSize, 1)));
+	if (delay < 1) { delay = 1; }
+	o->pacingTimerArmed = 1;
+	ILibLifeTime_AddEx(o->parent->Timer, ILibWebRTC_DTLS_TO_PACING_TIMER_OBJECT(o), delay, ILibSCTP_Pacing_Sink, NULL);
+}
+
+// Deficit Round Robin stream scheduler, used with I-DATA. On its turn, a stream may send up to its quantum of fragments, so a large
+// message on one stream can no longer hold up small messages on the others. Caller must hold the session lock for all of these.
+#define ILibSCTP_Scheduler_Quantum(o, s) (ILibSCTP_SchedulerQuantum * ((o)->streamScheduler == ILibSCTP_StreamScheduler_WEIGHTED ? (int)(s)->priority : 1))
+#define ILibSCTP_Scheduler_FragmentSize(rpacket) ((rpacket)->PacketSize - (12 + (int)sizeof(ILibSCTP_IDataPayload)))
+#define ILibSCTP_Scheduler_Peek(o) ((o)->schedCurrent != NULL ? (o)->schedCurrent->head : NULL)
+
+ILibSCTP_OutStream* ILibSCTP_GetOutStream(struct ILibStun_dTlsSession *o, unsigned short streamId)
+{
+	ILibSCTP_OutStream *s = (ILibSCTP_OutStream*)ILibSparseArray_Get(o->OutStreams, streamId);
+	if (s == NULL)
+	{
+		if ((s = (ILibSCTP_OutStream*)malloc(sizeof(ILibSCTP_OutStream))) == NULL) ILIBCRITICALEXIT(254);
+		memset(s, 0, sizeof(ILibSCTP_OutStream));
+		s->priority = 1;
+		ILibSparseArray_Add(o->OutStreams, streamId, s);
+	}
+	return(s);
+}
+// A stream reset restarts the Message Identifiers of the reset streams
+void ILibSCTP_ResetOutStreamMID(ILibSparseArray sender, int index, void *value, void *user)
+{
+	UNREFERENCED_PARAMETER(sender);
+	UNREFERENCED_PARAMETER(index);
+	UNREFERENCED_PARAMETER(user);
+	if (value != NULL) { ((ILibSCTP_OutStream*)value)->nextMID = 0; }
+}
+void ILibSCTP_Scheduler_Enqueue(struct ILibStun_dTlsSession *o, unsigned short streamId, ILibSCTP_RPACKET *rpacket)
+{
+	ILibSCTP_OutStream *s = ILibSCTP_GetOutStream(o, streamId);
+
+	rpacket->NextPacket = NULL;
+	if (s->tail == NULL) { s->head = rpacket; }
+	else { s->tail->NextPacket = rpacket; }
+	s->tail = rpacket;
+
+	if (s->scheduled == 0)
+	{
+		s->scheduled = 1;
+		if (o->schedCurrent == NULL)
+		{
+			s->next = s;
+			o->schedCurrent = o->schedPrev = s;
+			s->deficit = ILibSCTP_Scheduler_Quantum(o, s);
+		}
+		else
+		{
+			// Join the ring just before the stream whose turn it is, so this stream gets its turn after a full round
+			s->next = o->schedCurrent;
+			o->schedPrev->next = s;
+			o->schedPrev = s;
+			s->deficit = 0;
+		}
+	}
+}
+// Remove the fragment returned by ILibSCTP_Scheduler_Peek, and pass the turn on if this stream used up its quantum
+ILibSCTP_RPACKET* ILibSCTP_Scheduler_Pop(struct ILibStun_dTlsSession *o)
+{
+	ILibSCTP_OutStream *s = o->schedCurrent;
+	ILibSCTP_RPACKET *rpacket = s->head;
+
+	if ((s->head = rpacket->NextPacket) == NULL) { s->tail = NULL; }
+	rpacket->NextPacket = NULL;
+	s->deficit -= ILibSCTP_Scheduler_FragmentSize(rpacket);
+
+	if (s->head == NULL)
+	{
+		// Nothing left to send on this stream, so it leaves the ring
+		s->scheduled = 0;
+		s->deficit = 0;
+		if (s->next == s) { o->schedCurrent = o->schedPrev = NULL; return(rpacket); }
+		o->schedPrev->next = s->next;
+		o->schedCurrent = s->next;
+		o->schedCurrent->deficit += ILibSCTP_Scheduler_Quantum(o, o->schedCurrent);
+	}
+	else if (s->deficit < ILibSCTP_Scheduler_FragmentSize(s->head))
+	{
+		o->schedPrev = s;
+		o->schedCurrent = s->next;
+		o->schedCurrent->deficit += ILibSCTP_Scheduler_Quantum(o, o->schedCurrent);
+	}
+	return(rpacket);
+}
+// Assign TSNs to everything the scheduler holds, and move it to the holding queue. A stream reset names the last TSN sent, so this must happen first
+void ILibSCTP_Scheduler_Flush(struct ILibStun_dTlsSession *o)
+{
+	ILibSCTP_RPACKET *rpacket;
+
+	while (o->schedCurrent != NULL)
+	{
+		rpacket = ILibSCTP_Scheduler_Pop(o);
+		((ILibSCTP_DataPayload*)rpacket->Data)->TSN = htonl(o->outtsn++);
+
+		if (o->holdingQueueTail == NULL) { o->holdingQueueHead = (char*)rpacket; }
+		else { ((char**)(o->holdingQueueTail))[0] = (char*)rpacket; }
+		o->holdingQueueTail = (char*)rpacket;
+	}
+}
+
+//! Select how streams share the association, when the peer supports User Message Interleaving (I-DATA)
+/*!
+	\param sctpSession SCTP Session object
+	\param scheduler Stream Scheduler to use
+*/
+void ILibSCTP_SetStreamScheduler(void* sctpSession, ILibSCTP_StreamScheduler scheduler)
+{
+	struct ILibStun_dTlsSession *o = (struct ILibStun_dTlsSession*)sctpSession;
+	ILibSpinLock_Lock(&(o->Lock));
+	o->streamScheduler = scheduler;
+	ILibSpinLock_UnLock(&(o->Lock));
+}
+//! Set the priority of a stream, used by the weighted stream scheduler
+/*!
+	\param sctpSession SCTP Session object
+	\param streamId Stream Identifier
+	\param priority Relative share of the association this stream receives, when other streams also have data to send (1 - 255, Default is 1)
+*/
+void ILibSCTP_SetStreamPriority(void* sctpSession, unsigned short streamId, unsigned char priority)
+{
+	struct ILibStun_dTlsSession *o = (struct ILibStun_dTlsSession*)sctpSession;
+	ILibSpinLock_Lock(&(o->Lock));
+	ILibSCTP_GetOutStream(o, streamId)->priority = priority > 0 ? priority : 1;
+	ILibSpinLock_UnLock(&(o->Lock));
+}
+
+// Send any packets in the holding queue that credits and pacing allow, followed by what the stream scheduler holds. Caller must hold the session lock.
+void ILibStun_SctpSendHoldingQueue(struct ILibStun_Module *obj, int session, unsigned int now)
 {
-	int clen = 16;
-	unsigned int tsn = obj->dTlsSessions[session]->intsn;
-	unsigned int bytecount = 0;
+	struct ILibStun_dTlsSession *o = obj->dTlsSessions[session];
+	ILibSCTP_RPACKET *rpacket;
 
-	// Skip all packets with a low TSN. We do ths bacause we have not processed them yet, but will after adding this SACK
-	void *node = ILibLinkedList_GetNode_Head(obj->dTlsSessions[session]->receiveHoldBuffer);
-	while(node!=NULL && ILibLinkedList_GetDataFromNode(node) != NULL && ntohl(((ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(node))->TSN) <= obj->dTlsSessions[session]->userTSN)
+	while (o->receiverCredits > 0)
 	{
-		node = ILibLinkedList_GetNextNode(node);
-	}
+		if ((rpacket = (ILibSCTP_RPACKET*)o->holdingQueueHead) == NULL && (rpacket = ILibSCTP_Scheduler_Peek(o)) == NULL) break;
 
-	// Compute all selective ACK's
-	while (node != NULL)
-	{
-		ILibSCTP_DataPayload *p = (ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(node);
-		unsigned int gstart = (p == NULL ? 0 : ntohl(p->TSN));
-		unsigned int gend = gstart;
-		bytecount += (p == NULL ? 0 : ntohs(p->length));
+		// Check if we have sufficient credits to send the next packet
+		if (o->receiverCredits < (rpacket->PacketSize - (12 + 16))) break;
+		if (o->senderCredits < (rpacket->PacketSize - (12 + 16))) break;
+		if (ILibSCTP_Pacing_TryConsume(o, rpacket->PacketSize - (12 + 16), now) == 0) { ILibSCTP_Pacing_ArmTimer(o); break; }
 
-		node = ILibLinkedList_GetNextNode(node);
-		while (node != NULL && (p = (ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(node))!=NULL)
+		// Remove the packet from the holding queue
+		if (rpacket == (ILibSCTP_RPACKET*)o->holdingQueueHead)
+		{
+			o->holdingQueueHead = (char*)rpacket->NextPacket;	// Move to the next packet
+			if (o->holdingQueueHead == NULL) o->holdingQueueTail = NULL;
+		}
+		else
 		{
-			unsigned int x = ntohl(p->TSN);
-			bytecount += ntohs(p->length);
-			if (x == gend + 1) { gend = x; }
-			else break;
-			node = ILibLinkedList_GetNextNode(node);
+			// Interleaved fragments are assigned their TSN as they leave the scheduler, so TSNs are still sent in order
+			ILibSCTP_Scheduler_Pop(o);
+			((ILibSCTP_DataPayload*)rpacket->Data)->TSN = htonl(o->outtsn++);
 		}
+		o->holdingCount--;
+
+#ifdef _WEBRTCDEBUG
+		// Debug Events
+		if (o->onHold != NULL) { o->onHold(o, "OnHold", o->holdingCount); }
+#endif
+
+		// Add the packet to the end of the pending queue
+		if (o->pendingQueueTail == NULL) { o->pendingQueueHead = (char*)rpacket; }
+		else { ((char**)(o->pendingQueueTail))[0] = (char*)rpacket; }
+		rpacket->NextPacket = NULL;
+		o->pendingQueueTail = (char*)rpacket;
+		o->pendingCount++;
+		o->pendingByteCount += (rpacket->PacketSize - (12 + 16));
+
+		// Remove the credits
+		o->senderCredits -= (rpacket->PacketSize - (12 + 16));
+		o->receiverCredits -= (rpacket->PacketSize - (12 + 16));
+		o->holdingByteCount -= (rpacket->PacketSize - (12 + 16));
+
+#ifdef _WEBRTCDEBUG
+		// Debug Events
+		if (o->onReceiverCredits != NULL) { o->onReceiverCredits(o, "OnReceiverCredits", o->receiverCredits); }
+#endif
 
-		if (clen < 500) // Cap the number of encoded gaps.
+		if (o->T3RTXTIME == 0)
 		{
-			((unsigned short*)(packet + ptr + clen))[0] = htons((unsigned short)(gstart - tsn));			// Start	
-			((unsigned short*)(packet + ptr + clen))[1] = htons((unsigned short)(gend - tsn));				// End
-			RCTPRCVDEBUG(printf("SACK %u + %u to %u\r\n", tsn, gstart, gend);)
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d SENT [SACK] %u + %u to %u", session, tsn, gstart, gend);
-				clen += 4;
+			o->T3RTXTIME = now;
+#ifdef _WEBRTCDEBUG
+			if (o->onT3RTX != NULL){ o->onT3RTX(o, "OnT3RTX", o->RTO); } // Restart the timer, because the timer isn't currently set
+#endif
 		}
+
+		// Update the packet retry data
+		rpacket->LastSentTimeStamp = now;								// Last time the packet was sent (Used for retry)
+		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "Sending %u/%u bytes from Holding Queue", (rpacket->PacketSize - (12 + 16)), o->holdingByteCount);
+		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...TSN=%u", ntohl(((ILibSCTP_DataPayload*)rpacket->Data)->TSN));
+		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...LEN=%u", ntohs(((ILibSCTP_DataPayload*)rpacket->Data)->length));
+
+		// Send the packet
+		ILibStun_SendSctpPacket(obj, session, rpacket->Data - 12, rpacket->PacketSize);	// Send the packet
 	}
+}
+void ILibSCTP_Pacing_Sink(void *object)
+{
+	struct ILibStun_dTlsSession *o = ILibWebRTC_DTLS_FROM_PACING_TIMER_OBJECT(object);
+	struct ILibStun_Module *obj = o->parent;
+	int oldHoldCount;
 
-	// Create response
-	if (bytecount > ILibSCTP_MaxReceiverCredits) bytecount = ILibSCTP_MaxReceiverCredits;
-	ILibStun_AddSctpChunkHeader(packet, ptr, RCTP_CHUNK_TYPE_SACK, 0, (unsigned short)clen);
-	((unsigned int*)(packet + ptr + 4))[0] = htonl(obj->dTlsSessions[session]->intsn);		// Cumulative TSN Ack
-	((unsigned int*)(packet + ptr + 8))[0] = htonl(ILibSCTP_MaxReceiverCredits - bytecount);// Advertised Receiver Window Credit (a_rwnd) 
-	((unsigned short*)(packet + ptr + 12))[0] = htons(((unsigned short)clen - 16) / 4);		// Number of Gap Ack Blocks
-	((unsigned short*)(packet + ptr + 14))[0] = htons(0);									// Number of Duplicate TSNs
+	ILibSpinLock_Lock(&(o->Lock));
+	o->pacingTimerArmed = 0;
+	if (o->state != 2) { ILibSpinLock_UnLock(&(o->Lock)); return; }
 
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d SENT [SACK] a_rwnd: %u Cumalative TSN: %u", session, ILibSCTP_MaxReceiverCredits - bytecount, obj->dTlsSessions[session]->intsn);
+	oldHoldCount = o->holdingCount;
+	ILibStun_SctpSendHoldingQueue(obj, o->sessionId, (unsigned int)ILibGetUptime());
 
-	return (ptr + clen);
+	// If we can now send more packets, notify the application
+	if (obj->OnSendOK != NULL && o->holdingCount == 0 && oldHoldCount > 0)
+	{
+		ILibSpinLock_UnLock(&(o->Lock));
+		obj->OnSendOK(obj, o, o->User);
+		return;
+	}
+	ILibSpinLock_UnLock(&(o->Lock));
+}
+void ILibStun_PreSelect(void* object, fd_set *readset, fd_set *writeset, fd_set *errorset, int* blocktime)
+{
+	struct ILibStun_Module *obj = (struct ILibStun_Module*)object;
+	UNREFERENCED_PARAMETER(readset);
+	UNREFERENCED_PARAMETER(writeset);
+	UNREFERENCED_PARAMETER(errorset);
+	UNREFERENCED_PARAMETER(blocktime);
+
+	ILibStun_SctpFlushAllBundles(obj);
+	ILibStun_SendDtlsCoalesced(obj);
+	obj->bundlePreSelectDone = 1;
+}
+void ILibStun_PostSelect(void* object, int slct, fd_set *readset, fd_set *writeset, fd_set *errorset)
+{
+	struct ILibStun_Module *obj = (struct ILibStun_Module*)object;
+	UNREFERENCED_PARAMETER(slct);
+	UNREFERENCED_PARAMETER(readset);
+	UNREFERENCED_PARAMETER(writeset);
+	UNREFERENCED_PARAMETER(errorset);
+
+	obj->bundlePreSelectDone = 0;
+	ILibStun_SctpFlushAllBundles(obj);
+	ILibStun_SendDtlsCoalesced(obj); // Our UDP sockets have already run PostSelect, so these datagrams are written together in their next PreSelect
 }
 
-ILibTransport_DoneState ILibStun_SctpSendDataEx(struct ILibStun_Module *obj, int session, unsigned char flags, unsigned short streamid, unsigned short streamnum, int pid, char* data, int datalen)
+ILibTransport_DoneState ILibStun_SctpSendDataEx(struct ILibStun_Module *obj, int session, unsigned char flags, unsigned short streamid, unsigned int streamnum, int pid, char* data, int datalen)
 {
 	ILibSCTP_StreamAttributes sattr;
 	ILibSCTP_StreamAttributes_Data sattrData;
 	int rptr = sizeof(ILibSCTP_RPACKET);
 	ILibSCTP_RPACKET *rpacket;
+	int interleaving = obj->dTlsSessions[session]->interleaving;
+	int hdrlen = interleaving != 0 ? (int)sizeof(ILibSCTP_IDataPayload) : (int)sizeof(ILibSCTP_DataPayload);
+	int chargelen;
 	unsigned int tsn = obj->dTlsSessions[session]->outtsn;
-	obj->dTlsSessions[session]->outtsn++;
 
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d] ILibStun_SctpSendDataEx -> outtsn = %u", session, tsn);
+	// DATA fragments must have consecutive TSNs, so the TSN is assigned now. I-DATA fragments are assigned their TSN when they are sent, so they can be interleaved
+	if (interleaving == 0) { obj->dTlsSessions[session]->outtsn++; }
 
-	// Create data packet, allow for a header in front.
-	size_t newlen = sizeof(ILibSCTP_RPACKET) + datalen + 16;
-	newlen = FOURBYTEBOUNDARY(newlen);
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d] ILibStun_SctpSendDataEx -> outtsn = %u", session, tsn);
 
-	if ((rpacket = (ILibSCTP_RPACKET*)malloc(newlen)) == NULL) ILIBCRITICALERREXIT(254);
-	memset(rpacket, 0, newlen);
+	// Create data packet, allow for a header in front. Every header field is written below, so the buffer does not need to be cleared.
+	rpacket = ILibSCTP_PacketPool_Get(obj->dTlsSessions[session], datalen);
 	rpacket->Reliability = 0;																					// Full Reliable Mode (Default)
 	rpacket->NextPacket = NULL;																					// Pointer to the next packet (Used for queuing)
-	rpacket->PacketSize = (unsigned short)(12 + 16 + FOURBYTEBOUNDARY(datalen));								// Size of the packet (Used for queuing)	
+	rpacket->PacketSize = (unsigned short)(12 + hdrlen + FOURBYTEBOUNDARY(datalen));								// Size of the packet (Used for queuing)	
+	chargelen = rpacket->PacketSize - (12 + 16);																// Bytes charged against the windows, the same amount is restored when the packet is SACK'ed
 	rpacket->PacketGAPCounter = rpacket->PacketResendCounter = 0;												// Number of times the packet was resent (Used for retry)
 	rpacket->LastSentTimeStamp = 0;																				// Last time the packet was sent (Used for retry)
 	rpacket->CreationTimeStamp = (unsigned int)ILibGetUptime();
 
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Size: %u", rpacket->PacketSize);
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Size: %u", rpacket->PacketSize);
 
 	sattr.Raw = ILibSparseArray_Get(obj->dTlsSessions[session]->DataChannelMetaDeta, streamid);
 	sattrData.Raw = ILibSparseArray_Get(obj->dTlsSessions[session]->DataChannelMetaDetaValues, streamid);
@@ -3312,31 +4196,51 @@ ILibTransport_DoneState ILibStun_SctpSendDataEx(struct ILibStun_Module *obj, int
 
 	// There is a 12 byte GAP here to accomodate SCTP Common Header, if necessary
 
-	ILibStun_AddSctpChunkHeader(rpacket->Data, 0, RCTP_CHUNK_TYPE_DATA, flags, (unsigned short)(16 + datalen));	// Setup the data chunk header
+	ILibStun_AddSctpChunkHeader(rpacket->Data, 0, interleaving != 0 ? RCTP_CHUNK_TYPE_IDATA : RCTP_CHUNK_TYPE_DATA, flags, (unsigned short)(hdrlen + datalen));	// Setup the data chunk header
 	
 	((ILibSCTP_DataPayload*)rpacket->Data)->TSN = htonl(tsn);													// Cumulative TSN Ack
-	((ILibSCTP_DataPayload*)rpacket->Data)->StreamID = htons(streamid);											// Stream Identifier
-	((ILibSCTP_DataPayload*)rpacket->Data)->StreamSequenceNumber = htons(streamnum);							// Stream Sequence Number
-	((ILibSCTP_DataPayload*)rpacket->Data)->ProtocolID = htonl(pid);											// Payload Protocol Identifier
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...TSN [%u]", tsn);
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...SEQ [%u]", ((ILibSCTP_DataPayload*)rpacket->Data)->StreamSequenceNumber);
-
-	memcpy_s(((ILibSCTP_DataPayload*)rpacket->Data)->UserData, datalen + 16, data, datalen);									// Copy the user data
-	rptr += (16 + datalen);
+	if (interleaving != 0)
+	{
+		((ILibSCTP_IDataPayload*)rpacket->Data)->StreamID = htons(streamid);									// Stream Identifier
+		((ILibSCTP_IDataPayload*)rpacket->Data)->Reserved = 0;
+		((ILibSCTP_IDataPayload*)rpacket->Data)->MessageID = htonl(streamnum);									// Message Identifier
+		((ILibSCTP_IDataPayload*)rpacket->Data)->ProtocolID = htonl(pid);										// Payload Protocol Identifier, or Fragment Sequence Number
+	}
+	else
+	{
+		((ILibSCTP_DataPayload*)rpacket->Data)->StreamID = htons(streamid);										// Stream Identifier
+		((ILibSCTP_DataPayload*)rpacket->Data)->StreamSequenceNumber = htons((unsigned short)streamnum);		// Stream Sequence Number
+		((ILibSCTP_DataPayload*)rpacket->Data)->ProtocolID = htonl(pid);										// Payload Protocol Identifier
+	}
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...TSN [%u]", tsn);
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...SEQ [%u]", streamnum);
+
+	memcpy_s(rpacket->Data + hdrlen, datalen, data, datalen);														// Copy the user data
+	if (FOURBYTEBOUNDARY(datalen) != datalen) { memset(rpacket->Data + hdrlen + datalen, 0, FOURBYTEBOUNDARY(datalen) - datalen); } // Zero the chunk padding
+	rptr += (hdrlen + datalen);
 	RCTPDEBUG(printf("OUT DATA_CHUNK FLAGS: %d, TSN: %u, ID: %d, SEQ: %d, PID: %u, SIZE: %d\r\n", flags, tsn, streamid, streamnum, pid, datalen);)
 
 	// Check the credits
-	if ((obj->dTlsSessions[session]->receiverCredits < datalen) || datalen > obj->dTlsSessions[session]->senderCredits || (obj->dTlsSessions[session]->holdingCount != 0))
+	if ((obj->dTlsSessions[session]->receiverCredits < chargelen) || chargelen > obj->dTlsSessions[session]->senderCredits || (obj->dTlsSessions[session]->holdingCount != 0) || 
+		ILibSCTP_Pacing_TryConsume(obj->dTlsSessions[session], chargelen, rpacket->CreationTimeStamp) == 0)
 	{
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...To Holding Queue (%u bytes)", rpacket->PacketSize);
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "......LEN: %u", ntohs(((ILibSCTP_DataPayload*)rpacket->Data)->length));
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...To Holding Queue (%u bytes)", rpacket->PacketSize);
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "......LEN: %u", ntohs(((ILibSCTP_DataPayload*)rpacket->Data)->length));
 
-		// Add this packet to the holding queue
-		if (obj->dTlsSessions[session]->holdingQueueTail == NULL) { obj->dTlsSessions[session]->holdingQueueHead = (char*)rpacket; }
-		else { ((char**)(obj->dTlsSessions[session]->holdingQueueTail))[0] = (char*)rpacket; }
-		obj->dTlsSessions[session]->holdingQueueTail = (char*)rpacket;
+		// Add this packet to the holding queue, or let the stream scheduler decide when it is sent
+		if (interleaving != 0)
+		{
+			ILibSCTP_Scheduler_Enqueue(obj->dTlsSessions[session], streamid, rpacket);
+		}
+		else
+		{
+			if (obj->dTlsSessions[session]->holdingQueueTail == NULL) { obj->dTlsSessions[session]->holdingQueueHead = (char*)rpacket; }
+			else { ((char**)(obj->dTlsSessions[session]->holdingQueueTail))[0] = (char*)rpacket; }
+			obj->dTlsSessions[session]->holdingQueueTail = (char*)rpacket;
+		}
 		obj->dTlsSessions[session]->holdingCount++;
-		obj->dTlsSessions[session]->holdingByteCount += datalen;
+		obj->dTlsSessions[session]->holdingByteCount += chargelen;
+		ILibSCTP_Pacing_ArmTimer(obj->dTlsSessions[session]);  // The pacer will release the holding queue, if the peer does not SACK first
 		// if (obj->dTlsSessions[session]->holdingCount == 1) printf("HOLD\r\n");
 #ifdef _WEBRTCDEBUG
 		if (obj->dTlsSessions[session]->onHold != NULL) { obj->dTlsSessions[session]->onHold(obj->dTlsSessions[session], "OnHold", obj->dTlsSessions[session]->holdingCount); }
@@ -3344,11 +4248,13 @@ ILibTransport_DoneState ILibStun_SctpSendDataEx(struct ILibStun_Module *obj, int
 		return ILibTransport_DoneState_INCOMPLETE; // Hold, we don't have anymore credits
 	}
 	
+	if (interleaving != 0) { ((ILibSCTP_DataPayload*)rpacket->Data)->TSN = htonl(obj->dTlsSessions[session]->outtsn++); }
+
 	// Update the packet retry data
 	rpacket->LastSentTimeStamp = rpacket->CreationTimeStamp;								// Last time the packet was sent (Used for retry)
 	if (obj->dTlsSessions[session]->T3RTXTIME == 0)
 	{
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Start T3RTX Timer");
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Start T3RTX Timer");
 		// Only set the T3RTX timer if it is not already running
 		obj->dTlsSessions[session]->T3RTXTIME = rpacket->LastSentTimeStamp;
 #ifdef _WEBRTCDEBUG
@@ -3357,37 +4263,45 @@ ILibTransport_DoneState ILibStun_SctpSendDataEx(struct ILibStun_Module *obj, int
 	}
 
 	// Add this packet to the pending ack queue
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Added to Pending ACK Queue");
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Added to Pending ACK Queue");
 
-	obj->dTlsSessions[session]->receiverCredits -= datalen; // Receiver Window
-	obj->dTlsSessions[session]->senderCredits -= datalen;   // Congestion Window
+	obj->dTlsSessions[session]->receiverCredits -= chargelen; // Receiver Window
+	obj->dTlsSessions[session]->senderCredits -= chargelen;   // Congestion Window
 
 	if (obj->dTlsSessions[session]->pendingQueueTail == NULL) 
 	{
 		obj->dTlsSessions[session]->pendingQueueHead = (char*)rpacket; 
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "......HEAD");
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "......HEAD");
 	}
 	else 
 	{
 		((char**)(obj->dTlsSessions[session]->pendingQueueTail))[0] = (char*)rpacket; 
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "......TAIL");
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "......TAIL");
 	}
 	obj->dTlsSessions[session]->pendingQueueTail = (char*)rpacket;
 	obj->dTlsSessions[session]->pendingCount++;
 	
-	obj->dTlsSessions[session]->pendingByteCount += (rpacket->PacketSize - (12 + 16));
+	obj->dTlsSessions[session]->pendingByteCount += chargelen;
 
 #ifdef _WEBRTCDEBUG
 	// Debug Event
 	if (obj->dTlsSessions[session]->onReceiverCredits != NULL) { obj->dTlsSessions[session]->onReceiverCredits(obj->dTlsSessions[session], "OnReceiverCredits", obj->dTlsSessions[session]->receiverCredits); }
 #endif
 
-	// Send the packet now
-	if ((flags & 0x03) == 0x03 && obj->dTlsSessions[session]->rpacketptr > 0 && obj->dTlsSessions[session]->rpacketsize > (obj->dTlsSessions[session]->rpacketptr + 16 + datalen + 4) && (obj->dTlsSessions[session]->rpacketptr + 16 + datalen + 4) < 1400)
+	// Send the packet now. On the chain thread, chunks are bundled and flushed when the bundle is full, or once per chain iteration.
+	if (obj->dTlsSessions[session]->outBundle != 0 && (ILibIsRunningOnChainThread(obj->ChainLink.ParentChain) == 0 || (obj->dTlsSessions[session]->rpacketptr + hdrlen + datalen + 4) >= ILibSCTP_BundleMaxSize))
+	{
+		ILibStun_SctpFlushBundle(obj, session);
+	}
+	if (obj->dTlsSessions[session]->rpacketptr == 0 && ILibIsRunningOnChainThread(obj->ChainLink.ParentChain) != 0)
+	{
+		ILibStun_SctpStartBundle(obj, session);
+	}
+	if ((obj->dTlsSessions[session]->outBundle != 0 || (flags & 0x03) == 0x03) && obj->dTlsSessions[session]->rpacketptr > 0 && obj->dTlsSessions[session]->rpacketsize > (obj->dTlsSessions[session]->rpacketptr + hdrlen + datalen + 4) && (obj->dTlsSessions[session]->rpacketptr + hdrlen + datalen + 4) < ILibSCTP_BundleMaxSize)
 	{
 		int st;
 		// Merge this data chunk in packet that is going to be sent
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Merging");
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Merging");
 
 		// Align/Pad on 32bit aligned pointer
 		st = obj->dTlsSessions[session]->rpacketptr;
@@ -3395,19 +4309,19 @@ ILibTransport_DoneState ILibStun_SctpSendDataEx(struct ILibStun_Module *obj, int
 
 		if (st != obj->dTlsSessions[session]->rpacketptr)
 		{
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Aligning on 4 byte boundary [%d => %d]", st, obj->dTlsSessions[session]->rpacketptr);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Aligning on 4 byte boundary [%d => %d]", st, obj->dTlsSessions[session]->rpacketptr);
 		}
-		memcpy_s(obj->dTlsSessions[session]->rpacket + obj->dTlsSessions[session]->rpacketptr, 16 + datalen, rpacket->Data, 16 + datalen);
-		obj->dTlsSessions[session]->rpacketptr += FOURBYTEBOUNDARY(16 + datalen);	
+		memcpy_s(obj->dTlsSessions[session]->rpacket + obj->dTlsSessions[session]->rpacketptr, hdrlen + datalen, rpacket->Data, hdrlen + datalen);
+		obj->dTlsSessions[session]->rpacketptr += FOURBYTEBOUNDARY(hdrlen + datalen);	
 		((int*)obj->dTlsSessions[session]->rpacket)[2] |= SCTP_COMMON_HEADER_FLAGS_DATA;
 	}
 	else
 	{
 		// Send in a seperate packet
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Sending as separate packet");
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Sending as separate packet");
 		return ILibStun_SendSctpPacket(obj, session, rpacket->Data - 12, rpacket->PacketSize); // Problem sending
 	}
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Complete");
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Complete");
 	return ILibTransport_DoneState_COMPLETE; // Everything is ok
 }
 
@@ -3419,7 +4333,7 @@ ILibTransport_DoneState ILibStun_SctpSendData(struct ILibStun_Module *obj, int s
 	unsigned char flags = 0; // 2 = Start, 0 = Middle, 1 = End, 3 = Start & End
 	ILibSCTP_StreamAttributes attr;
 	ILibSCTP_StreamAttributes_Data attrData;
-	unsigned short seq;
+	unsigned int seq, fsn = 0;
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "ILibStun_SctpSendData[%d]: %d bytes (SID: %u, PID: %d)", session, datalen, streamid, pid);
 
@@ -3434,6 +4348,7 @@ ILibTransport_DoneState ILibStun_SctpSendData(struct ILibStun_Module *obj, int s
 
 	seq = attrData.Data.NextSequenceNumber++;
 	ILibSparseArray_Add(obj->dTlsSessions[session]->DataChannelMetaDetaValues, streamid, attrData.Raw);
+	if (obj->dTlsSessions[session]->interleaving != 0) { seq = ILibSCTP_GetOutStream(obj->dTlsSessions[session], streamid)->nextMID++; } // I-DATA uses a 32 bit Message Identifier instead
 
 
 	// Send the data in one block
@@ -3451,9 +4366,10 @@ ILibTransport_DoneState ILibStun_SctpSendData(struct ILibStun_Module *obj, int s
 		if (ptr == 0) flags |= 0x02;
 		if (ptr + len == datalen) flags |= 0x01;
 
-		// Send the block
-		r = ILibStun_SctpSendDataEx(obj, session, flags, streamid, seq, pid, data + ptr, len);
+		// Send the block. I-DATA only carries the Protocol ID on the first fragment, the others carry their Fragment Sequence Number
+		r = ILibStun_SctpSendDataEx(obj, session, flags, streamid, seq, (ptr == 0 || obj->dTlsSessions[session]->interleaving == 0) ? pid : (int)fsn, data + ptr, len);
 		ptr += len;
+		++fsn;
 	}
 
 	return r;
@@ -3493,10 +4409,32 @@ ILibTransport_DoneState ILibSCTP_SendEx(void* sctpSession, unsigned short stream
 	return r;
 }
 
-void ILibStun_SctpProcessStreamData(struct ILibStun_Module *obj, int session, unsigned short streamId, unsigned short steamSeq, unsigned char chunkflags, int pid, char* data, int datalen)
+// Locate the fields of a DATA or I-DATA chunk. I-DATA only carries the Protocol ID on the first fragment, so pid is -1 on the others.
+// Returns the chunk flags, with ILibSCTP_InterleavedFlag set for I-DATA
+unsigned char ILibSCTP_ParseDataChunk(ILibSCTP_DataPayload *chunk, unsigned short *streamId, unsigned int *messageId, int *pid, char **data, int *datalen)
+{
+	if (chunk->type == RCTP_CHUNK_TYPE_IDATA)
+	{
+		ILibSCTP_IDataPayload *idata = (ILibSCTP_IDataPayload*)chunk;
+		*streamId = ntohs(idata->StreamID);
+		*messageId = ntohl(idata->MessageID);
+		*pid = (idata->flags & 0x02) == 0x02 ? (int)ntohl(idata->ProtocolID) : -1;
+		*data = idata->UserData;
+		*datalen = (int)ntohs(idata->length) - (int)sizeof(ILibSCTP_IDataPayload);
+		return((unsigned char)(idata->flags | ILibSCTP_InterleavedFlag));
+	}
+	*streamId = ntohs(chunk->StreamID);
+	*messageId = ntohs(chunk->StreamSequenceNumber);
+	*pid = (int)ntohl(chunk->ProtocolID);
+	*data = chunk->UserData;
+	*datalen = (int)ntohs(chunk->length) - (int)sizeof(ILibSCTP_DataPayload);
+	return(chunk->flags);
+}
+
+// Chunks arrive here in TSN order. messageId is the Stream Sequence Number for DATA, or the Message Identifier for I-DATA
+void ILibStun_SctpProcessStreamData(struct ILibStun_Module *obj, int session, unsigned short streamId, unsigned int messageId, unsigned char chunkflags, int pid, char* data, int datalen)
 {
 	struct ILibStun_dTlsSession *o = (struct ILibStun_dTlsSession*)obj->dTlsSessions[session];
-	UNREFERENCED_PARAMETER(steamSeq); // We expect all packets to be in order now.
 
 	// TODO: Add error case for when invalid streamId is specified. Bryan
 
@@ -3620,15 +4558,44 @@ void ILibStun_SctpProcessStreamData(struct ILibStun_Module *obj, int session, un
 		else
 		{
 			// Start of a data accumulation
-			ILibSCTP_Accumulator *acc = (ILibSCTP_Accumulator*)ILibSparseArray_Get(obj->dTlsSessions[session]->DataAccumulator, streamId);
-			if(acc == NULL)
+			ILibSCTP_Accumulator *head = (ILibSCTP_Accumulator*)ILibSparseArray_Get(obj->dTlsSessions[session]->DataAccumulator, streamId);
+			ILibSCTP_Accumulator *acc = head, *idle = NULL;
+			unsigned char unordered = (chunkflags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag;
+
+			if ((chunkflags & ILibSCTP_InterleavedFlag) == ILibSCTP_InterleavedFlag)
+			{
+				// I-DATA fragments of several messages can be interleaved on a stream, so find the accumulator of this message
+				while (acc != NULL && (acc->bufferPtr < 0 || acc->messageId != messageId || acc->unordered != unordered))
+				{
+					if (acc->bufferPtr < 0) { idle = acc; }
+					acc = acc->next;
+				}
+				if (acc == NULL && (chunkflags & 0x02))
+				{
+					if ((acc = idle) == NULL)
+					{
+						acc = ILibSCTP_CreateAccumulator();
+						acc->next = head;
+						ILibSparseArray_Add(obj->dTlsSessions[session]->DataAccumulator, streamId, acc);
+					}
+				}
+			}
+			else if (acc == NULL && (chunkflags & 0x02))
 			{
-				if (chunkflags & 0x02) { acc = ILibSCTP_CreateAccumulator(); } // Only create, if we received a 'Begin' fragment
+				acc = ILibSCTP_CreateAccumulator(); // Only create, if we received a 'Begin' fragment
+				ILibSparseArray_Add(obj->dTlsSessions[session]->DataAccumulator, streamId, acc);
 			}
 
 			if (acc != NULL)
 			{
-				if (chunkflags & 0x02) { acc->bufferPtr = 0; }	// Set to Zero when a 'BeginFragment' is received
+				if (chunkflags & 0x02)
+				{
+					// Set to Zero when a 'BeginFragment' is received
+					acc->bufferPtr = 0;
+					acc->messageId = messageId;
+					acc->unordered = unordered;
+					acc->pid = pid;
+				}
 				if (acc->bufferPtr >= 0)						// If this is < 0, it means we never received a 'BeginFragment'
 				{
 					// Accumulate data
@@ -3641,15 +4608,13 @@ void ILibStun_SctpProcessStreamData(struct ILibStun_Module *obj, int session, un
 					memcpy_s(acc->buffer + acc->bufferPtr, acc->bufferLen - acc->bufferPtr, data, datalen);
 					acc->bufferPtr += datalen;
 
-					ILibSparseArray_Add(obj->dTlsSessions[session]->DataAccumulator, streamId, acc);
-
 					// End of data accumulation
 					if (chunkflags & 0x01)
 					{
 						if (obj->OnData != NULL && obj->dTlsSessions[session]->state == 2)
 						{
 							ILibSpinLock_UnLock(&(obj->dTlsSessions[session]->Lock));
-							obj->OnData(obj, obj->dTlsSessions[session], streamId, pid, acc->buffer, acc->bufferPtr, &(obj->dTlsSessions[session]->User));
+							obj->OnData(obj, obj->dTlsSessions[session], streamId, acc->pid, acc->buffer, acc->bufferPtr, &(obj->dTlsSessions[session]->User));
 							if (obj->dTlsSessions[session] == NULL || obj->dTlsSessions[session]->state != 2) return;
 							ILibSpinLock_Lock(&(obj->dTlsSessions[session]->Lock));
 						}
@@ -3693,7 +4658,6 @@ void ILibStun_SctpDisconnect_Final(void *obj)
 {
 	struct ILibStun_dTlsSession* o = (struct ILibStun_dTlsSession*)obj;
 	char* packet;
-	void *node;
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(o->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SctpDisconnect_Final dispatched on: Session %d [0x%p]", o->sessionId, obj);
 
@@ -3724,14 +4688,11 @@ void ILibStun_SctpDisconnect_Final(void *obj)
 		o->holdingQueueHead = packet;
 	}
 
+	// Free all idle packet buffers
+	ILibSCTP_PacketPool_Drain(o);
+
 	// Free all packets in receive holding queue
-	node = ILibLinkedList_GetNode_Head(o->receiveHoldBuffer);
-	while(node != NULL)
-	{
-		if (ILibLinkedList_GetDataFromNode(node) != NULL) { free(ILibLinkedList_GetDataFromNode(node)); }
-		node = ILibLinkedList_GetNextNode(node);
-	}
-	ILibLinkedList_Destroy(o->receiveHoldBuffer);
+	ILibSCTP_ReorderBuffer_Destroy(&(o->receiveHold));
 
 	ILibWebRTC_DestroySparseArrayTables(o);
 
@@ -3788,12 +4749,20 @@ void ILibStun_SctpDisconnect_Continue(void *chain, void *j)
 	if (o->rpacketptr > 0)
 	{
 		ILibRemoteLogging_printf(ILibChainGetLogger(o->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP(%d) trying to close, flushing %d bytes from RPACKET", o->sessionId, o->rpacketptr);
-		ILibStun_SendSctpPacket(obj, o->sessionId, o->rpacket, o->rpacketptr);
+		if (o->outBundle != 0) 
+		{
+			ILibStun_SctpFlushBundle(obj, o->sessionId);
+		}
+		else
+		{
+			ILibStun_SendSctpPacket(obj, o->sessionId, o->rpacket, o->rpacketptr);
+		}
 	}
 
 	if (obj->IceStates[o->iceStateSlot] != NULL)
 	{
 		SSL_shutdown(o->ssl);
+		o->dtlsCoalesced = 0; // Coalesced records are still in the write BIO, so they go out ahead of the close_notify below
 
 		while (BIO_ctrl_pending(SSL_get_wbio(o->ssl)) > 0)
 		{
@@ -3853,6 +4822,10 @@ void ILibStun_SctpDisconnect(struct ILibStun_Module *obj, int session)
 	struct ILibStun_dTlsSession* o = obj->dTlsSessions[session];
 
 	ILibLifeTime_Remove(o->parent->Timer, ILibWebRTC_DTLS_TO_SCTP_HEARTBEAT_TIMER_OBJECT(o)); // Stop SCTP Heartbeats
+	ILibLifeTime_Remove(o->parent->Timer, ILibWebRTC_DTLS_TO_DELAYED_SACK_TIMER_OBJECT(o)); // Stop Delayed SACK
+	ILibLifeTime_Remove(o->parent->Timer, ILibWebRTC_DTLS_TO_PACING_TIMER_OBJECT(o)); // Stop Pacer
+	o->sackDelayed = 0;
+	o->pacingTimerArmed = 0;
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(o->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "Disconnect Requested on Session: %d", session);
 
@@ -3874,15 +4847,34 @@ int ILibSCTP_FWDTSN_Check(struct ILibStun_dTlsSession *obj, char* buffer)
 	ILibSCTP_RPACKET *packet = (ILibSCTP_RPACKET*)obj->pendingQueueHead;
 	ILibSCTP_RPACKET *tmp, *tmp2;
 	unsigned int FWDTSN = 0; // Network Order
-	int ptr = 0;
+	int ptr = 0, i;
 	ILibSCTP_FwdTSNPayload *chunk = (ILibSCTP_FwdTSNPayload*)buffer;
+	ILibSCTP_IFwdTSNPayload *ichunk = (ILibSCTP_IFwdTSNPayload*)buffer;
+	ILibSCTP_IDataPayload *idata;
+	unsigned short uflag;
 
 	while (packet != NULL)
 	{
 		if (obj->intsn < ntohl(((ILibSCTP_DataPayload*)packet->Data)->TSN))
 		{
 			// These packets are not covered with the Cumulative TSN
-			if (packet->PacketGAPCounter == 0xFD )
+			if (packet->PacketGAPCounter == 0xFD && obj->interleaving != 0)
+			{
+				// With I-DATA, messages are skipped by stream, U bit and Message Identifier (RFC 8260, Section 2.3.1). Fragments of
+				// different messages are interleaved, so every abandoned fragment updates the entry of its own stream
+				idata = (ILibSCTP_IDataPayload*)packet->Data;
+				uflag = htons((idata->flags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag ? 0x01 : 0x00);
+				for (i = 0; i < ptr && (ichunk->SkippedStreams[i].StreamNumber != idata->StreamID || ichunk->SkippedStreams[i].Flags != uflag); ++i);
+				if (i == ptr || (int)(ntohl(idata->MessageID) - ntohl(ichunk->SkippedStreams[i].MessageID)) > 0)
+				{
+					ichunk->SkippedStreams[i].StreamNumber = idata->StreamID;
+					ichunk->SkippedStreams[i].Flags = uflag;
+					ichunk->SkippedStreams[i].MessageID = idata->MessageID;
+				}
+				if (i == ptr) { ++ptr; }
+				FWDTSN = idata->TSN;
+			}
+			else if (packet->PacketGAPCounter == 0xFD)
 			{ 
 				chunk->SkippedStreams[ptr].StreamNumber = ((ILibSCTP_DataPayload*)packet->Data)->StreamID;				
 				chunk->SkippedStreams[ptr].StreamSequence = (((ILibSCTP_DataPayload*)packet->Data)->flags & ILibSCTP_UnorderedFlag) != ILibSCTP_UnorderedFlag ? ((ILibSCTP_DataPayload*)packet->Data)->StreamSequenceNumber : 0x00;
@@ -3918,7 +4910,7 @@ int ILibSCTP_FWDTSN_Check(struct ILibStun_dTlsSession *obj, char* buffer)
 		while (tmp != NULL && tmp != packet)
 		{
 			tmp2 = tmp->NextPacket;
-			free(tmp);
+			ILibSCTP_PacketPool_Put(obj, tmp);
 			tmp = tmp2;
 		}
 
@@ -3926,12 +4918,12 @@ int ILibSCTP_FWDTSN_Check(struct ILibStun_dTlsSession *obj, char* buffer)
 		obj->pendingQueueHead = (char*)packet;
 		if (packet == NULL) { obj->pendingQueueTail = NULL; }
 
-		// Send a FWD-TSN Chunk
-		chunk->type = RCTP_CHUNK_TYPE_FWDTSN;
+		// Send a FWD-TSN Chunk, or an I-FORWARD-TSN Chunk if I-DATA is in use
+		chunk->type = obj->interleaving != 0 ? RCTP_CHUNK_TYPE_IFWDTSN : RCTP_CHUNK_TYPE_FWDTSN;
 		chunk->flags = 0x00;
 		chunk->NewTSN = FWDTSN;
 
-		ptr = 8 + (ptr * 4);
+		ptr = 8 + (ptr * (obj->interleaving != 0 ? (int)sizeof(ILibSCTP_IFwdTSNPayload_Stream) : 4));
 		chunk->length = htons((unsigned short)ptr);
 		obj->fwdTsnDelayTime = 0;
 	}
@@ -3956,8 +4948,7 @@ void ILibStun_SctpResent(struct ILibStun_dTlsSession *obj)
 #endif
 		ILibRemoteLogging_printf(ILibChainGetLogger(obj->parent->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: T3TX Timer Expired", obj->sessionId);
 		obj->senderCredits = ILibRUDP_StartMTU;												// Set CWND to 1 MTU
-		obj->SSTHRESH = MAX(obj->congestionWindowSize / 2, 4 * ILibRUDP_StartMTU);			// Update Slow Start Threshold
-		obj->congestionWindowSize = ILibRUDP_StartMTU;										// Reset the size of the Congestion Window, so that we'll initialy only have one SCTP packet in flight
+		obj->congestionControl->OnTimeout(obj);												// Update Slow Start Threshold, and shrink the Congestion Window
 #ifdef _WEBRTCDEBUG
 		if (obj->onCongestionWindowSizeChanged != NULL) { obj->onCongestionWindowSizeChanged(obj, "OnCongestionWindowSizeChanged", obj->congestionWindowSize); }
 #endif
@@ -4125,6 +5116,7 @@ ILibSparseArray ILibWebRTC_PropagateChannelClose(struct ILibStun_dTlsSession* ob
 			if(count==0)
 			{
 				ILibSparseArray_ClearEx(obj->DataChannelMetaDetaValues, NULL, NULL);
+				ILibSparseArray_Enumerate(obj->OutStreams, ILibSCTP_ResetOutStreamMID, NULL);
 				retVal = ILibSparseArray_Move(obj->DataChannelMetaDeta);
 				break;
 			}
@@ -4136,6 +5128,7 @@ ILibSparseArray ILibWebRTC_PropagateChannelClose(struct ILibStun_dTlsSession* ob
 					sid = ntohs(req->Streams[count-1]);
 					ILibSparseArray_Add(retVal, sid, ILibSparseArray_Remove(obj->DataChannelMetaDeta, sid)); 
 					ILibSparseArray_Remove(obj->DataChannelMetaDetaValues, sid);
+					ILibSCTP_ResetOutStreamMID(NULL, sid, ILibSparseArray_Get(obj->OutStreams, sid), NULL);
 					--count;
 				}
 				break;
@@ -4147,39 +5140,33 @@ ILibSparseArray ILibWebRTC_PropagateChannelClose(struct ILibStun_dTlsSession* ob
 	return retVal;
 }
 
-int ILibSCTP_AddPacketToHoldingQueue_Comparer(void *obj1, void *obj2)
+// Grow the receive window when the peer delivers more than half of it within one round trip, because it is then limiting throughput
+void ILibSCTP_ReceiveWindow_Update(struct ILibStun_dTlsSession *o, int bytes)
 {
-	unsigned int v2 = ntohl(((ILibSCTP_DataPayload*)obj2)->TSN);
-	unsigned int v1 = ntohl(((ILibSCTP_DataPayload*)obj1)->TSN);
+	unsigned int now = (unsigned int)ILibGetUptime();
+	unsigned int epoch = (unsigned int)MAX(o->SRTT, ILibSCTP_ReceiveWindowMinEpoch);
 
-	return(v2 == v1 ? 0 : ((v2 < v1)?-1:1));
-}
-void* ILibSCTP_AddPacketToHoldingQueue_Chooser(void *oldValue, void *newValue, void *user)
-{
-	if (oldValue != NULL)
-	{
-		return(oldValue);
-	}
-	else
+	if (o->receiveWindowEpoch == 0) { o->receiveWindowEpoch = now; }
+	o->receiveWindowBytes += bytes;
+	if (now - o->receiveWindowEpoch >= epoch)
 	{
-		unsigned short len = ntohs(((ILibSCTP_DataPayload*)newValue)->length);
-		char* retVal = (char*)malloc(len+1);
-		if (retVal == NULL) ILIBCRITICALEXIT(254);
-
-		memcpy_s(retVal, len + 1, (char*)newValue, len);
-		ReceiveHoldBuffer_Increment((ILibLinkedList)user, ((ILibSCTP_DataPayload*)newValue)->length);
-		return retVal;
+		if (o->receiveWindowBytes * 2 > o->receiveWindow && o->receiveWindow < ILibSCTP_MaxReceiveWindow)
+		{
+			o->receiveWindow = MIN(o->receiveWindow * 2, ILibSCTP_MaxReceiveWindow);
+			ILibRemoteLogging_printf(ILibChainGetLogger(o->parent->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "SCTP: %d Receive Window grown to %d bytes", o->sessionId, o->receiveWindow);
+		}
+		o->receiveWindowEpoch = now;
+		o->receiveWindowBytes = 0;
 	}
 }
-void* ILibSCTP_AddPacketToHoldingQueue(struct ILibStun_dTlsSession* o, ILibSCTP_DataPayload *payload, ILibSCTP_SackStatus *sentsack)
+ILibSCTP_DataPayload* ILibSCTP_AddPacketToHoldingQueue(struct ILibStun_dTlsSession* o, ILibSCTP_DataPayload *payload, ILibSCTP_SackStatus *sentsack)
 {
-	void* retVal = NULL;
-	// Out of sequence packet, find a spot in the receive queue.
+	ILibSCTP_DataPayload* retVal = NULL;
+	// Out of sequence packet, store it in its TSN slot. Everything held is still owed to the user, so the ring starts at userTSN + 1
 	
 	RCTPRCVDEBUG(printf("STORING %u, size = %d\r\n", ntohl(payload->TSN), ntohs(payload->length));)
-	if (ReceiveHoldBuffer_Used(o->receiveHoldBuffer) + payload->length > ILibSCTP_MaxReceiverCredits) { *sentsack = ILibSCTP_SackStatus_Skip; return(NULL); }
-
-	retVal = ILibLinkedList_SortedInsertEx(o->receiveHoldBuffer, &ILibSCTP_AddPacketToHoldingQueue_Comparer, &ILibSCTP_AddPacketToHoldingQueue_Chooser, payload, o->receiveHoldBuffer);
+	if (o->receiveHold.bytes + ntohs(payload->length) > o->receiveWindow) { *sentsack = ILibSCTP_SackStatus_Skip; return(NULL); }
+	if ((retVal = ILibSCTP_ReorderBuffer_Add(&(o->receiveHold), o->userTSN + 1, payload)) == NULL) { *sentsack = ILibSCTP_SackStatus_Skip; return(NULL); }
 	
 	// Send ACK now
 	if (*sentsack == ILibSCTP_SackStatus_NotSent)
@@ -4190,11 +5177,6 @@ void* ILibSCTP_AddPacketToHoldingQueue(struct ILibStun_dTlsSession* o, ILibSCTP_
 	return retVal;
 }
 
-int ILibSCTP_HoldingQueue_TSNComparer(void *obj1, void *obj2)
-{
-	return((((ILibSCTP_DataPayload*)obj1)->TSN == ((ILibSCTP_DataPayload*)obj2)->TSN) ? 0 : 1);
-}
-
 #ifdef _REMOTELOGGING
 void ILibSctp_DebugSctpPacket(ILibRemoteLogging *logger, char *packet, int packetLen, char *note)
 {
@@ -4214,6 +5196,9 @@ void ILibSctp_DebugSctpPacket(ILibRemoteLogging *logger, char *packet, int packe
 			case RCTP_CHUNK_TYPE_DATA:
 				ILibRemoteLogging_printf(logger, ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...[DATA] TSN: %u, U: %u, B: %u, E: %u", ntohl(((ILibSCTP_DataPayload*)(packet + ptr))->TSN), (((ILibSCTP_ChunkHeader*)(packet + ptr))->chunkFlags >> 2) & 0x01, (((ILibSCTP_ChunkHeader*)(packet + ptr))->chunkFlags >> 1) & 0x01, ((ILibSCTP_ChunkHeader*)(packet + ptr))->chunkFlags & 0x01);
 				break;
+			case RCTP_CHUNK_TYPE_IDATA:
+				ILibRemoteLogging_printf(logger, ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...[I-DATA] TSN: %u, MID: %u, U: %u, B: %u, E: %u", ntohl(((ILibSCTP_IDataPayload*)(packet + ptr))->TSN), ntohl(((ILibSCTP_IDataPayload*)(packet + ptr))->MessageID), (((ILibSCTP_ChunkHeader*)(packet + ptr))->chunkFlags >> 2) & 0x01, (((ILibSCTP_ChunkHeader*)(packet + ptr))->chunkFlags >> 1) & 0x01, ((ILibSCTP_ChunkHeader*)(packet + ptr))->chunkFlags & 0x01);
+				break;
 			case RCTP_CHUNK_TYPE_INIT:
 				ILibRemoteLogging_printf(logger, ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...[INIT]");
 				break;
@@ -4292,7 +5277,7 @@ void ILibSCTP_ReorderChunks(struct ILibStun_Module *obj, int sessionID, char *bu
 		unsigned short actualSize = FOURBYTEBOUNDARY(chunksize);
 		if (chunksize < 4 || ptr + chunksize > bufferLen) break;
 
-		if(chunktype == RCTP_CHUNK_TYPE_DATA)
+		if(chunktype == RCTP_CHUNK_TYPE_DATA || chunktype == RCTP_CHUNK_TYPE_IDATA)
 		{
 			// TempWrite Data Chunks
 			memcpy_s(dataChunks + dataChunksWritten, sizeof(ILibScratchPad2) - dataChunksWritten, (char*)chunkHdr, chunksize);
@@ -4325,6 +5310,22 @@ void ILibSCTP_ReorderChunks(struct ILibStun_Module *obj, int sessionID, char *bu
 		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...SCTP Size = %d, but reordered size is: %d", bufferLen, controlChunksWritten + dataChunksWritten + 12);
 	}
 }
+#ifdef _WEBRTCDEBUG
+void ILibStun_DelayedSctpPacket_Sink(void *object)
+{
+	ILibStun_DelayedSctpPacket *delayed = (ILibStun_DelayedSctpPacket*)object;
+
+	// Drop the packet if the session it was received on has gone away in the meantime
+	if (delayed->obj->dTlsSessions[delayed->session] == delayed->dtlsSession)
+	{
+		delayed->obj->inboundDelayReinjecting = 1;
+		ILibStun_ProcessSctpPacket(delayed->obj, delayed->session, delayed->buffer, delayed->bufferLength);
+		delayed->obj->inboundDelayReinjecting = 0;
+	}
+	free(delayed);
+}
+#endif
+
 // Main RFC specification: http://tools.ietf.org/html/rfc4960
 void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char* buffer, int bufferLength)
 {
@@ -4336,11 +5337,26 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 	struct ILibStun_dTlsSession* o = obj->dTlsSessions[session];
 	int rttCalculated = 0;
 	ILibSCTP_SackStatus sentsack = ILibSCTP_SackStatus_NotSent;
+	int sackDue = 0;
 
 	// Setup the session
 	if (bufferLength < 12 || o == NULL) return;
 
 #ifdef _WEBRTCDEBUG
+	// Simulated Inbound Delay, the packet is copied and processed again when the timer fires
+	if (obj->inboundDelayMilliseconds > 0 && obj->inboundDelayReinjecting == 0)
+	{
+		ILibStun_DelayedSctpPacket *delayed;
+		if ((delayed = (ILibStun_DelayedSctpPacket*)malloc(sizeof(ILibStun_DelayedSctpPacket) + bufferLength)) == NULL) { ILIBCRITICALEXIT(254); }
+		delayed->obj = obj;
+		delayed->dtlsSession = o;
+		delayed->session = session;
+		delayed->bufferLength = bufferLength;
+		memcpy_s(delayed->buffer, bufferLength, buffer, bufferLength);
+		ILibLifeTime_AddEx(obj->Timer, delayed, obj->inboundDelayMilliseconds, ILibStun_DelayedSctpPacket_Sink, free);
+		return;
+	}
+
 	// Simulated Inbound Packet Loss
 	if ((obj->lossPercentage) > 0 && ((rand() % 100) >= (100 - obj->lossPercentage))) { return; }
 #endif
@@ -4354,7 +5370,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 	{
 		// Technically speaking, consent freshness is supposed to be independent of SCTP/DTLS, but Chromium and Firefox no longer
 		// respond to a freshness probe, so I have to work-around this issue
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_DTLS, ILibRemoteLogging_Flags_VerbosityLevel_2, "Consent Freshness Updated (via dTLS) on IceSlot: %d", session);
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_DTLS, ILibRemoteLogging_Flags_VerbosityLevel_2, "Consent Freshness Updated (via dTLS) on IceSlot: %d", session);
 
 		o->freshnessTimestampStart = 0;
 		ILibLifeTime_Remove(obj->Timer, ILibWebRTC_DTLS_TO_CONSENT_FRESHNESS_TIMER_OBJECT(o));
@@ -4369,8 +5385,16 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 	// Setup the response packet
 	rptr = &(o->rpacketptr);
 	rpacket = o->rpacket;
-	((int*)rpacket)[0] = ((int*)rpacket)[1] = ((int*)rpacket)[2] = 0;	// Set common header area to zeros, so we can temporarily stick some flags in there to keep track of control/data packet order
-	*rptr = 12;
+	if (o->outBundle != 0)
+	{
+		// Outbound chunks are waiting to be sent, so the response is added to them and everything goes out together
+		o->outBundle = 0;
+	}
+	else
+	{
+		((int*)rpacket)[0] = ((int*)rpacket)[1] = ((int*)rpacket)[2] = 0;	// Set common header area to zeros, so we can temporarily stick some flags in there to keep track of control/data packet order
+		*rptr = 12;
+	}
 
 	// printf("SCTP size: %d\r\n", bufferLength);
 
@@ -4400,7 +5424,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 				unsigned short hdrLen;
 				ILibSCTP_Reconfig_OutgoingSSNResetRequest *outRequest = NULL;
 
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [RECONFIG]", session);
+				ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [RECONFIG]", session);
 
 				while((bytesProcessed + 4 )< chunkLen)
 				{
@@ -4429,7 +5453,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 								}
 								
 								outRequest = (ILibSCTP_Reconfig_OutgoingSSNResetRequest*)((char*)(&outChunk->reconfigurationParameter) + outOffset);
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Outgoing Reset Request: Seq/%u", (unsigned int)ntohl(req->RReqSeqNum));
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Outgoing Reset Request: Seq/%u", (unsigned int)ntohl(req->RReqSeqNum));
 
 								if(lastTSN <= o->userTSN)
 								{
@@ -4438,6 +5462,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 
 									outRequest->parameterType = htons(SCTP_RECONFIG_TYPE_OUTGOING_SSN_RESET_REQUEST);
 									outRequest->parameterLength = htons(16 + 2*streamCount);
+									ILibSCTP_Scheduler_Flush(o); // Interleaved fragments that are still waiting must be covered by LastTSN
 									outRequest->LastTSN = htonl(o->outtsn - 1);
 									outRequest->RReqSeqNum = htonl(o->RREQSEQ++);
 									outRequest->RResSeqNum = htonl(o->RRESSEQ++);	
@@ -4448,7 +5473,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 										// We're going to move the contents to a new SparseArray, so we can post the events without a lock
 
 										ILibSparseArray dup = ILibSparseArray_Move(o->DataChannelMetaDeta);
-										ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Resetting all streams");
+										ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Resetting all streams");
 
 										ILibSpinLock_UnLock(&(o->Lock));
 											ILibWebRTC_PropagateChannelCloseEx(dup, o);
@@ -4456,18 +5481,19 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 									}
 									else
 									{
-										ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Number of streams to be reset: %u", streamCount);
+										ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Number of streams to be reset: %u", streamCount);
 										while(streamCount > 0)
 										{
 											streamId = ntohs(req->Streams[streamCount-1]);
 											attr.Raw = ILibSparseArray_Remove(o->DataChannelMetaDeta, streamId);
 
-											ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, ".........Resetting stream: %u", streamId);
+											ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, ".........Resetting stream: %u", streamId);
 
 											if((attr.Data.StatusFlags & ILibSCTP_StreamAttributesData_Assigned_Status_ASSIGNED) == ILibSCTP_StreamAttributesData_Assigned_Status_ASSIGNED)
 											{
 												OutboundResponse->Result = htonl(ILibSCTP_Reconfig_Result_Success_Performed);	
 												ILibSparseArray_Remove(o->DataChannelMetaDetaValues, streamId); // Clear associated data with this stream ID
+												ILibSCTP_ResetOutStreamMID(NULL, streamId, ILibSparseArray_Get(o->OutStreams, streamId), NULL);
 												if(obj->OnWebRTCDataChannelClosed != NULL)
 												{
 													ILibSpinLock_UnLock(&(o->Lock));
@@ -4503,14 +5529,14 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 								else
 								{
 									// We have not received all data for the stream yet, so we need to defer the reset
-									ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......LastTSN/%u has not elapsed, DEFERRING", lastTSN);
+									ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......LastTSN/%u has not elapsed, DEFERRING", lastTSN);
 									OutboundResponse->Result = htonl((unsigned int)ILibSCTP_Reconfig_Result_In_Progress); 
 
 									if(o->pendingReconfigPacket !=NULL && o->pendingReconfigPacket >= o->rpacket && o->pendingReconfigPacket <= (o->rpacket + o->rpacketsize))
 									{
 										// Locally initiated Channel Close is pending. Deny request, becuase we don't have resources to process this yet
 										OutboundResponse->Result = htonl(ILibSCTP_Reconfig_Result_Denied);
-										ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Insufficient resources to process Close, due to locally initiated close in progress");
+										ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Insufficient resources to process Close, due to locally initiated close in progress");
 									}
 									else 
 									{
@@ -4549,7 +5575,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 								unsigned short streamCount = (ntohs(req->parameterLength) - 8) / 2;
 								ILibSCTP_PendingTSN_Data pending;
 
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Incoming Reset Request: Seq/%u", (unsigned int)ntohl(req->RReqSeqNum));
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Incoming Reset Request: Seq/%u", (unsigned int)ntohl(req->RReqSeqNum));
 								pending.Raw = o->pendingReconfigPacket;
 
 								if(outRequest != NULL)
@@ -4562,16 +5588,17 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 									OutboundResponse->RESSEQNum = req->RReqSeqNum;	
 									OutboundResponse->Result = htonl((unsigned int)(pending.Data.Type == 0xFF && pending.Data.Flags == 0x00)?ILibSCTP_Reconfig_Result_In_Progress:ILibSCTP_Reconfig_Result_Success_NOP);									
 									outOffset += sizeof(ILibSCTP_Reconfig_Response);
-									ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Responded with Response Parameter");
+									ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Responded with Response Parameter");
 									break;
 								}
 	
 								// Lone INBOUND RESET REQUEST
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Responding with Outbound Reset Request");
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Responding with Outbound Reset Request");
 								outRequest = (ILibSCTP_Reconfig_OutgoingSSNResetRequest*)((char*)(&outChunk->reconfigurationParameter) + outOffset); // Ignore Klocwork Error, it's not a problem in this case												
 								outRequest->parameterType = htons(SCTP_RECONFIG_TYPE_OUTGOING_SSN_RESET_REQUEST);
 								//outRequest->parameterLength = htons(16 + 2 * streamCount);
 								outRequest->parameterLength = 16 + 2 * streamCount;
+								ILibSCTP_Scheduler_Flush(o); // Interleaved fragments that are still waiting must be covered by LastTSN
 								outRequest->LastTSN = htonl(o->outtsn - 1);
 								outRequest->RReqSeqNum = htonl(o->RREQSEQ++);
 								outRequest->RResSeqNum = htonl(o->RRESSEQ++);
@@ -4579,17 +5606,18 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 								outOffset += FOURBYTEBOUNDARY(outRequest->parameterLength);			 // Add parameter size and padding
 								outRequest->parameterLength = htons(outRequest->parameterLength);
 								
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Number of streams to be reset: %u", streamCount);
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......Number of streams to be reset: %u", streamCount);
 								while(streamCount > 0)
 								{
 									streamId = ntohs(req->Streams[streamCount-1]);
 									attr.Raw = ILibSparseArray_Remove(o->DataChannelMetaDeta, streamId);
 
-									ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, ".........Resetting stream: %u", streamId);
+									ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, ".........Resetting stream: %u", streamId);
 
 									if ((attr.Data.StatusFlags & ILibSCTP_StreamAttributesData_Assigned_Status_ASSIGNED) == ILibSCTP_StreamAttributesData_Assigned_Status_ASSIGNED)
 									{
 										ILibSparseArray_Remove(o->DataChannelMetaDetaValues, streamId); // Clear associated data with this stream ID
+										ILibSCTP_ResetOutStreamMID(NULL, streamId, ILibSparseArray_Get(o->OutStreams, streamId), NULL);
 										if (obj->OnWebRTCDataChannelClosed != NULL)
 										{
 											ILibSpinLock_UnLock(&(o->Lock));
@@ -4605,7 +5633,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 						case SCTP_RECONFIG_TYPE_RECONFIGURATION_RESPONSE: // Response
 							{
 								ILibSCTP_Reconfig_Response *res = (ILibSCTP_Reconfig_Response*)hdr;
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Received Response [%u/%s]: Seq/%u",(unsigned int)ntohl(res->Result), ((unsigned int)ntohl(res->Result)==0 || (unsigned int)ntohl(res->Result)==1 || (unsigned int)ntohl(res->Result)==4 || (unsigned int)ntohl(res->Result)==6)?"SUCCESS":"ERROR", (unsigned int)ntohl(res->RESSEQNum));
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Received Response [%u/%s]: Seq/%u",(unsigned int)ntohl(res->Result), ((unsigned int)ntohl(res->Result)==0 || (unsigned int)ntohl(res->Result)==1 || (unsigned int)ntohl(res->Result)==4 || (unsigned int)ntohl(res->Result)==6)?"SUCCESS":"ERROR", (unsigned int)ntohl(res->RESSEQNum));
 								
 								if(o->pendingReconfigPacket!=NULL && ((ILibSCTP_PendingTSN_Data*)((char*)&o->pendingReconfigPacket))->Data.Type != 0xFF)
 								{ 
@@ -4615,7 +5643,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 										ILibSparseArray arr = ILibWebRTC_PropagateChannelClose(o, o->pendingReconfigPacket);
 										
 										ILibLifeTime_Remove(o->parent->Timer, ILibWebRTC_DTLS_TO_TIMER_OBJECT(o));
-										ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......[Response for a pending Close]");
+										ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......[Response for a pending Close]");
 										o->pendingReconfigPacket = NULL;
 										
 										// We need to shed the Lock before we call up the stack
@@ -4643,7 +5671,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			break;
 		case RCTP_CHUNK_TYPE_COOKIEACK:
 		{
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [COOKIEACK]", session);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [COOKIEACK]", session);
 			if (obj->OnConnect != NULL && o->state == 1)
 			{
 				o->state = 2;
@@ -4662,9 +5690,9 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			// Set TSN
 			o->RRESSEQ = o->userTSN = o->intsn = ntohl(((unsigned int*)(buffer + ptr + 16))[0]) - 1;
 
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [INIT-ACK]", session);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/IN  = %u", o->intsn);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/OUT = %u", o->outtsn);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [INIT-ACK]", session);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/IN  = %u", o->intsn);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/OUT = %u", o->outtsn);
 
 			// Optional/Variable Fields
 			{
@@ -4686,13 +5714,13 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 						for (chunkIndex = 0; chunkIndex < tLen - 4; ++chunkIndex)
 						{
 							ILibSparseArray_Add(o->PeerFeatureSet, (int)((unsigned char*)(buffer + ptr + 20 + varLen + 4))[chunkIndex], (void*)0x01);
-							ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Supported Extension: %d", (int)((unsigned char*)(buffer + ptr + 20 + varLen + 4))[chunkIndex]);
+							ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Supported Extension: %d", (int)((unsigned char*)(buffer + ptr + 20 + varLen + 4))[chunkIndex]);
 						}
 						break;
 					case SCTP_INIT_PARAM_STATE_COOKIE:
 						cookie = (char*)(buffer + ptr + 20 + varLen + 4);
 						cookieLen = tLen - 4;
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Received Cookie: %s", ILibRemoteLogging_ConvertToHex(cookie, cookieLen));
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Received Cookie: %s", ILibRemoteLogging_ConvertToHex(cookie, cookieLen));
 						
 						tmpval1 = *rptr;
 
@@ -4702,7 +5730,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 						*rptr += FOURBYTEBOUNDARY(tLen);
 
 						tmpval2 = *rptr;
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......RPTR Pre: %d Mid %d Post: %d tLen: %u", tmpval1, tmpval3, tmpval2, tLen);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "......RPTR Pre: %d Mid %d Post: %d tLen: %u", tmpval1, tmpval3, tmpval2, tLen);
 
 						break;
 					default:
@@ -4711,6 +5739,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 					varLen += FOURBYTEBOUNDARY(tLen);	// Add parameter size and padding
 				}
 			}
+			o->interleaving = (unsigned char)ILibSCTP_DoesPeerSupportFeature(o, RCTP_CHUNK_TYPE_IDATA); // We always offer I-DATA, so it is used if the peer offered it too
 		}
 			break;
 		case RCTP_CHUNK_TYPE_INIT:
@@ -4730,10 +5759,10 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			o->outport = ntohs(((unsigned short*)buffer)[0]);
 			o->maxOutStreams = MIN(ntohs(((unsigned short*)(buffer + ptr + 12))[0]), ILibSCTP_Stream_MaximumCount);
 			o->maxInStreams = MIN(ntohs(((unsigned short*)(buffer + ptr + 12))[1]), ILibSCTP_Stream_MaximumCount);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [INIT]", session);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/IN        = %u", o->intsn);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/OUT       = %u", o->outtsn);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...SenderCredits = %u", o->senderCredits);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [INIT]", session);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/IN        = %u", o->intsn);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/OUT       = %u", o->outtsn);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...SenderCredits = %u", o->senderCredits);
 
 			// Optional/Variable Fields
 			{
@@ -4754,7 +5783,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 							for(chunkIndex = 0 ; chunkIndex < tLen - 4; ++chunkIndex)
 							{
 								ILibSparseArray_Add(o->PeerFeatureSet, (int)((unsigned char*)(buffer + ptr + 20 + varLen + 4))[chunkIndex], (void*)0x01);
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Supported Extension: %d", (int)((unsigned char*)(buffer + ptr + 20 + varLen + 4))[chunkIndex]);
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Supported Extension: %d", (int)((unsigned char*)(buffer + ptr + 20 + varLen + 4))[chunkIndex]);
 							}
 							break;
 						default:
@@ -4763,6 +5792,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 					varLen += FOURBYTEBOUNDARY(tLen);	// Add parameter size and padding
 				}
 			}
+			o->interleaving = (unsigned char)ILibSCTP_DoesPeerSupportFeature(o, RCTP_CHUNK_TYPE_IDATA); // We always offer I-DATA, so it is used if the peer offered it too
 
 #ifdef _WEBRTCDEBUG
 			// Debug Events
@@ -4774,8 +5804,8 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			// Create response
 			{
 				long long uptime = ILibGetUptime();
-				char chunks[1] = {130};
-				ILibStun_AddSctpChunkHeader(rpacket, *rptr, RCTP_CHUNK_TYPE_INITACK, 0, 37);
+				char chunks[3] = { (char)RCTP_CHUNK_TYPE_RECONFIG, RCTP_CHUNK_TYPE_IDATA, (char)RCTP_CHUNK_TYPE_IFWDTSN };
+				ILibStun_AddSctpChunkHeader(rpacket, *rptr, RCTP_CHUNK_TYPE_INITACK, 0, 39);
 				*rptr += 4;
 				((ILibSCTP_InitAckChunk*)(rpacket + *rptr))->InitiateTag = o->tag;									// Initiate Tag
 				((ILibSCTP_InitAckChunk*)(rpacket + *rptr))->A_RWND = htonl(ILibSCTP_MaxReceiverCredits);			// Advertised Receiver Window Credit (a_rwnd)	
@@ -4783,9 +5813,9 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 				((ILibSCTP_InitAckChunk*)(rpacket + *rptr))->NumberOfInboundStreams = htons(o->maxInStreams);		// Number of Inbound Streams
 				((ILibSCTP_InitAckChunk*)(rpacket + *rptr))->InitialTSN = htonl(o->outtsn);							// Initial TSN
 				*rptr += sizeof(ILibSCTP_InitAckChunk);
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Setting Cookie: %s", ILibRemoteLogging_ConvertToHex((char*)&uptime, sizeof(uptime)));
+				ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Setting Cookie: %s", ILibRemoteLogging_ConvertToHex((char*)&uptime, sizeof(uptime)));
 				*rptr += ILibSCTP_AddOptionalVariableParameter(rpacket + *rptr, htons(SCTP_INIT_PARAM_STATE_COOKIE), (void*)&uptime, sizeof(uptime)); // Stick uptime as cookie, so we can calculate initial RTT
-				*rptr += ILibSCTP_AddOptionalVariableParameter(rpacket + *rptr, htons(SCTP_INIT_PARAM_SUPPORTED_EXTENSIONS), chunks, 1); // Supports RE-CONFIG
+				*rptr += ILibSCTP_AddOptionalVariableParameter(rpacket + *rptr, htons(SCTP_INIT_PARAM_SUPPORTED_EXTENSIONS), chunks, 3); // Supports RE-CONFIG, I-DATA and I-FORWARD-TSN
 			}
 			break;
 		case RCTP_CHUNK_TYPE_SACK:
@@ -4810,9 +5840,9 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			o->zeroWindowProbeTime = 0;
 			o->lastSackTime = (unsigned int)ILibGetUptime();
 
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP [SACK] Received");
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... TSN = %u", tsn);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... GAP Count = %u", GapAckCount);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP [SACK] Received");
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... TSN = %u", tsn);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... GAP Count = %u", GapAckCount);
 			if (GapAckCount > 0)
 			{
 				int y;
@@ -4820,7 +5850,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 				{
 					gstart = tsn + ntohs(((unsigned short*)(buffer + ptr + 16 + (y * 4)))[0]);	// Start of GAP Block
 					gend = tsn + ntohs(((unsigned short*)(buffer + ptr + 16 + (y * 4)))[1]);	// End of GAP Block
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... GAP [%u] - [%u]", gstart, gend);
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... GAP [%u] - [%u]", gstart, gend);
 				}
 			}
 
@@ -4829,7 +5859,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			{
 				// We have exited Fast Recovery Mode
 				o->FastRetransmitExitPoint = 0;
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d] has exited Fast-Recovery Mode (Sender Credits: %d / Receiver Credits: %d)", o->sessionId, o->senderCredits, o->receiverCredits);
+				ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d] has exited Fast-Recovery Mode (Sender Credits: %d / Receiver Credits: %d)", o->sessionId, o->senderCredits, o->receiverCredits);
 #ifdef _WEBRTCDEBUG
 				if (o->onFastRecovery != NULL){ o->onFastRecovery(o, "OnFastRecovery", 0); }
 #endif
@@ -4861,6 +5891,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 							if (o->RTO < RTO_MIN) { o->RTO = RTO_MIN; }
 							if (o->RTO > RTO_MAX) { o->RTO = RTO_MAX; }
 							rttCalculated = 1; // We only need to calculate this once for each packet received
+							if (o->congestionControl->OnRTTSample != NULL) { o->congestionControl->OnRTTSample(o, r); }
 #ifdef _WEBRTCDEBUG
 							if (o->onRTTCalculated != NULL) { o->onRTTCalculated(o, "OnRTTCalculated", o->SRTT); }
 							if (o->onRTTCalculated != NULL) { o->onRTTCalculated(o, "OnLastSackTime", o->lastSackTime); }
@@ -4877,7 +5908,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 				if (o->pendingQueueHead == NULL) { o->pendingQueueTail = NULL; }
 				else { tsnx = ntohl(((ILibSCTP_DataPayload*)((ILibSCTP_RPACKET*)o->pendingQueueHead)->Data)->TSN); }
 
-				free(rpacket);
+				ILibSCTP_PacketPool_Put(o, rpacket);
 				o->timervalue = 0; // This is a valid SACK, reset the timeout for packet resent				
 			}
 
@@ -4898,14 +5929,14 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 #endif
 			}
 
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...A_RWND: %u", arwnd);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...Sender Credits: %u", o->senderCredits);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...A_RWND: %u", arwnd);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...Sender Credits: %u", o->senderCredits);
 
 			if (o->pendingQueueHead == NULL)
 			{
 				o->senderCredits = o->congestionWindowSize;
 				o->PARTIAL_BYTES_ACKED = 0;
-				if(o->T3RTXTIME!=0) {ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: T3TX Timer OFF", o->sessionId);}
+				if(o->T3RTXTIME!=0) {ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: T3TX Timer OFF", o->sessionId);}
 				o->T3RTXTIME = 0;
 #ifdef _WEBRTCDEBUG
 				if (o->onT3RTX != NULL){ o->onT3RTX(o, "OnT3RTX", 0); } // All data has been ack'ed, so we can turn off the T3RTX timer
@@ -4917,25 +5948,20 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 				if (cumulativeTSNAdvanced > 0)
 				{
 					o->T3RTXTIME = o->lastSackTime;
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: T3TX Timer Restarted", o->sessionId);
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: T3TX Timer Restarted", o->sessionId);
 #ifdef _WEBRTCDEBUG
 					if (o->onT3RTX != NULL){ o->onT3RTX(o, "OnT3RTX", o->RTO); } // The lowest TSN has been ACK'ed, and there is still data pending, so restart the timer
 #endif
 				}
 			}
-			if (o->congestionWindowSize <= o->SSTHRESH && o->FastRetransmitExitPoint == 0 && cumulativeTSNAdvanced != 0 && o->congestionWindowSize < ILibSCTP_MaxReceiverCredits)
 			{
-				// When our window is smaller than the Slow Start Threshold, we can only grow our Window by the MIN of the total bytes ACK'ed, or one MTU
-				o->congestionWindowSize += MIN(cumulativeTSNAdvanced, ILibRUDP_StartMTU);
 #ifdef _WEBRTCDEBUG
-				if (o->onCongestionWindowSizeChanged != NULL) { o->onCongestionWindowSizeChanged(o, "OnCongestionWindowSizeChanged", o->congestionWindowSize); }
+				int oldWindowSize = o->congestionWindowSize;
+#endif
+				o->congestionControl->OnAck(o, cumulativeTSNAdvanced, pbc);
+#ifdef _WEBRTCDEBUG
+				if (o->onCongestionWindowSizeChanged != NULL && oldWindowSize != o->congestionWindowSize) { o->onCongestionWindowSizeChanged(o, "OnCongestionWindowSizeChanged", o->congestionWindowSize); }
 #endif
-			}
-			else if (o->congestionWindowSize > o->SSTHRESH && (int)(o->PARTIAL_BYTES_ACKED) >= o->congestionWindowSize && pbc >= o->congestionWindowSize)
-			{
-				// When our Congestion Window is greater than the Slow Start Threshold, we only grow our Window if we are fully utilizing our congestion window
-				o->congestionWindowSize += ILibRUDP_StartMTU;
-				o->PARTIAL_BYTES_ACKED = o->PARTIAL_BYTES_ACKED - o->congestionWindowSize;
 			}
 
 			//printf("ARK-STR %d GAPS, %d SENDS\r\n", GapAckCount, SendCount);
@@ -4987,12 +6013,11 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 #ifdef _WEBRTCDEBUG
 							if (o->onFastRecovery != NULL){ o->onFastRecovery(o, "OnFastRecovery", 1); }
 #endif
-							o->SSTHRESH = MAX((o->congestionWindowSize / 2), (4 * ILibRUDP_StartMTU));;
-							o->congestionWindowSize = o->SSTHRESH;
+							o->congestionControl->OnFastRetransmit(o);
 							o->senderCredits = MIN(o->senderCredits, o->congestionWindowSize);
 							o->PARTIAL_BYTES_ACKED = 0;
 							windowReset = 1;
-							ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Entering Fast-Retry Mode (Sender Credits: %d)", o->sessionId, o->senderCredits);
+							ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Entering Fast-Retry Mode (Sender Credits: %d)", o->sessionId, o->senderCredits);
 #ifdef _WEBRTCDEBUG
 							if (o->onCongestionWindowSizeChanged != NULL) { o->onCongestionWindowSizeChanged(o, "OnCongestionWindowSizeChanged", o->congestionWindowSize); }
 #endif
@@ -5008,7 +6033,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 							{
 								// We are re-transmitting the lowest outstanding TSN, restart the T3-RTX timer
 								o->T3RTXTIME = o->lastSackTime;
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Restarting T3RTX Timer (Retransmitting lowest TSN)", o->sessionId);
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Restarting T3RTX Timer (Retransmitting lowest TSN)", o->sessionId);
 #ifdef _WEBRTCDEBUG
 								if (o->onT3RTX != NULL){ o->onT3RTX(o, "OnT3RTX", o->RTO); }
 #endif
@@ -5017,7 +6042,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 							{
 								// Since we are not re-transmitting the lowest outstanding TSN, only start the T3-RTX timer, if it's not running
 								o->T3RTXTIME = o->lastSackTime;
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Restarting T3RTX Timer (Not retransmitting lowest TSN)", o->sessionId);
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Restarting T3RTX Timer (Not retransmitting lowest TSN)", o->sessionId);
 #ifdef _WEBRTCDEBUG
 								if (o->onT3RTX != NULL){ o->onT3RTX(o, "OnT3RTX", o->RTO); }
 #endif
@@ -5028,7 +6053,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 							rpacket->LastSentTimeStamp = o->lastSackTime;								// Update Send Time, used for retry
 							ILibStun_SendSctpPacket(obj, session, rpacket->Data - 12, rpacket->PacketSize);
 							rpacket->PacketResendCounter++;												// Add to the packet resent counter
-							ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...TSN=%u", ntohl(((ILibSCTP_DataPayload*)(rpacket->Data))->TSN));
+							ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...TSN=%u", ntohl(((ILibSCTP_DataPayload*)(rpacket->Data))->TSN));
 							//printf("RESEND COUNT %d, TSN=%u\r\n", ((unsigned char*)(packet + sizeof(char*) + 2))[0], tsnx);
 
 							FastRetryDisabled = 1;
@@ -5055,7 +6080,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 								o->senderCredits -= (rpacket->PacketSize - (12 + 16));		// Update sender credits
 								o->lastRetransmitTime = o->lastSackTime; // Every time we retransmit, we need to take note of it, for RTT purposes
 								
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Retransmitting/T3RTX Expired", o->sessionId);
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: Retransmitting/T3RTX Expired", o->sessionId);
 								ILibStun_SendSctpPacket(obj, session, rpacket->Data - 12, rpacket->PacketSize);
 #ifdef _WEBRTCDEBUG
 								//if (o->onSendRetry != NULL) { o->onSendRetry(obj, "OnSendRetry", ((unsigned short*)(rpacket->Data + sizeof(char*)))[0]); }
@@ -5066,7 +6091,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 							{
 								// No Sender Credits available, so we're just going to mark these packets for retransmit later (frt = 0xFF)
 								// (This block left blank on purpose, so we can include these comments)
-								ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: No sender credits available for retransmit", o->sessionId);
+								ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP[%d]: No sender credits available for retransmit", o->sessionId);
 							}
 						}
 					}
@@ -5099,59 +6124,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 
 			// Send any packets in the holding queue that we can, we do this because we may now have more credits
 			oldHoldCount = o->holdingCount;
-			while (o->receiverCredits > 0 && o->holdingQueueHead != NULL)
-			{
-				rpacket = (ILibSCTP_RPACKET*)o->holdingQueueHead;
-
-				// Check if we have sufficient credits to send the next packet
-				if (o->receiverCredits < (rpacket->PacketSize - (12 + 16))) break;
-				if (o->senderCredits < (rpacket->PacketSize - (12 + 16))) break;
-
-				// Remove the packet from the holding queue
-				o->holdingQueueHead = (char*)rpacket->NextPacket;	// Move to the next packet
-				if (o->holdingQueueHead == NULL) o->holdingQueueTail = NULL;
-				o->holdingCount--;
-
-#ifdef _WEBRTCDEBUG
-				// Debug Events
-				if (o->onHold != NULL) { o->onHold(o, "OnHold", o->holdingCount); }
-#endif
-
-				// Add the packet to the end of the pending queue
-				if (o->pendingQueueTail == NULL) { o->pendingQueueHead = (char*)rpacket; }
-				else { ((char**)(o->pendingQueueTail))[0] = (char*)rpacket; }
-				rpacket->NextPacket = NULL;
-				o->pendingQueueTail = (char*)rpacket;
-				o->pendingCount++;
-				o->pendingByteCount += (rpacket->PacketSize - (12 + 16));
-
-				// Remove the credits
-				o->senderCredits -= (rpacket->PacketSize - (12 + 16));
-				o->receiverCredits -= (rpacket->PacketSize - (12 + 16));
-				o->holdingByteCount -= (rpacket->PacketSize - (12 + 16));
-
-#ifdef _WEBRTCDEBUG
-				// Debug Events
-				if (o->onReceiverCredits != NULL) { o->onReceiverCredits(o, "OnReceiverCredits", o->receiverCredits); }
-#endif
-
-				if (o->T3RTXTIME == 0)
-				{
-					o->T3RTXTIME = o->lastSackTime;
-#ifdef _WEBRTCDEBUG
-					if (o->onT3RTX != NULL){ o->onT3RTX(o, "OnT3RTX", o->RTO); } // Restart the timer, because the timer isn't currently set
-#endif
-				}
-
-				// Update the packet retry data
-				rpacket->LastSentTimeStamp = o->lastSackTime;								// Last time the packet was sent (Used for retry)
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "Sending %u/%u bytes from Holding Queue", (rpacket->PacketSize - (12 + 16)), o->holdingByteCount);
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...TSN=%u", ntohl(((ILibSCTP_DataPayload*)rpacket->Data)->TSN));
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...LEN=%u", ntohs(((ILibSCTP_DataPayload*)rpacket->Data)->length));
-
-				// Send the packet
-				ILibStun_SendSctpPacket(obj, session, rpacket->Data - 12, rpacket->PacketSize);	// Send the packet
-			}
+			ILibStun_SctpSendHoldingQueue(obj, session, o->lastSackTime);
 
 			// If we can now send more packets, notify the application
 			if (obj->OnSendOK != NULL && o->holdingCount == 0 && oldHoldCount > 0)
@@ -5171,7 +6144,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			ILibStun_AddSctpChunkHeader(rpacket, *rptr, RCTP_CHUNK_TYPE_HEARTBEATACK, 0, chunksize);
 			memcpy_s(rpacket + *rptr + 4, 4092 - *rptr, buffer + ptr + 4, chunksize - 4);
 			*rptr += FOURBYTEBOUNDARY(chunksize);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Received [HEARTBEAT/%u]", session, ntohs(chunkHdr->chunkLength));
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Received [HEARTBEAT/%u]", session, ntohs(chunkHdr->chunkLength));
 			break;
 		case RCTP_CHUNK_TYPE_HEARTBEATACK:
 			RCTPDEBUG(printf("RCTP_CHUNK_TYPE_HEARTBEATACK, Size=%d\r\n", chunksize);)
@@ -5187,10 +6160,10 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 				{
 					ILibSCTP_ErrorCause_Header *cause = (ILibSCTP_ErrorCause_Header*)(chunkHdr->chunkData + start);
 					unsigned short causeLen = FOURBYTEBOUNDARY(ntohs(cause->CauseLength));
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d Received [ABORT:%u/%s]", session, ntohs(cause->CauseCode), SCTP_ERROR_CAUSE_TO_STRING(cause));
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d Received [ABORT:%u/%s]", session, ntohs(cause->CauseCode), SCTP_ERROR_CAUSE_TO_STRING(cause));
 					if(ntohs(cause->CauseCode)==SCTP_ERROR_CAUSE_CODE_PROTOCOL_VIOLATION)
 					{
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...%s", cause->CauseInformation);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...%s", cause->CauseInformation);
 					}
 					start += causeLen;
 				}				
@@ -5201,16 +6174,17 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 		case RCTP_CHUNK_TYPE_SHUTDOWNACK:
 		case RCTP_CHUNK_TYPE_ERROR:
 			ILibSpinLock_UnLock(&(o->Lock));
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [SHUTDOWN/ERROR] (%u)", session, chunktype);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [SHUTDOWN/ERROR] (%u)", session, chunktype);
 			ILibStun_SctpDisconnect(obj, session);
 			return;
 		case RCTP_CHUNK_TYPE_COOKIEECHO:
 			o->SRTT = (int)(ILibGetUptime() - *((long long*)(buffer + ptr + 4)));
 			o->RTTVAR = o->SRTT / 2;
 			o->RTO = o->SRTT + 4 * o->RTTVAR;
-			o->SSTHRESH = 4 * ILibRUDP_StartMTU;
+			o->SSTHRESH = ILibSCTP_InitialSSTHRESH;
 			if (o->RTO < RTO_MIN) { o->RTO = RTO_MIN; }
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [COOKIE-ECHO]", session);
+			if (o->congestionControl->OnRTTSample != NULL) { o->congestionControl->OnRTTSample(o, o->SRTT); }
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [COOKIE-ECHO]", session);
 
 			*rptr = ILibStun_AddSctpChunkHeader(rpacket, *rptr, RCTP_CHUNK_TYPE_COOKIEACK, 0, 4);
 			if (obj->OnConnect != NULL && o->state == 1)
@@ -5223,184 +6197,183 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			}
 			break;
 		case RCTP_CHUNK_TYPE_FWDTSN:
+		case RCTP_CHUNK_TYPE_IFWDTSN:
 		{
 			ILibSCTP_FwdTSNPayload *fdata = (ILibSCTP_FwdTSNPayload*)(buffer + ptr);
+			ILibSCTP_IFwdTSNPayload *ifdata = (ILibSCTP_IFwdTSNPayload*)(buffer + ptr);
 			int i;
-			int len = (htons(fdata->length) - 8) / 4;
-			void *holding;
+			int len = (htons(fdata->length) - 8) / (chunktype == RCTP_CHUNK_TYPE_IFWDTSN ? (int)sizeof(ILibSCTP_IFwdTSNPayload_Stream) : 4);
+			unsigned int x;
 			unsigned int NewTSN = ntohl(fdata->NewTSN);
-			ILibSCTP_DataPayload *data;
 			ILibSCTP_Accumulator *acc;
 
 			if (NewTSN <= o->intsn) { break; }	// Skip this FWD-TSN because it's stale
-			while ((holding = ILibLinkedList_GetNode_Head(o->receiveHoldBuffer)) != NULL && (data = (ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(holding)) != NULL && data->TSN <= NewTSN)
+			for (x = o->userTSN + 1; o->receiveHold.count > 0 && (int)(NewTSN - x) >= 0 && x - (o->userTSN + 1) < ILibSCTP_ReorderBuffer_Capacity; ++x)
 			{
-				free(data);
-				ILibLinkedList_Remove(holding);
+				ILibSCTP_ReorderBuffer_Remove(&(o->receiveHold), x);
 			}
+			if ((int)(NewTSN - o->userTSN) > 0) { o->userTSN = NewTSN; } // The abandoned chunks will never be delivered, so the user is caught up to NewTSN
 			
 			for (i = 0; i < len; ++i)
 			{
+				if (chunktype == RCTP_CHUNK_TYPE_IFWDTSN)
+				{
+					// Abort the Re-Assembly of every message on this stream, up to and including the skipped Message Identifier
+					acc = (ILibSCTP_Accumulator*)ILibSparseArray_Get(o->DataAccumulator, ntohs(ifdata->SkippedStreams[i].StreamNumber));
+					for (; acc != NULL; acc = acc->next)
+					{
+						if (acc->unordered == (ntohs(ifdata->SkippedStreams[i].Flags) & 0x01) && (int)(ntohl(ifdata->SkippedStreams[i].MessageID) - acc->messageId) >= 0) { acc->bufferPtr = -1; }
+					}
+					continue;
+				}
 				acc = (ILibSCTP_Accumulator*)ILibSparseArray_Get(o->DataAccumulator, ntohl(fdata->SkippedStreams[i].StreamNumber));
 				if (acc != NULL) { acc->bufferPtr = -1; } // If an accumulator was created, reset the bufferPtr to abort the Re-Assembly
 			}
 
 			o->intsn = NewTSN;
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [FWDTSN]", session);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Updated TSN to: %u", NewTSN);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d received [FWDTSN]", session);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Updated TSN to: %u", NewTSN);
 		}
 			break;
 		case RCTP_CHUNK_TYPE_DATA:
+		case RCTP_CHUNK_TYPE_IDATA:
 		{
-			void* holdingNode;
+			ILibSCTP_DataPayload *holding;
 			unsigned int tsn;
 			unsigned short streamId;
-			unsigned short streamSeq;
-			unsigned int pid;
+			unsigned int streamSeq;
+			int pid;
 			ILibSCTP_DataPayload *data;
-			int pulled = 0;
+			char *userData;
+			int userDataLen;
 
 			RCTPDEBUG(printf("RCTP_CHUNK_TYPE_DATA, Flags=%d, Size=%d\r\n", chunkflags, chunksize);)
+			if (chunksize < (chunktype == RCTP_CHUNK_TYPE_IDATA ? sizeof(ILibSCTP_IDataPayload) : sizeof(ILibSCTP_DataPayload))) { break; }
 			data = (ILibSCTP_DataPayload*)(buffer + ptr);
 			tsn = ntohl(data->TSN);
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP [DATA] Received");
-			ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... TSN = %u", tsn);
+			ILibSCTP_ReceiveWindow_Update(o, chunksize);
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP [DATA] Received");
+			ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... TSN = %u", tsn);
 
 			if ((chunkflags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag && ((chunkflags & 0x03) == 0x03))
 			{
 				// 'Unordered Delivery' was specified, and we have a full fragment, Propagate Data up the stack immediately
-				streamId = ntohs(data->StreamID);
-				pid = ntohl(data->ProtocolID);
+				unsigned char flagsx = ILibSCTP_ParseDataChunk(data, &streamId, &streamSeq, &pid, &userData, &userDataLen);
 
 				if (tsn == o->intsn + 1)
 				{
-					ILibStun_SctpProcessStreamData(obj, session, streamId, 0, chunkflags, pid, data->UserData, chunksize - 16);
+					ILibStun_SctpProcessStreamData(obj, session, streamId, streamSeq, flagsx, pid, userData, userDataLen);
 				}
-				else if (tsn > o->intsn + 1 && ILibLinkedList_GetNode_Search(o->receiveHoldBuffer, &ILibSCTP_HoldingQueue_TSNComparer, data) == NULL)
+				else if (tsn > o->intsn + 1 && ILibSCTP_ReorderBuffer_Get(&(o->receiveHold), tsn) == NULL)
 				{
-					ILibStun_SctpProcessStreamData(obj, session, streamId, 0, chunkflags, pid, data->UserData, chunksize - 16);
+					ILibStun_SctpProcessStreamData(obj, session, streamId, streamSeq, flagsx, pid, userData, userDataLen);
 				}
 			}
 
 			if (tsn == o->intsn + 1)
 			{
-				void* rqptr;
-				o->intsn = tsn;
-				streamId = ntohs(data->StreamID);
-				streamSeq = ntohs(data->StreamSequenceNumber);
-				pid = ntohl(data->ProtocolID);
+				unsigned char flagsx;
+				flagsx = ILibSCTP_ParseDataChunk(data, &streamId, &streamSeq, &pid, &userData, &userDataLen);
 
 				RCTPRCVDEBUG(printf("GOT %u, size = %d\r\n", tsn, chunksize);)
-				RCTPDEBUG(printf("IN DATA_CHUNK FLAGS: %d, TSN: %u, ID: %d, SEQ: %d, PID: %u, SIZE: %d\r\n", chunkflags, tsn, streamId, streamSeq, pid, chunksize - 16);)
+				RCTPDEBUG(printf("IN DATA_CHUNK FLAGS: %d, TSN: %u, ID: %d, SEQ: %u, PID: %d, SIZE: %d\r\n", chunkflags, tsn, streamId, streamSeq, pid, userDataLen);)
 
-				if((o->flags & DTLS_PAUSE_FLAG)==DTLS_PAUSE_FLAG || (o->userTSN < o->intsn - 1))
+				if((o->flags & DTLS_PAUSE_FLAG)==DTLS_PAUSE_FLAG || (o->userTSN < tsn - 1))
 				{
 					// We are paused, so we need to buffer this packet for later. (Or, the userTSN isn't caught up yet)
-					holdingNode = ILibSCTP_AddPacketToHoldingQueue(o, data, &sentsack);
-					if (holdingNode != NULL)
+					holding = ILibSCTP_AddPacketToHoldingQueue(o, data, &sentsack);
+					if (holding != NULL)
 					{
-						ILibSCTP_GetHoldingQueueFlags(holdingNode)->DataPropagated = ((chunkflags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag);
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u Buffered, due to PAUSE", o->sessionId, ntohl(data->TSN));
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... UserTSN = %u", o->userTSN);
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... InTSN   = %u", o->intsn);
+						o->intsn = tsn; // Only acknowledge the chunk once it is held, a dropped chunk must be retransmitted
+						o->receiveHold.propagated[ILibSCTP_ReorderBuffer_Slot(tsn)] = ((chunkflags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u Buffered, due to PAUSE", o->sessionId, ntohl(data->TSN));
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... UserTSN = %u", o->userTSN);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... InTSN   = %u", o->intsn);
 					}
 					else
 					{
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u DROPPED, because holding Queue is FULL", o->sessionId, ntohl(data->TSN));
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... UserTSN = %u", o->userTSN);
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... InTSN   = %u", o->intsn);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u DROPPED, because holding Queue is FULL", o->sessionId, ntohl(data->TSN));
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... UserTSN = %u", o->userTSN);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "... InTSN   = %u", o->intsn);
 					}
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d, exiting processing loop due to PAUSE state", o->sessionId);
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d, exiting processing loop due to PAUSE state", o->sessionId);
 					break;
 				}
 				else
 				{
+					o->intsn = tsn;
 					o->userTSN = o->intsn;
 				}
 
 				// Move the TSN as forward as we can
-				rqptr = ILibLinkedList_GetNode_Head(o->receiveHoldBuffer);
-				while (rqptr != NULL)
+				while (ILibSCTP_ReorderBuffer_Get(&(o->receiveHold), o->intsn + 1) != NULL)
 				{
-					unsigned int tsnx = (ILibLinkedList_GetDataFromNode(rqptr) == NULL ? 0 : ntohl(((ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(rqptr))->TSN));
-					if (tsnx != o->intsn + 1) break;
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "TSN Moved Forward to: %u", tsnx);
-					o->intsn = tsnx;
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "TSN Moved Forward to: %u", o->intsn + 1);
+					++o->intsn;
 					RCTPRCVDEBUG(printf("MOVED TSN to %u\r\n", o->intsn);)
-						rqptr = ILibLinkedList_GetNextNode(rqptr);
 				}
 
 
-				// TODO: Optimize this, send SACK only after a little bit of time (or every 3 packets or so). Or only in some cases.
-				if (sentsack == ILibSCTP_SackStatus_NotSent)
-				{
-					sentsack = ILibSCTP_SackStatus_Sent;
-					*rptr = ILibStun_SctpAddSackChunk(obj, session, rpacket, *rptr); // Send the ACK with the TSN as far forward as we can
-				}
+				// In-sequence DATA is acknowledged once the whole packet was processed, so the SACK can be delayed or bundled (RFC 4960, Section 6.2)
+				sackDue = 1;
 
 				if ((chunkflags & ILibSCTP_UnorderedFlag) != ILibSCTP_UnorderedFlag || ((chunkflags & 0x03) != 0x03))
 				{
 					// Only continue processing here, if 'Unordered Delivery' was not specified, or we have a partial fragment
 					ILibSpinLock_UnLock(&(o->Lock));
-					ILibStun_SctpProcessStreamData(obj, session, streamId, streamSeq, chunkflags, pid, data->UserData, chunksize - 16);
+					ILibStun_SctpProcessStreamData(obj, session, streamId, streamSeq, flagsx, pid, userData, userDataLen);
 					if (obj->dTlsSessions[session] == NULL || obj->dTlsSessions[session]->state == 0) return;
 					ILibSpinLock_Lock(&(o->Lock));
 				}
 
 				// Pull as many packets as we can out of the receive hold queue
-				pulled = 0;
-				while (ILibLinkedList_GetCount(o->receiveHoldBuffer) > 0)
+				while ((holding = ILibSCTP_ReorderBuffer_Get(&(o->receiveHold), o->userTSN + 1)) != NULL)
 				{
-					ILibSCTP_DataPayload *payload = (ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(ILibLinkedList_GetNode_Head(o->receiveHoldBuffer));
-					unsigned char chunkflagsx = payload->flags;
+					ILibSCTP_DataPayload *payload = holding;
+					unsigned char chunkflagsx;
 					unsigned int tsnx = ntohl(payload->TSN);
-					unsigned short chunksizex = ntohs(payload->length);
-					if ((tsnx > o->intsn + 1) || (tsnx > o->userTSN + 1)) break; // This is not the next expected packet
+					if (tsnx > o->intsn + 1) break; // This is not the next expected packet
 					
-					pulled += payload->length;
-					RCTPRCVDEBUG(printf("UNSTORING %u, size = %d\r\n", tsnx, chunksizex);)
+					RCTPRCVDEBUG(printf("UNSTORING %u, size = %d\r\n", tsnx, ntohs(payload->length));)
 
-					streamId = ntohs(payload->StreamID);
-					streamSeq = ntohs(payload->StreamSequenceNumber);
-					pid = ntohl(payload->ProtocolID);
-					o->userTSN = o->intsn = tsnx;
+					chunkflagsx = ILibSCTP_ParseDataChunk(payload, &streamId, &streamSeq, &pid, &userData, &userDataLen);
+					o->userTSN = tsnx;
+					if (tsnx > o->intsn) { o->intsn = tsnx; }
 
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u Pulled from Holding Queue", o->sessionId, o->userTSN);
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u Pulled from Holding Queue", o->sessionId, o->userTSN);
 
-					if (ILibSCTP_GetHoldingQueueFlags(ILibLinkedList_GetNode_Head(o->receiveHoldBuffer))->DataPropagated == 0)
+					if (o->receiveHold.propagated[ILibSCTP_ReorderBuffer_Slot(tsnx)] == 0)
 					{
 						// Only propagate this up, if it hasn't been propagated already
 						ILibSpinLock_UnLock(&(o->Lock));
-						ILibStun_SctpProcessStreamData(obj, session, streamId, streamSeq, chunkflagsx, pid, payload->UserData, chunksizex - 16);
+						ILibStun_SctpProcessStreamData(obj, session, streamId, streamSeq, chunkflagsx, pid, userData, userDataLen);
 						if (obj->dTlsSessions[session] == NULL || obj->dTlsSessions[session]->state == 0) return;
 						ILibSpinLock_Lock(&(o->Lock));
 					}
 
-					free(payload);
-					ILibLinkedList_Remove(ILibLinkedList_GetNode_Head(o->receiveHoldBuffer));
+					ILibSCTP_ReorderBuffer_Remove(&(o->receiveHold), tsnx);
 					if((o->flags & DTLS_PAUSE_FLAG)==DTLS_PAUSE_FLAG) 
 					{
-						ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP_2: %d, exiting processing loop due to PAUSE state", o->sessionId);
+						ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP_2: %d, exiting processing loop due to PAUSE state", o->sessionId);
 						break;
 					}
 				}
-				if (pulled > 0) ReceiveHoldBuffer_Decrement(o->receiveHoldBuffer, pulled);
 			}
 			else if (tsn > o->intsn + 1)
 			{
 				// This is an out of order packet, so lets buffer it for later
-				holdingNode = ILibSCTP_AddPacketToHoldingQueue(o, data, &sentsack);
-				if (holdingNode != NULL)
+				holding = ILibSCTP_AddPacketToHoldingQueue(o, data, &sentsack);
+				if (holding != NULL)
 				{
-					ILibSCTP_GetHoldingQueueFlags(holdingNode)->DataPropagated = (((chunkflags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag) && ((chunkflags & 0x03) == 0x03));
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u Buffered, out of order", o->sessionId, ntohl(data->TSN));
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...Expected: %u", o->intsn + 1);
+					o->receiveHold.propagated[ILibSCTP_ReorderBuffer_Slot(tsn)] = (((chunkflags & ILibSCTP_UnorderedFlag) == ILibSCTP_UnorderedFlag) && ((chunkflags & 0x03) == 0x03));
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "SCTP: %d Packet: %u Buffered, out of order", o->sessionId, ntohl(data->TSN));
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_3, "...Expected: %u", o->intsn + 1);
 				}
 				else
 				{
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d Packet: %u DROPPED, because holding Queue is FULL", o->sessionId, ntohl(data->TSN));
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... UserTSN = %u", o->userTSN);
-					ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... InTSN   = %u", o->intsn);
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d Packet: %u DROPPED, because holding Queue is FULL", o->sessionId, ntohl(data->TSN));
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... UserTSN = %u", o->userTSN);
+					ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "... InTSN   = %u", o->intsn);
 
 				}
 			}
@@ -5408,7 +6381,7 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 			{
 				// Already received packet.
 				RCTPRCVDEBUG(printf("TOSSING %u, size = %d\r\n", tsn, chunksize);)
-				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d Packet: %u dropped, duplicate... Expected: %u", o->sessionId, ntohl(data->TSN), o->intsn + 1);
+				ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d Packet: %u dropped, duplicate... Expected: %u", o->sessionId, ntohl(data->TSN), o->intsn + 1);
 
 				// Send ACK now
 				if (sentsack == 0)
@@ -5425,10 +6398,26 @@ void ILibStun_ProcessSctpPacket(struct ILibStun_Module *obj, int session, char*
 		}
 
 		ptr += FOURBYTEBOUNDARY(chunksize); // Add chunk size and padding
-		ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Buffer Index =  %d", ptr);
+		ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_2, "...Buffer Index =  %d", ptr);
 	}
-	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Stopped Reading SCTP, rptr = %d", *rptr);
+	ILibRemoteLogging_printfEx(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...Stopped Reading SCTP, rptr = %d", *rptr);
 	if (session == -1) { ILibSpinLock_UnLock(&(o->Lock)); return; }
+	if (sackDue != 0 && sentsack == ILibSCTP_SackStatus_NotSent)
+	{
+		// Send the SACK now if this is the second packet since the last one, if there are gaps, or if it can ride along with outbound DATA.
+		// Otherwise, hold it for up to ILibSCTP_DelayedSackTimeout milliseconds.
+		if (++o->sackPacketCount >= ILibSCTP_DelayedSackPacketCount || o->receiveHold.count > 0 || (((int*)rpacket)[2] & SCTP_COMMON_HEADER_FLAGS_DATA) == SCTP_COMMON_HEADER_FLAGS_DATA)
+		{
+			sentsack = ILibSCTP_SackStatus_Sent;
+			*rptr = ILibStun_SctpAddSackChunk(obj, session, rpacket, *rptr); // Send the ACK with the TSN as far forward as we can
+		}
+		else if (o->sackDelayed == 0)
+		{
+			o->sackDelayed = 1;
+			ILibLifeTime_AddEx(obj->Timer, ILibWebRTC_DTLS_TO_DELAYED_SACK_TIMER_OBJECT(o), ILibSCTP_DelayedSackTimeout, ILibStun_SctpDelayedSack_Sink, NULL);
+		}
+	}
+	if (sentsack == ILibSCTP_SackStatus_Sent) { ILibStun_SctpSackSent(o); }
 	if (*rptr > 12) 
 	{
 #ifdef _REMOTELOGGING
@@ -5466,10 +6455,13 @@ void ILibSCTP_Resume(void* sctpSession)
 {
 	struct ILibStun_dTlsSession* obj = (struct ILibStun_dTlsSession*)sctpSession;
 	struct ILibStun_Module *sobj = obj->parent;
-	void *node;
 	ILibSCTP_DataPayload *payload;
 	int sessionID = obj->sessionId;
-	int pulled = 0;
+	unsigned short streamId;
+	unsigned int messageId;
+	int pid, datalen;
+	char *data;
+	unsigned char chunkflags;
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d RESUME operation begin", obj->sessionId);
 
@@ -5480,26 +6472,20 @@ void ILibSCTP_Resume(void* sctpSession)
 	}
 
 	// Check the receive hold buffer to see if there are any packets we need to propagate
-	while((node = ILibLinkedList_GetNode_Head(obj->receiveHoldBuffer)) != NULL && (payload = (ILibSCTP_DataPayload*)ILibLinkedList_GetDataFromNode(node)) != NULL)
+	while((payload = ILibSCTP_ReorderBuffer_Get(&(obj->receiveHold), obj->userTSN + 1)) != NULL)
 	{
-		if(ntohl(payload->TSN) == obj->userTSN + 1)
+		// This packet is the next expected packet for the user
+		obj->userTSN = ntohl(payload->TSN);
+		if (obj->receiveHold.propagated[ILibSCTP_ReorderBuffer_Slot(obj->userTSN)] == 0)
 		{
-			// This packet is the next expected packet for the user
-			obj->userTSN = ntohl(payload->TSN);
-			pulled += payload->length;
+			chunkflags = ILibSCTP_ParseDataChunk(payload, &streamId, &messageId, &pid, &data, &datalen);
 			ILibSpinLock_UnLock(&(obj->Lock));
-			ILibStun_SctpProcessStreamData(obj->parent, obj->sessionId, ntohs(payload->StreamID), ntohs(payload->StreamSequenceNumber), payload->flags, ntohl(payload->ProtocolID), payload->UserData, ntohs(payload->length) - 16);
+			ILibStun_SctpProcessStreamData(obj->parent, obj->sessionId, streamId, messageId, chunkflags, pid, data, datalen);
 			if (sobj->dTlsSessions[sessionID] == NULL || sobj->dTlsSessions[sessionID]->state == 0) return; // Referencing Dtls object this way, in case it was closed/freed by the user in the last call
 			ILibSpinLock_Lock(&(obj->Lock));
-			free(payload);
-			ILibLinkedList_Remove(node);
-		}
-		else
-		{
-			break;
 		}
+		ILibSCTP_ReorderBuffer_Remove(&(obj->receiveHold), obj->userTSN);
 	}
-	if (pulled > 0) ReceiveHoldBuffer_Decrement(obj->receiveHoldBuffer, pulled);
 	ILibSpinLock_UnLock(&(obj->Lock));
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->Transport.ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "SCTP: %d RESUME operation complete", sessionID);
 }
@@ -5510,7 +6496,7 @@ void ILibStun_InitiateSCTP(struct ILibStun_Module *obj, int session, unsigned sh
 	char buffer[32 + 12];
 	int ptr;
 	unsigned int initiateTag;
-	char chunks[1] = { 130 };
+	char chunks[3] = { (char)RCTP_CHUNK_TYPE_RECONFIG, RCTP_CHUNK_TYPE_IDATA, (char)RCTP_CHUNK_TYPE_IFWDTSN };
 
 	obj->dTlsSessions[session]->inport = sourcePort;
 	obj->dTlsSessions[session]->outport = destinationPort;
@@ -5539,7 +6525,7 @@ void ILibStun_InitiateSCTP(struct ILibStun_Module *obj, int session, unsigned sh
 	ptr += 4;
 
 	ptr += ILibSCTP_AddOptionalVariableParameter(buffer + ptr, htons(SCTP_INIT_PARAM_UNRELIABLE_STREAM), NULL, 0);		// Supports UNRELIABLE
-	ptr += ILibSCTP_AddOptionalVariableParameter(buffer + ptr, htons(SCTP_INIT_PARAM_SUPPORTED_EXTENSIONS), chunks, 1); // Supports RE-CONFIG
+	ptr += ILibSCTP_AddOptionalVariableParameter(buffer + ptr, htons(SCTP_INIT_PARAM_SUPPORTED_EXTENSIONS), chunks, 3); // Supports RE-CONFIG, I-DATA and I-FORWARD-TSN
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "Initiating SCTP...");
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_SCTP, ILibRemoteLogging_Flags_VerbosityLevel_1, "...TSN/IN = %u", obj->dTlsSessions[session]->outtsn);
@@ -5648,6 +6634,7 @@ ILibWebRTC_DataChannel_CloseStatus ILibWebRTC_CloseDataChannelEx2(void *WebRTCMo
 
 			req->parameterType = htons(SCTP_RECONFIG_TYPE_OUTGOING_SSN_RESET_REQUEST);
 			req->parameterLength = htons((unsigned short)(16 + 2*streamIdLength));
+			ILibSCTP_Scheduler_Flush(obj); // Interleaved fragments that are still waiting must be covered by LastTSN
 			req->LastTSN = htonl(obj->outtsn-1);
 
 			req->RReqSeqNum = htonl(obj->RREQSEQ++);
@@ -5771,6 +6758,11 @@ void ILibStun_CreateDtlsSession(struct ILibStun_Module *obj, int sessionId, int
 	memcpy_s(obj->dTlsSessions[sessionId]->remoteInterface, sizeof(struct sockaddr_in6), remoteInterface, INET_SOCKADDR_LENGTH(remoteInterface->sin6_family));
 	obj->dTlsSessions[sessionId]->senderCredits = 4 * ILibRUDP_StartMTU;
 	obj->dTlsSessions[sessionId]->congestionWindowSize = 4 * ILibRUDP_StartMTU;
+	obj->dTlsSessions[sessionId]->SSTHRESH = ILibSCTP_InitialSSTHRESH;		// The side that receives the COOKIE-ECHO also sets these from the handshake RTT,
+	obj->dTlsSessions[sessionId]->RTO = RTO_INITIAL;						// but the side that sends it relies on these until its first RTT sample
+	obj->dTlsSessions[sessionId]->congestionControl = ILibSCTP_GetCongestionControlOps(obj->defaultCongestionControl);
+	obj->dTlsSessions[sessionId]->pacingEnabled = obj->defaultPacing;
+	obj->dTlsSessions[sessionId]->receiveWindow = ILibSCTP_MaxReceiverCredits;
 	obj->dTlsSessions[sessionId]->ssl = SSL_new(obj->SecurityContext);
 
 	SSL_set_ex_data(obj->dTlsSessions[sessionId]->ssl, ILibStunClientIndex, obj);
@@ -5779,7 +6771,6 @@ void ILibStun_CreateDtlsSession(struct ILibStun_Module *obj, int sessionId, int
 	obj->dTlsSessions[sessionId]->rpacketsize = 4096;
 
 	ILibWebRTC_CreateSparseArrayTables(obj->dTlsSessions[sessionId]);
-	obj->dTlsSessions[sessionId]->receiveHoldBuffer = ILibLinkedList_CreateEx(sizeof(int));
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_DTLS, ILibRemoteLogging_Flags_VerbosityLevel_1, "New DTLS Session: %d linked to IceStateSlot: %d using %s:%u", sessionId, iceSlot, ILibRemoteLogging_ConvertAddress((struct sockaddr*)remoteInterface), htons(remoteInterface->sin6_port));
 }
@@ -5808,6 +6799,7 @@ void ILibStun_InitiateDTLS(struct ILibStun_IceState *IceState, int IceSlot, stru
 	BIO_get_mem_ptr(obj->dTlsSessions[j]->writeBIO, &(obj->dTlsSessions[j]->writeBIOBuffer));
 	BIO_set_mem_eof_return(read, -1);
 	BIO_set_mem_eof_return(write, -1);
+	ILibStun_ReserveDtlsBuffer(write);
 
 	// Bind everything
 	SSL_set_bio(obj->dTlsSessions[j]->ssl, read, write); // MS Static Code Analysis erroneously reports this could be NULL, becuase it was too dumb to see it was initialized in ILibStun_CreateDtlsSession()
@@ -5890,11 +6882,9 @@ void ILibStun_DTLS_Success_OnCreateTURNChannelBinding(ILibTURN_ClientModule turn
 		// We must initiate SCTP
 		ILibStun_InitiateSCTP(obj, (int)channelNumber, 5000, 5000);
 	}
-	else
-	{
-		// Start the timer, for SCTP Heartbeats
-		ILibLifeTime_AddEx(obj->Timer, ILibWebRTC_DTLS_TO_SCTP_HEARTBEAT_TIMER_OBJECT(obj->dTlsSessions[(int)channelNumber]), 100, &ILibStun_SctpOnTimeout, NULL);
-	}
+
+	// Start the timer, for SCTP Heartbeats. This also drives T3-RTX retransmissions, so the initiating side needs it too
+	ILibLifeTime_AddEx(obj->Timer, ILibWebRTC_DTLS_TO_SCTP_HEARTBEAT_TIMER_OBJECT(obj->dTlsSessions[(int)channelNumber]), 100, &ILibStun_SctpOnTimeout, NULL);
 	
 }
 void ILibStun_DTLS_Success_OnCreateTURNChannelBinding2(ILibTURN_ClientModule turnModule, unsigned short channelNumber, int success, void* user)
@@ -5918,7 +6908,7 @@ void ILibStun_DTLS_Success(struct ILibStun_Module *obj, int session, struct sock
 
 	ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_DTLS, ILibRemoteLogging_Flags_VerbosityLevel_1, "DTLS Session: %d [Handshake SUCCESS]", session);
 
-	obj->dTlsSessions[session]->SSTHRESH = 4 * ILibRUDP_StartMTU;
+	obj->dTlsSessions[session]->SSTHRESH = ILibSCTP_InitialSSTHRESH;
 
 	IceSlot = obj->dTlsSessions[session]->iceStateSlot;
 	if (IceSlot >= 0)
@@ -5934,6 +6924,9 @@ void ILibStun_DTLS_Success(struct ILibStun_Module *obj, int session, struct sock
 		{
 			// Since the remote side didn't initiate the offer, we must initiate SCTP
 			ILibStun_InitiateSCTP(obj, session, 5000, 5000);
+
+			// Start the timer, for SCTP Heartbeats. This also drives T3-RTX retransmissions, so the initiating side needs it too
+			ILibLifeTime_AddEx(obj->Timer, ILibWebRTC_DTLS_TO_SCTP_HEARTBEAT_TIMER_OBJECT(obj->dTlsSessions[session]), 100, &ILibStun_SctpOnTimeout, NULL);
 		}
 		else
 		{
@@ -6112,6 +7105,7 @@ void ILibStun_OnUDP(ILibAsyncUDPSocket_SocketModule socketModule, char* buffer,
 		BIO_get_mem_ptr(obj->dTlsSessions[j]->writeBIO, &(obj->dTlsSessions[j]->writeBIOBuffer));
 		BIO_set_mem_eof_return(read, -1);
 		BIO_set_mem_eof_return(write, -1);
+		ILibStun_ReserveDtlsBuffer(write);
 
 		// Bind everything
 		SSL_set_bio(obj->dTlsSessions[j]->ssl, read, write);
@@ -6208,14 +7202,20 @@ void ILibStun_OnUDP(ILibAsyncUDPSocket_SocketModule socketModule, char* buffer,
 		}
 		else
 		{
-			i = SSL_read(obj->dTlsSessions[existingSession]->ssl, tbuffer, 4096);
-			ILibSpinLock_UnLock(&(obj->dTlsSessions[existingSession]->Lock));
-			if (i > 0)
+			// A datagram can carry several coalesced DTLS records, and SSL_read() returns one record at a time, so keep reading until the
+			// datagram is drained. Otherwise the remaining records would sit in the read BIO until the next datagram arrives.
+			while ((i = SSL_read(obj->dTlsSessions[existingSession]->ssl, tbuffer, 4096)) > 0)
 			{
 				// We got new dTLS data
+				ILibSpinLock_UnLock(&(obj->dTlsSessions[existingSession]->Lock));
 				ILibStun_ProcessSctpPacket(obj, existingSession, tbuffer, i);
+				if (obj->dTlsSessions[existingSession] == NULL || obj->dTlsSessions[existingSession]->state == 0) { break; }
+				ILibSpinLock_Lock(&(obj->dTlsSessions[existingSession]->Lock));
 			}
-			else if (i == 0)
+			if (i > 0) { return; } // The session was closed while processing a record
+
+			ILibSpinLock_UnLock(&(obj->dTlsSessions[existingSession]->Lock));
+			if (i == 0)
 			{
 				// Session closed, perform cleanup
 				ILibRemoteLogging_printf(ILibChainGetLogger(obj->ChainLink.ParentChain), ILibRemoteLogging_Modules_WebRTC_DTLS, ILibRemoteLogging_Flags_VerbosityLevel_1, "DTLS Session: %d was closed", existingSession);
@@ -6255,6 +7255,7 @@ void ILibStun_OnUDP(ILibAsyncUDPSocket_SocketModule socketModule, char* buffer,
 				}
 				if(obj->dTlsSessions[existingSession]->state == 4) {ILibWebRTC_DTLS_HandshakeDetect(obj, "S ", obj->dTlsSessions[existingSession]->writeBIOBuffer->data, 0, (int)obj->dTlsSessions[existingSession]->writeBIOBuffer->length);}
 				ignore_result(BIO_reset(obj->dTlsSessions[existingSession]->writeBIO));
+				obj->dTlsSessions[existingSession]->dtlsCoalesced = 0; // Any coalesced records went out with this datagram
 			}
 			ILibSpinLock_UnLock(&(obj->dTlsSessions[existingSession]->Lock));
 		}
@@ -6453,6 +7454,24 @@ void ILibWebRTC_DisableConsentFreshness(void *stunModule)
 	struct ILibStun_Module *obj = (struct ILibStun_Module*)stunModule;
 	obj->consentFreshnessDisabled = 1;
 }
+// Returns nonzero if the CPU has AES and carry-less multiply instructions, which OpenSSL uses to run AES-GCM in hardware
+int ILibStun_DtlsHardwareAES()
+{
+#if defined(ILibStun_HWAES_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	return((__builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul")) ? 1 : 0);
+#elif defined(ILibStun_HWAES_X86)
+	int info[4];
+	__cpuid(info, 1);
+	return(((info[2] & (1 << 25)) != 0 && (info[2] & (1 << 1)) != 0) ? 1 : 0);
+#elif defined(ILibStun_HWAES_ARMV8)
+	return(((getauxval(AT_HWCAP) & HWCAP_AES) != 0 && (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0) ? 1 : 0);
+#elif defined(__aarch64__) && defined(__APPLE__)
+	return(1);
+#else
+	return(0);
+#endif
+}
 //! Set Security Attributes for STUN/ICE/WebRTC
 /*!
 	\param StunModule The Stun client to update (obtained from ILibStunClient_Start)
@@ -6476,6 +7495,8 @@ void ILibStunClient_SetOptions(void* StunModule, SSL_CTX* securityContext, char*
 		//SSL_CTX_set_ecdh_auto(obj->SecurityContext, 1);	// DEPRECATED in OpenSSL/1.1.x
 		SSL_CTX_set_session_cache_mode(obj->SecurityContext, SSL_SESS_CACHE_OFF);
 		SSL_CTX_set_read_ahead(obj->SecurityContext, 1);
+		SSL_CTX_set_cipher_list(obj->SecurityContext, ILibStun_DtlsHardwareAES() != 0 ? ILibStun_DtlsCipherList_AES : ILibStun_DtlsCipherList_ChaCha);
+		SSL_CTX_set_options(obj->SecurityContext, SSL_OP_CIPHER_SERVER_PREFERENCE);
 		SSL_CTX_set_verify(obj->SecurityContext, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, ILibStunClient_dTLS_verify_callback);
 	}
 }
@@ -6505,10 +7526,15 @@ void* ILibStunClient_Start(void *Chain, unsigned short LocalPort, ILibStunClient
 	obj->LocalIf6.sin6_family = AF_INET6;
 	obj->LocalIf6.sin6_port = htons(LocalPort);
 	obj->ChainLink.ParentChain = Chain;
+	obj->ChainLink.PreSelectHandler = &ILibStun_PreSelect;
+	obj->ChainLink.PostSelectHandler = &ILibStun_PostSelect;
 	obj->ChainLink.DestroyHandler = &ILibStun_OnDestroy;
 	obj->UDP = ILibAsyncUDPSocket_CreateEx(Chain, ILibRUDP_MaxMTU, (struct sockaddr*)&(obj->LocalIf), ILibAsyncUDPSocket_Reuse_EXCLUSIVE, &ILibStun_OnUDP, NULL, obj);
 	if (obj->UDP == NULL) { free(obj); return NULL; }
 	ILibChain_Link_SetMetadata(obj->UDP, "ILibWebRTC_stun_listener_ipv4");
+#ifdef ILibAsyncSocket_MMSG_SUPPORTED
+	ILibAsyncSocket_SetDatagramBatching(obj->UDP, 1);	// All STUN, DTLS and SCTP traffic goes through this socket, so read and write it in batches
+#endif
 #ifdef WIN32
 	obj->UDP6 = ILibAsyncUDPSocket_CreateEx(Chain, ILibRUDP_MaxMTU, (struct sockaddr*)&(obj->LocalIf6), ILibAsyncUDPSocket_Reuse_EXCLUSIVE, &ILibStun_OnUDP, NULL, obj);
 	if (obj->UDP6 == NULL) { free(obj); return NULL; }
@@ -7550,6 +8576,12 @@ void ILibSCTP_SetSimulatedInboundLossPercentage(void *stunModule, int lossPercen
 	obj->lossPercentage = lossPercentage;
 }
 
+void ILibSCTP_SetSimulatedInboundDelay(void *stunModule, int delayMilliseconds)
+{
+	struct ILibStun_Module *obj = (struct ILibStun_Module*)stunModule;
+	obj->inboundDelayMilliseconds = delayMilliseconds;
+}
+
 void ILibSCTP_SetTSNCallback(void *dtlsSession, ILibSCTP_OnTSNChanged tsnHandler)
 {
 	struct ILibStun_dTlsSession *session = (struct ILibStun_dTlsSession*)dtlsSession;
@@ -7821,9 +8853,235 @@ uint32_t crc32_z(uint32_t crc, const unsigned char* buf, uint32_t len)
 	return crc ^ 0xffffffffUL;
 }
 /* ========================================================================= */
+
+#if defined(ILibSCTP_HWCRC32C_SSE42) || defined(ILibSCTP_HWCRC32C_ARMV8)
+//
+// The CRC32C instruction has a latency of 3 cycles, but can issue every cycle. So large buffers are split in three, and run as
+// three independent streams that are combined afterwards, by applying the CRC of a run of zeros to the first two. The zero
+// operators are 4x256 tables, for each of the two stream lengths. (Mark Adler, https://stackoverflow.com/a/17646775)
+//
+#define ILibSCTP_CRC32C_POLY 0x82f63b78
+#define ILibSCTP_CRC32C_LONG 8192
+#define ILibSCTP_CRC32C_SHORT 256
+
+uint32_t ILibSCTP_crc32c_long[4][256];
+uint32_t ILibSCTP_crc32c_short[4][256];
+
+uint32_t ILibSCTP_gf2_matrix_times(uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+	while (vec)
+	{
+		if (vec & 1) { sum ^= *mat; }
+		vec >>= 1;
+		mat++;
+	}
+	return(sum);
+}
+void ILibSCTP_gf2_matrix_square(uint32_t *square, uint32_t *mat)
+{
+	int n;
+	for (n = 0; n < 32; n++) { square[n] = ILibSCTP_gf2_matrix_times(mat, mat[n]); }
+}
+// Construct the operator that applies len zeros to a crc
+void ILibSCTP_crc32c_zeros_op(uint32_t *even, size_t len)
+{
+	int n;
+	uint32_t row;
+	uint32_t odd[32];
+
+	// Operator for one zero bit in odd
+	odd[0] = ILibSCTP_CRC32C_POLY;
+	row = 1;
+	for (n = 1; n < 32; n++)
+	{
+		odd[n] = row;
+		row <<= 1;
+	}
+
+	ILibSCTP_gf2_matrix_square(even, odd);		// 2 zero bits
+	ILibSCTP_gf2_matrix_square(odd, even);		// 4 zero bits
+
+	// First square will put the operator for one zero byte (eight zero bits) in even, and each subsequent square doubles it
+	do
+	{
+		ILibSCTP_gf2_matrix_square(even, odd);
+		len >>= 1;
+		if (len == 0) { return; }
+		ILibSCTP_gf2_matrix_square(odd, even);
+		len >>= 1;
+	} while (len);
+
+	for (n = 0; n < 32; n++) { even[n] = odd[n]; }
+}
+void ILibSCTP_crc32c_zeros(uint32_t zeros[][256], size_t len)
+{
+	uint32_t n;
+	uint32_t op[32];
+
+	ILibSCTP_crc32c_zeros_op(op, len);
+	for (n = 0; n < 256; n++)
+	{
+		zeros[0][n] = ILibSCTP_gf2_matrix_times(op, n);
+		zeros[1][n] = ILibSCTP_gf2_matrix_times(op, n << 8);
+		zeros[2][n] = ILibSCTP_gf2_matrix_times(op, n << 16);
+		zeros[3][n] = ILibSCTP_gf2_matrix_times(op, n << 24);
+	}
+}
+#define ILibSCTP_crc32c_shift(zeros, crc) (zeros[0][(crc) & 0xff] ^ zeros[1][((crc) >> 8) & 0xff] ^ zeros[2][((crc) >> 16) & 0xff] ^ zeros[3][(crc) >> 24])
+
+#if defined(ILibSCTP_HWCRC32C_SSE42)
+	#if defined(__x86_64__) || defined(_M_X64)
+		typedef uint64_t ILibSCTP_crc32c_word;
+		#define ILibSCTP_crc32c_hw_word(crc, p) (uint32_t)_mm_crc32_u64((crc), *(const uint64_t*)(p))
+	#else
+		typedef uint32_t ILibSCTP_crc32c_word;
+		#define ILibSCTP_crc32c_hw_word(crc, p) _mm_crc32_u32((crc), *(const uint32_t*)(p))
+	#endif
+	#define ILibSCTP_crc32c_hw_byte(crc, p) _mm_crc32_u8((crc), *(p))
+#elif defined(ILibSCTP_HWCRC32C_ARMV8_ASM)
+	typedef uint64_t ILibSCTP_crc32c_word;
+	ILibSCTP_HWCRC32C_ATTR static inline uint32_t ILibSCTP_crc32c_hw_word(uint32_t crc, const unsigned char *p)
+	{
+		__asm__("crc32cx %w0, %w0, %x1" : "+r"(crc) : "r"(*(const uint64_t*)p));
+		return(crc);
+	}
+	ILibSCTP_HWCRC32C_ATTR static inline uint32_t ILibSCTP_crc32c_hw_byte(uint32_t crc, const unsigned char *p)
+	{
+		__asm__("crc32cb %w0, %w0, %w1" : "+r"(crc) : "r"((uint32_t)*p));
+		return(crc);
+	}
+#else
+	typedef uint64_t ILibSCTP_crc32c_word;
+	#define ILibSCTP_crc32c_hw_word(crc, p) __crc32cd((crc), *(const uint64_t*)(p))
+	#define ILibSCTP_crc32c_hw_byte(crc, p) __crc32cb((crc), *(p))
+#endif
+
+ILibSCTP_HWCRC32C_ATTR uint32_t crc32c_hw(uint32_t crc, const unsigned char* buf, uint32_t len)
+{
+	const unsigned char *next = buf;
+	const unsigned char *end;
+	uint32_t crc0, crc1, crc2;
+
+	if (buf == NULL) return 0UL;
+	crc0 = crc ^ 0xffffffffUL;
+
+	// Compute the crc to bring the data pointer to a word boundary
+	while (len && ((uintptr_t)next & (sizeof(ILibSCTP_crc32c_word) - 1)) != 0)
+	{
+		crc0 = ILibSCTP_crc32c_hw_byte(crc0, next);
+		next++;
+		len--;
+	}
+
+	// Compute the crc on sets of LONG*3 bytes, executing three independent crc instructions, each on LONG bytes
+	while (len >= ILibSCTP_CRC32C_LONG * 3)
+	{
+		crc1 = 0;
+		crc2 = 0;
+		end = next + ILibSCTP_CRC32C_LONG;
+		do
+		{
+			crc0 = ILibSCTP_crc32c_hw_word(crc0, next);
+			crc1 = ILibSCTP_crc32c_hw_word(crc1, next + ILibSCTP_CRC32C_LONG);
+			crc2 = ILibSCTP_crc32c_hw_word(crc2, next + ILibSCTP_CRC32C_LONG * 2);
+			next += sizeof(ILibSCTP_crc32c_word);
+		} while (next < end);
+		crc0 = ILibSCTP_crc32c_shift(ILibSCTP_crc32c_long, crc0) ^ crc1;
+		crc0 = ILibSCTP_crc32c_shift(ILibSCTP_crc32c_long, crc0) ^ crc2;
+		next += ILibSCTP_CRC32C_LONG * 2;
+		len -= ILibSCTP_CRC32C_LONG * 3;
+	}
+
+	// Do the same thing, but now on SHORT*3 blocks for the remaining data less than a LONG*3 block
+	while (len >= ILibSCTP_CRC32C_SHORT * 3)
+	{
+		crc1 = 0;
+		crc2 = 0;
+		end = next + ILibSCTP_CRC32C_SHORT;
+		do
+		{
+			crc0 = ILibSCTP_crc32c_hw_word(crc0, next);
+			crc1 = ILibSCTP_crc32c_hw_word(crc1, next + ILibSCTP_CRC32C_SHORT);
+			crc2 = ILibSCTP_crc32c_hw_word(crc2, next + ILibSCTP_CRC32C_SHORT * 2);
+			next += sizeof(ILibSCTP_crc32c_word);
+		} while (next < end);
+		crc0 = ILibSCTP_crc32c_shift(ILibSCTP_crc32c_short, crc0) ^ crc1;
+		crc0 = ILibSCTP_crc32c_shift(ILibSCTP_crc32c_short, crc0) ^ crc2;
+		next += ILibSCTP_CRC32C_SHORT * 2;
+		len -= ILibSCTP_CRC32C_SHORT * 3;
+	}
+
+	// Compute the crc on the remaining words
+	end = next + (len - (len & (sizeof(ILibSCTP_crc32c_word) - 1)));
+	while (next < end)
+	{
+		crc0 = ILibSCTP_crc32c_hw_word(crc0, next);
+		next += sizeof(ILibSCTP_crc32c_word);
+	}
+	len &= (sizeof(ILibSCTP_crc32c_word) - 1);
+
+	// Compute the crc for up to seven leftover bytes
+	while (len)
+	{
+		crc0 = ILibSCTP_crc32c_hw_byte(crc0, next);
+		next++;
+		len--;
+	}
+
+	return crc0 ^ 0xffffffffUL;
+}
+
+int crc32c_hw_supported()
+{
+#if defined(ILibSCTP_HWCRC32C_SSE42) && defined(__GNUC__)
+	__builtin_cpu_init();
+	return(__builtin_cpu_supports("sse4.2") ? 1 : 0);
+#elif defined(ILibSCTP_HWCRC32C_SSE42)
+	int info[4];
+	__cpuid(info, 1);
+	return((info[2] & (1 << 20)) != 0 ? 1 : 0);
+#elif defined(ILibSCTP_HWCRC32C_ARMV8_ASM)
+	return((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0 ? 1 : 0);
+#else
+	return(1);
+#endif
+}
+#endif
+
+uint32_t(*crc32c_impl)(uint32_t crc, const unsigned char* buf, uint32_t len) = crc32c_z;
+
+// Selects the CRC32C implementation. Runs once per process, as SCTP on any chain and the data store share the zero operator tables
+void crc32c_init()
+{
+#if defined(ILibSCTP_HWCRC32C_SSE42) || defined(ILibSCTP_HWCRC32C_ARMV8)
+	if (crc32c_hw_supported() != 0)
+	{
+		ILibSCTP_crc32c_zeros(ILibSCTP_crc32c_long, ILibSCTP_CRC32C_LONG);
+		ILibSCTP_crc32c_zeros(ILibSCTP_crc32c_short, ILibSCTP_CRC32C_SHORT);
+		crc32c_impl = crc32c_hw;
+	}
+#endif
+}
+#ifdef WIN32
+INIT_ONCE crc32c_once = INIT_ONCE_STATIC_INIT;
+BOOL CALLBACK crc32c_init_sink(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	UNREFERENCED_PARAMETER(once);
+	UNREFERENCED_PARAMETER(param);
+	UNREFERENCED_PARAMETER(context);
+	crc32c_init();
+	return(TRUE);
+}
+#define crc32c_init_once() InitOnceExecuteOnce(&crc32c_once, crc32c_init_sink, NULL, NULL)
+#else
+pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+#define crc32c_init_once() pthread_once(&crc32c_once, crc32c_init)
+#endif
 uint32_t crc32c(uint32_t crc, const unsigned char* buf, uint32_t len)
 {
-	return crc32c_z(crc, buf, len);
+	crc32c_init_once();
+	return crc32c_impl(crc, buf, len);
 }
 uint32_t crc32(uint32_t crc, const unsigned char* buf, uint32_t len)
 {
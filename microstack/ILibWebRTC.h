@@ -52,6 +52,20 @@ typedef enum ILibWebRTC_TURN_ConnectFlags
 	ILibWebRTC_TURN_ALWAYS_RELAY = 2	//!< Always relay all connections
 } ILibWebRTC_TURN_ConnectFlags;
 
+//! SCTP Congestion Control Algorithms
+typedef enum ILibSCTP_CongestionControl
+{
+	ILibSCTP_CongestionControl_RENO = 0,		//!< RFC 4960 Slow-Start/Congestion Avoidance (Default)
+	ILibSCTP_CongestionControl_DELAY = 1		//!< Delay-based (Vegas style), backs off as queueing delay builds, and reacts less to random loss
+}ILibSCTP_CongestionControl;
+
+//! SCTP Stream Schedulers, used to interleave messages when the peer supports I-DATA (RFC 8260)
+typedef enum ILibSCTP_StreamScheduler
+{
+	ILibSCTP_StreamScheduler_ROUND_ROBIN = 0,	//!< Streams with pending data take turns, sending an equal share (Default)
+	ILibSCTP_StreamScheduler_WEIGHTED = 1		//!< Streams with pending data take turns, sending a share in proportion to their priority
+}ILibSCTP_StreamScheduler;
+
 typedef enum ILibWebRTC_DataChannel_ReliabilityModes
 {
 	ILibWebRTC_DataChannel_ReliabilityMode_RELIABLE = 0x00,								//!< Reliable Transport [DEFAULT]
@@ -147,6 +161,7 @@ typedef void(*ILibSCTP_OnTSNChanged)(void *stunModule, int OutboundTSN, int Cumu
 typedef void (*ILibSCTP_OnSCTPDebug)(void* dtlsSession, char* debugField, int data);
 void ILibSCTP_SetSenderReceiverCreditsCallback(void* stunModule, ILibSCTP_OnSenderReceiverCreditsChanged callback);
 void ILibSCTP_SetSimulatedInboundLossPercentage(void *stunModule, int lossPercentage);
+void ILibSCTP_SetSimulatedInboundDelay(void *stunModule, int delayMilliseconds);
 void ILibSCTP_SetTSNCallback(void *dtlsSession, ILibSCTP_OnTSNChanged tsnHandler);
 int ILibSCTP_Debug_SetDebugCallback(void *dtlsSession, char* debugFieldName, ILibSCTP_OnSCTPDebug handler);
 #endif
@@ -168,6 +183,11 @@ void ILibSCTP_SetCallbacks(void* StunModule, ILibSCTP_OnConnect onconnect, ILibS
 ILibTransport_DoneState ILibSCTP_Send(void* SctpSession, unsigned short streamId, char* data, int datalen);
 ILibTransport_DoneState ILibSCTP_SendEx(void* SctpSession, unsigned short streamId, char* data, int datalen, int dataType);
 int ILibSCTP_GetPendingBytesToSend(void* SctpSession);
+void ILibSCTP_GetPacketPoolStats(void* SctpSession, unsigned long long *hits, unsigned long long *misses);
+void ILibSCTP_SetCongestionControl(void* SctpSession, ILibSCTP_CongestionControl algorithm, int enablePacing);
+void ILibSCTP_SetDefaultCongestionControl(void* StunModule, ILibSCTP_CongestionControl algorithm, int enablePacing);
+void ILibSCTP_SetStreamScheduler(void* SctpSession, ILibSCTP_StreamScheduler scheduler);
+void ILibSCTP_SetStreamPriority(void* SctpSession, unsigned short streamId, unsigned char priority);
 void ILibSCTP_Close(void* SctpSession);
 
 void ILibSCTP_SetUser(void* SctpSession, void* user);
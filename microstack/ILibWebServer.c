@@ -14,6 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#if defined(_POSIX) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64		// 64 bit off_t for fseeko()/ftello(), so files over 2 GB can be streamed on 32 bit builds
+#endif
+
 #define HTTPVERSION "1.1"
 
 #if defined(WIN32) && !defined(_WIN32_WCE) && !defined(_MINCORE)
@@ -39,6 +43,15 @@ limitations under the License.
 
 #define DIGEST_AUTHENTICATION_NONCE_DEFAULT_DURATION_MINUTES 15
 #define ILibWebServer_StreamHeader_Raw_MaxHeaderLength 4096
+#define ILibWebServer_StreamFile_SendFileChunkSize 262144
+
+#ifdef WIN32
+	#define ILibWebServer_GetFilePosition(pfile) _ftelli64(pfile)
+	#define ILibWebServer_SeekFilePosition(pfile, position, seekMode) _fseeki64(pfile, position, seekMode)
+#else
+	#define ILibWebServer_GetFilePosition(pfile) ((long long)ftello(pfile))
+	#define ILibWebServer_SeekFilePosition(pfile, position, seekMode) fseeko(pfile, (off_t)(position), seekMode)
+#endif
 
 int ILibWebServerSSLCTXIndex = -1;
 int ILibWebServerConnectionSSLCTXIndex = -1;
@@ -114,8 +127,12 @@ typedef struct ILibWebServer_Session_SystemData
 	int	  WebSocketFragmentMaxBufferSize;	// WebSocketFragmentMaxBufferSize;
 	char  WebSocketCouldNotAutoReassemble;	// WebSocketCouldNotAutoReassemble
 	char  WebSocketCloseFrameSent;			// WebSocketCloseFrameSent
+	char  WebSocketCompressedMessage;		// Set while receiving the frames of a compressed message
 	void* DigestTable;
 	void* WebSocket_Request;
+	ILibWebClient_WebSocket_Deflater WebSocketDeflater;	// permessage-deflate state, if negotiated
+	long long StreamFileOffset;					// Next file offset to send for ILibWebServer_StreamFile
+	long long StreamFileRemaining;				// Bytes left to send for ILibWebServer_StreamFile
 }ILibWebServer_Session_SystemData;
 
 #define ILibWebServer_Session_GetSystemData(ws) ((ILibWebServer_Session_SystemData*)((char*)ws+sizeof(ILibWebServer_Session)))
@@ -559,6 +576,74 @@ void ILibWebServer_OnDisconnect(void *AsyncServerSocketModule, void *ConnectionT
 	ILibWebServer_Release((struct ILibWebServer_Session *)user);
 }
 
+//
+// Delivers the payload of a data frame to the user, re-assembling fragments if requested
+//
+void ILibWebServer_WebSocket_Dispatch(struct ILibWebServer_Session *ws, char *payload, int payloadLen, int FIN, unsigned char OPCODE)
+{
+	int tempBegin = 0;
+
+	if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize == 0)
+	{
+		// We will just pass the data up, and let the app handle fragment re-assembly
+		ILibWebServer_Session_GetSystemData(ws)->WebSocketDataFrameType = (int)OPCODE;
+		tempBegin = 0;
+		ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, payload, &tempBegin, payloadLen, FIN == 0 ? ILibWebServer_DoneFlag_Partial : ILibWebServer_DoneFlag_LastPartial);
+	}
+	else
+	{
+		// We will try to automatically re-assemble fragments, up to the max buffer size the user specified
+		if (OPCODE != 0) { ILibWebServer_Session_GetSystemData(ws)->WebSocketDataFrameType = (int)OPCODE; } // Set the DataFrame Type, so the user can query it
+
+		if (FIN != 0 && ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex == 0 && ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble == 0)
+		{
+			// We have an entire fragment, and we didn't save any of it yet... We can just forward it up without copying the buffer
+			tempBegin = 0;
+			ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, payload, &tempBegin, payloadLen, ILibWebServer_DoneFlag_NotDone);
+		}
+		else
+		{
+			while (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex + payloadLen >= ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize)
+			{
+				// Need to grow the buffer
+
+				if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize == ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize)
+				{
+					// We are already maxed out, so just send what we have as an unfinished fragment	
+					ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble = 1; // Set this flag, becuase we can't reassemble, so our FIN flag will be different to reflect that					
+					tempBegin = 0;
+					ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer, &tempBegin, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, ILibWebServer_DoneFlag_Partial);
+					ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex = 0; // Reset the index, becuase new data is going to go to the front
+					if (payloadLen >= ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize)
+					{
+						// This frame won't fit either, so pass it up as is
+						tempBegin = 0;
+						ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, payload, &tempBegin, payloadLen, FIN == 0 ? ILibWebServer_DoneFlag_Partial : ILibWebServer_DoneFlag_LastPartial);
+						if (FIN != 0) { ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble = 0; }
+						return;
+					}
+				}
+				else
+				{
+					// We can grow the buffer
+					ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize = ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize * 2;
+					if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize > ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize) { ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize = ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize; }
+					if ((ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer = (char*)realloc(ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize)) == NULL) { ILIBCRITICALEXIT(254); }
+				}
+			}
+
+			memcpy_s(ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer + ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize - ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, payload, payloadLen);
+			ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex += payloadLen;
+
+			if (FIN != 0)
+			{
+				ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer, &tempBegin, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble == 0 ? ILibWebServer_DoneFlag_NotDone : ILibWebServer_DoneFlag_LastPartial);
+				ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble = 0; // Reset (We can try to auto-assemble)
+				ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex = 0; // Reset (We can write to the start of the buffer)
+			}
+		}
+	}
+}
 int ILibWebServer_ProcessWebSocketData(struct ILibWebServer_Session *ws, char* buffer, int offset, int length)
 {
 	int x;
@@ -568,7 +653,6 @@ int ILibWebServer_ProcessWebSocketData(struct ILibWebServer_Session *ws, char* b
 	char* maskingKey = NULL;
 	int FIN;
 	unsigned char OPCODE;
-	int tempBegin = 0;
 
 	if (length < 2) { return(offset); } // We need at least 2 bytes to read enough of the headers to know how long the frame is
 
@@ -576,6 +660,13 @@ int ILibWebServer_ProcessWebSocketData(struct ILibWebServer_Session *ws, char* b
 	FIN = (hdr & WEBSOCKET_FIN) != 0;
 	OPCODE = (hdr & WEBSOCKET_OPCODE) >> 8;
 
+	if ((hdr & WEBSOCKET_RSV) != 0 && ((hdr & WEBSOCKET_RSV) != WEBSOCKET_RSV1 || ILibWebServer_Session_GetSystemData(ws)->WebSocketDeflater == NULL || OPCODE == WEBSOCKET_OPCODE_FRAMECONT || OPCODE >= 0x8))
+	{
+		// RSV1 is only valid on the first frame of a data message, and only if permessage-deflate was negotiated
+		ILibWebServer_DisconnectSession(ws);
+		return(length);
+	}
+
 	plen = (unsigned char)(hdr & WEBSOCKET_PLEN);
 	if (plen == 126)
 	{
@@ -629,56 +720,28 @@ int ILibWebServer_ProcessWebSocketData(struct ILibWebServer_Session *ws, char* b
 	if (OPCODE < 0x8)
 	{
 		// NON-CONTROL OP-CODE
-		if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize == 0)
+		if (OPCODE != 0) { ILibWebServer_Session_GetSystemData(ws)->WebSocketCompressedMessage = (hdr & WEBSOCKET_RSV1) != 0 ? 1 : 0; }
+		if (ILibWebServer_Session_GetSystemData(ws)->WebSocketCompressedMessage == 0)
 		{
-			// We will just pass the data up, and let the app handle fragment re-assembly
-			ILibWebServer_Session_GetSystemData(ws)->WebSocketDataFrameType = (int)OPCODE;
-			tempBegin = 0;
-			ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, buffer + i, &tempBegin, plen, FIN == 0 ? ILibWebServer_DoneFlag_Partial : ILibWebServer_DoneFlag_LastPartial);
+			ILibWebServer_WebSocket_Dispatch(ws, buffer + i, plen, FIN, OPCODE);
 		}
 		else
 		{
-			// We will try to automatically re-assemble fragments, up to the max buffer size the user specified
-			if (OPCODE != 0) { ILibWebServer_Session_GetSystemData(ws)->WebSocketDataFrameType = (int)OPCODE; } // Set the DataFrame Type, so the user can query it
+			// Decompress in bounded pieces, so a small frame cannot force us to allocate a huge buffer
+			char *chunk;
+			int chunkLen, last, r;
 
-			if (FIN != 0 && ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex == 0 && ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble == 0)
+			ILibWebClient_WebSocket_Deflate_SetInput(ILibWebServer_Session_GetSystemData(ws)->WebSocketDeflater, buffer + i, plen, FIN);
+			while ((r = ILibWebClient_WebSocket_Deflate_Inflate(ILibWebServer_Session_GetSystemData(ws)->WebSocketDeflater, &chunk, &chunkLen, &last)) > 0)
 			{
-				// We have an entire fragment, and we didn't save any of it yet... We can just forward it up without copying the buffer
-				tempBegin = 0;
-				ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, buffer + i, &tempBegin, plen, ILibWebServer_DoneFlag_NotDone);
+				ILibWebServer_WebSocket_Dispatch(ws, chunk, chunkLen, last, OPCODE);
+				OPCODE = WEBSOCKET_OPCODE_FRAMECONT;
+				if (ILibAsyncSocket_IsConnected(ILibWebServer_Session_GetSystemData(ws)->ConnectionToken) == 0) { break; }
 			}
-			else
+			if (r < 0)
 			{
-				if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex + plen >= ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize)
-				{
-					// Need to grow the buffer
-
-					if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize == ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize)
-					{
-						// We are already maxed out, so just send what we have as an unfinished fragment	
-						ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble = 1; // Set this flag, becuase we can't reassemble, so our FIN flag will be different to reflect that					
-						tempBegin = 0;
-						ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer, &tempBegin, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, ILibWebServer_DoneFlag_Partial);
-						ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex = 0; // Reset the index, becuase new data is going to go to the front
-					}
-					else
-					{
-						// We can grow the buffer
-						ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize = ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize * 2;
-						if (ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize > ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize) { ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize = ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentMaxBufferSize; }
-						if ((ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer = (char*)realloc(ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize)) == NULL) { ILIBCRITICALEXIT(254); }
-					}
-				}
-
-				memcpy_s(ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer + ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBufferSize - ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, buffer + i, plen);
-				ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex += plen;
-
-				if (FIN != 0)
-				{
-					ws->OnReceive(ws, 0, (struct packetheader*)ILibWebServer_Session_GetSystemData(ws)->WebSocket_Request, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentBuffer, &tempBegin, ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex, ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble == 0 ? ILibWebServer_DoneFlag_NotDone : ILibWebServer_DoneFlag_LastPartial);
-					ILibWebServer_Session_GetSystemData(ws)->WebSocketCouldNotAutoReassemble = 0; // Reset (We can try to auto-assemble)
-					ILibWebServer_Session_GetSystemData(ws)->WebSocketFragmentIndex = 0; // Reset (We can write to the start of the buffer)
-				}
+				ILibWebServer_DisconnectSession(ws);
+				return(length);
 			}
 		}
 	}
@@ -1051,6 +1114,17 @@ void ILibWebServer_SetTLS(ILibWebServer_ServerToken object, void *ssl_ctx)
 */
 ILibExportMethod ILibWebServer_ServerToken ILibWebServer_CreateEx2(void *Chain, int MaxConnections, unsigned short PortNumber, int loopbackFlag, ILibWebServer_Session_OnSession OnSession, int ExtraMemorySize, void *User)
 {
+	return(ILibWebServer_CreateEx3(Chain, MaxConnections, PortNumber, loopbackFlag, ILibAsyncServerSocket_ListenFlags_NONE, OnSession, ExtraMemorySize, User));
+}
+/*! \fn ILibWebServer_CreateEx3(void *Chain, int MaxConnections, unsigned short PortNumber, int loopbackFlag, int listenFlags, ILibWebServer_Session_OnSession OnSession, int ExtraMemorySize, void *User)
+\brief Constructor for ILibWebServer, with listen options
+\par
+To spread a web server across several threads, create one ILibWebServer per chain, all on the same port, with ILibAsyncServerSocket_ListenFlags_REUSEPORT.
+\param listenFlags ILibAsyncServerSocket_ListenFlags for the listening socket
+*/
+ILibExportMethod ILibWebServer_ServerToken ILibWebServer_CreateEx3(void *Chain, int MaxConnections, unsigned short PortNumber, int loopbackFlag, int listenFlags, ILibWebServer_Session_OnSession OnSession, int ExtraMemorySize, void *User)
+{
+	struct sockaddr_in6 localif;
 	struct ILibWebServer_StateModule *RetVal = (struct ILibWebServer_StateModule *)ILibChain_Link_Allocate(sizeof(struct ILibWebServer_StateModule), ExtraMemorySize);
 	RetVal->ChainLink.MetaData = ILibMemory_SmartAllocate_FromString("ILibWebServer");
 	RetVal->ChainLink.DestroyHandler = &ILibWebServer_Destroy;
@@ -1061,17 +1135,21 @@ ILibExportMethod ILibWebServer_ServerToken ILibWebServer_CreateEx2(void *Chain,
 	//
 	// Create the underling ILibAsyncServerSocket
 	//
-	RetVal->ServerSocket = ILibCreateAsyncServerSocketModule(
+	ILibAsyncServerSocket_SetLocalInterface(&localif, PortNumber, loopbackFlag);
+	RetVal->ServerSocket = ILibCreateAsyncServerSocketModuleWithMemoryExFLAGS(
 		Chain,
 		MaxConnections,
-		PortNumber,
 		INITIAL_BUFFER_SIZE,
-		loopbackFlag,
+		(struct sockaddr*)&localif,
 		&ILibWebServer_OnConnect,			// OnConnect
 		&ILibWebServer_OnDisconnect,		// OnDisconnect
 		&ILibWebServer_OnReceive,			// OnReceive
 		&ILibWebServer_OnInterrupt,			// OnInterrupt
-		&ILibWebServer_OnSendOK				// OnSendOK
+		&ILibWebServer_OnSendOK,			// OnSendOK
+		0,
+		listenFlags,
+		0,
+		0
 		);
 
 	if (RetVal->ServerSocket == NULL) { free(RetVal); return NULL; }
@@ -1380,8 +1458,15 @@ ILibExportMethod ILibWebServer_WebSocket_DataTypes ILibWebServer_WebSocket_GetDa
 	return((ILibWebServer_WebSocket_DataTypes)ILibWebServer_Session_GetSystemData(session)->WebSocketDataFrameType);
 }
 ILibExportMethod int ILibWebServer_UpgradeWebSocket(struct ILibWebServer_Session *session, int autoFragmentReassemblyMaxBufferSize)
+{
+	return(ILibWebServer_UpgradeWebSocketEx(session, autoFragmentReassemblyMaxBufferSize, ILibWebClient_WebSocket_DeflateFlag_NONE));
+}
+ILibExportMethod int ILibWebServer_UpgradeWebSocketEx(struct ILibWebServer_Session *session, int autoFragmentReassemblyMaxBufferSize, int deflateFlags)
 {
 	char wsguid[] = WEBSOCKET_GUID;
+	char extensions[128];
+	int extensionsLen = 0;
+	int offerFlags, clientWindowBits, serverWindowBits;
 	SHA_CTX c;
 	char shavalue[21];
 	char* websocketKey;
@@ -1412,8 +1497,25 @@ ILibExportMethod int ILibWebServer_UpgradeWebSocket(struct ILibWebServer_Session
 
 	ILibWebServer_Session_GetSystemData(session)->WebSocket_Request = ILibClonePacket(hdr);
 
+	if ((deflateFlags & ILibWebClient_WebSocket_DeflateFlag_ENABLED) != 0)
+	{
+		websocketKey = ILibGetHeaderLineEx(hdr, "Sec-WebSocket-Extensions", 24, &websocketKeyLen);
+		if (websocketKey != NULL && ILibWebClient_WebSocket_Deflate_ParseExtensions(websocketKey, websocketKeyLen, &offerFlags, &clientWindowBits, &serverWindowBits) == 0)
+		{
+			// Accept the client's offer, adding any no_context_takeover options that we want
+			offerFlags |= deflateFlags;
+			extensionsLen = sprintf_s(extensions, sizeof(extensions), "\r\nSec-WebSocket-Extensions: permessage-deflate%s%s",
+				(offerFlags & ILibWebClient_WebSocket_DeflateFlag_SERVER_NO_CONTEXT_TAKEOVER) != 0 ? "; server_no_context_takeover" : "",
+				(offerFlags & ILibWebClient_WebSocket_DeflateFlag_CLIENT_NO_CONTEXT_TAKEOVER) != 0 ? "; client_no_context_takeover" : "");
+			if (serverWindowBits < 15) { extensionsLen += sprintf_s(extensions + extensionsLen, sizeof(extensions) - extensionsLen, "; server_max_window_bits=%d", serverWindowBits); }
+			ILibWebServer_Session_GetSystemData(session)->WebSocketDeflater = ILibWebClient_WebSocket_Deflate_Create(1, offerFlags, serverWindowBits);
+			if (ILibWebServer_Session_GetSystemData(session)->WebSocketDeflater == NULL) { extensionsLen = 0; }
+		}
+	}
+
 	ILibWebServer_Send_Raw(session, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ", 97, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebServer_DoneFlag_NotDone);
 	ILibWebServer_Send_Raw(session, keyResult, keyResultLen, ILibAsyncSocket_MemoryOwnership_CHAIN, ILibWebServer_DoneFlag_NotDone);
+	if (extensionsLen > 0) { ILibWebServer_Send_Raw(session, extensions, extensionsLen, ILibAsyncSocket_MemoryOwnership_USER, ILibWebServer_DoneFlag_NotDone); }
 	ILibWebServer_Send_Raw(session, "\r\n\r\n", 4, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebServer_DoneFlag_NotDone);
 
 	ILibWebServer_Session_GetSystemData(session)->RequestAnsweredMethod = 1; // Set this flag, so we continue reading from the socket, as we're going to bypass HTTP parsing
@@ -1494,6 +1596,31 @@ ILibExportMethod enum ILibWebServer_Status ILibWebServer_WebSocket_Send(struct I
 	char header[4];
 	int headerLen;
 	enum ILibWebServer_Status RetVal = ILibWebServer_INVALID_SESSION;
+	char *compressed;
+	int compressedLen;
+
+	if (ILibWebServer_Session_GetSystemData(session)->WebSocketDeflater != NULL && ILibWebServer_Session_GetSystemData(session)->WebSocketFragmentFlag == 0 && fragmentStatus == ILibWebServer_WebSocket_FragmentFlag_Complete &&
+		(bufferType == ILibWebServer_WebSocket_DataType_TEXT || bufferType == ILibWebServer_WebSocket_DataType_BINARY))
+	{
+		// Only whole messages are compressed, and the deflater must be used under the lock, to keep the message order in sync with the LZ77 history
+		ILibSpinLock_Lock(&(ILibWebServer_Session_GetSystemData(session)->SessionLock));
+		if ((compressed = ILibWebClient_WebSocket_Deflate_Compress(ILibWebServer_Session_GetSystemData(session)->WebSocketDeflater, buffer, bufferLen, &compressedLen)) != NULL)
+		{
+			int i = 0, len;
+			while (i < compressedLen)
+			{
+				len = compressedLen - i > WEBSOCKET_MAX_OUTPUT_FRAMESIZE ? WEBSOCKET_MAX_OUTPUT_FRAMESIZE : compressedLen - i;
+				headerLen = ILibWebServer_WebSocket_CreateHeader(header, (i == 0 ? WEBSOCKET_RSV1 : 0) | (i + len == compressedLen ? WEBSOCKET_FIN : 0), i == 0 ? (unsigned short)bufferType : WEBSOCKET_OPCODE_FRAMECONT, len);
+				RetVal = (enum ILibWebServer_Status)ILibAsyncServerSocket_Send(ILibWebServer_Session_GetSystemData(session)->AsyncServerSocket, ILibWebServer_Session_GetSystemData(session)->ConnectionToken, header, headerLen, ILibAsyncSocket_MemoryOwnership_USER);
+				RetVal = (enum ILibWebServer_Status)ILibAsyncServerSocket_Send(ILibWebServer_Session_GetSystemData(session)->AsyncServerSocket, ILibWebServer_Session_GetSystemData(session)->ConnectionToken, compressed + i, len, ILibAsyncSocket_MemoryOwnership_USER);
+				i += len;
+			}
+			ILibSpinLock_UnLock(&(ILibWebServer_Session_GetSystemData(session)->SessionLock));
+			if (userFree == ILibAsyncSocket_MemoryOwnership_CHAIN) { free(buffer); }
+			return RetVal;
+		}
+		ILibSpinLock_UnLock(&(ILibWebServer_Session_GetSystemData(session)->SessionLock));
+	}
 
 	if (bufferLen > WEBSOCKET_MAX_OUTPUT_FRAMESIZE)
 	{
@@ -2058,6 +2185,7 @@ void ILibWebServer_Release(struct ILibWebServer_Session *session)
 		SESSION_TRACK(session, "** Destroyed **");
 		if (ILibWebServer_Session_GetSystemData(session)->DigestTable != NULL) { ILibDestroyHashTree(ILibWebServer_Session_GetSystemData(session)->DigestTable); }
 		if (ILibWebServer_Session_GetSystemData(session)->WebSocketFragmentBuffer != NULL)	{ free(ILibWebServer_Session_GetSystemData(session)->WebSocketFragmentBuffer); }
+		if (ILibWebServer_Session_GetSystemData(session)->WebSocketDeflater != NULL) { ILibWebClient_WebSocket_Deflate_Destroy(ILibWebServer_Session_GetSystemData(session)->WebSocketDeflater); }
 		if (ILibWebServer_Session_GetSystemData(session)->WebSocket_Request != NULL) { ILibDestructPacket((struct packetheader*)ILibWebServer_Session_GetSystemData(session)->WebSocket_Request); }
 		free(session);
 	}
@@ -2111,33 +2239,182 @@ return ILibAsyncServerSocket_FakeConnect(wsm->ServerSocket, cd);
 }
 */
 
+#ifdef ILibAsyncSocket_SENDFILE_SUPPORTED
+// Private method used to stream a file segment as part of the body, without copying it through user space
+enum ILibWebServer_Status ILibWebServer_StreamBody_File(struct ILibWebServer_Session *session, int fd, long long offset, int length)
+{
+	ILibWebServer_Session_SystemData *sd = ILibWebServer_Session_GetSystemData(session);
+	struct packetheader *hdr = ILibWebClient_GetHeaderFromDataObject(sd->WebClientDataObject);
+	enum ILibWebServer_Status RetVal;
+	char *hex;
+	int hexLen;
+	int chunked;
+
+	if (session->SessionInterrupted != 0 || hdr == NULL) { return(ILibWebServer_INVALID_SESSION); }
+	chunked = (hdr->VersionLength == 3 && memcmp(hdr->Version, "1.0", 3) == 0) ? 0 : 1;
+
+	if (chunked != 0)
+	{
+		if ((hex = (char*)malloc(16)) == NULL) ILIBCRITICALEXIT(254);
+		hexLen = sprintf_s(hex, 16, "%X\r\n", length);
+		if (ILibWebServer_Send_Raw(session, hex, hexLen, ILibAsyncSocket_MemoryOwnership_CHAIN, ILibWebServer_DoneFlag_NotDone) == ILibWebServer_TRIED_TO_SEND_ON_CLOSED_SOCKET) { return(ILibWebServer_TRIED_TO_SEND_ON_CLOSED_SOCKET); }
+	}
+	RetVal = (enum ILibWebServer_Status)ILibAsyncSocket_SendFile(sd->ConnectionToken, fd, offset, (unsigned int)length);
+	if (chunked != 0 && RetVal != ILibWebServer_TRIED_TO_SEND_ON_CLOSED_SOCKET)
+	{
+		RetVal = ILibWebServer_Send_Raw(session, "\r\n", 2, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebServer_DoneFlag_NotDone);
+	}
+	return(RetVal);
+}
+#endif
+
+// Private method used to finish streaming a file, once all of it was sent or a send error occured
+void ILibWebServer_StreamFileDone(struct ILibWebServer_Session *sender, FILE *pfile)
+{
+	sender->OnSendOK = NULL;
+	sender->User3 = NULL;
+	ILibWebServer_StreamBody(sender, NULL, 0, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebServer_DoneFlag_Done);
+	fclose(pfile);
+}
+
 // Private method used to send a file to the web session asynchronously
 void ILibWebServer_StreamFileSendOK(struct ILibWebServer_Session *sender)
 {
+	ILibWebServer_Session_SystemData *sd = ILibWebServer_Session_GetSystemData(sender);
 	FILE* pfile;
 	size_t len;
-	int status = 0;
+	int status = ILibWebServer_ALL_DATA_SENT;
 
 	pfile = (FILE*)sender->User3;
-	while ((len = fread(ILibScratchPad, 1, sizeof(ILibScratchPad), pfile)) != 0)
+	if (pfile == NULL) { return; }
+
+#ifdef ILibAsyncSocket_SENDFILE_SUPPORTED
+	if (ILibAsyncSocket_CanSendFile(sd->ConnectionToken))
 	{
+		// Plaintext session, so let the kernel move the file to the socket. Each segment is only queued behind what
+		// is already pending, so we stop as soon as the socket backs up, and continue from the next OnSendOK
+		while (sd->StreamFileRemaining > 0 && status == ILibWebServer_ALL_DATA_SENT)
+		{
+			len = sd->StreamFileRemaining < ILibWebServer_StreamFile_SendFileChunkSize ? (size_t)sd->StreamFileRemaining : ILibWebServer_StreamFile_SendFileChunkSize;
+			status = ILibWebServer_StreamBody_File(sender, fileno(pfile), sd->StreamFileOffset, (int)len);
+			sd->StreamFileOffset += (long long)len;
+			sd->StreamFileRemaining -= (long long)len;
+		}
+
+		// The file must stay open until the last segment has actually been sent
+		if (status < 0 || (sd->StreamFileRemaining == 0 && status == ILibWebServer_ALL_DATA_SENT)) { ILibWebServer_StreamFileDone(sender, pfile); }
+		return;
+	}
+#endif
+
+	while (sd->StreamFileRemaining > 0)
+	{
+		len = sd->StreamFileRemaining < (long long)sizeof(ILibScratchPad) ? (size_t)sd->StreamFileRemaining : sizeof(ILibScratchPad);
+		if ((len = fread(ILibScratchPad, 1, len, pfile)) == 0) { break; }
+		sd->StreamFileRemaining -= (long long)len;
 		status = ILibWebServer_StreamBody(sender, ILibScratchPad, (int)len, ILibAsyncSocket_MemoryOwnership_USER, ILibWebServer_DoneFlag_NotDone);
-		if (status != ILibWebServer_ALL_DATA_SENT || len < sizeof(ILibScratchPad)) break;
+		if (status != ILibWebServer_ALL_DATA_SENT) break;
 	}
 
-	if (len < sizeof(ILibScratchPad) || status < 0)
+	if (sd->StreamFileRemaining == 0 || len == 0 || status < 0)
 	{
 		// Finished sending the file or got a send error, close the session
-		ILibWebServer_StreamBody(sender, NULL, 0, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebServer_DoneFlag_Done);
-		fclose(pfile);
+		ILibWebServer_StreamFileDone(sender, pfile);
 	}
 }
 
-// Streams a file to the web session asynchronously, closes the session when done.
-// Caller must supply a valid file handle.
-void ILibWebServer_StreamFile(struct ILibWebServer_Session *session, FILE* pfile)
+// Streams Length bytes of a file starting at Offset to the web session asynchronously. A negative Length streams to the end of the file.
+// Closes the file when done. Caller must supply a valid file handle.
+void ILibWebServer_StreamFileEx(struct ILibWebServer_Session *session, FILE* pfile, long long Offset, long long Length)
 {
+	ILibWebServer_Session_SystemData *sd = ILibWebServer_Session_GetSystemData(session);
+	long long fileLength;
+
+	ILibWebServer_SeekFilePosition(pfile, 0, SEEK_END);
+	fileLength = ILibWebServer_GetFilePosition(pfile);
+	if (Offset < 0 || Offset > fileLength) { Offset = fileLength; }
+	if (Length < 0 || Length > fileLength - Offset) { Length = fileLength - Offset; }
+	ILibWebServer_SeekFilePosition(pfile, Offset, SEEK_SET);
+
+	sd->StreamFileOffset = Offset;
+	sd->StreamFileRemaining = Length;
 	session->OnSendOK = ILibWebServer_StreamFileSendOK;
 	session->User3 = (void*)pfile;
 	ILibWebServer_StreamFileSendOK(session);
 }
+
+// Streams a file to the web session asynchronously, closes the session when done.
+// Caller must supply a valid file handle.
+void ILibWebServer_StreamFile(struct ILibWebServer_Session *session, FILE* pfile)
+{
+	ILibWebServer_StreamFileEx(session, pfile, ILibWebServer_GetFilePosition(pfile), -1);
+}
+
+/*! \fn ILibWebServer_StreamFile_Range(struct ILibWebServer_Session *session, FILE* pfile, char *ResponseHeaders)
+\brief Responds to the current request with a file, honoring the request's Range header
+\par
+Sends <b>206 Partial Content</b> with a Content-Range header if a valid range was requested, <b>416 Range Not Satisfiable</b> if the
+range could not be satisfied, and <b>200 OK</b> with the whole file otherwise. The file is closed when done.
+\param session The ILibWebServer_Session to send the response on
+\param pfile The file to send
+\param ResponseHeaders Additional HTTP header fields, such as Content-Type, following the rules of \a ILibWebServer_StreamHeader_Raw. (NULL if none)
+\returns Send Status of the response header
+*/
+enum ILibWebServer_Status ILibWebServer_StreamFile_Range(struct ILibWebServer_Session *session, FILE* pfile, char *ResponseHeaders)
+{
+	struct packetheader *hdr = ILibWebClient_GetHeaderFromDataObject(ILibWebServer_Session_GetSystemData(session)->WebClientDataObject);
+	enum ILibWebServer_Status RetVal;
+	char *range = hdr != NULL ? ILibGetHeaderLine(hdr, "Range", 5) : NULL;
+	char *headers;
+	int headersLen = 128 + (ResponseHeaders != NULL ? (int)strnlen_s(ResponseHeaders, ILibWebServer_StreamHeader_Raw_MaxHeaderLength) : 0);
+	long long fileLength, start = 0, length = -1;
+	enum ILibWebClient_Range_Result result = ILibWebClient_Range_Result_BAD_REQUEST;
+
+	ILibWebServer_SeekFilePosition(pfile, 0, SEEK_END);
+	fileLength = ILibWebServer_GetFilePosition(pfile);
+	ILibWebServer_SeekFilePosition(pfile, 0, SEEK_SET);
+
+	if ((headers = (char*)malloc(headersLen)) == NULL) ILIBCRITICALEXIT(254);
+	if (range != NULL)
+	{
+		// ILibWebClient_Parse_Range() tokenizes in place, so work on a copy of the request header
+		range = ILibString_Copy(range, strnlen_s(range, ILibWebServer_StreamHeader_Raw_MaxHeaderLength));
+		result = ILibWebClient_Parse_Range(range, &start, &length, fileLength);
+		free(range);
+		if (result == ILibWebClient_Range_Result_OK)
+		{
+			if (start + length > fileLength) { length = fileLength - start; }
+			if (length <= 0) { result = ILibWebClient_Range_Result_INVALID_RANGE; }
+		}
+	}
+
+	switch (result)
+	{
+		case ILibWebClient_Range_Result_OK:
+			sprintf_s(headers, headersLen, "%s\r\nAccept-Ranges: bytes\r\nContent-Range: bytes %lld-%lld/%lld", ResponseHeaders != NULL ? ResponseHeaders : "", start, start + length - 1, fileLength);
+			RetVal = ILibWebServer_StreamHeader_Raw(session, 206, "Partial Content", headers, ILibAsyncSocket_MemoryOwnership_CHAIN);
+			break;
+		case ILibWebClient_Range_Result_INVALID_RANGE:
+			sprintf_s(headers, headersLen, "\r\nContent-Range: bytes */%lld", fileLength);
+			RetVal = ILibWebServer_StreamHeader_Raw(session, 416, "Range Not Satisfiable", headers, ILibAsyncSocket_MemoryOwnership_CHAIN);
+			if (RetVal >= 0) { ILibWebServer_StreamBody(session, NULL, 0, ILibAsyncSocket_MemoryOwnership_STATIC, ILibWebServer_DoneFlag_Done); }
+			fclose(pfile);
+			return(RetVal);
+		default:
+			// No Range, or one we couldn't parse, so just send the whole thing
+			start = 0; length = -1;
+			sprintf_s(headers, headersLen, "%s\r\nAccept-Ranges: bytes", ResponseHeaders != NULL ? ResponseHeaders : "");
+			RetVal = ILibWebServer_StreamHeader_Raw(session, 200, "OK", headers, ILibAsyncSocket_MemoryOwnership_CHAIN);
+			break;
+	}
+
+	if (RetVal < 0)
+	{
+		fclose(pfile);
+	}
+	else
+	{
+		ILibWebServer_StreamFileEx(session, pfile, start, length);
+	}
+	return(RetVal);
+}
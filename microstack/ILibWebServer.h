@@ -195,6 +195,7 @@ void *ILibWebServer_Session_GetConnectionToken(ILibWebServer_Session *session);
 
 ILibWebServer_ServerToken ILibWebServer_CreateEx(void *Chain, int MaxConnections, unsigned short PortNumber, int loopbackFlag, ILibWebServer_Session_OnSession OnSession, void *User);
 ILibExportMethod ILibWebServer_ServerToken ILibWebServer_CreateEx2(void *Chain, int MaxConnections, unsigned short PortNumber, int loopbackFlag, ILibWebServer_Session_OnSession OnSession, int ExtraMemorySize, void *User);
+ILibExportMethod ILibWebServer_ServerToken ILibWebServer_CreateEx3(void *Chain, int MaxConnections, unsigned short PortNumber, int loopbackFlag, int listenFlags, ILibWebServer_Session_OnSession OnSession, int ExtraMemorySize, void *User);
 #define ILibWebServer_Create(Chain, MaxConnections, PortNumber, OnSession, User) ILibWebServer_CreateEx(Chain, MaxConnections, PortNumber, INADDR_ANY, OnSession, User)
 #define ILibWebServer_Create2(Chain, MaxConnections, PortNumber, OnSession, ExtraMemorySize, User) ILibWebServer_CreateEx2(Chain, MaxConnections, PortNumber, INADDR_ANY, OnSession, ExtraMemorySize, User)
 ILibAsyncServerSocket_ServerModule ILibWebServer_GetServerSocketModule(ILibWebServer_ServerToken server);
@@ -218,6 +219,8 @@ ILibExportMethod void ILibWebServer_Digest_SendUnauthorized(struct ILibWebServer
 ILibExportMethod char* ILibWebServer_IsCrossSiteRequest(ILibWebServer_Session* session);
 
 ILibExportMethod int ILibWebServer_UpgradeWebSocket(struct ILibWebServer_Session *session, int autoFragmentReassemblyMaxBufferSize);
+// Same as ILibWebServer_UpgradeWebSocket, but accepts a permessage-deflate offer from the client if deflateFlags is set (ILibWebClient_WebSocket_DeflateFlags)
+ILibExportMethod int ILibWebServer_UpgradeWebSocketEx(struct ILibWebServer_Session *session, int autoFragmentReassemblyMaxBufferSize, int deflateFlags);
 ILibExportMethod enum ILibWebServer_Status ILibWebServer_WebSocket_Send(struct ILibWebServer_Session *session, char* buffer, int bufferLen, ILibWebServer_WebSocket_DataTypes bufferType, enum ILibAsyncSocket_MemoryOwnership userFree, ILibWebServer_WebSocket_FragmentFlags fragmentStatus);
 ILibExportMethod void ILibWebServer_WebSocket_Close(struct ILibWebServer_Session *session);
 
@@ -262,6 +265,8 @@ ILibExportMethod void ILibWebServer_Resume(struct ILibWebServer_Session *session
 void ILibWebServer_OverrideReceiveHandler(struct ILibWebServer_Session *session, ILibWebServer_Session_OnReceive OnReceive);
 
 void ILibWebServer_StreamFile(struct ILibWebServer_Session *session, FILE* pfile);
+void ILibWebServer_StreamFileEx(struct ILibWebServer_Session *session, FILE* pfile, long long Offset, long long Length);
+enum ILibWebServer_Status ILibWebServer_StreamFile_Range(struct ILibWebServer_Session *session, FILE* pfile, char *ResponseHeaders);
 
 #ifdef __cplusplus
 }
@@ -1325,5 +1325,9 @@ void ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedLossPercentage(ILibWrapper
 {
 	ILibSCTP_SetSimulatedInboundLossPercentage(((ILibWrapper_WebRTC_ConnectionFactoryStruct*)factory)->mStunModule, lossPercentage);
 }
+void ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedDelay(ILibWrapper_WebRTC_ConnectionFactory factory, int delayMilliseconds)
+{
+	ILibSCTP_SetSimulatedInboundDelay(((ILibWrapper_WebRTC_ConnectionFactoryStruct*)factory)->mStunModule, delayMilliseconds);
+}
 #endif
 #endif
@@ -382,6 +382,7 @@ ILibTransport_DoneState ILibWrapper_WebRTC_DataChannel_SendString(ILibWrapper_We
 #ifdef _WEBRTCDEBUG
 int ILibWrapper_WebRTC_Connection_Debug_Set(ILibWrapper_WebRTC_Connection connection, char* debugFieldName, ILibWrapper_WebRTC_Connection_Debug_OnEvent eventHandler);
 void ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedLossPercentage(ILibWrapper_WebRTC_ConnectionFactory factory, int lossPercentage);
+void ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedDelay(ILibWrapper_WebRTC_ConnectionFactory factory, int delayMilliseconds);
 #endif
 
 /** @}*/
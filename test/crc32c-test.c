@@ -0,0 +1,88 @@
+/*
+Copyright 2022 Intel Corporation
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// crc32c-test.c : Checks the CRC32C used for SCTP packets and data store records against the table driven version.
+//
+// crc32c() uses the CRC32C instruction when the CPU has one (SSE 4.2 or ARMv8 CRC). This checks it against crc32c_z() for
+// every start alignment, for lengths on both sides of the 3-stream split points, and for chained calls.
+// The process exit code is non-zero if any result differs.
+//
+// Build (Linux, from the repository root):
+//   M=microstack; gcc -O2 -D_POSIX -DMICROSTACK_PROXY -I$M -I. test/crc32c-test.c $M/ILibWebRTC.c $M/ILibParsers.c $M/ILibCrypto.c
+//       $M/ILibAsyncSocket.c $M/ILibAsyncServerSocket.c $M/ILibAsyncUDPSocket.c $M/ILibWebClient.c $M/ILibWebServer.c
+//       $M/ILibRemoteLogging.c -o crc32c-test -lpthread -ldl -lssl -lcrypto -lz -lutil -lrt
+// Usage: crc32c-test
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define TEST_BUFFER_SIZE (8192 * 3 + 256 * 3 + 67)
+
+extern uint32_t crc32c(uint32_t crc, const unsigned char* buf, uint32_t len);
+extern uint32_t crc32c_z(uint32_t crc, const unsigned char* buf, uint32_t len);
+extern uint32_t(*crc32c_impl)(uint32_t crc, const unsigned char* buf, uint32_t len);
+
+unsigned char test_buffer[TEST_BUFFER_SIZE];
+long test_checks, test_bad;
+
+void test_compare(uint32_t crc, uint32_t offset, uint32_t length)
+{
+	uint32_t expected = crc32c_z(crc, test_buffer + offset, length);
+	uint32_t actual = crc32c(crc, test_buffer + offset, length);
+
+	++test_checks;
+	if (actual != expected)
+	{
+		if (test_bad++ < 10) { printf("   MISMATCH: crc %08x, offset %u, length %u: %08x, expected %08x\n", crc, offset, length, actual, expected); }
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t i, offset, length, split;
+
+	for (i = 0; i < TEST_BUFFER_SIZE; ++i) { test_buffer[i] = (unsigned char)(i * 31 + (i >> 8)); }
+
+	// Check value from RFC 3720, appendix B.4
+	if (crc32c(0, (unsigned char*)"123456789", 9) != 0xe3069283) { printf("   MISMATCH: check value of \"123456789\"\n"); ++test_bad; }
+	printf("crc32c() uses the %s implementation\n", crc32c_impl == crc32c_z ? "table driven" : "hardware");
+
+	for (offset = 0; offset < 8; ++offset)
+	{
+		for (length = 0; length + offset <= TEST_BUFFER_SIZE; length = length < 64 ? length + 1 : length * 2 + 13) { test_compare(0, offset, length); }
+		for (length = 256 * 3 - 9; length < 256 * 3 + 9; ++length) { test_compare(0, offset, length); }
+		for (length = 8192 * 3 - 9; length < 8192 * 3 + 9; ++length) { test_compare(0, offset, length); }
+		test_compare(0, offset, TEST_BUFFER_SIZE - offset);
+		test_compare(0x12345678, offset, TEST_BUFFER_SIZE - offset);
+	}
+
+	// Chained calls must give the same result as a single call over the whole buffer
+	for (split = 1; split < TEST_BUFFER_SIZE; split = split * 3 + 1)
+	{
+		++test_checks;
+		if (crc32c(crc32c(0, test_buffer, split), test_buffer + split, TEST_BUFFER_SIZE - split) != crc32c_z(0, test_buffer, TEST_BUFFER_SIZE))
+		{
+			printf("   MISMATCH: chained at %u\n", split);
+			++test_bad;
+		}
+	}
+
+	printf("%ld checks, %ld mismatches\n", test_checks, test_bad);
+	return(test_bad == 0 ? 0 : 1);
+}
@@ -0,0 +1,226 @@
+/*
+Copyright 2022 Intel Corporation
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Times the SimpleDataStore key scans, record check formats, write-back tier and module keys, and checks their results.
+// The exit code is non-zero if any check fails.
+// Usage: meshagent datastore-bench.js [path] [keys|checksum|writeback|modules ...]
+//
+var fs = require('fs');
+var dbPath = process.argv.length > 2 ? process.argv[2] : 'datastore-bench.db';
+var failures = 0;
+
+function cleanup()
+{
+    try { fs.unlinkSync(dbPath); } catch (e) { }
+    try { fs.unlinkSync(dbPath + '.idx'); } catch (e) { }
+}
+
+function create(options)
+{
+    return (require('SimpleDataStore').Create(dbPath, options));
+}
+
+function check(condition, message)
+{
+    if (!condition)
+    {
+        console.log('   FAILED: ' + message);
+        ++failures;
+    }
+}
+
+function elapsed(func)
+{
+    var start = Date.now();
+    func();
+    return (Date.now() - start);
+}
+
+// String values are stored with their terminating NUL, which Get() returns as part of the string
+function readsBack(db, key, value)
+{
+    var stored = db.Get(key);
+    return (stored == value + '\0' || stored == value);
+}
+
+function sameKeys(a, b)
+{
+    return (a.length == b.length && a.every(function (k, i) { return (k == b[i]); }));
+}
+
+// Compares listing a key family with Keys + filter, against KeysWithPrefix and KeysInRange
+function keysBench()
+{
+    var sizes = [10000, 100000];
+    var rounds = 20;
+
+    for (var s in sizes)
+    {
+        cleanup();
+        var db = create();
+        db.BeginBatch();
+        for (var i = 0; i < sizes[s]; ++i)
+        {
+            // One key in fifty is a module, the rest are split between two other key families
+            var family = (i % 50) == 0 ? '__MODULE:' : ((i % 3) == 0 ? 'user/' : 'feature/');
+            db.Put(family + ((i * 7919) % sizes[s]), 'v');
+        }
+        db.CommitBatch();
+
+        var filtered, prefixed, ranged, users;
+        var filterMs = elapsed(function () { for (var r = 0; r < rounds; ++r) { filtered = db.Keys.filter(function (k) { return (k.startsWith('__MODULE:')); }); } }) / rounds;
+        var prefixMs = elapsed(function () { for (var r = 0; r < rounds; ++r) { prefixed = db.KeysWithPrefix('__MODULE:'); } }) / rounds;
+        var rangeMs = elapsed(function () { for (var r = 0; r < rounds; ++r) { ranged = db.KeysInRange('user/', 'user0'); } }) / rounds;
+        users = db.Keys.filter(function (k) { return (k.startsWith('user/')); });
+
+        console.log(sizes[s] + ' keys:');
+        console.log('   Keys + filter:  ' + filtered.length + ' keys, ' + filterMs.toFixed(2) + ' ms');
+        console.log('   KeysWithPrefix: ' + prefixed.length + ' keys, ' + prefixMs.toFixed(2) + ' ms');
+        console.log('   KeysInRange:    ' + ranged.length + ' keys, ' + rangeMs.toFixed(2) + ' ms');
+        check(filtered.length > 0 && sameKeys(prefixed, filtered), 'KeysWithPrefix returned ' + prefixed.length + ' keys, expected the ' + filtered.length + ' keys from Keys');
+        check(users.length > 0 && sameKeys(ranged, users), 'KeysInRange returned ' + ranged.length + ' keys, expected the ' + users.length + ' keys from Keys');
+        db = null;
+        _debugGC();
+    }
+}
+
+// Compares SHA384 and CRC32C record checks for put, reopen and first read
+function checksumBench()
+{
+    var count = 20000;
+    var value = Buffer.alloc(1024, 'x').toString();
+    var formats = ['sha384', 'crc32c'];
+
+    for (var f in formats)
+    {
+        cleanup();
+        var db = create({ checksum: formats[f] });
+        var putMs = elapsed(function ()
+        {
+            db.BeginBatch();
+            for (var i = 0; i < count; ++i) { db.Put('key/' + i, value); }
+            db.CommitBatch();
+        });
+        db = null;
+        _debugGC();
+
+        // Remove the snapshot, so every record is read and checked on open
+        try { fs.unlinkSync(dbPath + '.idx'); } catch (e) { }
+        var openMs = elapsed(function () { db = create({ checksum: formats[f] }); });
+
+        var bad = 0;
+        var getMs = elapsed(function () { for (var i = 0; i < count; ++i) { if (!readsBack(db, 'key/' + i, value)) { ++bad; } } });
+
+        console.log(formats[f] + ':');
+        console.log('   Put:       ' + putMs + ' ms');
+        console.log('   Open:      ' + openMs + ' ms');
+        console.log('   First Get: ' + getMs + ' ms');
+        check(bad == 0, bad + ' of ' + count + ' values did not read back');
+        check(db.Keys.length == count, db.Keys.length + ' keys after reopen, expected ' + count);
+        db = null;
+        _debugGC();
+    }
+}
+
+// Compares rewriting a few hot keys directly, against rewriting them through the write-back tier
+function writebackBench()
+{
+    var puts = 100000;
+    var hotKeys = 16;
+    var runs = [{ name: 'Direct    ', config: function (db) { } }, { name: 'Write-back', config: function (db) { db.ConfigWriteBack(1000, 65536); } }];
+
+    for (var r in runs)
+    {
+        cleanup();
+        var db = create();
+        runs[r].config(db);
+        var ms = elapsed(function ()
+        {
+            for (var i = 0; i < puts; ++i) { db.Put('hot/' + (i % hotKeys), i.toString()); }
+            db.Flush();
+        });
+        runs[r].size = fs.statSync(dbPath).size;
+        console.log(runs[r].name + ': ' + puts + ' puts to ' + hotKeys + ' keys, ' + ms + ' ms, file ' + runs[r].size + ' bytes');
+        db = null;
+        _debugGC();
+
+        // The last value of every key must be on disk
+        var bad = 0;
+        db = create();
+        for (var i = puts - hotKeys; i < puts; ++i) { if (!readsBack(db, 'hot/' + (i % hotKeys), i.toString())) { ++bad; } }
+        check(bad == 0, bad + ' keys did not read back after reopen');
+        db = null;
+        _debugGC();
+    }
+    check(runs[1].size < runs[0].size, 'write-back file is ' + runs[1].size + ' bytes, expected less than the ' + runs[0].size + ' bytes written directly');
+}
+
+// Compares storing and reading modules as plain keys, against __MODULE: keys, which Put() stores compressed
+function modulesBench()
+{
+    var modules = 200;
+    var sources = 20;
+    var reads = 20;
+    var prefixes = ['plain/', '__MODULE:'];
+    var stored = [];
+
+    function source(i)
+    {
+        var lines = [];
+        for (var j = 0; j < 400; ++j) { lines.push('function f' + i + '_' + j + '(a, b) { return (a + b * ' + j + '); }'); }
+        lines.push('module.exports = f' + i + '_0;');
+        return (lines.join('\n'));
+    }
+
+    for (var p in prefixes)
+    {
+        cleanup();
+        var db = create();
+        var size = fs.statSync(dbPath).size;
+        var putMs = elapsed(function () { for (var i = 0; i < modules; ++i) { db.Put(prefixes[p] + 'mod' + i, source(i % sources)); } });
+        stored[p] = fs.statSync(dbPath).size - size;
+
+        var bad = 0;
+        var getMs = elapsed(function ()
+        {
+            for (var r = 0; r < reads; ++r)
+            {
+                for (var i = 0; i < modules; ++i) { if (!readsBack(db, prefixes[p] + 'mod' + i, source(i % sources))) { ++bad; } }
+            }
+        });
+
+        console.log(prefixes[p] + ' keys: ' + modules + ' modules (' + sources + ' distinct sources), ' + stored[p] + ' bytes stored, put ' + putMs + ' ms, ' + (modules * reads) + ' gets ' + getMs + ' ms');
+        check(bad == 0, bad + ' module reads did not match their source');
+        check(db.Keys.length == modules, db.Keys.length + ' keys, expected only the ' + modules + ' module keys');
+        db = null;
+        _debugGC();
+    }
+    check(stored[1] < stored[0], '__MODULE: keys took ' + stored[1] + ' bytes, expected less than the ' + stored[0] + ' bytes of plain keys');
+}
+
+var benches = { keys: keysBench, checksum: checksumBench, writeback: writebackBench, modules: modulesBench };
+var selected = process.argv.length > 3 ? process.argv.slice(3) : Object.keys(benches);
+
+for (var i in selected)
+{
+    if (benches[selected[i]] == null) { console.log('Unknown bench: ' + selected[i]); ++failures; continue; }
+    console.log('== ' + selected[i]);
+    benches[selected[i]]();
+}
+cleanup();
+console.log(failures == 0 ? 'All checks passed' : (failures + ' checks FAILED'));
+process.exit(failures == 0 ? 0 : 1);
@@ -0,0 +1,175 @@
+/*
+Copyright 2022 Intel Corporation
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// datastore-contention-bench.c : Measures ILibSimpleDataStore gets from many threads.
+//
+// Each run is timed twice: with every get wrapped in ILibSimpleDataStore_Lock/UnLock (every reader waits for the others),
+// and with plain gets (readers share the store). Runs with a writer thread also report the slowest put.
+// Every value read is checked against its key, and the process exit code is non-zero if any read was wrong.
+//
+// Build (Linux, from the repository root):
+//   M=microstack; gcc -O2 -D_POSIX -DMICROSTACK_PROXY -I$M -I. test/datastore-contention-bench.c $M/ILibSimpleDataStore.c $M/ILibParsers.c
+//       $M/ILibCrypto.c $M/ILibAsyncSocket.c $M/ILibAsyncServerSocket.c $M/ILibAsyncUDPSocket.c $M/ILibWebClient.c $M/ILibWebServer.c
+//       $M/ILibWebRTC.c $M/ILibRemoteLogging.c -o datastore-contention-bench -lpthread -ldl -lssl -lcrypto -lz -lutil -lrt
+// Usage: datastore-contention-bench [path] [ms per run]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "ILibParsers.h"
+#include "ILibSimpleDataStore.h"
+
+#define BENCH_KEYS 10000
+#define BENCH_VALUE_SIZE 120
+#define BENCH_MAX_READERS 8
+
+// Compressed values live in microscript, this benchmark does not store any
+int ILibInflate(char *buffer, size_t bufferLen, char *decompressed, size_t *decompressedLen, uint32_t crc) { return(1); }
+int ILibDeflate(char *buffer, size_t bufferLen, char *compressed, size_t *compressedLen, uint32_t *crc) { return(1); }
+
+ILibSimpleDataStore bench_store;
+volatile int bench_stop;
+int bench_coarse;
+long bench_gets[BENCH_MAX_READERS];
+long bench_bad[BENCH_MAX_READERS];
+long bench_puts;
+double bench_maxPut;
+
+double bench_now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return(tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0);
+}
+
+// Values start with "k<index>-", so a reader can tell it got the value of the key it asked for
+void bench_value(char *value, int i, long version)
+{
+	int len;
+	memset(value, '-', BENCH_VALUE_SIZE);
+	len = sprintf(value, "k%d-v%ld", i, version);
+	value[len] = '-';
+}
+
+void* bench_reader(void *arg)
+{
+	long id = (long)arg, gets = 0, bad = 0;
+	unsigned int seed = (unsigned int)id * 7919 + 1;
+	char key[32], value[256], expected[32];
+	int i, len, expectedLen;
+
+	while (bench_stop == 0)
+	{
+		i = rand_r(&seed) % BENCH_KEYS;
+		sprintf(key, "key/%d", i);
+		if (bench_coarse != 0) { ILibSimpleDataStore_Lock(bench_store); }
+		len = ILibSimpleDataStore_GetEx(bench_store, key, (int)strnlen_s(key, sizeof(key)), value, sizeof(value));
+		if (bench_coarse != 0) { ILibSimpleDataStore_UnLock(bench_store); }
+		expectedLen = sprintf(expected, "k%d-", i);
+		if (len != BENCH_VALUE_SIZE || memcmp(value, expected, expectedLen) != 0) { ++bad; }
+		++gets;
+	}
+	bench_gets[id] = gets;
+	bench_bad[id] = bad;
+	return(NULL);
+}
+
+void* bench_writer(void *arg)
+{
+	unsigned int seed = 99;
+	char key[32], value[256];
+	double start, elapsed;
+	int i;
+
+	bench_puts = 0; bench_maxPut = 0;
+	while (bench_stop == 0)
+	{
+		i = rand_r(&seed) % BENCH_KEYS;
+		sprintf(key, "key/%d", i);
+		bench_value(value, i, bench_puts);
+		start = bench_now();
+		ILibSimpleDataStore_PutEx(bench_store, key, (int)strnlen_s(key, sizeof(key)), value, BENCH_VALUE_SIZE);
+		elapsed = bench_now() - start;
+		if (elapsed > bench_maxPut) { bench_maxPut = elapsed; }
+		++bench_puts;
+		usleep(100);
+	}
+	return(NULL);
+}
+
+long bench_run(int readers, int withWriter, int ms)
+{
+	pthread_t threads[BENCH_MAX_READERS], writer;
+	long gets = 0, bad = 0;
+	char label[32];
+	int i;
+
+	bench_stop = 0;
+	for (i = 0; i < readers; ++i) { pthread_create(&threads[i], NULL, bench_reader, (void*)(long)i); }
+	if (withWriter != 0) { pthread_create(&writer, NULL, bench_writer, NULL); }
+	usleep(ms * 1000);
+	bench_stop = 1;
+	for (i = 0; i < readers; ++i) { pthread_join(threads[i], NULL); gets += bench_gets[i]; bad += bench_bad[i]; }
+	if (withWriter != 0) { pthread_join(writer, NULL); }
+
+	sprintf_s(label, sizeof(label), "%d reader%s%s:", readers, readers == 1 ? "" : "s", withWriter != 0 ? " + writer" : "");
+	printf("   %-16s %-20s %10.0f gets/s", bench_coarse != 0 ? "Lock+Get+UnLock" : "Get", label, gets * 1000.0 / ms);
+	if (withWriter != 0) { printf(", %ld puts, slowest put %.2f ms", bench_puts, bench_maxPut); }
+	if (bad != 0) { printf(", %ld BAD READS", bad); }
+	printf("\n");
+	return(bad);
+}
+
+int main(int argc, char **argv)
+{
+	char *path = argc > 1 ? argv[1] : "contention-bench.db";
+	int ms = argc > 2 ? atoi(argv[2]) : 1000;
+	int readers[] = { 1, 2, 4, 8 };
+	char key[32], value[256], idx[1024];
+	long bad = 0;
+	int i, withWriter;
+
+	sprintf_s(idx, sizeof(idx), "%s.idx", path);
+	unlink(path); unlink(idx);
+	if ((bench_store = ILibSimpleDataStore_Create(path)) == NULL) { printf("Could not create %s\n", path); return(1); }
+
+	ILibSimpleDataStore_BatchBegin(bench_store);
+	for (i = 0; i < BENCH_KEYS; ++i)
+	{
+		sprintf(key, "key/%d", i);
+		bench_value(value, i, 0);
+		ILibSimpleDataStore_PutEx(bench_store, key, (int)strnlen_s(key, sizeof(key)), value, BENCH_VALUE_SIZE);
+	}
+	ILibSimpleDataStore_BatchCommit(bench_store);
+
+	printf("%d keys, %d byte values, %d ms per run, %ld CPUs\n", BENCH_KEYS, BENCH_VALUE_SIZE, ms, sysconf(_SC_NPROCESSORS_ONLN));
+	for (withWriter = 0; withWriter < 2; ++withWriter)
+	{
+		for (bench_coarse = 1; bench_coarse >= 0; --bench_coarse)
+		{
+			for (i = 0; i < (int)(sizeof(readers) / sizeof(readers[0])); ++i) { bad += bench_run(readers[i], withWriter, ms); }
+		}
+	}
+
+	ILibSimpleDataStore_Close(bench_store);
+	unlink(path); unlink(idx);
+	return(bad == 0 ? 0 : 1);
+}
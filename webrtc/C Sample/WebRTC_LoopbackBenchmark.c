@@ -0,0 +1,496 @@
+/*
+Copyright 2015 Intel Corporation
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// WebRTC_LoopbackBenchmark.c : Measures the ICE/DTLS/SCTP datapath without a browser.
+//
+// Two connection factories are created on one chain, and connected to each other over 127.0.0.1 by exchanging
+// generated offers directly. Data channels are then pumped from one side to the other, and the benchmark reports
+// throughput, per message latency percentiles and CPU time per MB. Simulated loss and delay are applied to inbound
+// SCTP packets on both sides, so this needs to be built with _WEBRTCDEBUG (see the bench-* targets in the makefile).
+//
+// The process exit code is non-zero if the run did not complete, or if throughput fell below the -q threshold,
+// so it can be used as a regression check.
+//
+
+#if defined(WIN32) && !defined(_WIN32_WCE)
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#define _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+
+#include "../../microstack/ILibParsers.h"
+#include "../../microstack/ILibAsyncSocket.h"
+#include "../../microstack/ILibWebRTC.h"
+#include "../../microstack/ILibWrapperWebRTC.h"
+
+#if defined(_POSIX)
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#if defined(WIN32) && !defined(snprintf) && _MSC_VER < 1900
+#define snprintf(dst, len, frm, ...) _snprintf_s(dst, len, _TRUNCATE, frm, __VA_ARGS__)
+#endif
+
+#ifndef _WEBRTCDEBUG
+#error WebRTC_LoopbackBenchmark requires _WEBRTCDEBUG, for the simulated loss/delay interfaces
+#endif
+
+#define BENCH_MAX_CHANNELS 16
+#define BENCH_HEADER_SIZE 16				// [channel:4][sequence:4][timestamp:8]
+#define BENCH_PROBE_SIZE 64
+#define BENCH_PROBE_CHANNEL 0xFFFFFFFF
+
+typedef struct Bench_Latency
+{
+	unsigned long long *samples;
+	int count;
+	int capacity;
+}Bench_Latency;
+
+typedef struct Bench_Settings
+{
+	int messageSize;
+	int messageCount;
+	int channelCount;
+	int window;								// Maximum messages in flight, 0 = Unlimited
+	int lossPercentage;
+	int delayMilliseconds;
+	int timeoutSeconds;
+	int probe;								// Non-zero to measure the latency of a small message stream, sent alongside the bulk channels
+	unsigned short port;
+	ILibSCTP_CongestionControl congestionControl;
+	int pacing;
+	double minimumMBps;
+}Bench_Settings;
+
+void* chain;
+Bench_Settings settings;
+
+ILibWrapper_WebRTC_ConnectionFactory senderFactory, receiverFactory;
+ILibWrapper_WebRTC_Connection senderConnection, receiverConnection;
+ILibWrapper_WebRTC_DataChannel *senderChannels[BENCH_MAX_CHANNELS];
+ILibWrapper_WebRTC_DataChannel *probeChannel = NULL;
+int senderChannelsAcked = 0;
+
+char *messageBuffer = NULL;
+int messagesSent = 0, messagesReceived = 0, probesSent = 0;
+unsigned int nextSequence[BENCH_MAX_CHANNELS], expectedSequence[BENCH_MAX_CHANNELS];
+int senderBlocked = 0;
+int probeOutstanding = 0;
+int benchmarkFailed = 0, benchmarkDone = 0;
+long long bytesReceived = 0;
+
+unsigned long long startTime = 0, endTime;
+double startCPU, endCPU;
+Bench_Latency bulkLatency, probeLatency;
+
+// Monotonic clock, in microseconds
+unsigned long long Bench_Now()
+{
+#if defined(WIN32)
+	LARGE_INTEGER f, c;
+	QueryPerformanceFrequency(&f);
+	QueryPerformanceCounter(&c);
+	return((unsigned long long)(c.QuadPart / f.QuadPart) * 1000000 + (unsigned long long)((c.QuadPart % f.QuadPart) * 1000000 / f.QuadPart));
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return((unsigned long long)t.tv_sec * 1000000 + (unsigned long long)(t.tv_nsec / 1000));
+#endif
+}
+
+// User + System CPU time consumed by this process, in seconds
+double Bench_CPU()
+{
+#if defined(WIN32)
+	FILETIME c, e, k, u;
+	ULARGE_INTEGER kt, ut;
+	GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u);
+	kt.LowPart = k.dwLowDateTime; kt.HighPart = k.dwHighDateTime;
+	ut.LowPart = u.dwLowDateTime; ut.HighPart = u.dwHighDateTime;
+	return((double)(kt.QuadPart + ut.QuadPart) / 10000000.0);
+#else
+	struct rusage r;
+	getrusage(RUSAGE_SELF, &r);
+	return((double)(r.ru_utime.tv_sec + r.ru_stime.tv_sec) + (double)(r.ru_utime.tv_usec + r.ru_stime.tv_usec) / 1000000.0);
+#endif
+}
+
+void Bench_Latency_Add(Bench_Latency *l, unsigned long long value)
+{
+	if (l->count == l->capacity)
+	{
+		l->capacity = l->capacity == 0 ? 1024 : l->capacity * 2;
+		if ((l->samples = (unsigned long long*)realloc(l->samples, l->capacity * sizeof(unsigned long long))) == NULL) { ILIBCRITICALEXIT(254); }
+	}
+	l->samples[l->count++] = value;
+}
+int Bench_Latency_Compare(const void *a, const void *b)
+{
+	unsigned long long x = *((unsigned long long*)a), y = *((unsigned long long*)b);
+	return(x < y ? -1 : (x > y ? 1 : 0));
+}
+unsigned long long Bench_Latency_Percentile(Bench_Latency *l, double p)
+{
+	int i = (int)(p * (double)(l->count - 1) + 0.5);
+	return(l->samples[i]);
+}
+void Bench_Latency_Print(char *name, Bench_Latency *l)
+{
+	if (l->count == 0) { printf("  %s latency: no samples\r\n", name); return; }
+	qsort(l->samples, l->count, sizeof(unsigned long long), Bench_Latency_Compare);
+	printf("  %s latency (us, %d samples): p50 = %llu, p90 = %llu, p99 = %llu, p99.9 = %llu, max = %llu\r\n", name, l->count,
+		Bench_Latency_Percentile(l, 0.50), Bench_Latency_Percentile(l, 0.90), Bench_Latency_Percentile(l, 0.99), Bench_Latency_Percentile(l, 0.999), l->samples[l->count - 1]);
+}
+
+void Bench_Finish(int failed)
+{
+	double seconds, cpu, mb;
+
+	if (benchmarkDone != 0) { return; }
+	benchmarkDone = 1;
+	benchmarkFailed = failed;
+	endTime = Bench_Now();
+	endCPU = Bench_CPU();
+
+	seconds = startTime == 0 ? 0 : (double)(endTime - startTime) / 1000000.0;
+	cpu = startTime == 0 ? 0 : endCPU - startCPU;
+	mb = (double)bytesReceived / (1024.0 * 1024.0);
+
+	printf("\r\n%s: %d/%d messages of %d bytes on %d channel(s), loss = %d%%, delay = %d ms, cc = %s%s\r\n", failed == 0 ? "COMPLETE" : "INCOMPLETE",
+		messagesReceived, settings.messageCount, settings.messageSize, settings.channelCount, settings.lossPercentage, settings.delayMilliseconds,
+		settings.congestionControl == ILibSCTP_CongestionControl_DELAY ? "delay" : "reno", settings.pacing != 0 ? "+pacing" : "");
+	if (seconds > 0)
+	{
+		printf("  Throughput: %.2f MB/s, %.0f messages/s over %.3f seconds\r\n", mb / seconds, (double)messagesReceived / seconds, seconds);
+	}
+	if (mb > 0 && cpu > 0)
+	{
+		printf("  CPU: %.3f seconds, %.2f ms per MB, %.2f MB/s per core\r\n", cpu, cpu * 1000.0 / mb, mb / cpu);
+	}
+	Bench_Latency_Print("Message", &bulkLatency);
+	if (settings.probe != 0) { Bench_Latency_Print("Probe", &probeLatency); }
+
+	if (failed == 0 && settings.minimumMBps > 0 && (seconds <= 0 || mb / seconds < settings.minimumMBps))
+	{
+		printf("  FAILED: Throughput is below the minimum of %.2f MB/s\r\n", settings.minimumMBps);
+		benchmarkFailed = 1;
+	}
+	ILibStopChain(chain);
+}
+
+void Bench_Stamp(char *buffer, unsigned int channel, unsigned int sequence)
+{
+	unsigned long long now = Bench_Now();
+	((unsigned int*)buffer)[0] = channel;
+	((unsigned int*)buffer)[1] = sequence;
+	memcpy_s(buffer + 8, 8, &now, 8);
+}
+
+void Bench_SendProbe()
+{
+	ILibTransport_DoneState r;
+	if (probeChannel == NULL || probeOutstanding != 0 || benchmarkDone != 0 || messagesSent >= settings.messageCount) { return; }
+
+	Bench_Stamp(messageBuffer, BENCH_PROBE_CHANNEL, (unsigned int)probesSent++);
+	probeOutstanding = 1;
+	if ((r = ILibWrapper_WebRTC_DataChannel_Send(probeChannel, messageBuffer, BENCH_PROBE_SIZE)) == ILibTransport_DoneState_ERROR) { Bench_Finish(1); }
+	else if (r == ILibTransport_DoneState_INCOMPLETE) { senderBlocked = 1; }
+}
+
+// Sends bulk messages round robin across the channels, until SCTP pushes back, the window is full, or all messages are sent
+void Bench_Pump()
+{
+	ILibTransport_DoneState r;
+	int channel;
+
+	while (benchmarkDone == 0 && senderBlocked == 0 && messagesSent < settings.messageCount && (settings.window == 0 || messagesSent - messagesReceived < settings.window))
+	{
+		channel = messagesSent % settings.channelCount;
+		Bench_Stamp(messageBuffer, (unsigned int)channel, nextSequence[channel]++);
+		++messagesSent;
+
+		if ((r = ILibWrapper_WebRTC_DataChannel_Send(senderChannels[channel], messageBuffer, settings.messageSize)) == ILibTransport_DoneState_ERROR) { Bench_Finish(1); return; }
+		if (r == ILibTransport_DoneState_INCOMPLETE) { senderBlocked = 1; }
+	}
+}
+
+void Bench_OnReceiverData(ILibWrapper_WebRTC_DataChannel *dataChannel, char* buffer, int bufferLen)
+{
+	unsigned long long now = Bench_Now(), stamp;
+	unsigned int channel, sequence;
+
+	UNREFERENCED_PARAMETER(dataChannel);
+	if (bufferLen < BENCH_HEADER_SIZE) { printf("Received a truncated message (%d bytes)\r\n", bufferLen); Bench_Finish(1); return; }
+
+	channel = ((unsigned int*)buffer)[0];
+	sequence = ((unsigned int*)buffer)[1];
+	memcpy_s(&stamp, 8, buffer + 8, 8);
+
+	if (channel == BENCH_PROBE_CHANNEL)
+	{
+		Bench_Latency_Add(&probeLatency, now - stamp);
+		probeOutstanding = 0;
+		Bench_SendProbe();
+		return;
+	}
+
+	if (channel >= (unsigned int)settings.channelCount || bufferLen != settings.messageSize) { printf("Received a corrupt message\r\n"); Bench_Finish(1); return; }
+	if (sequence != expectedSequence[channel]++) { printf("Received message %u on channel %u out of order\r\n", sequence, channel); Bench_Finish(1); return; }
+
+	Bench_Latency_Add(&bulkLatency, now - stamp);
+	bytesReceived += bufferLen;
+	if (++messagesReceived == settings.messageCount) { Bench_Finish(0); return; }
+	if (settings.window != 0) { Bench_Pump(); }
+}
+
+void Bench_OnSenderSendOK(ILibWrapper_WebRTC_Connection connection)
+{
+	UNREFERENCED_PARAMETER(connection);
+	senderBlocked = 0;
+	Bench_Pump();
+	Bench_SendProbe();
+}
+
+void Bench_Start()
+{
+	void *dtls = ILibWrapper_WebRTC_Connection2DtlsSession(senderConnection);
+
+	ILibSCTP_SetCongestionControl(dtls, settings.congestionControl, settings.pacing);
+	if (probeChannel != NULL)
+	{
+		// Let the probe stream go ahead of the bulk streams, when the peer supports interleaving
+		ILibSCTP_SetStreamScheduler(dtls, ILibSCTP_StreamScheduler_WEIGHTED);
+		ILibSCTP_SetStreamPriority(dtls, probeChannel->streamId, 255);
+	}
+
+	printf("Data Channels established, sending %d messages...\r\n", settings.messageCount);
+	startTime = Bench_Now();
+	startCPU = Bench_CPU();
+	Bench_Pump();
+	Bench_SendProbe();
+}
+
+void Bench_OnSenderChannelAck(ILibWrapper_WebRTC_DataChannel *dataChannel)
+{
+	UNREFERENCED_PARAMETER(dataChannel);
+	if (++senderChannelsAcked == settings.channelCount + (settings.probe != 0 ? 1 : 0)) { Bench_Start(); }
+}
+
+void Bench_OnSenderConnection(ILibWrapper_WebRTC_Connection connection, int connected)
+{
+	char name[32];
+	int i, len;
+
+	if (connected == 0)
+	{
+		if (benchmarkDone == 0) { printf("Sender was disconnected\r\n"); Bench_Finish(1); }
+		return;
+	}
+
+	printf("Sender connected [%s]\r\n", ILibWrapper_WebRTC_Connection_DoesPeerSupportUnreliableMode(connection) == 0 ? "RELIABLE Only" : "UNRELIABLE Supported");
+	for (i = 0; i < settings.channelCount; ++i)
+	{
+		len = snprintf(name, sizeof(name), "bench%d", i);
+		senderChannels[i] = ILibWrapper_WebRTC_DataChannel_Create(connection, name, len, &Bench_OnSenderChannelAck);
+	}
+	if (settings.probe != 0)
+	{
+		probeChannel = ILibWrapper_WebRTC_DataChannel_Create(connection, "probe", 5, &Bench_OnSenderChannelAck);
+	}
+}
+
+void Bench_OnReceiverConnection(ILibWrapper_WebRTC_Connection connection, int connected)
+{
+	UNREFERENCED_PARAMETER(connection);
+	if (connected == 0 && benchmarkDone == 0) { printf("Receiver was disconnected\r\n"); Bench_Finish(1); }
+}
+
+void Bench_OnReceiverChannel(ILibWrapper_WebRTC_Connection connection, ILibWrapper_WebRTC_DataChannel *dataChannel)
+{
+	UNREFERENCED_PARAMETER(connection);
+	dataChannel->Header.DataChannelCallbacks.OnBinaryData = (ILibWrapper_WebRTC_DataChannel_OnData)&Bench_OnReceiverData;
+
+	// The microstack only ACKs a DATA_CHANNEL_OPEN from a browser, so ACK the sender's channels here
+	ILibWrapper_WebRTC_DataChannel_SendEx(dataChannel, "\x02", 1, 50);
+}
+
+void Bench_OnIgnoredChannel(ILibWrapper_WebRTC_Connection connection, ILibWrapper_WebRTC_DataChannel *dataChannel)
+{
+	UNREFERENCED_PARAMETER(connection);
+	UNREFERENCED_PARAMETER(dataChannel);
+}
+
+void Bench_OnIgnoredSendOK(ILibWrapper_WebRTC_Connection connection)
+{
+	UNREFERENCED_PARAMETER(connection);
+}
+
+void Bench_OnTimeout(void *object)
+{
+	UNREFERENCED_PARAMETER(object);
+	printf("Timed out after %d seconds\r\n", settings.timeoutSeconds);
+	Bench_Finish(1);
+}
+
+// Replaces the candidates in an SDP offer with a single host candidate on 127.0.0.1, so the two sides always connect over loopback
+char* Bench_LoopbackSDP(char *sdp, unsigned short port)
+{
+	char candidate[64];
+	char *retVal;
+	int sdpLen = (int)strlen(sdp), retValLen = 0, retValSize, candidateLen;
+	struct parser_result *pr;
+	struct parser_result_field *f;
+
+	candidateLen = snprintf(candidate, sizeof(candidate), "a=candidate:1 1 UDP 2130706431 127.0.0.1 %u typ host\r\n", port);
+	retValSize = sdpLen + 2 + candidateLen + 1;
+	if ((retVal = (char*)malloc(retValSize)) == NULL) { ILIBCRITICALEXIT(254); }
+
+	pr = ILibParseString(sdp, 0, sdpLen, "\r\n", 2);
+	f = pr->FirstResult;
+	while (f != NULL)
+	{
+		if (f->datalength > 0 && !(f->datalength > 12 && strncmp(f->data, "a=candidate:", 12) == 0))
+		{
+			memcpy_s(retVal + retValLen, retValSize - retValLen, f->data, f->datalength);
+			retValLen += f->datalength;
+			memcpy_s(retVal + retValLen, retValSize - retValLen, "\r\n", 2);
+			retValLen += 2;
+		}
+		f = f->NextResult;
+	}
+	ILibDestructParserResults(pr);
+
+	memcpy_s(retVal + retValLen, retValSize - retValLen, candidate, candidateLen + 1);
+	return(retVal);
+}
+
+void Bench_Usage()
+{
+	printf("Usage: webrtc_bench [options]\r\n");
+	printf("  -s <bytes>     Message size (default 1024, minimum %d)\r\n", BENCH_HEADER_SIZE);
+	printf("  -n <count>     Number of messages (default 100000)\r\n");
+	printf("  -c <channels>  Number of data channels to send on, round robin (default 1, max %d)\r\n", BENCH_MAX_CHANNELS);
+	printf("  -w <messages>  Maximum messages in flight, 0 = unlimited (default 0). Use 1 for ping-pong latency\r\n");
+	printf("  -l <percent>   Simulated inbound packet loss, on both sides (default 0)\r\n");
+	printf("  -d <ms>        Simulated inbound delay, on both sides (default 0)\r\n");
+	printf("  -a <algorithm> Congestion control: reno, delay (default reno)\r\n");
+	printf("  -P             Enable send pacing\r\n");
+	printf("  -i             Also send %d byte probes on a separate channel, to measure latency behind bulk data\r\n", BENCH_PROBE_SIZE);
+	printf("  -p <port>      Local UDP port for the sender, the receiver uses port + 1 (default 5360)\r\n");
+	printf("  -t <seconds>   Give up after this long (default 60)\r\n");
+	printf("  -q <MB/s>      Exit with an error if throughput is below this value\r\n");
+}
+
+#if defined(WIN32)
+int main(int argc, char* argv[])
+#else
+int main(int argc, char **argv)
+#endif
+{
+	char *offer, *answer, *sdp;
+	int i;
+
+#if defined(WIN32)
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#elif defined(_POSIX)
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	memset(&settings, 0, sizeof(settings));
+	settings.messageSize = 1024;
+	settings.messageCount = 100000;
+	settings.channelCount = 1;
+	settings.timeoutSeconds = 60;
+	settings.port = 5360;
+	settings.congestionControl = ILibSCTP_CongestionControl_RENO;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-P") == 0) { settings.pacing = 1; continue; }
+		if (strcmp(argv[i], "-i") == 0) { settings.probe = 1; continue; }
+		if (i + 1 >= argc || strlen(argv[i]) != 2 || argv[i][0] != '-') { Bench_Usage(); return(1); }
+		switch (argv[i][1])
+		{
+			case 's': settings.messageSize = atoi(argv[++i]); break;
+			case 'n': settings.messageCount = atoi(argv[++i]); break;
+			case 'c': settings.channelCount = atoi(argv[++i]); break;
+			case 'w': settings.window = atoi(argv[++i]); break;
+			case 'l': settings.lossPercentage = atoi(argv[++i]); break;
+			case 'd': settings.delayMilliseconds = atoi(argv[++i]); break;
+			case 'p': settings.port = (unsigned short)atoi(argv[++i]); break;
+			case 't': settings.timeoutSeconds = atoi(argv[++i]); break;
+			case 'q': settings.minimumMBps = atof(argv[++i]); break;
+			case 'a':
+				++i;
+				if (strcmp(argv[i], "delay") == 0) { settings.congestionControl = ILibSCTP_CongestionControl_DELAY; }
+				else if (strcmp(argv[i], "reno") != 0) { Bench_Usage(); return(1); }
+				break;
+			default: Bench_Usage(); return(1);
+		}
+	}
+	if (settings.messageSize < BENCH_HEADER_SIZE || settings.messageCount <= 0 || settings.channelCount <= 0 || settings.channelCount > BENCH_MAX_CHANNELS || settings.window < 0)
+	{
+		Bench_Usage();
+		return(1);
+	}
+
+	if ((messageBuffer = (char*)malloc(settings.messageSize > BENCH_PROBE_SIZE ? settings.messageSize : BENCH_PROBE_SIZE)) == NULL) { ILIBCRITICALEXIT(254); }
+	memset(messageBuffer, 0x55, settings.messageSize > BENCH_PROBE_SIZE ? settings.messageSize : BENCH_PROBE_SIZE);
+	memset(nextSequence, 0, sizeof(nextSequence));
+	memset(expectedSequence, 0, sizeof(expectedSequence));
+	memset(&bulkLatency, 0, sizeof(bulkLatency));
+	memset(&probeLatency, 0, sizeof(probeLatency));
+
+	chain = ILibCreateChain();
+	senderFactory = ILibWrapper_WebRTC_ConnectionFactory_CreateConnectionFactory(chain, settings.port);
+	receiverFactory = ILibWrapper_WebRTC_ConnectionFactory_CreateConnectionFactory(chain, settings.port + 1);
+	ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedLossPercentage(senderFactory, settings.lossPercentage);
+	ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedLossPercentage(receiverFactory, settings.lossPercentage);
+	ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedDelay(senderFactory, settings.delayMilliseconds);
+	ILibWrapper_WebRTC_ConnectionFactory_SetSimulatedDelay(receiverFactory, settings.delayMilliseconds);
+
+	senderConnection = ILibWrapper_WebRTC_ConnectionFactory_CreateConnection(senderFactory, &Bench_OnSenderConnection, &Bench_OnIgnoredChannel, &Bench_OnSenderSendOK);
+	receiverConnection = ILibWrapper_WebRTC_ConnectionFactory_CreateConnection(receiverFactory, &Bench_OnReceiverConnection, &Bench_OnReceiverChannel, &Bench_OnIgnoredSendOK);
+
+	// Exchange the offers directly, instead of through a rendezvous server
+	offer = ILibWrapper_WebRTC_Connection_GenerateOffer(senderConnection, NULL);
+	sdp = Bench_LoopbackSDP(offer, settings.port);
+	answer = ILibWrapper_WebRTC_Connection_SetOffer(receiverConnection, sdp, (int)strlen(sdp), NULL);
+	free(offer);
+	free(sdp);
+
+	sdp = Bench_LoopbackSDP(answer, settings.port + 1);
+	free(ILibWrapper_WebRTC_Connection_SetOffer(senderConnection, sdp, (int)strlen(sdp), NULL));
+	free(answer);
+	free(sdp);
+
+	ILibLifeTime_Add(ILibGetBaseTimer(chain), &settings, settings.timeoutSeconds, &Bench_OnTimeout, NULL);
+
+	printf("Connecting over 127.0.0.1:%u <-> 127.0.0.1:%u...\r\n", settings.port, settings.port + 1);
+	ILibStartChain(chain); // This will block until the benchmark completes, or times out
+
+	free(messageBuffer);
+	free(bulkLatency.samples);
+	free(probeLatency.samples);
+#if defined(WIN32)
+	_CrtDumpMemoryLeaks();
+#endif
+	return(benchmarkFailed != 0 || benchmarkDone == 0 ? 1 : 0);
+}